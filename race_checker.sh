@@ -37,4 +37,10 @@ tool_path=/home/yiranyaoqiu/RaceChecker
 # -partial_instrument 1 -static_profile $tool_path/static_profile/static_profile_water.out \
 # -instrumented_lines $tool_path/static_profile/instrumented_lines_water.out \
 # -ignore_lib 1 -enable_debug 0 -debug_pthread 1 -debug_mem 1 -debug_main 1 \
-# -debug_pthread 1 -debug_malloc 1 -- ~/splash2_origin/codes/apps/water-nsquared/WATER-NSQUARED < ~/splash2_origin/codes/apps/water-nsquared/input
\ No newline at end of file
+# -debug_pthread 1 -debug_malloc 1 -- ~/splash2_origin/codes/apps/water-nsquared/WATER-NSQUARED < ~/splash2_origin/codes/apps/water-nsquared/input
+
+# offline detection, record the trace once and detect the races from it
+# /home/yiranyaoqiu/pin/pin -t $tool_path/build-debug/tracer_profiler.so \
+# -enable_recorder 1 -trace_log_path trace-log -ignore_lib 1 -- test/verify/verifier19
+# $tool_path/build-debug/race_replayer --trace_log_path=trace-log \
+# --enable_fast_track=1 --track_racy_inst=1
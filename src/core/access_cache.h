@@ -0,0 +1,68 @@
+#ifndef __CORE_ACCESS_CACHE_H
+#define __CORE_ACCESS_CACHE_H
+
+/**
+ * Per-thread cache of recently analyzed memory accesses.
+ *
+ * A direct-mapped table indexed by address. An entry remembers the
+ * instruction, address, size and kind of an access together with the epoch
+ * it was seen in. The epoch is a per-thread counter bumped at the sync
+ * events of the thread plus a global generation that is bumped whenever
+ * memory is released or a thread starts. A repeat of the same access in
+ * the same epoch is dropped, which is only safe when every analyzer
+ * ignores such repeats on its own, see Analyzer::CachedAccess. Lockset and
+ * state machine detectors do not, other threads may change the state of
+ * the unit between the two accesses.
+ * Entries of older epochs are simply treated as misses, the table is never
+ * flushed. Only the owner thread touches its cache.
+ */
+
+#include <cstring>
+#include "core/basictypes.h"
+#include "core/static_info.h"
+
+#define ACCESS_CACHE_BITS 8
+#define ACCESS_CACHE_SIZE (1<<ACCESS_CACHE_BITS)
+
+class AccessCache {
+public:
+	AccessCache() { memset(entries_,0,sizeof(entries_)); }
+	~AccessCache() {}
+
+	//return true if the access is a repeat in this epoch, otherwise it is
+	//remembered
+	bool Hit(Inst *inst,address_t addr,size_t size,bool is_write,
+		uint64 epoch,uint32 gen) {
+		Entry &entry=entries_[Index(addr)];
+		uint32 info=((uint32)size<<1) | (is_write?1:0);
+		if(entry.addr==addr && entry.inst==inst && entry.info==info &&
+			entry.epoch==epoch && entry.gen==gen)
+			return true;
+		entry.addr=addr;
+		entry.inst=inst;
+		entry.info=info;
+		entry.epoch=epoch;
+		entry.gen=gen;
+		return false;
+	}
+
+private:
+	struct Entry {
+		address_t addr;
+		Inst *inst;
+		uint64 epoch;
+		uint32 gen;
+		uint32 info; //size and access kind
+	};
+
+	static size_t Index(address_t addr) {
+		return (size_t)((addr>>2)^(addr>>(ACCESS_CACHE_BITS+2))) &
+			(ACCESS_CACHE_SIZE-1);
+	}
+
+	Entry entries_[ACCESS_CACHE_SIZE];
+
+	DISALLOW_COPY_CONSTRUCTORS(AccessCache);
+};
+
+#endif /* __CORE_ACCESS_CACHE_H */
@@ -169,6 +169,10 @@ public:
   		Inst *inst,address_t addr) { semaphore_count_++; }
 
   	virtual void SaveStatistics(const char *file_name) {}
+  	//whether a memory access repeated by the same thread with the same
+  	//inst, address, size and kind since the last sync event of the thread
+  	//is a no-op for the analyzer, so that the access cache may drop it
+  	virtual bool CachedAccess() { return false; }
 	
 	Descriptor *desc() { return &desc_; }
 	void setCallStackInfo (CallStackInfo *info) { callStackInfo=info; }
@@ -47,6 +47,8 @@
 #define ATOMIC_VAL_COMPARE_AND_SWAP(ptr,oldval,newval) \
     __sync_val_compare_and_swap((ptr), (oldval), (newval))
 
-
+// Full memory barrier, orders the initialization of an object before the
+// store that publishes it.
+#define MEMORY_BARRIER() __sync_synchronize()
 
 #endif
\ No newline at end of file
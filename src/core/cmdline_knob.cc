@@ -1,4 +1,6 @@
 #include "core/cmdline_knob.h"
+#include <cstdlib>
+#include <getopt.h>
 #include "core/log.h"
 
 CmdlineKnob::CmdlineKnob()
@@ -8,7 +10,12 @@ CmdlineKnob::~CmdlineKnob()
 {
 	for(KnobNameMap::iterator iter=knob_table_.begin();
 		iter!=knob_table_.end();iter++) {
-		delete iter->second.second;
+		if(iter->second.first==KNOB_TYPE_BOOL)
+			delete (bool *)iter->second.second;
+		else if(iter->second.first==KNOB_TYPE_INT)
+			delete (int *)iter->second.second;
+		else
+			delete (std::string *)iter->second.second;
 	}
 }
 
@@ -44,14 +51,12 @@ void CmdlineKnob::Parse(int argc,char *argv[])
 	for(KnobNameMap::iterator iter=knob_table_.begin();
 		iter!=knob_table_.end();++iter,++idx) {
 		long_options[idx].name=iter->first.c_str();
-		long_options[idx].has_arg=optional_argument;
+		long_options[idx].has_arg=required_argument;
 		long_options[idx].flag=NULL;
-		// short option name-char
-		long_options[idx].val='a'+idx;
-		// concate the shot options 
-		optstring.append(1,(char)long_options[idx].val);
-		optstring.append(":");
-		opt_map[long_options[idx].value]=&iter->second;
+		// long options only, the values are out of the char range so that
+		// the knobs never run out of short option names
+		long_options[idx].val=256+idx;
+		opt_map[long_options[idx].val]=&iter->second;
 	}
 	long_options[idx].name=NULL;
 	long_options[idx].has_arg=0;
@@ -71,8 +76,10 @@ void CmdlineKnob::Parse(int argc,char *argv[])
 			&option_index);
 		if(c==-1)
 			break;
+		// unknown option, getopt has reported it
+		if(opt_map.find(c)==opt_map.end())
+			continue;
 		TypedKnob *knob=opt_map[c];
-		DEBUG_ASSERT(knob);
 
 		if(knob->first==KNOB_TYPE_BOOL)
 			*((bool *)knob->second)=atoi(optarg)?true:false;
@@ -115,7 +122,7 @@ void CmdlineKnob::RegisterStr(const std::string &name,const std::string &desc,
 {
 	if(Exist(name))
 		return ;
-	std::string *value=new std::string(value);
+	std::string *value=new std::string(val);
 	knob_table_[name]=TypedKnob(KNOB_TYPE_STR,value);
 }
 
@@ -137,5 +144,5 @@ std::string CmdlineKnob::ValueStr(const std::string &name)
 {
 	KnobNameMap::iterator iter=knob_table_.find(name);
 	DEBUG_ASSERT(iter!=knob_table_.end() && iter->second.first==KNOB_TYPE_STR);
-	return *((bool *)iter->second.second);
+	return *((std::string *)iter->second.second);
 }
\ No newline at end of file
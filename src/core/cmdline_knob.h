@@ -19,7 +19,7 @@ public:
 		const std::string &val);
 	void RegisterInt(const std::string &name,const std::string &desc,
 		const std::string &val);
-	void RegisterStr(const std::sting &name,const std::string &desc,
+	void RegisterStr(const std::string &name,const std::string &desc,
 		const std::string &val);
 	bool ValueBool(const std::string &name);
 	int ValueInt(const std::string &name);
@@ -0,0 +1,243 @@
+#include "core/detection_queue.h"
+#include <cstring>
+#include <ctime>
+#include <sched.h>
+#include "core/log.h"
+
+//wait on the semaphore for at most timeout ms
+static void TimedWait(Semaphore *sem,uint32 timeout)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME,&ts);
+	ts.tv_nsec+=(long)timeout*1000000;
+	ts.tv_sec+=ts.tv_nsec/1000000000;
+	ts.tv_nsec%=1000000000;
+	sem->TimedWait(&ts);
+}
+
+DetectionQueue::DetectionQueue(EventLog *log,Partitioner *partitioner,
+	uint32 reader,uint32 spin,uint32 max_rings,Semaphore *ready_sem)
+	:ring_num_(0),max_rings_(max_rings),cursor_(0),log_(log),
+	partitioner_(partitioner),reader_(reader),spin_(spin),ready_sem_(ready_sem),
+	sleeping_(0),closed_(false),attached_(true)
+{
+	rings_=new EventRing *[max_rings];
+	space_sems_=new Semaphore *[max_rings];
+	space_waiting_=new uint32[max_rings];
+	memset(rings_,0,sizeof(EventRing *)*max_rings);
+	memset(space_sems_,0,sizeof(Semaphore *)*max_rings);
+	memset((void *)space_waiting_,0,sizeof(uint32)*max_rings);
+}
+
+DetectionQueue::~DetectionQueue()
+{
+	for(uint32 i=0;i<ring_num_;i++) {
+		delete rings_[i];
+		delete space_sems_[i];
+	}
+	delete [] rings_;
+	delete [] space_sems_;
+	delete [] space_waiting_;
+	delete ready_sem_;
+}
+
+//rings are indexed by the thread id, a thread reusing the id of an exited
+//thread appends to its ring. the producers attach their rings one at a
+//time.
+void DetectionQueue::AttachRing(uint32 tid,Semaphore *space_sem)
+{
+	DEBUG_ASSERT(tid<max_rings_);
+	if(rings_[tid]) {
+		delete space_sem;
+		return ;
+	}
+	space_sems_[tid]=space_sem;
+	rings_[tid]=new EventRing;
+	MEMORY_BARRIER();
+	if(tid>=ring_num_)
+		ring_num_=tid+1;
+}
+
+//only the owner thread of the ring flushes
+void DetectionQueue::Flush(uint32 tid,EventBuffer *buff)
+{
+	EventRing *ring=rings_[tid];
+	while(!buff->Empty()) {
+		//nobody takes the events anymore
+		if(!attached_) {
+			buff->Pop();
+			continue;
+		}
+		if(ring->Space()==0) {
+			//let the consumer see the staged part while waiting
+			ring->Publish();
+			Notify();
+			WaitSpace(tid);
+			continue;
+		}
+		ring->Stage(buff->Front());
+		buff->Pop();
+	}
+	ring->Publish();
+	Notify();
+}
+
+//block the producer until the consumer frees a slot of its ring or leaves
+void DetectionQueue::WaitSpace(uint32 tid)
+{
+	EventRing *ring=rings_[tid];
+	for(uint32 i=0;i<spin_;i++) {
+		if(ring->Space()>0 || !attached_)
+			return ;
+		sched_yield();
+	}
+	Semaphore *sem=space_sems_[tid];
+	while(attached_ && ring->Space()==0) {
+		space_waiting_[tid]=1;
+		MEMORY_BARRIER();
+		if(attached_ && ring->Space()==0)
+			TimedWait(sem,DETECTION_WAIT_TIMEOUT);
+	}
+	space_waiting_[tid]=0;
+}
+
+//the number of events published so far
+uint64 DetectionQueue::Progress()
+{
+	uint64 progress=log_->Tail();
+	uint32 num=ring_num_;
+	for(uint32 i=0;i<num;i++)
+		if(rings_[i])
+			progress+=rings_[i]->Published();
+	return progress;
+}
+
+//called by the detection thread when nothing can be popped. a pop fails
+//only if nothing has been published since, so wait for the progress.
+void DetectionQueue::Wait()
+{
+	uint64 progress=Progress();
+	for(uint32 i=0;i<spin_;i++) {
+		if(closed_ || Progress()!=progress)
+			return ;
+		sched_yield();
+	}
+	sleeping_=1;
+	MEMORY_BARRIER();
+	if(!closed_ && Progress()==progress)
+		TimedWait(ready_sem_,DETECTION_WAIT_TIMEOUT);
+	sleeping_=0;
+}
+
+//called by the detection thread once it stops consuming. the logged
+//events are released for it from now on, the partition plans do not wait
+//for it, and the producers waiting for space in its rings are woken up.
+void DetectionQueue::Detach()
+{
+	attached_=false;
+	MEMORY_BARRIER();
+	partitioner_->Detach(reader_);
+	log_->Detach(reader_);
+	uint32 num=ring_num_;
+	for(uint32 i=0;i<num;i++) {
+		if(space_waiting_[i]) {
+			space_waiting_[i]=0;
+			space_sems_[i]->Post();
+		}
+	}
+}
+
+//only the detection thread pops. the producer flushes its rings before
+//logging an event, so the memory events preceding a logged event are
+//already in the ring when the event is seen. a partition change is a cut
+//of all the rings.
+bool DetectionQueue::Pop(EventRecord *rec)
+{
+	return PopLogged(rec) || PopMemory(rec,1)==1;
+}
+
+size_t DetectionQueue::PopBatch(EventRecord *recs,size_t max)
+{
+	size_t num=0;
+	while(num<max) {
+		if(PopLogged(&recs[num])) {
+			num++;
+			continue;
+		}
+		size_t taken=PopMemory(&recs[num],max-num);
+		if(taken==0)
+			break;
+		num+=taken;
+	}
+	return num;
+}
+
+//take the next logged event once no earlier memory event is left
+bool DetectionQueue::PopLogged(EventRecord *rec)
+{
+	uint64 next=log_->Next(reader_);
+	EventLogEntry *entry=log_->Front(reader_);
+	if(!entry)
+		return false;
+	bool ready=true;
+	if(entry->id==PARTITION_MIGRATE) {
+		for(uint32 i=0;i<ring_num_ && ready;i++) {
+			EventRecord *front=rings_[i]?rings_[i]->Front():NULL;
+			ready=!front || front->seq>=next;
+		}
+	}
+	else if(entry->ring!=EVENT_LOG_NO_RING) {
+		EventRecord *front=rings_[entry->ring]->Front();
+		ready=!front || front->seq>=next;
+	}
+	if(!ready)
+		return false;
+	rec->id=entry->id;
+	rec->seq=next;
+	rec->event=entry->event;
+	log_->Pop(reader_);
+	return true;
+}
+
+//take the run of memory events of one ring preceding the next logged
+//event, the ring slots are released at once
+size_t DetectionQueue::PopMemory(EventRecord *recs,size_t max)
+{
+	uint64 next=log_->Next(reader_);
+	uint32 num=ring_num_;
+	for(uint32 i=0;i<num;i++) {
+		uint32 idx=(cursor_+i)%num;
+		EventRing *ring=rings_[idx];
+		if(!ring)
+			continue;
+		uint64 ready=ring->Ready();
+		size_t taken=0;
+		while(taken<max && taken<ready) {
+			EventRecord *rec=ring->At(taken);
+			if(rec->seq>=next)
+				break;
+			recs[taken]=*rec;
+			partitioner_->Account(reader_,rec->mem.addr);
+			taken++;
+		}
+		if(taken==0)
+			continue;
+		ring->Pop(taken);
+		if(space_waiting_[idx]) {
+			space_waiting_[idx]=0;
+			space_sems_[idx]->Post();
+		}
+		cursor_=idx;
+		return taken;
+	}
+	return 0;
+}
+
+bool DetectionQueue::Empty()
+{
+	uint32 num=ring_num_;
+	for(uint32 i=0;i<num;i++)
+		if(rings_[i] && !rings_[i]->Empty())
+			return false;
+	return log_->Empty(reader_);
+}
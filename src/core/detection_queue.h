@@ -0,0 +1,84 @@
+#ifndef __CORE_DETECTION_QUEUE_H
+#define __CORE_DETECTION_QUEUE_H
+
+/**
+ * The input of a parallel detection thread.
+ *
+ * Each application thread owns a single producer ring of memory events,
+ * the non memory events are read from the shared broadcast log. The
+ * consumer takes a logged event once its thread has no earlier memory
+ * event left, and a memory event once the logged events before it have
+ * been taken.
+ *
+ * Both sides spin for a while and then block, the consumer while there is
+ * nothing to take, a producer while its ring is full. The wake up flags
+ * are checked without a fence, a missed wake up only costs a timed wait.
+ * A producer only blocks while the detection thread consumes, the events
+ * flushed once it has left are dropped.
+ */
+
+#include "core/basictypes.h"
+#include "core/sync.h"
+#include "core/event.h"
+#include "core/partition.h"
+
+//the longest wait, in ms, for a wake up missed in the detection hand-off
+#define DETECTION_WAIT_TIMEOUT 10
+
+class DetectionQueue {
+public:
+	//the rings are indexed by the producer thread id, below max_rings
+	DetectionQueue(EventLog *log,Partitioner *partitioner,uint32 reader,
+		uint32 spin,uint32 max_rings,Semaphore *ready_sem);
+	~DetectionQueue();
+	uint32 Index() { return reader_; }
+	void AttachRing(uint32 tid,Semaphore *space_sem);
+	void Flush(uint32 tid,EventBuffer *buff);
+	bool Pop(EventRecord *rec);
+	//pop up to max events in order, the memory events of a ring are
+	//taken as a run
+	size_t PopBatch(EventRecord *recs,size_t max);
+	bool Empty();
+	//consumer side, wait for new events
+	void Wait();
+	//producer side, wake the consumer up if it waits
+	void Notify() {
+		if(sleeping_) {
+			sleeping_=0;
+			ready_sem_->Post();
+		}
+	}
+	//no more events will come, the consumer stops waiting
+	void Close() {
+		closed_=true;
+		ready_sem_->Post();
+	}
+	bool Closed() { return closed_; }
+	//the detection thread does not consume anymore, the producers stop
+	//waiting for it
+	void Detach();
+	bool Attached() { return attached_; }
+private:
+	bool PopLogged(EventRecord *rec);
+	size_t PopMemory(EventRecord *recs,size_t max);
+	uint64 Progress();
+	void WaitSpace(uint32 tid);
+
+	EventRing **rings_;
+	volatile uint32 ring_num_;
+	uint32 max_rings_;
+	uint32 cursor_;
+	EventLog *log_;
+	Partitioner *partitioner_;
+	uint32 reader_;
+	uint32 spin_;
+	Semaphore *ready_sem_;
+	volatile uint32 sleeping_;
+	volatile bool closed_;
+	volatile bool attached_;
+	Semaphore **space_sems_;
+	volatile uint32 *space_waiting_;
+	DISALLOW_COPY_CONSTRUCTORS(DetectionQueue);
+};
+
+#endif /* __CORE_DETECTION_QUEUE_H */
@@ -0,0 +1,247 @@
+#include "core/detection_queue.h"
+#include <vector>
+#include <pthread.h>
+#include <unistd.h>
+#include "core/unit_test.h"
+
+#define PRODUCER_NUM 4
+#define CONSUMER_NUM 3
+#define EVENTS_PER_PRODUCER 100000
+//one logged event every that many events of a producer
+#define SYNC_PERIOD 50
+
+struct HandOff {
+	EventLog *log;
+	Partitioner *partitioner;
+	std::vector<DetectionQueue *> queues;
+	volatile bool done;
+};
+
+struct Consumer {
+	HandOff *handoff;
+	uint32 idx;
+	uint64 logged;
+	uint64 memory;
+	uint64 errors;
+};
+
+static HandOff *NewHandOff(uint32 consumer_num,uint64 capacity)
+{
+	HandOff *handoff=new HandOff;
+	handoff->log=new EventLog(new SysMutex,consumer_num,capacity,
+		new SysSemaphore(0));
+	handoff->partitioner=new Partitioner(consumer_num,new SysMutex);
+	for(uint32 i=0;i<consumer_num;i++) {
+		DetectionQueue *queue=new DetectionQueue(handoff->log,
+			handoff->partitioner,i,100,PRODUCER_NUM,new SysSemaphore(0));
+		for(uint32 tid=0;tid<PRODUCER_NUM;tid++)
+			queue->AttachRing(tid,new SysSemaphore(0));
+		handoff->queues.push_back(queue);
+	}
+	handoff->done=false;
+	return handoff;
+}
+
+static void DeleteHandOff(HandOff *handoff)
+{
+	for(size_t i=0;i<handoff->queues.size();i++)
+		delete handoff->queues[i];
+	delete handoff->log;
+	delete handoff->partitioner;
+	delete handoff;
+}
+
+//the logged events carry the thread and the position in its stream, the
+//memory events carry them as the address and the clock
+static void *Produce(HandOff *handoff,uint32 tid)
+{
+	size_t consumer_num=handoff->queues.size();
+	std::vector<EventBuffer *> buffs;
+	for(size_t i=0;i<consumer_num;i++)
+		buffs.push_back(new EventBuffer);
+	uint64 seq=0;
+	for(uint64 i=0;i<EVENTS_PER_PRODUCER;i++) {
+		if(i%SYNC_PERIOD==0) {
+			for(size_t j=0;j<consumer_num;j++)
+				if(!buffs[j]->Empty())
+					handoff->queues[j]->Flush(tid,buffs[j]);
+			EventBase *event=CREATE_EVENT(ThreadStart,tid,i);
+			event->set_ref(consumer_num);
+			seq=handoff->log->Append(event,tid);
+			continue;
+		}
+		EventRecord rec;
+		rec.id=BEFORE_MEM_READ;
+		rec.seq=seq;
+		rec.mem.thd_id=tid;
+		rec.mem.thd_clk=i;
+		rec.mem.inst=NULL;
+		rec.mem.addr=(i*64) | tid;
+		rec.mem.size=1;
+		uint32 owner=handoff->partitioner->Owner(rec.mem.addr);
+		if(buffs[owner]->Full())
+			handoff->queues[owner]->Flush(tid,buffs[owner]);
+		buffs[owner]->Push(rec);
+	}
+	for(size_t i=0;i<consumer_num;i++) {
+		if(!buffs[i]->Empty())
+			handoff->queues[i]->Flush(tid,buffs[i]);
+		delete buffs[i];
+	}
+	return NULL;
+}
+
+static void *ProduceThread(void *arg)
+{
+	std::pair<HandOff *,uint32> *producer=(std::pair<HandOff *,uint32> *)arg;
+	return Produce(producer->first,producer->second);
+}
+
+//check that each thread's events come in its order, and the logged
+//events in the global order
+static void *ConsumeThread(void *arg)
+{
+	Consumer *consumer=(Consumer *)arg;
+	DetectionQueue *queue=consumer->handoff->queues[consumer->idx];
+	EventRecord recs[64];
+	int64 last[PRODUCER_NUM];
+	for(uint32 i=0;i<PRODUCER_NUM;i++)
+		last[i]=-1;
+	uint64 last_seq=0;
+	while(true) {
+		size_t num=queue->PopBatch(recs,64);
+		if(num==0) {
+			if(consumer->handoff->done && queue->Empty())
+				break;
+			queue->Wait();
+			continue;
+		}
+		for(size_t i=0;i<num;i++) {
+			uint32 tid;
+			int64 pos;
+			if(recs[i].IsMemory()) {
+				tid=recs[i].mem.thd_id;
+				pos=recs[i].mem.thd_clk;
+				if(recs[i].seq>last_seq ||
+					consumer->handoff->partitioner->Owner(recs[i].mem.addr)!=
+					consumer->idx)
+					consumer->errors++;
+				consumer->memory++;
+			}
+			else {
+				ThreadStartEvent *event=(ThreadStartEvent *)recs[i].event;
+				tid=event->arg0();
+				pos=event->arg1();
+				if(recs[i].seq!=last_seq+1)
+					consumer->errors++;
+				last_seq=recs[i].seq;
+				consumer->logged++;
+				DELETE_EVENT(event);
+			}
+			if(pos<=last[tid])
+				consumer->errors++;
+			last[tid]=pos;
+		}
+	}
+	return NULL;
+}
+
+void TestPopBatchOrder()
+{
+	HandOff *handoff=NewHandOff(CONSUMER_NUM,64);
+	pthread_t producers[PRODUCER_NUM],consumers[CONSUMER_NUM];
+	std::pair<HandOff *,uint32> producer_args[PRODUCER_NUM];
+	Consumer consumer_args[CONSUMER_NUM];
+	for(uint32 i=0;i<CONSUMER_NUM;i++) {
+		Consumer consumer={handoff,i,0,0,0};
+		consumer_args[i]=consumer;
+		pthread_create(&consumers[i],NULL,ConsumeThread,&consumer_args[i]);
+	}
+	for(uint32 i=0;i<PRODUCER_NUM;i++) {
+		producer_args[i]=std::make_pair(handoff,i);
+		pthread_create(&producers[i],NULL,ProduceThread,&producer_args[i]);
+	}
+	for(uint32 i=0;i<PRODUCER_NUM;i++)
+		pthread_join(producers[i],NULL);
+	handoff->done=true;
+	for(uint32 i=0;i<CONSUMER_NUM;i++)
+		handoff->queues[i]->Close();
+	for(uint32 i=0;i<CONSUMER_NUM;i++)
+		pthread_join(consumers[i],NULL);
+	uint64 logged=PRODUCER_NUM*EVENTS_PER_PRODUCER/SYNC_PERIOD;
+	uint64 memory=0;
+	for(uint32 i=0;i<CONSUMER_NUM;i++) {
+		EXPECT_EQ(consumer_args[i].errors,0);
+		EXPECT_EQ(consumer_args[i].logged,logged);
+		memory+=consumer_args[i].memory;
+	}
+	EXPECT_EQ(memory,PRODUCER_NUM*EVENTS_PER_PRODUCER-logged);
+	DeleteHandOff(handoff);
+}
+
+//the consumer leaves at once, the producer fills its ring and the log far
+//beyond their capacities without blocking
+void TestDetachedConsumer()
+{
+	HandOff *handoff=NewHandOff(1,64);
+	handoff->queues[0]->Detach();
+	Produce(handoff,0);
+	EXPECT_TRUE(!handoff->queues[0]->Attached());
+	EXPECT_TRUE(handoff->log->Empty(0));
+	DeleteHandOff(handoff);
+}
+
+//a consumer leaving while the producer waits for space releases it
+void TestDetachWhileWaiting()
+{
+	HandOff *handoff=NewHandOff(1,0);
+	pthread_t producer;
+	std::pair<HandOff *,uint32> producer_arg(handoff,0);
+	pthread_create(&producer,NULL,ProduceThread,&producer_arg);
+	EventRecord recs[16];
+	size_t num=handoff->queues[0]->PopBatch(recs,16);
+	for(size_t i=0;i<num;i++)
+		if(!recs[i].IsMemory())
+			DELETE_EVENT(recs[i].event);
+	handoff->queues[0]->Detach();
+	pthread_join(producer,NULL);
+	DeleteHandOff(handoff);
+}
+
+static void *AppendThread(void *arg)
+{
+	EventLog *log=(EventLog *)arg;
+	for(uint32 i=0;i<100;i++) {
+		EventBase *event=CREATE_EVENT(ThreadStart,0,i);
+		event->set_ref(1);
+		log->Append(event,EVENT_LOG_NO_RING);
+	}
+	return NULL;
+}
+
+//a lagging reader detaches while the producer is blocked on a full log
+void TestDetachBoundedLog()
+{
+	EventLog *log=new EventLog(new SysMutex,1,8,new SysSemaphore(0));
+	pthread_t producer;
+	pthread_create(&producer,NULL,AppendThread,log);
+	//let the producer fill the log and block
+	while(log->Tail()<8)
+		usleep(1000);
+	usleep(100000);
+	EXPECT_EQ(log->Tail(),8);
+	log->Detach(0);
+	pthread_join(producer,NULL);
+	EXPECT_EQ(log->Tail(),100);
+	EXPECT_TRUE(log->Empty(0));
+	delete log;
+}
+
+int main(int argc,char *argv[])
+{
+	RUN_TEST(TestPopBatchOrder);
+	RUN_TEST(TestDetachedConsumer);
+	RUN_TEST(TestDetachWhileWaiting);
+	RUN_TEST(TestDetachBoundedLog);
+	return UNIT_TEST_RESULT();
+}
@@ -1,7 +1,14 @@
 #ifndef __CORE_EVENT_H
 #define __CORE_EVENT_H
 
+#include <vector>
 #include "core/basictypes.h"
+#include "core/atomic.h"
+#include "core/sync.h"
+
+class Inst;
+class Image;
+class PartitionPlan;
 
 #define PROGRAM_START 1
 #define PROGRAM_EXIT 2
@@ -78,49 +85,302 @@
 #define BEFORE_SEM_WAIT 63
 #define AFTER_SEM_WAIT 64
 
+#define PARTITION_MIGRATE 65
+
+//the size of the tables indexed by event number
+#define EVENT_NUM 66
+
 
 class EventBase {
 public:
 	virtual std::string name()=0;
+	virtual uint32 id()=0;
 	virtual std::string func()=0;
 	virtual int argc()=0;
 	virtual int ref()=0;
 	virtual void set_ref(int ref)=0;
 	virtual void increase_ref()=0;
 	virtual int decrease_ref()=0;
+	virtual ~EventBase() {}
 protected:
 	EventBase() {}
-	virtual ~EventBase() {}
 private:
 	DISALLOW_COPY_CONSTRUCTORS(EventBase);
 };
 
+//a fixed size record passed by value through the event buffers and the
+//detection rings. memory events are plain records and never touch the
+//heap, the rare non memory events keep their reference counted object.
+struct EventRecord {
+	uint32 id; //the event number defined above
+	//the global order of a non memory event. a memory event carries the
+	//order of the last non memory event of its thread.
+	uint64 seq;
+	union {
+		EventBase *event;
+		struct {
+			thread_t thd_id;
+			timestamp_t thd_clk;
+			Inst *inst;
+			address_t addr;
+			size_t size;
+		} mem;
+	};
+	bool IsMemory() { return id>=BEFORE_MEM_READ && id<=AFTER_MEM_WRITE; }
+};
+
+//the default number of events an application thread batches per detection
+//thread before handing them over
 #define MAX_EVENT_NUM 10
 class EventBuffer {
 public:
-	EventBuffer():bgn_idx_(0),end_idx_(0) {
-		vec_.assign(MAX_EVENT_NUM+1,NULL);
+	explicit EventBuffer(size_t capacity=MAX_EVENT_NUM)
+		:bgn_idx_(0),end_idx_(0),capacity_(capacity?capacity:1) {
+		vec_.resize(capacity_+1);
 	}
 	~EventBuffer() {}
-	void Push(EventBase *eb) {
-		vec_[end_idx_]=eb;
-		end_idx_=(end_idx_+1)%(MAX_EVENT_NUM+1);
+	void Push(const EventRecord &rec) {
+		vec_[end_idx_]=rec;
+		end_idx_=(end_idx_+1)%(capacity_+1);
 	}
-	EventBase *Pop() {
-		EventBase *eb=vec_[bgn_idx_];
-		vec_[bgn_idx_]=NULL;
-		bgn_idx_=(bgn_idx_+1)%(MAX_EVENT_NUM+1);
-		return eb;
+	EventRecord &Front() { return vec_[bgn_idx_]; }
+	void Pop() {
+		bgn_idx_=(bgn_idx_+1)%(capacity_+1);
 	}
 	bool Empty() { return bgn_idx_==end_idx_; }
 	bool Full() { 
-		return bgn_idx_<end_idx_?(end_idx_-bgn_idx_==MAX_EVENT_NUM):
-			(end_idx_-bgn_idx_+1==0);
+		return (end_idx_+1)%(capacity_+1)==bgn_idx_;
+	}
+private:
+	size_t bgn_idx_;
+	size_t end_idx_;
+	size_t capacity_;
+	std::vector<EventRecord> vec_;
+};
+
+//bounded single producer single consumer ring of event records. the
+//slots are reused in place once the consumer has passed them. the
+//producer stages a batch and publishes it with a single store of the tail.
+#define EVENT_RING_SIZE 4096
+class EventRing {
+public:
+	EventRing():head_(0),tail_(0),staged_(0) {
+		records_.resize(EVENT_RING_SIZE);
+	}
+	~EventRing() {}
+	//producer side
+	size_t Space() { return EVENT_RING_SIZE-(staged_-head_); }
+	void Stage(const EventRecord &rec) {
+		records_[staged_ & (EVENT_RING_SIZE-1)]=rec;
+		staged_++;
+	}
+	void Publish() {
+		MEMORY_BARRIER();
+		tail_=staged_;
+	}
+	//consumer side
+	bool Empty() { return head_==tail_; }
+	uint64 Published() { return tail_; }
+	EventRecord *Front() {
+		if(head_==tail_)
+			return NULL;
+		MEMORY_BARRIER();
+		return &records_[head_ & (EVENT_RING_SIZE-1)];
+	}
+	void Pop() {
+		MEMORY_BARRIER();
+		head_++;
+	}
+	//the published records not taken yet, read in place through At
+	uint64 Ready() {
+		uint64 num=tail_-head_;
+		MEMORY_BARRIER();
+		return num;
+	}
+	EventRecord *At(uint64 i) {
+		return &records_[(head_+i) & (EVENT_RING_SIZE-1)];
+	}
+	void Pop(uint64 num) {
+		MEMORY_BARRIER();
+		head_+=num;
 	}
 private:
-	int bgn_idx_;
-	int end_idx_;
-	std::vector<EventBase *> vec_;
+	volatile uint64 head_;
+	volatile uint64 tail_;
+	uint64 staged_;
+	std::vector<EventRecord> records_;
+	DISALLOW_COPY_CONSTRUCTORS(EventRing);
+};
+
+//broadcast log of the non memory events. an event is appended once and
+//every detection thread reads it through its own cursor. the log grows by
+//chunks, the last reader leaving a chunk frees it. the log position of an
+//entry is its global order, starting from 1. the producers block while the
+//slowest reader is more than capacity entries behind. a detached reader
+//does not hold the producers back, its entries are released as appended.
+//the producers wait for space without the lock, which a reader needs to
+//detach.
+#define EVENT_LOG_CHUNK_SIZE 1024
+#define EVENT_LOG_NO_RING static_cast<uint32>(-1)
+struct EventLogEntry {
+	EventBase *event;
+	uint32 id;
+	uint32 ring; //the ring of the producer thread, if it has one
+};
+
+class EventLog {
+public:
+	EventLog(Mutex *lock,uint32 reader_num,uint64 capacity,Semaphore *space_sem)
+		:lock_(lock),reader_num_(reader_num),capacity_(capacity),waiters_(0),
+		waiting_(0),space_sem_(space_sem),detached_num_(0),tail_(0) {
+		tail_chunk_=new Chunk(reader_num);
+		cursors_=new Cursor[reader_num];
+		for(uint32 i=0;i<reader_num;i++) {
+			cursors_[i].chunk=tail_chunk_;
+			cursors_[i].next=1;
+			cursors_[i].detached=false;
+		}
+	}
+	~EventLog() {
+		//chunks before the slowest cursor have been freed
+		Chunk *chunk=tail_chunk_;
+		uint64 next=tail_+1;
+		for(uint32 i=0;i<reader_num_;i++)
+			if(cursors_[i].next<next) {
+				next=cursors_[i].next;
+				chunk=cursors_[i].chunk;
+			}
+		while(chunk) {
+			Chunk *tmp=chunk->next;
+			delete chunk;
+			chunk=tmp;
+		}
+		delete [] cursors_;
+		delete lock_;
+		delete space_sem_;
+	}
+	//producer side, returns the order of the event
+	uint64 Append(EventBase *eb,uint32 ring) {
+		lock_->Lock();
+		//wait without the lock, a reader may need it to detach
+		while(capacity_ && tail_-Slowest()>=capacity_) {
+			waiters_++;
+			waiting_=1;
+			MEMORY_BARRIER();
+			bool full=tail_-Slowest()>=capacity_;
+			lock_->Unlock();
+			if(full)
+				space_sem_->Wait();
+			lock_->Lock();
+			waiters_--;
+		}
+		uint64 seq=tail_+1;
+		size_t off=(seq-1)%EVENT_LOG_CHUNK_SIZE;
+		EventLogEntry &entry=tail_chunk_->entries[off];
+		entry.event=eb;
+		entry.id=eb->id();
+		entry.ring=ring;
+		//the next chunk exists before any reader can leave this one
+		if(off==EVENT_LOG_CHUNK_SIZE-1) {
+			tail_chunk_->next=new Chunk(reader_num_);
+			tail_chunk_=tail_chunk_->next;
+		}
+		MEMORY_BARRIER();
+		tail_=seq;
+		for(uint32 i=0;detached_num_ && i<reader_num_;i++)
+			if(cursors_[i].detached)
+				Release(i);
+		//a single post wakes a single producer, pass it on to the others
+		if(waiters_) {
+			waiting_=1;
+			MEMORY_BARRIER();
+			if(tail_-Slowest()<capacity_)
+				space_sem_->Post();
+		}
+		lock_->Unlock();
+		return seq;
+	}
+	//the reader stops reading, its pending entries are released
+	void Detach(uint32 reader) {
+		ScopedLock lock(lock_);
+		if(cursors_[reader].detached)
+			return ;
+		cursors_[reader].detached=true;
+		detached_num_++;
+		Release(reader);
+		if(waiters_)
+			space_sem_->Post();
+	}
+	//reader side, each reader only touches its own cursor
+	uint64 Next(uint32 reader) { return cursors_[reader].next; }
+	bool Empty(uint32 reader) { return cursors_[reader].next>tail_; }
+	EventLogEntry *Front(uint32 reader) {
+		Cursor &cursor=cursors_[reader];
+		if(cursor.next>tail_)
+			return NULL;
+		MEMORY_BARRIER();
+		return &cursor.chunk->entries[(cursor.next-1)%EVENT_LOG_CHUNK_SIZE];
+	}
+	void Pop(uint32 reader) {
+		Cursor &cursor=cursors_[reader];
+		cursor.next++;
+		if(capacity_) {
+			MEMORY_BARRIER();
+			if(waiting_) {
+				waiting_=0;
+				space_sem_->Post();
+			}
+		}
+		if((cursor.next-1)%EVENT_LOG_CHUNK_SIZE!=0)
+			return ;
+		Chunk *chunk=cursor.chunk;
+		cursor.chunk=chunk->next;
+		if(ATOMIC_SUB_AND_FETCH(&chunk->readers,1)==0)
+			delete chunk;
+	}
+	uint64 Tail() { return tail_; }
+private:
+	struct Chunk {
+		explicit Chunk(uint32 reader_num):next(NULL),readers(reader_num) {}
+		EventLogEntry entries[EVENT_LOG_CHUNK_SIZE];
+		Chunk *next;
+		volatile uint32 readers;
+	};
+	struct Cursor {
+		Chunk *chunk;
+		volatile uint64 next;
+		bool detached;
+	};
+
+	//pop the entries of a detached reader for it, under the lock
+	void Release(uint32 reader) {
+		while(!Empty(reader)) {
+			EventBase *eb=Front(reader)->event;
+			if(eb->decrease_ref()==0)
+				delete eb;
+			Pop(reader);
+		}
+	}
+	//the entries consumed by every attached reader
+	uint64 Slowest() {
+		uint64 next=tail_+1;
+		for(uint32 i=0;i<reader_num_;i++)
+			if(!cursors_[i].detached && cursors_[i].next<next)
+				next=cursors_[i].next;
+		return next-1;
+	}
+
+	Mutex *lock_;
+	uint32 reader_num_;
+	uint64 capacity_;
+	uint32 waiters_; //the blocked producers, under the lock
+	volatile uint32 waiting_;
+	Semaphore *space_sem_;
+	uint32 detached_num_;
+	Cursor *cursors_;
+	Chunk *tail_chunk_;
+	volatile uint64 tail_;
+	DISALLOW_COPY_CONSTRUCTORS(EventLog);
 };
 
 #define EVENT_ARGS_0
@@ -214,7 +474,7 @@ private:
 		volatile int ref_;												\
 		int ref() {return ref_;}										\
 		void increase_ref() {++ref_;}									\
-		int decrease_ref() {return --ref_;}								\
+		int decrease_ref() {return ATOMIC_SUB_AND_FETCH(&ref_,1);}		\
 		void set_ref(int ref) {ref_=ref;}								\
 	private:															\
 		DISALLOW_COPY_CONSTRUCTORS(Event);								\
@@ -238,122 +498,125 @@ EVENT_TEMPLATE(7);
 
 //EVENT_TEMPLATE specilizes the number of the parameters
 //EVENT specilizes the event class
-#define EVENT(name_,func_,sig_)											\
+#define EVENT(name_,id_,func_,sig_)										\
 	class EVENT_CLASS(name_):public Event<EVENT_CLASS(name_),sig_>		\
 	{																	\
 	public:																\
 		EVENT_CLASS(name_)() {}											\
 		~EVENT_CLASS(name_)() {}										\
 		std::string name() { return #name_; }							\
+		uint32 id() { return id_; }										\
+		static const uint32 ID=id_;										\
 		std::string func() { return func_; }							\
 	private:															\
 		DISALLOW_COPY_CONSTRUCTORS(EVENT_CLASS(name_));					\
 	}
 
-EVENT(ImageLoad,"ImageLoad",void (Image *,address_t,address_t,address_t,size_t,
+EVENT(ImageLoad,IMAGE_LOAD,"ImageLoad",void (Image *,address_t,address_t,address_t,size_t,
 	address_t,size_t));
-EVENT(ImageUnload,"ImageUnload",void (Image *,address_t,address_t,address_t,size_t,
+EVENT(ImageUnload,IMAGE_UNLOAD,"ImageUnload",void (Image *,address_t,address_t,address_t,size_t,
 	address_t,size_t));
-EVENT(ThreadStart,"ThreadStart",void (thread_t,thread_t));
-EVENT(ThreadExit,"ThreadExit",void (thread_t,timestamp_t));
-EVENT(Main,"Main",void (thread_t,timestamp_t));
-EVENT(ThreadMain,"ThreadMain",void (thread_t,timestamp_t));
-EVENT(BeforeMemRead,"BeforeMemRead", void (thread_t,timestamp_t,Inst *,
+EVENT(ThreadStart,THREAD_START,"ThreadStart",void (thread_t,thread_t));
+EVENT(ThreadExit,THREAD_EXIT,"ThreadExit",void (thread_t,timestamp_t));
+EVENT(Main,MAIN,"Main",void (thread_t,timestamp_t));
+EVENT(ThreadMain,THREAD_MAIN,"ThreadMain",void (thread_t,timestamp_t));
+EVENT(BeforeMemRead,BEFORE_MEM_READ,"BeforeMemRead", void (thread_t,timestamp_t,Inst *,
 	address_t,size_t));
-EVENT(AfterMemRead,"AfterMemRead", void (thread_t,timestamp_t,Inst *,
+EVENT(AfterMemRead,AFTER_MEM_READ,"AfterMemRead", void (thread_t,timestamp_t,Inst *,
 	address_t,size_t));
-EVENT(BeforeMemWrite,"BeforeMemWrite", void (thread_t,timestamp_t,Inst *,
+EVENT(BeforeMemWrite,BEFORE_MEM_WRITE,"BeforeMemWrite", void (thread_t,timestamp_t,Inst *,
 	address_t,size_t));
-EVENT(AfterMemWrite,"AfterMemWrite", void (thread_t,timestamp_t,Inst *,
+EVENT(AfterMemWrite,AFTER_MEM_WRITE,"AfterMemWrite", void (thread_t,timestamp_t,Inst *,
 	address_t,size_t));
-EVENT(BeforeAtomicInst,"BeforeAtomicInst",void (thread_t,timestamp_t,Inst *,
+EVENT(BeforeAtomicInst,BEFORE_ATOMIC_INST,"BeforeAtomicInst",void (thread_t,timestamp_t,Inst *,
 	std::string,address_t));
-EVENT(AfterAtomicInst,"AfterAtomicInst",void (thread_t,timestamp_t,Inst *,
+EVENT(AfterAtomicInst,AFTER_ATOMIC_INST,"AfterAtomicInst",void (thread_t,timestamp_t,Inst *,
 	std::string,address_t));
-EVENT(BeforeCall,"BeforeCall",void (thread_t,timestamp_t,Inst *,std::string *funcname,address_t));
-EVENT(AfterCall,"AfterCall",void (thread_t,timestamp_t,Inst *,address_t,
+EVENT(BeforeCall,BEFORE_CALL,"BeforeCall",void (thread_t,timestamp_t,Inst *,std::string *funcname,address_t));
+EVENT(AfterCall,AFTER_CALL,"AfterCall",void (thread_t,timestamp_t,Inst *,address_t,
 	address_t));
-EVENT(BeforeReturn,"BeforeReturn",void (thread_t,timestamp_t,Inst *,std::string *funcname,address_t));
-EVENT(AfterReturn,"AfterReturn",void (thread_t,timestamp_t,Inst *,address_t));
-EVENT(BeforePthreadCreate,"BeforePthreadCreate",void (thread_t,timestamp_t,
+EVENT(BeforeReturn,BEFORE_RETURN,"BeforeReturn",void (thread_t,timestamp_t,Inst *,std::string *funcname,address_t));
+EVENT(AfterReturn,AFTER_RETURN,"AfterReturn",void (thread_t,timestamp_t,Inst *,address_t));
+EVENT(BeforePthreadCreate,BEFORE_PTHREAD_CREATE,"BeforePthreadCreate",void (thread_t,timestamp_t,
 	Inst *));
-EVENT(AfterPthreadCreate,"AfterPthreadCreate",void (thread_t,timestamp_t,
+EVENT(AfterPthreadCreate,AFTER_PTHREAD_CREATE,"AfterPthreadCreate",void (thread_t,timestamp_t,
 	Inst *,thread_t));
-EVENT(BeforePthreadJoin,"BeforePthreadJoin",void (thread_t,timestamp_t,Inst *,
+EVENT(BeforePthreadJoin,BEFORE_PTHREAD_JOIN,"BeforePthreadJoin",void (thread_t,timestamp_t,Inst *,
 	thread_t));
-EVENT(AfterPthreadJoin,"AfterPthreadJoin",void (thread_t,timestamp_t,Inst *,
+EVENT(AfterPthreadJoin,AFTER_PTHREAD_JOIN,"AfterPthreadJoin",void (thread_t,timestamp_t,Inst *,
 	thread_t));
-EVENT(BeforePthreadMutexTryLock,"BeforePthreadMutexTryLock",void (thread_t,
+EVENT(BeforePthreadMutexTryLock,BEFORE_PTHREAD_MUTEX_TRYLOCK,"BeforePthreadMutexTryLock",void (thread_t,
 	timestamp_t,Inst *,address_t));
-EVENT(AfterPthreadMutexTryLock,"AfterPthreadMutexTryLock",void (thread_t,
+EVENT(AfterPthreadMutexTryLock,AFTER_PTHREAD_MUTEX_TRYLOCK,"AfterPthreadMutexTryLock",void (thread_t,
 	timestamp_t,Inst *,address_t,int));
-EVENT(BeforePthreadMutexLock,"BeforePthreadMutexLock",void (thread_t,
+EVENT(BeforePthreadMutexLock,BEFORE_PTHREAD_MUTEX_LOCK,"BeforePthreadMutexLock",void (thread_t,
 	timestamp_t,Inst *,address_t));
-EVENT(AfterPthreadMutexLock,"AfterPthreadMutexLock",void (thread_t,
+EVENT(AfterPthreadMutexLock,AFTER_PTHREAD_MUTEX_LOCK,"AfterPthreadMutexLock",void (thread_t,
 	timestamp_t,Inst *,address_t));
-EVENT(BeforePthreadMutexUnlock,"BeforePthreadMutexUnlock",void (thread_t,
+EVENT(BeforePthreadMutexUnlock,BEFORE_PTHREAD_MUTEX_UNLOCK,"BeforePthreadMutexUnlock",void (thread_t,
 	timestamp_t,Inst *,address_t));
-EVENT(AfterPthreadMutexUnlock,"AfterPthreadMutexUnlock",void (thread_t,
+EVENT(AfterPthreadMutexUnlock,AFTER_PTHREAD_MUTEX_UNLOCK,"AfterPthreadMutexUnlock",void (thread_t,
 	timestamp_t,Inst *,address_t));
-EVENT(BeforePthreadRwlockTryRdlock,"BeforePthreadRwlockTryRdlock",void (thread_t,
+EVENT(BeforePthreadRwlockTryRdlock,BEFORE_PTHREAD_RWLOCK_TRYRDLOCK,"BeforePthreadRwlockTryRdlock",void (thread_t,
 	timestamp_t,Inst *,address_t));
-EVENT(AfterPthreadRwlockTryRdlock,"AfterPthreadRwlockTryRdlock",void (thread_t,
+EVENT(AfterPthreadRwlockTryRdlock,AFTER_PTHREAD_RWLOCK_TRYRDLOCK,"AfterPthreadRwlockTryRdlock",void (thread_t,
 	timestamp_t,Inst *,address_t,int));
-EVENT(BeforePthreadRwlockRdlock,"BeforePthreadRwlockRdlock",void (thread_t,
+EVENT(BeforePthreadRwlockRdlock,BEFORE_PTHREAD_RWLOCK_RDLOCK,"BeforePthreadRwlockRdlock",void (thread_t,
 	timestamp_t,Inst *,address_t));
-EVENT(AfterPthreadRwlockRdlock,"AfterPthreadRwlockRdlock",void (thread_t,
+EVENT(AfterPthreadRwlockRdlock,AFTER_PTHREAD_RWLOCK_RDLOCK,"AfterPthreadRwlockRdlock",void (thread_t,
 	timestamp_t,Inst *,address_t));
-EVENT(BeforePthreadRwlockTryWrlock,"BeforePthreadRwlockTryWrlock",void (thread_t,
+EVENT(BeforePthreadRwlockTryWrlock,BEFORE_PTHREAD_RWLOCK_TRYWRLOCK,"BeforePthreadRwlockTryWrlock",void (thread_t,
 	timestamp_t,Inst *,address_t));
-EVENT(AfterPthreadRwlockTryWrlock,"AfterPthreadRwlockTryWrlock",void (thread_t,
+EVENT(AfterPthreadRwlockTryWrlock,AFTER_PTHREAD_RWLOCK_TRYWRLOCK,"AfterPthreadRwlockTryWrlock",void (thread_t,
 	timestamp_t,Inst *,address_t,int));
-EVENT(BeforePthreadRwlockWrlock,"BeforePthreadRwlockWrlock",void (thread_t,
+EVENT(BeforePthreadRwlockWrlock,BEFORE_PTHREAD_RWLOCK_WRLOCK,"BeforePthreadRwlockWrlock",void (thread_t,
 	timestamp_t,Inst *,address_t));
-EVENT(AfterPthreadRwlockWrlock,"AfterPthreadRwlockWrlock",void (thread_t,
+EVENT(AfterPthreadRwlockWrlock,AFTER_PTHREAD_RWLOCK_WRLOCK,"AfterPthreadRwlockWrlock",void (thread_t,
 	timestamp_t,Inst *,address_t));
-EVENT(BeforePthreadRwlockUnlock,"BeforePthreadRwlockUnlock",void (thread_t,
+EVENT(BeforePthreadRwlockUnlock,BEFORE_PTHREAD_RWLOCK_UNLOCK,"BeforePthreadRwlockUnlock",void (thread_t,
 	timestamp_t,Inst *,address_t));
-EVENT(AfterPthreadRwlockUnlock,"AfterPthreadRwlockUnlock",void (thread_t,
+EVENT(AfterPthreadRwlockUnlock,AFTER_PTHREAD_RWLOCK_UNLOCK,"AfterPthreadRwlockUnlock",void (thread_t,
 	timestamp_t,Inst *,address_t));
-EVENT(BeforeMalloc,"BeforeMalloc",void (thread_t,timestamp_t,Inst *,size_t));
-EVENT(AfterMalloc,"AfterMalloc",void (thread_t,timestamp_t,Inst *,size_t,address_t));
-EVENT(BeforeCalloc,"BeforeCalloc",void (thread_t,timestamp_t,Inst *,size_t,size_t));
-EVENT(AfterCalloc,"AfterCalloc",void (thread_t,timestamp_t,Inst *,size_t,size_t,
+EVENT(BeforeMalloc,BEFORE_MALLOC,"BeforeMalloc",void (thread_t,timestamp_t,Inst *,size_t));
+EVENT(AfterMalloc,AFTER_MALLOC,"AfterMalloc",void (thread_t,timestamp_t,Inst *,size_t,address_t));
+EVENT(BeforeCalloc,BEFORE_CALLOC,"BeforeCalloc",void (thread_t,timestamp_t,Inst *,size_t,size_t));
+EVENT(AfterCalloc,AFTER_CALLOC,"AfterCalloc",void (thread_t,timestamp_t,Inst *,size_t,size_t,
 	address_t));
-EVENT(BeforeRealloc,"BeforeRealloc",void (thread_t,timestamp_t,Inst *,address_t,size_t));
-EVENT(AfterRealloc,"AfterRealloc",void (thread_t,timestamp_t,Inst *,address_t,size_t,
+EVENT(BeforeRealloc,BEFORE_REALLOC,"BeforeRealloc",void (thread_t,timestamp_t,Inst *,address_t,size_t));
+EVENT(AfterRealloc,AFTER_REALLOC,"AfterRealloc",void (thread_t,timestamp_t,Inst *,address_t,size_t,
 	address_t));
-EVENT(BeforeFree,"BeforeFree",void (thread_t,timestamp_t,Inst *,address_t));
-EVENT(AfterFree,"AfterFree",void (thread_t,timestamp_t,Inst *,address_t));
-EVENT(BeforePthreadCondSignal,"BeforePthreadCondSignal",void (thread_t,timestamp_t,Inst *,
+EVENT(BeforeFree,BEFORE_FREE,"BeforeFree",void (thread_t,timestamp_t,Inst *,address_t));
+EVENT(AfterFree,AFTER_FREE,"AfterFree",void (thread_t,timestamp_t,Inst *,address_t));
+EVENT(BeforePthreadCondSignal,BEFORE_PTHREAD_COND_SIGNAL,"BeforePthreadCondSignal",void (thread_t,timestamp_t,Inst *,
 	address_t));
-EVENT(AfterPthreadCondSignal,"AfterPthreadCondSignal",void (thread_t,timestamp_t,Inst *,
+EVENT(AfterPthreadCondSignal,AFTER_PTHREAD_COND_SIGNAL,"AfterPthreadCondSignal",void (thread_t,timestamp_t,Inst *,
 	address_t));
-EVENT(BeforePthreadCondBroadcast,"BeforePthreadCondBroadcast",void (thread_t,timestamp_t,Inst *,
+EVENT(BeforePthreadCondBroadcast,BEFORE_PTHREAD_COND_BROADCAST,"BeforePthreadCondBroadcast",void (thread_t,timestamp_t,Inst *,
 	address_t));
-EVENT(AfterPthreadCondBroadcast,"AfterPthreadCondBroadcast",void (thread_t,timestamp_t,Inst *,
+EVENT(AfterPthreadCondBroadcast,AFTER_PTHREAD_COND_BROADCAST,"AfterPthreadCondBroadcast",void (thread_t,timestamp_t,Inst *,
 	address_t));
-EVENT(BeforePthreadCondWait,"BeforePthreadCondWait",void (thread_t,timestamp_t,
+EVENT(BeforePthreadCondWait,BEFORE_PTHREAD_COND_WAIT,"BeforePthreadCondWait",void (thread_t,timestamp_t,
 	Inst *,address_t,address_t));
-EVENT(AfterPthreadCondWait,"AfterPthreadCondWait",void (thread_t,timestamp_t,
+EVENT(AfterPthreadCondWait,AFTER_PTHREAD_COND_WAIT,"AfterPthreadCondWait",void (thread_t,timestamp_t,
 	Inst *,address_t,address_t));
-EVENT(BeforePthreadCondTimedwait,"BeforePthreadCondTimedwait",void (thread_t,timestamp_t,
+EVENT(BeforePthreadCondTimedwait,BEFORE_PTHREAD_COND_TIMEDWAIT,"BeforePthreadCondTimedwait",void (thread_t,timestamp_t,
 	Inst *,address_t,address_t));
-EVENT(AfterPthreadCondTimedwait,"AfterPthreadCondTimedwait",void (thread_t,timestamp_t,
+EVENT(AfterPthreadCondTimedwait,AFTER_PTHREAD_COND_TIMEDWAIT,"AfterPthreadCondTimedwait",void (thread_t,timestamp_t,
 	Inst *,address_t,address_t));
-EVENT(BeforePthreadBarrierInit,"BeforePthreadBarrierInit",void (thread_t,timestamp_t,Inst *,
+EVENT(BeforePthreadBarrierInit,BEFORE_PTHREAD_BARRIER_INIT,"BeforePthreadBarrierInit",void (thread_t,timestamp_t,Inst *,
 	address_t,unsigned int));
-EVENT(AfterPthreadBarrierInit,"AfterPthreadBarrierInit",void (thread_t,timestamp_t,Inst *,
+EVENT(AfterPthreadBarrierInit,AFTER_PTHREAD_BARRIER_INIT,"AfterPthreadBarrierInit",void (thread_t,timestamp_t,Inst *,
 	address_t,unsigned int));
-EVENT(BeforePthreadBarrierWait,"BeforePthreadBarrierWait",void (thread_t,timestamp_t,Inst *,
+EVENT(BeforePthreadBarrierWait,BEFORE_PTHREAD_BARRIER_WAIT,"BeforePthreadBarrierWait",void (thread_t,timestamp_t,Inst *,
     address_t));
-EVENT(AfterPthreadBarrierWait,"AfterPthreadBarrierWait",void (thread_t,timestamp_t,Inst *,
+EVENT(AfterPthreadBarrierWait,AFTER_PTHREAD_BARRIER_WAIT,"AfterPthreadBarrierWait",void (thread_t,timestamp_t,Inst *,
     address_t));
-EVENT(BeforeSemInit,"BeforeSemInit",void (thread_t,timestamp_t,Inst *,address_t,unsigned int));
-EVENT(AfterSemInit,"AfterSemInit",void (thread_t,timestamp_t,Inst *,address_t,unsigned int));
-EVENT(BeforeSemPost,"BeforeSemPost",void (thread_t,timestamp_t,Inst *,address_t));
-EVENT(AfterSemPost,"AfterSemPost",void (thread_t,timestamp_t,Inst *,address_t));
-EVENT(BeforeSemWait,"BeforeSemWait",void (thread_t,timestamp_t,Inst *,address_t));
-EVENT(AfterSemWait,"AfterSemWait",void (thread_t,timestamp_t,Inst *,address_t));
+EVENT(BeforeSemInit,BEFORE_SEM_INIT,"BeforeSemInit",void (thread_t,timestamp_t,Inst *,address_t,unsigned int));
+EVENT(AfterSemInit,AFTER_SEM_INIT,"AfterSemInit",void (thread_t,timestamp_t,Inst *,address_t,unsigned int));
+EVENT(BeforeSemPost,BEFORE_SEM_POST,"BeforeSemPost",void (thread_t,timestamp_t,Inst *,address_t));
+EVENT(AfterSemPost,AFTER_SEM_POST,"AfterSemPost",void (thread_t,timestamp_t,Inst *,address_t));
+EVENT(BeforeSemWait,BEFORE_SEM_WAIT,"BeforeSemWait",void (thread_t,timestamp_t,Inst *,address_t));
+EVENT(AfterSemWait,AFTER_SEM_WAIT,"AfterSemWait",void (thread_t,timestamp_t,Inst *,address_t));
+EVENT(PartitionMigrate,PARTITION_MIGRATE,"PartitionMigrate",void (PartitionPlan *));
 
 #endif /* __CORE_EVENT_H */
\ No newline at end of file
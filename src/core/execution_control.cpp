@@ -9,8 +9,16 @@ TLS_KEY ExecutionControl::app_thd_key;
 ExecutionControl::ExecutionControl()
 	:kernel_lock_(NULL),knob_(NULL),debug_file_(NULL),
 	callstack_info_(NULL),debug_analyzer_(NULL),sinfo_(NULL),
-	main_thread_started_(false),main_thd_id_(INVALID_THD_ID)
-	{}
+	main_thread_started_(false),main_thd_id_(INVALID_THD_ID),
+	access_cache_(false),mem_gen_(0),dtc_ready_(false),
+	sync_log_(NULL),partitioner_(NULL),partition_seq_(0),
+	partition_thd_uid_(INVALID_PIN_THREAD_UID)
+{
+	memset(tls_access_cache_,0,sizeof(tls_access_cache_));
+	memset(tls_cache_epoch_,0,sizeof(tls_cache_epoch_));
+	memset(tls_ignore_,0,sizeof(tls_ignore_));
+	memset(tls_sync_seq_,0,sizeof(tls_sync_seq_));
+}
 
 ExecutionControl::~ExecutionControl()
 {
@@ -20,6 +28,8 @@ ExecutionControl::~ExecutionControl()
 	if(callstack_info_)
 		delete callstack_info_;
 	delete sinfo_;
+	for(int i=0;i<PIN_MAX_THREADS;i++)
+		delete tls_access_cache_[i];
 }
 
 void ExecutionControl::Initialize()
@@ -28,6 +38,7 @@ void ExecutionControl::Initialize()
 	Knob::Initialize(new PinKnob());
 	kernel_lock_=CreateMutex();
 	knob_=Knob::Get();
+	dtc_ready_sem_.Init();
 	ctrl_=this;
 }
 
@@ -47,6 +58,16 @@ void ExecutionControl::PreSetup()
 		" threads","0");
 	knob_->RegisterInt("parallel_verifier_number","the number of the paralle verifier"
 		" threads","0");
+	knob_->RegisterBool("access_cache","whether drop the accesses repeated by the same"
+		" instruction in the same thread epoch","0");
+	knob_->RegisterInt("handoff_spin","the tries before a detection or application"
+		" thread blocks in the parallel detection hand-off","100");
+	knob_->RegisterInt("event_log_capacity","the non memory events the slowest"
+		" detection thread may lag behind, 0 for no limit","65536");
+	knob_->RegisterInt("event_batch_size","the events an application thread batches"
+		" per detection thread, and a detection thread handles at once","10");
+	knob_->RegisterInt("partition_interval","the milliseconds between two checks of"
+		" the parallel detection load balance, 0 keeps the address partition","100");
 
 	debug_analyzer_=new DebugAnalyzer;
 	debug_analyzer_->Register();
@@ -122,12 +143,27 @@ void ExecutionControl::PostSetup()
 		desc_.SetHookMallocFunc();
 		desc_.SetHookAtomicInst();
 		desc_.SetHookCallReturn();
+		sync_log_=new EventLog(CreateMutex(),GetParallelDetectorNumber(),
+			knob_->ValueInt("event_log_capacity"),CreateSemaphore(0));
+		partitioner_=new Partitioner(GetParallelDetectorNumber(),CreateMutex());
 		ParallelDetectionThread();
 	}
 
 	if(GetParallelVerifierNumber()>0) {
 		ParallelVerificationThread();
 	}
+	//after memory hooks expect to see every before memory event, and the
+	//parallel detectors are not asked
+	access_cache_=knob_->ValueBool("access_cache") && !desc_.HookAfterMem() &&
+		GetParallelDetectorNumber()==0;
+	//a repeat is only dropped when no analyzer would act on it
+	for(AnalyzerContainer::iterator it=analyzers_.begin();
+		access_cache_ && it!=analyzers_.end();it++) {
+		if((*it)->desc()->HookBeforeMem() && !(*it)->CachedAccess())
+			access_cache_=false;
+	}
+	if(knob_->ValueBool("access_cache") && !access_cache_)
+		INFO_PRINT("access cache disabled, an analyzer needs every access\n");
 	
 	//Setup call stack info if needed.
 	if(desc_.TrackCallStack()) {
@@ -167,6 +203,37 @@ bool ExecutionControl::FilterNonPotentialInstrument(std::string &filename,
 	return false;
 }
 
+//The reject tests go to an inlined if call, and only the accesses that
+//pass them reach the analysis routine. The after handlers rely on the
+//address recorded by every before handler, so they keep the plain call.
+void ExecutionControl::InsertBeforeMemCall(INS ins,AFUNPTR func,Inst *inst,
+	IARG_TYPE ea,IARG_TYPE size)
+{
+	if(desc_.HookAfterMem()) {
+		INS_InsertCall(ins,IPOINT_BEFORE,func,
+			CALL_ORDER_BEFORE
+			IARG_THREAD_ID,
+			IARG_PTR,inst,
+			ea,
+			size,
+			IARG_END);
+		return ;
+	}
+	INS_InsertIfCall(ins,IPOINT_BEFORE,
+		(AFUNPTR)__IfMemAccess,
+		CALL_ORDER_BEFORE
+		IARG_FAST_ANALYSIS_CALL,
+		IARG_THREAD_ID,
+		IARG_END);
+	INS_InsertThenCall(ins,IPOINT_BEFORE,func,
+		CALL_ORDER_BEFORE
+		IARG_THREAD_ID,
+		IARG_PTR,inst,
+		ea,
+		size,
+		IARG_END);
+}
+
 void ExecutionControl::InstrumentTrace(TRACE trace,VOID *v) 
 {
 	HandlePreInstrumentTrace(trace);
@@ -250,38 +317,16 @@ void ExecutionControl::InstrumentTrace(TRACE trace,VOID *v)
 					UpdateInstOpcode(inst,ins);
 					//Instrument before mem accesses.
 					if(desc_.HookBeforeMem()) {
-						if(INS_IsMemoryRead(ins)) {
-							INS_InsertCall(ins,IPOINT_BEFORE,
-								(AFUNPTR)__BeforeMemRead,
-								CALL_ORDER_BEFORE
-								IARG_THREAD_ID,
-								IARG_PTR,inst,
-								IARG_MEMORYREAD_EA,
-								IARG_MEMORYREAD_SIZE,
-								IARG_END);
-						}
-
-						if(INS_IsMemoryWrite(ins)) {
-							INS_InsertCall(ins,IPOINT_BEFORE,
-								(AFUNPTR)__BeforeMemWrite,
-								CALL_ORDER_BEFORE
-								IARG_THREAD_ID,
-								IARG_PTR,inst,
-								IARG_MEMORYWRITE_EA,
-								IARG_MEMORYWRITE_SIZE,
-								IARG_END);
-						}
+						if(INS_IsMemoryRead(ins))
+							InsertBeforeMemCall(ins,(AFUNPTR)__BeforeMemRead,inst,
+								IARG_MEMORYREAD_EA,IARG_MEMORYREAD_SIZE);
+						if(INS_IsMemoryWrite(ins))
+							InsertBeforeMemCall(ins,(AFUNPTR)__BeforeMemWrite,inst,
+								IARG_MEMORYWRITE_EA,IARG_MEMORYWRITE_SIZE);
 						//true if this instruction has 2 memory read operands 
-						if(INS_HasMemoryRead2(ins)) {
-							INS_InsertCall(ins,IPOINT_BEFORE,
-								(AFUNPTR)__BeforeMemRead2,
-								CALL_ORDER_BEFORE
-								IARG_THREAD_ID,
-								IARG_PTR,inst,
-								IARG_MEMORYREAD2_EA,
-								IARG_MEMORYREAD_SIZE,
-								IARG_END);
-						}
+						if(INS_HasMemoryRead2(ins))
+							InsertBeforeMemCall(ins,(AFUNPTR)__BeforeMemRead2,inst,
+								IARG_MEMORYREAD2_EA,IARG_MEMORYREAD_SIZE);
 					}
 					// Instrument after mem accesses.
 		          	if (desc_.HookAfterMem()) {
@@ -449,24 +494,36 @@ void ExecutionControl::ContextChange(THREADID tid,CONTEXT_CHANGE_REASON reason,
 }
 
 //each event queue belongs to a specified detection thread
-//there is no need to synchronize
-EventBase *ExecutionControl::GetEventBase(thread_t thd_id)
+bool ExecutionControl::GetEvent(thread_t thd_id,EventRecord *rec)
 {
-	ScopedLock lock(thd_deqlk_table_[thd_id]);
-	DEBUG_ASSERT(thd_deq_table_.find(thd_id)!=thd_deq_table_.end());
-	EventDeque *q=thd_deq_table_[thd_id];
-	if(q->empty())
-		return NULL;
-	EventBase *eb=q->front();
-	q->pop_front();
-	return eb;
+	DEBUG_ASSERT(dtc_queue_table_.find(thd_id)!=dtc_queue_table_.end());
+	return dtc_queue_table_[thd_id]->Pop(rec);
 }
 
 bool ExecutionControl::DetectionDequeEmpty(thread_t thd_id)
 {
-	ScopedLock lock(thd_deqlk_table_[thd_id]);
-	DEBUG_ASSERT(thd_deq_table_.find(thd_id)!=thd_deq_table_.end());
-	return thd_deq_table_[thd_id]->empty();
+	DEBUG_ASSERT(dtc_queue_table_.find(thd_id)!=dtc_queue_table_.end());
+	return dtc_queue_table_[thd_id]->Empty();
+}
+
+//no more events will come to the detection thread
+bool ExecutionControl::DetectionDequeClosed(thread_t thd_id)
+{
+	DEBUG_ASSERT(dtc_queue_table_.find(thd_id)!=dtc_queue_table_.end());
+	return dtc_queue_table_[thd_id]->Closed();
+}
+
+size_t ExecutionControl::GetEvents(thread_t thd_id,EventRecord *recs,size_t max)
+{
+	DEBUG_ASSERT(dtc_queue_table_.find(thd_id)!=dtc_queue_table_.end());
+	return dtc_queue_table_[thd_id]->PopBatch(recs,max);
+}
+
+//spin and then block until new events arrive for the detection thread
+void ExecutionControl::WaitEvent(thread_t thd_id)
+{
+	DEBUG_ASSERT(dtc_queue_table_.find(thd_id)!=dtc_queue_table_.end());
+	dtc_queue_table_[thd_id]->Wait();
 }
 
 //detector thread main function
@@ -475,12 +532,24 @@ void ExecutionControl::CreateDetectionThread(VOID *v)
 	LockKernel();
 	//get the thread_uid
 	thread_t curr_thd_id=PIN_ThreadUid();
-	//create the queue to preserve the event info
-	thd_deq_table_[curr_thd_id]=new EventDeque;
-	//each detection queue shuold be synchronized by a lock
-	thd_deqlk_table_[curr_thd_id]=CreateMutex();
+	//create the queue to preserve the event info, each queue reads the
+	//sync log from the beginning through its own cursor
+	DetectionQueue *queue=new DetectionQueue(sync_log_,partitioner_,
+		dtc_queues_.size(),knob_->ValueInt("handoff_spin"),PIN_MAX_THREADS,
+		CreateSemaphore(0));
+	dtc_queue_table_[curr_thd_id]=queue;
+	dtc_queues_.push_back(queue);
+	//the table is not changed anymore once it is ready
+	if(dtc_queue_table_.size()==(size_t)GetParallelDetectorNumber()) {
+		MEMORY_BARRIER();
+		dtc_ready_=true;
+		dtc_ready_sem_.Post();
+	}
 	UnlockKernel();
 	HandleCreateDetectionThread(curr_thd_id);
+	//the events coming from now on are not waited for
+	queue->Detach();
+	ExitThread(0);
 }
 
 void ExecutionControl::CreateVerificationThread(VOID *v)
@@ -502,7 +571,59 @@ void ExecutionControl::ParallelDetectionThread()
 				==INVALID_THREADID)
 				Abort("Can not spawn internal thread.\n");
 		}	
+		if(prl_dtc_num>1 && knob_->ValueInt("partition_interval")>0) {
+			if(!SpawnInternalThread(__PartitionThread,NULL,0,&partition_thd_uid_))
+				Abort("Can not spawn internal thread.\n");
+		}
+	}
+}
+
+//periodically rebalance the address partition of the detection threads
+void ExecutionControl::PartitionThread(VOID *v)
+{
+	UINT32 interval=knob_->ValueInt("partition_interval");
+	dtc_ready_sem_.Wait();
+	while(!IsProcessExiting()) {
+		Sleep(interval);
+		RebalancePartition();
+	}
+	ExitThread(0);
+}
+
+//the shard moves take effect at a cut of the sync log. the application
+//threads are stopped meanwhile, so the memory events routed by the old
+//owners all reach the rings before the cut, and the later ones are
+//tagged after it.
+void ExecutionControl::RebalancePartition()
+{
+	PartitionPlan *plan=partitioner_->Plan(CreateMutex(),CreateSemaphore(0));
+	if(!plan)
+		return ;
+	THREADID curr_thd_id=PIN_ThreadId();
+	if(!PIN_StopApplicationThreads(curr_thd_id)) {
+		partitioner_->Discard(plan);
+		return ;
 	}
+	for(UINT32 i=0;i<PIN_GetStoppedThreadCount();i++) {
+		THREADID tid=PIN_GetStoppedThreadId(i);
+		VOID *v=PIN_GetThreadData(app_thd_key,tid);
+		if(!v)
+			continue;
+		EventBufferTable *buff_table=(EventBufferTable *)v;
+		for(uint32 index=0;index<buff_table->size();index++)
+			if(!(*buff_table)[index]->Empty())
+				dtc_queues_[index]->Flush(tid,(*buff_table)[index]);
+	}
+	EVENT_CLASS(PartitionMigrate) *event=CREATE_EVENT(PartitionMigrate,plan);
+	event->set_ref(GetParallelDetectorNumber());
+	uint64 seq=sync_log_->Append(event,EVENT_LOG_NO_RING);
+	for(int i=0;i<PIN_MAX_THREADS;i++)
+		tls_sync_seq_[i]=seq;
+	partition_seq_=seq;
+	partitioner_->Apply(plan);
+	PIN_ResumeApplicationThreads(curr_thd_id);
+	for(uint32 index=0;index<dtc_queues_.size();index++)
+		dtc_queues_[index]->Notify();
 }
 
 void ExecutionControl::ParallelVerificationThread()
@@ -530,30 +651,41 @@ int ExecutionControl::GetParallelDetectorNumber()
 	return knob_->ValueInt("parallel_detector_number");
 }
 
+size_t ExecutionControl::GetEventBatchSize()
+{
+	int size=knob_->ValueInt("event_batch_size");
+	return size>0?size:MAX_EVENT_NUM;
+}
+
 int ExecutionControl::GetParallelVerifierNumber()
 {
 	return knob_->ValueInt("parallel_verifier_number");
 }
 
-void ExecutionControl::PushEventBufferToDetectionDeque(thread_t thd_uid,
+//memory events of the current thread go to its own ring
+void ExecutionControl::PushEventBufferToDetectionDeque(uint32 index,
 	EventBuffer *buff)
 {
-	//synchronize the queue of the detector
-	ScopedLock lock(thd_deqlk_table_[thd_uid]);
-	EventDeque *dtc_eb_deq=thd_deq_table_[thd_uid];
-	while(!buff->Empty()) {
-		dtc_eb_deq->push_back(buff->Pop());
-	}
+	dtc_queues_[index]->Flush(PIN_ThreadId(),buff);
+}
+
+uint32 ExecutionControl::GetDetectorIndex(thread_t thd_id)
+{
+	DEBUG_ASSERT(dtc_queue_table_.find(thd_id)!=dtc_queue_table_.end());
+	return dtc_queue_table_[thd_id]->Index();
 }
 
-void ExecutionControl::PushEventToDetectionDeque(thread_t thd_uid,
-	EventBase *eb)
+//non memory events are logged once for all detection threads, the early
+//ones wait in the log until the detection threads are running
+void ExecutionControl::DistributeNonMemEvent(EventBase *event,bool has_ring)
 {
-	//synchronize the queue of the detector
-	ScopedLock lock(thd_deqlk_table_[thd_uid]);
-	EventDeque *dtc_eb_deq=thd_deq_table_[thd_uid];
-	dtc_eb_deq->push_back(eb);
-	// INFO_FMT_PRINT("============detection deque size:[%ld]==========\n",dtc_eb_deq->size());
+	THREADID tid=PIN_ThreadId();
+	event->set_ref(GetParallelDetectorNumber());
+	uint64 seq=sync_log_->Append(event,has_ring?tid:EVENT_LOG_NO_RING);
+	if(has_ring)
+		tls_sync_seq_[tid]=seq;
+	for(uint32 index=0;index<dtc_queues_.size();index++)
+		dtc_queues_[index]->Notify();
 }
 
 void ExecutionControl::FreeEventBuffer()
@@ -562,10 +694,8 @@ void ExecutionControl::FreeEventBuffer()
 	VOID *v=PIN_GetThreadData(app_thd_key,thd_id);
 	if(v) {
 		EventBufferTable *buff_table=(EventBufferTable*)v;
-		for(EventBufferTable::iterator iter=buff_table->begin();
-			iter!=buff_table->end();iter++) {
-			delete iter->second;
-		}
+		for(uint32 index=0;index<buff_table->size();index++)
+			delete (*buff_table)[index];
 		delete buff_table;
 		PIN_SetThreadData(app_thd_key,NULL,thd_id);
 	}
@@ -578,13 +708,14 @@ void ExecutionControl::ProgramExit(INT32 code,VOID *v)
 {
 	HandleProgramExit();
 	//free the queue of each detection thread
-	for(EventDequeTable::iterator iter=thd_deq_table_.begin();
-		iter!=thd_deq_table_.end();iter++)
-		delete iter->second;
-	//free the lock of the queue of each detection thread
-	for(EventDequeLockTable::iterator iter=thd_deqlk_table_.begin();
-		iter!=thd_deqlk_table_.end();iter++)
+	for(DetectionQueueTable::iterator iter=dtc_queue_table_.begin();
+		iter!=dtc_queue_table_.end();iter++)
 		delete iter->second;
+	delete sync_log_;
+	if(partitioner_) {
+		INFO_PRINT(partitioner_->ToString());
+		delete partitioner_;
+	}
 	PIN_DeleteThreadDataKey(app_thd_key);
 
 	//save static info
@@ -598,12 +729,15 @@ void ExecutionControl::ProgramExit(INT32 code,VOID *v)
 void ExecutionControl::FiniUnlocked(INT32 code,VOID *v)
 {
 	if(GetParallelDetectorNumber()>0) {
+		//no event will come anymore, wake the waiting detection threads
+		for(uint32 index=0;index<dtc_queues_.size();index++)
+			dtc_queues_[index]->Close();
 		//wait for the termination of the detection threads
 		BOOL wait_status;
 		INT32 thd_exit_code;
 		BOOL thd_exit_status=TRUE;
-		for(EventDequeTable::iterator iter=thd_deq_table_.begin();
-			iter!=thd_deq_table_.end();iter++) {
+		for(DetectionQueueTable::iterator iter=dtc_queue_table_.begin();
+			iter!=dtc_queue_table_.end();iter++) {
 			wait_status=PIN_WaitForThreadTermination(iter->first,PIN_INFINITE_TIMEOUT,
 				&thd_exit_code);
 			if(!wait_status)
@@ -611,6 +745,12 @@ void ExecutionControl::FiniUnlocked(INT32 code,VOID *v)
 			if(thd_exit_code!=0)
 				thd_exit_status=FALSE;
 		}
+		if(partition_thd_uid_!=INVALID_PIN_THREAD_UID) {
+			wait_status=PIN_WaitForThreadTermination(partition_thd_uid_,
+				PIN_INFINITE_TIMEOUT,&thd_exit_code);
+			if(!wait_status || thd_exit_code!=0)
+				thd_exit_status=FALSE;
+		}
 		if(!thd_exit_status)
 			Abort("At least one of the detection threads exit abnormally.\n");
 	}
@@ -642,6 +782,14 @@ void ExecutionControl::ThreadStart(THREADID tid,CONTEXT *ctxt,INT32 flags,VOID *
 
 	LockKernel();
 	tls_thd_clock_[tid]=0; //init thread clock
+	tls_ignore_[tid]=0;
+	//the start of a thread moves the clock of its parent
+	AdvanceMemGen();
+	if(access_cache_) {
+		delete tls_access_cache_[tid];
+		tls_access_cache_[tid]=new AccessCache;
+		tls_cache_epoch_[tid]=0;
+	}
 	thd_create_sem_map_[os_tid]=CreateSemaphore(0);
 	os_tid_map_[os_tid]=curr_thd_id;
 
@@ -664,22 +812,23 @@ void ExecutionControl::ThreadStart(THREADID tid,CONTEXT *ctxt,INT32 flags,VOID *
 	size_t prl_dtc_num=GetParallelDetectorNumber();
 	if(prl_dtc_num>0) {
 		//wait for all detection threads have been created
-		while(thd_deq_table_.size()!=prl_dtc_num) {
-			Sleep(10);
-		}
-		//create event buffer table
+		if(!dtc_ready_)
+			dtc_ready_sem_.Wait();
+		//create event buffer table and the rings of this thread
 		EventBufferTable *buff_table=new EventBufferTable;
-		for(EventDequeTable::iterator iter=thd_deq_table_.begin();
-			iter!=thd_deq_table_.end();iter++) {
-			EventBuffer *buff=new EventBuffer;
-			(*buff_table)[iter->first]=buff;
+		size_t batch_size=GetEventBatchSize();
+		LockKernel();
+		for(uint32 index=0;index<dtc_queues_.size();index++) {
+			buff_table->push_back(new EventBuffer(batch_size));
+			dtc_queues_[index]->AttachRing(tid,CreateSemaphore(0));
 		}
+		UnlockKernel();
+		//the memory events are routed by the current partition
+		tls_sync_seq_[tid]=partition_seq_;
 		curr_thd_id=PIN_ThreadId();
 		if(!PIN_SetThreadData(app_thd_key,buff_table,curr_thd_id)) {
-			for(EventBufferTable::iterator iter=buff_table->begin();
-				iter!=buff_table->end();iter++) {
-				delete iter->second;
-			}
+			for(uint32 index=0;index<buff_table->size();index++)
+				delete (*buff_table)[index];
 			delete buff_table;
 		}
 	}
@@ -775,6 +924,7 @@ void ExecutionControl::HandleImageUnload(IMG img, Image *image)
       		bss_size = SEC_Size(sec);
     	}
   	}
+  	AdvanceMemGen();
   	CALL_ANALYSIS_FUNC(ImageUnload, image, low_addr, high_addr, data_start,
                      data_size, bss_start, bss_size);
   	if(GetParallelDetectorNumber()>0)
@@ -819,12 +969,14 @@ void ExecutionControl::HandleThreadMain(THREADID tid, CONTEXT *ctxt)
 void ExecutionControl::HandleBeforeMemRead(THREADID tid,Inst *inst,
 	address_t addr,size_t size) 
 {
+	if(RepeatedAccess(tid,inst,addr,size,false))
+		return ;
 	thread_t self=Self();
 	timestamp_t curr_thd_clk=GetThdClk(tid);
 	CALL_ANALYSIS_FUNC2(BeforeMem,BeforeMemRead,self,curr_thd_clk,inst,
 		addr,size);
 	if(GetParallelDetectorNumber()>0) {
-		DISTRIBUTE_MEMORY_EVENT(BeforeMemRead,self,curr_thd_clk,inst,addr,size);
+		DISTRIBUTE_MEMORY_EVENT(BEFORE_MEM_READ,self,curr_thd_clk,inst);
 	}
 }
 
@@ -836,18 +988,20 @@ void ExecutionControl::HandleAfterMemRead(THREADID tid, Inst *inst,
   	CALL_ANALYSIS_FUNC2(AfterMem, AfterMemRead, self, curr_thd_clk,
                       inst, addr, size);
   	if(GetParallelDetectorNumber()>0)
-		DISTRIBUTE_MEMORY_EVENT(AfterMemRead,self,curr_thd_clk,inst,addr,size);
+		DISTRIBUTE_MEMORY_EVENT(AFTER_MEM_READ,self,curr_thd_clk,inst);
 }
 
 void ExecutionControl::HandleBeforeMemWrite(THREADID tid, Inst *inst,
                                             address_t addr, size_t size) 
 {
+  	if(RepeatedAccess(tid,inst,addr,size,true))
+  		return ;
   	thread_t self = Self();
   	timestamp_t curr_thd_clk = GetThdClk(tid);
   	CALL_ANALYSIS_FUNC2(BeforeMem, BeforeMemWrite, self, curr_thd_clk,
                       inst, addr, size);
   	if(GetParallelDetectorNumber()>0)
-		DISTRIBUTE_MEMORY_EVENT(BeforeMemWrite,self,curr_thd_clk,inst,addr,size);
+		DISTRIBUTE_MEMORY_EVENT(BEFORE_MEM_WRITE,self,curr_thd_clk,inst);
 }
 
 void ExecutionControl::HandleAfterMemWrite(THREADID tid, Inst *inst,
@@ -858,13 +1012,14 @@ void ExecutionControl::HandleAfterMemWrite(THREADID tid, Inst *inst,
   	CALL_ANALYSIS_FUNC2(AfterMem, AfterMemWrite, self, curr_thd_clk,
                       inst, addr, size);
   	if(GetParallelDetectorNumber()>0)
-		DISTRIBUTE_MEMORY_EVENT(AfterMemWrite,self,curr_thd_clk,inst,addr,size);
+		DISTRIBUTE_MEMORY_EVENT(AFTER_MEM_WRITE,self,curr_thd_clk,inst);
 }
 
 void ExecutionControl::HandleBeforeAtomicInst(THREADID tid, Inst *inst,
                                               OPCODE opcode, address_t addr) 
 {
   	thread_t self = Self();
+  	AdvanceCacheEpoch(tid);
   	timestamp_t curr_thd_clk = GetThdClk(tid);
   	std::string type = OPCODE_StringShort(opcode);
   	CALL_ANALYSIS_FUNC2(AtomicInst, BeforeAtomicInst, self, curr_thd_clk,
@@ -878,6 +1033,7 @@ void ExecutionControl::HandleAfterAtomicInst(THREADID tid, Inst *inst,
                                              OPCODE opcode, address_t addr) 
 {
   	thread_t self = Self();
+  	AdvanceCacheEpoch(tid);
   	timestamp_t curr_thd_clk = GetThdClk(tid);
   	//string with instruction opcode
   	std::string type = OPCODE_StringShort(opcode); 
@@ -935,11 +1091,15 @@ void ExecutionControl::HandleAfterReturn(THREADID tid, Inst *inst,
 
 //Arround the wrapper handlers
 void ExecutionControl::HandleBeforeWrapper(WrapperBase *wrapper) {
-  // Nothing.
+  AdvanceCacheEpoch(wrapper->tid());
+  // The wrapper events stand for the accesses of the wrapped library code.
+  tls_ignore_[wrapper->tid()]++;
 }
 
 void ExecutionControl::HandleAfterWrapper(WrapperBase *wrapper) 
 {
+  AdvanceCacheEpoch(wrapper->tid());
+  tls_ignore_[wrapper->tid()]--;
   // Simulate a return if call stack is being tracked. This is because the
   // return target will be changed by PIN (not transparent) for each function
   // that has a wrapper defined.
@@ -1151,6 +1311,13 @@ void ExecutionControl::__ThreadMain(THREADID tid,CONTEXT *ctxt)
 	ctrl_->HandleThreadMain(tid,ctxt);
 }
 
+//Straight-line so that pin can inline it. The stack accesses are already
+//left out at instrumentation when they are skipped.
+ADDRINT PIN_FAST_ANALYSIS_CALL ExecutionControl::__IfMemAccess(THREADID tid)
+{
+	return ctrl_->tls_ignore_[tid]==0;
+}
+
 void ExecutionControl::__BeforeMemRead(THREADID tid, Inst *inst,
                                        ADDRINT addr, UINT32 size) 
 {
@@ -1595,6 +1762,7 @@ IMPLEMENT_WRAPPER_HANDLER(Calloc, ExecutionControl)
 
 IMPLEMENT_WRAPPER_HANDLER(Realloc, ExecutionControl) 
 {
+  	AdvanceMemGen();
   	thread_t self = Self();
   	Inst *inst = GetInst(wrapper->ret_addr());
   	CALL_ANALYSIS_FUNC2(MallocFunc,
@@ -1628,6 +1796,7 @@ IMPLEMENT_WRAPPER_HANDLER(Realloc, ExecutionControl)
 
 IMPLEMENT_WRAPPER_HANDLER(Free, ExecutionControl) 
 {
+  	AdvanceMemGen();
   	thread_t self = Self();
   	Inst *inst = GetInst(wrapper->ret_addr());
   	CALL_ANALYSIS_FUNC2(MallocFunc,
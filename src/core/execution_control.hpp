@@ -17,6 +17,9 @@
 #include "core/pin_sync.hpp"
 #include "core/pin_knob.h"
 #include "core/wrapper.hpp"
+#include "core/access_cache.h"
+#include "core/partition.h"
+#include "core/detection_queue.h"
 #include "event.h"
 
 //Define macros for calling analysis functions.
@@ -132,28 +135,31 @@
 
 #define TLS_MAX_EVENT 10
 
-#define DISTRIBUTE_MEMORY_EVENT(Name,...) do {									\
+//memory events are plain records split into units, no event object is
+//allocated for them
+#define DISTRIBUTE_MEMORY_EVENT(Id,Thd,Clk,Ins) do {							\
 	address_t unit_size_=GetUnitSize();											\
 	thread_t thd_id=PIN_ThreadId();												\
 	VOID *v=PIN_GetThreadData(app_thd_key,thd_id);								\
 	DEBUG_ASSERT(v);															\
 	EventBufferTable *buff_table=(EventBufferTable *)v;							\
-	size_t prl_dtc_num=buff_table->size();										\
-	EventBufferTable::iterator iter;											\
+	EventRecord rec;															\
+	rec.id=Id;																	\
+	rec.seq=tls_sync_seq_[thd_id];												\
+	rec.mem.thd_id=Thd;															\
+	rec.mem.thd_clk=Clk;														\
+	rec.mem.inst=Ins;															\
+	rec.mem.size=unit_size_;													\
 	address_t start_addr=UNIT_DOWN_ALIGN(addr,unit_size_);						\
 	address_t end_addr=UNIT_UP_ALIGN(addr+size,unit_size_);						\
 	for(address_t curr_addr=start_addr;curr_addr<end_addr;						\
 		curr_addr+=unit_size_) {												\
-		EVENT_CLASS(Name) *event=CREATE_EVENT(Name,__VA_ARGS__);				\
-		event->arg3_=curr_addr;													\
-		event->arg4_=unit_size_;												\
-		iter=buff_table->begin();												\
-		int index=(curr_addr/unit_size_)%prl_dtc_num;							\
-		std::advance(iter,index);												\
-		EventBuffer *buff=iter->second;											\
+		rec.mem.addr=curr_addr;													\
+		uint32 index=partitioner_->Owner(curr_addr);							\
+		EventBuffer *buff=(*buff_table)[index];									\
 		if(buff->Full())														\
-			PushEventBufferToDetectionDeque(iter->first,buff);					\
-		buff->Push(event);														\
+			PushEventBufferToDetectionDeque(index,buff);						\
+		buff->Push(rec);														\
 	} 																			\
 	} while(0)													
 
@@ -163,31 +169,13 @@
 	EVENT_CLASS(Name) *event=CREATE_EVENT(Name,__VA_ARGS__);					\
 	if(v) {																		\
 		EventBufferTable *buff_table=(EventBufferTable *)v;						\
-		for(EventBufferTable::iterator iter=buff_table->begin();				\
-			iter!=buff_table->end();iter++) {									\
-			EventBuffer *buff=iter->second;										\
+		for(uint32 index=0;index<buff_table->size();index++) {					\
+			EventBuffer *buff=(*buff_table)[index];								\
 			if(!buff->Empty())													\
-				PushEventBufferToDetectionDeque(iter->first,buff);				\
+				PushEventBufferToDetectionDeque(index,buff);					\
 		}																		\
 	}																			\
-	if(thd_deq_table_.empty())													\
-		pre_event_deq_.push_back(event);										\
-	else {																		\
-		while(!pre_event_deq_.empty()) {										\
-			EventBase *pre_event=pre_event_deq_.front();						\
-			pre_event_deq_.pop_front();											\
-			pre_event->set_ref(GetParallelDetectorNumber());					\
-			for(EventDequeTable::iterator iter=thd_deq_table_.begin();			\
-				iter!=thd_deq_table_.end();iter++) {							\
-				PushEventToDetectionDeque(iter->first,pre_event);				\
-			} 																	\
-		}																		\
-		event->set_ref(GetParallelDetectorNumber());							\
-		for(EventDequeTable::iterator iter=thd_deq_table_.begin();				\
-			iter!=thd_deq_table_.end();iter++) {								\
-			PushEventToDetectionDeque(iter->first,event);						\
-		} 																		\
-	}																			\
+	DistributeNonMemEvent(event,v!=NULL);										\
 	} while(0)
 
 //The main controller for the dynamic program analysis.
@@ -210,16 +198,19 @@ public:
 	void ThreadStart(THREADID tid,CONTEXT *ctxt,INT32 FLAGS,VOID *v);
 	void ThreadExit(THREADID tid,const CONTEXT *ctxt,INT32 code,VOID *v);
 	//parallel detection
-	typedef std::deque<EventBase *> EventDeque;
-	typedef std::map<thread_t,EventDeque *> EventDequeTable;
-	typedef std::map<thread_t,Mutex *> EventDequeLockTable;
-	typedef std::map<thread_t,EventBuffer *> EventBufferTable;
+	//the buffers of an application thread, indexed by the detection thread
+	typedef std::vector<EventBuffer *> EventBufferTable;
+	typedef std::map<thread_t,DetectionQueue *> DetectionQueueTable;
 	//parallel detection
 	void ParallelDetectionThread();	
 	void CreateDetectionThread(VOID *);
 	static void __CreateDetectionThread(VOID *v) {
 		ctrl_->CreateDetectionThread(v);
 	}
+	void PartitionThread(VOID *);
+	static void __PartitionThread(VOID *v) {
+		ctrl_->PartitionThread(v);
+	}
 	//parallel verification
 	void ParallelVerificationThread();
 	void CreateVerificationThread(VOID *);
@@ -288,19 +279,39 @@ protected:
   	thread_t GetParent();
   	thread_t Self() { return PIN_ThreadUid(); }
   	timestamp_t GetThdClk(THREADID tid) { return tls_thd_clock_[tid]; }
+  	//every sync event of a thread starts a new access cache epoch, the
+  	//thread clock seen by the analyzers is left alone
+  	void AdvanceCacheEpoch(THREADID tid) {
+  		if(access_cache_)
+  			tls_cache_epoch_[tid]++;
+  	}
+  	//released memory and new threads invalidate the access caches of all
+  	//threads
+  	void AdvanceMemGen() { ATOMIC_ADD_AND_FETCH(&mem_gen_,1); }
+  	bool RepeatedAccess(THREADID tid,Inst *inst,address_t addr,size_t size,
+  		bool is_write) {
+  		return access_cache_ && tls_access_cache_[tid]->Hit(inst,addr,size,
+  			is_write,tls_cache_epoch_[tid],mem_gen_);
+  	}
 
   	thread_t WaitForNewChild(WRAPPER_CLASS(PthreadCreate) *wrapper);
   	void ReplacePthreadCreateWrapper(IMG img);
   	void ReplacePthreadWrappers(IMG img);
   	void ReplaceMallocWrappers(IMG img);
   	//parallel detection
-  	EventBase *GetEventBase(thread_t thd_id);
+  	bool GetEvent(thread_t thd_id,EventRecord *rec);
+  	size_t GetEvents(thread_t thd_id,EventRecord *recs,size_t max);
   	bool DetectionDequeEmpty(thread_t thd_id);
+  	bool DetectionDequeClosed(thread_t thd_id);
+  	void WaitEvent(thread_t thd_id);
+  	void DistributeNonMemEvent(EventBase *event,bool has_ring);
   	virtual address_t GetUnitSize() { return 0; }
   	void FreeEventBuffer();
-  	void PushEventBufferToDetectionDeque(thread_t thd_uid,EventBuffer *buff);
-  	void PushEventToDetectionDeque(thread_t thd_uid,EventBase *eb);
+  	void PushEventBufferToDetectionDeque(uint32 index,EventBuffer *buff);
   	int GetParallelDetectorNumber();
+  	size_t GetEventBatchSize();
+  	uint32 GetDetectorIndex(thread_t thd_id);
+  	void RebalancePartition();
   	//parallel verification
   	int GetParallelVerifierNumber();
 
@@ -323,6 +334,13 @@ protected:
  	address_t tls_read2_addr_[PIN_MAX_THREADS];
  	size_t tls_read2_size_[PIN_MAX_THREADS];
  	address_t tls_atomic_addr_[PIN_MAX_THREADS];
+ 	//same epoch access filtering
+ 	bool access_cache_;
+ 	volatile uint32 mem_gen_;
+ 	AccessCache *tls_access_cache_[PIN_MAX_THREADS];
+ 	uint64 tls_cache_epoch_[PIN_MAX_THREADS];
+ 	//reject state checked inline before the memory handlers
+ 	uint32 tls_ignore_[PIN_MAX_THREADS];
 
  	std::map<OS_THREAD_ID,Semaphore *> thd_create_sem_map_; //init=0
  	std::map<OS_THREAD_ID,thread_t> child_thd_map_;
@@ -332,9 +350,16 @@ protected:
  	std::vector<std::string> static_profile_;
  	std::tr1::unordered_set<uint64> instrumented_lines_;
  	//detection thread queue
- 	EventDeque pre_event_deq_;
- 	EventDequeTable thd_deq_table_;
- 	EventDequeLockTable thd_deqlk_table_;
+ 	DetectionQueueTable dtc_queue_table_;
+ 	std::vector<DetectionQueue *> dtc_queues_;
+ 	volatile bool dtc_ready_;
+ 	PinSemaphore dtc_ready_sem_;
+ 	EventLog *sync_log_;
+ 	uint64 tls_sync_seq_[PIN_MAX_THREADS];
+ 	//memory events are routed by the owner of their address shard
+ 	Partitioner *partitioner_;
+ 	volatile uint64 partition_seq_;
+ 	PIN_THREAD_UID partition_thd_uid_;
 
  	std::map<RTN,std::string> rtn_funcname_map_;
  	std::set<thread_t> vrf_thd_set_;
@@ -343,6 +368,8 @@ protected:
  private:
  	void InstrumentStartupFunc(IMG img);
  	bool FilterNonPotentialInstrument(std::string &filename,INT32 &line,INS ins);
+ 	void InsertBeforeMemCall(INS ins,AFUNPTR func,Inst *inst,IARG_TYPE ea,
+ 		IARG_TYPE size);
 
  	uint64 FilenameAndLineHash(std::string &file_name,int line) {
 		uint64 key=0;
@@ -362,6 +389,7 @@ protected:
 
  	static void __Main(THREADID tid,CONTEXT *ctxt);
  	static void __ThreadMain(THREADID ,CONTEXT *ctxt);
+ 	static ADDRINT PIN_FAST_ANALYSIS_CALL __IfMemAccess(THREADID tid);
  	static void __BeforeMemRead(THREADID tid, Inst *inst, ADDRINT addr,
                            			UINT32 size);
  	static void __AfterMemRead(THREADID tid, Inst *inst);
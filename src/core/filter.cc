@@ -1,10 +1,34 @@
 #include "core/filter.h"
+#include <cstdlib>
+#include "core/atomic.h"
 
+const RegionFilter::PageEntry RegionFilter::PAGE_NONE;
+const RegionFilter::PageEntry RegionFilter::PAGE_FULL;
+
+RegionFilter::~RegionFilter()
+{
+	if(l1Table) {
+		for(size_t i=0;i<((size_t)1<<FILTER_L1_BITS);i++) {
+			if(!l1Table[i])
+				continue;
+			for(size_t j=0;j<((size_t)1<<FILTER_L2_BITS);j++)
+				if(l1Table[i][j]>PAGE_FULL)
+					delete [] (uint64 *)l1Table[i][j];
+			free((void *)l1Table[i]);
+		}
+		free((void *)l1Table);
+	}
+	delete internalLock;
+}
 
 void RegionFilter::AddRegion(address_t addr,size_t size,bool locking)
 {
 	ScopedLock slock(internalLock,locking);
+	std::map<address_t,size_t>::iterator it=addrRegionMap.find(addr);
+	if(it!=addrRegionMap.end())
+		MarkRange(addr,addr+it->second,false);
 	addrRegionMap[addr]=size;
+	MarkRange(addr,addr+size,true);
 }
 
 size_t RegionFilter::RemoveRegion(address_t addr,bool locking)
@@ -16,24 +40,114 @@ size_t RegionFilter::RemoveRegion(address_t addr,bool locking)
 	if(it!=addrRegionMap.end()) {
 		size=it->second;
 		addrRegionMap.erase(it);
+		MarkRange(addr,addr+size,false);
 	}
 	return size;
 }
 //Addresses not in region should be filtered
 bool RegionFilter::Filter(address_t addr,bool locking)
 {
-	ScopedLock slock(internalLock,locking);
-
-	if(addrRegionMap.begin()==addrRegionMap.end())
+	if(addr>>FILTER_ADDR_BITS)
+		return FilterWide(addr,locking);
+	volatile PageEntry *entry=GetPageEntry(addr,false);
+	if(!entry)
+		return true;
+	PageEntry page=*entry;
+	if(page==PAGE_NONE)
 		return true;
+	if(page==PAGE_FULL)
+		return false;
+	size_t off=addr & ((1<<FILTER_PAGE_BITS)-1);
+	volatile uint64 *bits=(volatile uint64 *)page;
+	return !(bits[off>>6] & ((uint64)1<<(off & 63)));
+}
+
+//the page index stops at the address bits, a wider address is looked up
+//in the region map
+bool RegionFilter::FilterWide(address_t addr,bool locking)
+{
+	ScopedLock slock(internalLock,locking);
 	std::map<address_t,size_t>::iterator it=addrRegionMap.upper_bound(addr);
 	if(it==addrRegionMap.begin())
 		return true;
+	--it;
+	return addr-it->first>=it->second;
+}
 
-	it--;
-	address_t regionStart=it->first;
-	size_t regionSize=it->second;
-	if(addr>=regionStart && addr<regionStart+regionSize)
-		return false;
-	return true;
-}
\ No newline at end of file
+volatile RegionFilter::PageEntry *RegionFilter::GetPageEntry(address_t addr,
+	bool create)
+{
+	size_t i1=(size_t)(addr>>(FILTER_PAGE_BITS+FILTER_L2_BITS));
+	size_t i2=(size_t)(addr>>FILTER_PAGE_BITS) & (((size_t)1<<FILTER_L2_BITS)-1);
+	if(i1>=((size_t)1<<FILTER_L1_BITS))
+		return NULL;
+	if(!l1Table) {
+		if(!create)
+			return NULL;
+		//calloc'ed so that untouched directory pages stay unbacked
+		volatile PageEntry **l1=(volatile PageEntry **)calloc(
+			(size_t)1<<FILTER_L1_BITS,sizeof(PageEntry *));
+		MEMORY_BARRIER();
+		l1Table=l1;
+	}
+	if(!l1Table[i1]) {
+		if(!create)
+			return NULL;
+		volatile PageEntry *l2=(volatile PageEntry *)calloc(
+			(size_t)1<<FILTER_L2_BITS,sizeof(PageEntry));
+		MEMORY_BARRIER();
+		l1Table[i1]=l2;
+	}
+	return &l1Table[i1][i2];
+}
+
+//mirror [start,end) into the page index, writers are serialized
+void RegionFilter::MarkRange(address_t start,address_t end,bool tracked)
+{
+	address_t page_size=(address_t)1<<FILTER_PAGE_BITS;
+	for(address_t pg_addr=start;pg_addr<end;) {
+		address_t pg_start=pg_addr & ~(page_size-1);
+		address_t pg_end=pg_start+page_size;
+		if(pg_end>end || pg_end==0)
+			pg_end=end;
+		volatile PageEntry *entry=GetPageEntry(pg_addr,tracked);
+		if(entry)
+			MarkPage(entry,pg_addr-pg_start,pg_end-pg_start,tracked);
+		pg_addr=pg_end;
+	}
+}
+
+void RegionFilter::MarkPage(volatile PageEntry *entry,size_t lo,size_t hi,
+	bool tracked)
+{
+	size_t page_size=1<<FILTER_PAGE_BITS;
+	PageEntry page=*entry;
+	//whole page transitions need no bitmap
+	if(lo==0 && hi==page_size && page<=PAGE_FULL) {
+		*entry=tracked?PAGE_FULL:PAGE_NONE;
+		return ;
+	}
+	if((page==PAGE_NONE && !tracked) || (page==PAGE_FULL && tracked))
+		return ;
+	if(page<=PAGE_FULL) {
+		//fill the bitmap before publishing it
+		uint64 *bits=new uint64[FILTER_PAGE_WORDS];
+		for(size_t i=0;i<FILTER_PAGE_WORDS;i++)
+			bits[i]=(page==PAGE_FULL)?~(uint64)0:0;
+		MEMORY_BARRIER();
+		*entry=(PageEntry)bits;
+		page=(PageEntry)bits;
+	}
+	volatile uint64 *bits=(volatile uint64 *)page;
+	for(size_t i=lo;i<hi;) {
+		size_t w=i>>6;
+		size_t b=i & 63;
+		size_t n=(hi-i<64-b)?hi-i:64-b;
+		uint64 mask=(n==64)?~(uint64)0:(((uint64)1<<n)-1)<<b;
+		if(tracked)
+			ATOMIC_FETCH_AND_OR(&bits[w],mask);
+		else
+			ATOMIC_FETCH_AND_AND(&bits[w],~mask);
+		i+=n;
+	}
+}
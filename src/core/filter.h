@@ -3,6 +3,15 @@
 
 /**
  * Define address filters.
+ *
+ * The region map is only changed on malloc/free and image load, while
+ * Filter runs on every access. Updates still go through the map under the
+ * lock, and are mirrored into a page index that readers query without any
+ * lock. A page is either untracked, fully tracked, or carries a byte
+ * bitmap. Bitmaps are never freed while the filter lives, so a reader never
+ * sees a released page. The index covers 48-bit addresses, the wider ones
+ * are looked up in the map under the lock. Regions are assumed not to
+ * overlap.
  */
 
 #include <map>
@@ -10,23 +19,41 @@
 #include "core/sync.h"
 #include "core/log.h"
 
+#define FILTER_ADDR_BITS 48
+#define FILTER_PAGE_BITS 12
+#define FILTER_L2_BITS 16
+#define FILTER_L1_BITS (FILTER_ADDR_BITS-FILTER_L2_BITS-FILTER_PAGE_BITS)
+#define FILTER_PAGE_WORDS ((1<<FILTER_PAGE_BITS)/64)
+
 class RegionFilter {
 public:
-	explicit RegionFilter(Mutex *lock):internalLock(lock) {}
-	~RegionFilter() { delete internalLock; }
+	explicit RegionFilter(Mutex *lock):internalLock(lock),l1Table(NULL) {}
+	~RegionFilter();
 
 	void AddRegion(address_t addr,size_t size) { AddRegion(addr,size,true); }
 	size_t RemoveRegion(address_t addr) { return RemoveRegion(addr,true); }
 	bool Filter(address_t addr) { return Filter(addr,true); }
 
 	void AddRegion(address_t addr,size_t size,bool locking);
-	size_t RemoveRegion(address_t addr,bool locking); 
+	size_t RemoveRegion(address_t addr,bool locking);
+	//lock free, locking only applies to the addresses beyond the index
 	bool Filter(address_t addr, bool locking);
 
 private:
+	//page entry: untracked, fully tracked, or the page bitmap
+	typedef uint64 PageEntry;
+	static const PageEntry PAGE_NONE=0;
+	static const PageEntry PAGE_FULL=1;
+
+	bool FilterWide(address_t addr,bool locking);
+	volatile PageEntry *GetPageEntry(address_t addr,bool create);
+	void MarkRange(address_t start,address_t end,bool tracked);
+	void MarkPage(volatile PageEntry *entry,size_t lo,size_t hi,bool tracked);
+
 	Mutex *internalLock;
 	std::map<address_t,size_t> addrRegionMap;
+	volatile PageEntry ** volatile l1Table;
 	DISALLOW_COPY_CONSTRUCTORS(RegionFilter);
 };
 
-#endif /* __CORE_FILTER_H */
\ No newline at end of file
+#endif /* __CORE_FILTER_H */
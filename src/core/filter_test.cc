@@ -0,0 +1,110 @@
+#include "core/filter.h"
+#include "core/unit_test.h"
+
+#define PAGE_SIZE ((address_t)1<<FILTER_PAGE_BITS)
+
+//every byte of [start,end) has the expected state, the bytes around it are
+//checked by the callers
+static void ExpectTracked(RegionFilter *filter,address_t start,address_t end,
+	bool tracked)
+{
+	for(address_t addr=start;addr<end;addr++)
+		EXPECT_EQ(filter->Filter(addr),!tracked);
+}
+
+//regions inside a page and across page ends get a byte bitmap
+void TestPartialPages()
+{
+	RegionFilter filter(new SysMutex);
+	address_t base=0x10000000;
+	filter.AddRegion(base+10,20);
+	filter.AddRegion(base+100,1);
+	filter.AddRegion(base+PAGE_SIZE-7,14);
+	ExpectTracked(&filter,base,base+10,false);
+	ExpectTracked(&filter,base+10,base+30,true);
+	ExpectTracked(&filter,base+30,base+100,false);
+	ExpectTracked(&filter,base+100,base+101,true);
+	ExpectTracked(&filter,base+101,base+PAGE_SIZE-7,false);
+	ExpectTracked(&filter,base+PAGE_SIZE-7,base+PAGE_SIZE+7,true);
+	ExpectTracked(&filter,base+PAGE_SIZE+7,base+2*PAGE_SIZE,false);
+	//removing one region keeps its neighbours in the same page
+	EXPECT_EQ(filter.RemoveRegion(base+10),20);
+	ExpectTracked(&filter,base,base+100,false);
+	ExpectTracked(&filter,base+100,base+101,true);
+	EXPECT_EQ(filter.RemoveRegion(base+10),0);
+}
+
+//whole pages switch without a bitmap, and a bitmap page can become whole
+void TestWholePages()
+{
+	RegionFilter filter(new SysMutex);
+	address_t base=0x20000000;
+	filter.AddRegion(base,3*PAGE_SIZE);
+	EXPECT_TRUE(filter.Filter(base-1));
+	ExpectTracked(&filter,base,base+3*PAGE_SIZE,true);
+	EXPECT_TRUE(filter.Filter(base+3*PAGE_SIZE));
+	EXPECT_EQ(filter.RemoveRegion(base),3*PAGE_SIZE);
+	ExpectTracked(&filter,base,base+3*PAGE_SIZE,false);
+	//a page split by two regions is tracked whole when both are there
+	filter.AddRegion(base,PAGE_SIZE/2);
+	filter.AddRegion(base+PAGE_SIZE/2,PAGE_SIZE/2);
+	ExpectTracked(&filter,base,base+PAGE_SIZE,true);
+	filter.RemoveRegion(base);
+	ExpectTracked(&filter,base,base+PAGE_SIZE/2,false);
+	ExpectTracked(&filter,base+PAGE_SIZE/2,base+PAGE_SIZE,true);
+	//a whole page region over a bitmap page
+	filter.RemoveRegion(base+PAGE_SIZE/2);
+	filter.AddRegion(base,PAGE_SIZE);
+	ExpectTracked(&filter,base,base+PAGE_SIZE,true);
+	filter.RemoveRegion(base);
+	ExpectTracked(&filter,base,base+PAGE_SIZE,false);
+}
+
+//a region added again at the same address replaces the old one
+void TestReAdd()
+{
+	RegionFilter filter(new SysMutex);
+	address_t base=0x30000000;
+	filter.AddRegion(base,2*PAGE_SIZE);
+	filter.AddRegion(base,16);
+	ExpectTracked(&filter,base,base+16,true);
+	ExpectTracked(&filter,base+16,base+2*PAGE_SIZE,false);
+	EXPECT_EQ(filter.RemoveRegion(base),16);
+	filter.AddRegion(base,100);
+	ExpectTracked(&filter,base,base+100,true);
+	EXPECT_TRUE(filter.Filter(base+100));
+	EXPECT_EQ(filter.RemoveRegion(base),100);
+	ExpectTracked(&filter,base,base+100,false);
+}
+
+//the addresses beyond the page index are still tracked
+void TestWideAddress()
+{
+	RegionFilter filter(new SysMutex);
+	address_t bound=(address_t)1<<FILTER_ADDR_BITS;
+	filter.AddRegion(bound+0x1000,64);
+	EXPECT_TRUE(filter.Filter(bound+0xfff));
+	ExpectTracked(&filter,bound+0x1000,bound+0x1040,true);
+	EXPECT_TRUE(filter.Filter(bound+0x1040));
+	//the low alias is not tracked
+	EXPECT_TRUE(filter.Filter(0x1000));
+	//a region across the bound
+	filter.AddRegion(bound-32,64);
+	ExpectTracked(&filter,bound-32,bound+32,true);
+	EXPECT_TRUE(filter.Filter(bound-33));
+	EXPECT_TRUE(filter.Filter(bound+32));
+	EXPECT_EQ(filter.RemoveRegion(bound+0x1000),64);
+	EXPECT_TRUE(filter.Filter(bound+0x1000));
+	EXPECT_EQ(filter.RemoveRegion(bound-32),64);
+	ExpectTracked(&filter,bound-32,bound+32,false);
+	EXPECT_TRUE(filter.Filter(~(address_t)0));
+}
+
+int main(int argc,char *argv[])
+{
+	RUN_TEST(TestPartialPages);
+	RUN_TEST(TestWholePages);
+	RUN_TEST(TestReAdd);
+	RUN_TEST(TestWideAddress);
+	return UNIT_TEST_RESULT();
+}
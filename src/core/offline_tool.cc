@@ -68,7 +68,7 @@ void OfflineTool::Exit()
 	HandleExit();
 	// save static info
 	if(!read_only_)
-		sinfo_in->Save(knob_->ValueStr("sinfo_out"));
+		sinfo_->Save(knob_->ValueStr("sinfo_out"));
 	if(debug_file_)
 		debug_file_->Close();
 	// finilize log
@@ -8,8 +8,12 @@ srcs += \
 	core/descriptor.cc \
 	core/callstack.cc \
 	core/knob.cc \
+	core/cmdline_knob.cc \
+	core/offline_tool.cc \
 	core/execution_control.cpp \
+	core/detection_queue.cc \
 	core/filter.cc \
+	core/partition.cc \
 	core/lock_set.cc \
 	core/log.cc \
 	core/pin_knob.cpp \
@@ -17,6 +21,7 @@ srcs += \
 	core/static_info.cc \
 	core/static_info.pb.cc \
 	core/vector_clock.cc \
+	core/tree_clock.cc \
 	core/segment_set.cc \
 	core/wrapper.cpp 
 
@@ -26,7 +31,9 @@ core_objs := \
 	core/callstack.o \
 	core/knob.o \
 	core/execution_control.o \
+	core/detection_queue.o \
 	core/filter.o \
+  	core/partition.o \
   	core/lock_set.o \
   	core/log.o \
   	core/pin_knob.o \
@@ -34,6 +41,63 @@ core_objs := \
   	core/static_info.o \
   	core/static_info.pb.o \
   	core/vector_clock.o \
+  	core/tree_clock.o \
   	core/segment_set.o \
   	core/wrapper.o
 
+# the objects of the offline tools, which run outside of pin
+core_offline_objs := \
+	core/debug_analyzer.o \
+	core/descriptor.o \
+	core/knob.o \
+	core/cmdline_knob.o \
+	core/offline_tool.o \
+	core/filter.o \
+	core/partition.o \
+	core/lock_set.o \
+	core/log.o \
+	core/static_info.o \
+	core/static_info.pb.o \
+	core/vector_clock.o \
+	core/tree_clock.o \
+	core/segment_set.o
+
+# the unit tests of the offline code, run by make test
+srcs += \
+	core/detection_queue_test.cc \
+	core/filter_test.cc \
+	core/partition_test.cc \
+	core/shadow_memory_test.cc \
+	core/vector_clock_test.cc
+
+tests += \
+	core_detection_queue_test \
+	core_filter_test \
+	core_partition_test \
+	core_shadow_memory_test \
+	core_vector_clock_test
+
+core_detection_queue_test_objs := \
+	core/detection_queue_test.o \
+	core/detection_queue.o \
+	core/partition.o \
+	core/log.o
+
+core_filter_test_objs := \
+	core/filter_test.o \
+	core/filter.o \
+	core/log.o
+
+core_partition_test_objs := \
+	core/partition_test.o \
+	core/partition.o
+
+core_shadow_memory_test_objs := \
+	core/shadow_memory_test.o \
+	core/log.o
+
+core_vector_clock_test_objs := \
+	core/vector_clock_test.o \
+	core/vector_clock.o \
+	core/tree_clock.o \
+	core/log.o
@@ -0,0 +1,217 @@
+#include "core/partition.h"
+#include <algorithm>
+#include <sstream>
+#include "core/atomic.h"
+
+PartitionPlan::PartitionPlan(Partitioner *partitioner,uint32 owner_num,
+	Mutex *lock,Semaphore *sem)
+	:partitioner_(partitioner),owner_num_(owner_num),move_num_(0),sent_(0),
+	waiting_(0),done_(0),lock_(lock),sem_(sem)
+{
+	source_.resize(PARTITION_SHARD_NUM,PARTITION_NO_OWNER);
+	target_.resize(PARTITION_SHARD_NUM,PARTITION_NO_OWNER);
+	outgoing_.resize(owner_num,false);
+	inbox_.resize(owner_num);
+	sent_num_.resize(owner_num,0);
+	states_.resize(owner_num,OWNER_PENDING);
+}
+
+PartitionPlan::~PartitionPlan()
+{
+	delete lock_;
+	delete sem_;
+}
+
+void PartitionPlan::AddMove(uint32 shard,uint32 from,uint32 to)
+{
+	source_[shard]=from;
+	target_[shard]=to;
+	outgoing_[from]=true;
+	move_num_++;
+}
+
+void PartitionPlan::Send(uint32 to,void *meta)
+{
+	ScopedLock lock(lock_);
+	inbox_[to].push_back(meta);
+	sent_num_[to]++;
+}
+
+//under the lock, the last owner to arrive releases the waiting ones
+void PartitionPlan::Arrive()
+{
+	if(++sent_==owner_num_) {
+		for(uint32 i=0;i<waiting_;i++)
+			sem_->Post();
+	}
+}
+
+void PartitionPlan::FinishSend(uint32 owner)
+{
+	lock_->Lock();
+	states_[owner]=OWNER_SENT;
+	waiting_++;
+	Arrive();
+	lock_->Unlock();
+	sem_->Wait();
+}
+
+void PartitionPlan::Finish(uint32 owner)
+{
+	lock_->Lock();
+	states_[owner]=OWNER_DONE;
+	bool last=++done_==owner_num_;
+	lock_->Unlock();
+	if(last)
+		partitioner_->Retire(this);
+}
+
+//the metas sent to the owner stay in its inbox, it is exiting
+bool PartitionPlan::Leave(uint32 owner)
+{
+	ScopedLock lock(lock_);
+	if(states_[owner]!=OWNER_PENDING)
+		return false;
+	states_[owner]=OWNER_DONE;
+	Arrive();
+	return ++done_==owner_num_;
+}
+
+Partitioner::Partitioner(uint32 owner_num,Mutex *lock)
+	:owner_num_(owner_num),rebalance_num_(0),lock_(lock)
+{
+	for(uint32 i=0;i<PARTITION_SHARD_NUM;i++)
+		owners_[i]=i%owner_num;
+	for(uint32 i=0;i<owner_num;i++)
+		loads_.push_back(new OwnerLoad);
+	detached_.resize(owner_num,false);
+}
+
+Partitioner::~Partitioner()
+{
+	for(size_t i=0;i<loads_.size();i++)
+		delete loads_[i];
+	for(size_t i=0;i<plans_.size();i++)
+		delete plans_[i];
+	delete lock_;
+}
+
+PartitionPlan *Partitioner::Plan(Mutex *lock,Semaphore *sem)
+{
+	ScopedLock plan_lock(lock_);
+	//the loads of the last period, read while the owners keep counting
+	std::vector<uint64> owner_load(owner_num_,0);
+	std::vector<uint64> shard_load(PARTITION_SHARD_NUM,0);
+	uint64 sum=0;
+	uint32 attached_num=0,hi=owner_num_,lo=owner_num_;
+	for(uint32 i=0;i<owner_num_;i++) {
+		OwnerLoad *load=loads_[i];
+		uint64 total=load->total;
+		owner_load[i]=total-load->base;
+		load->base=total;
+		for(uint32 j=0;j<PARTITION_SHARD_NUM;j++) {
+			uint64 curr=load->shards[j];
+			shard_load[j]+=curr-load->bases[j];
+			load->bases[j]=curr;
+		}
+		if(detached_[i])
+			continue;
+		sum+=owner_load[i];
+		attached_num++;
+		if(hi==owner_num_ || owner_load[i]>owner_load[hi])
+			hi=i;
+		if(lo==owner_num_ || owner_load[i]<owner_load[lo])
+			lo=i;
+	}
+	if(attached_num<2 || sum<PARTITION_MIN_LOAD ||
+		!PARTITION_IMBALANCE(owner_load[hi],sum/attached_num)) {
+		delete lock;
+		delete sem;
+		return NULL;
+	}
+	//hottest shards first, a shard is moved only if it narrows the gap
+	std::vector<std::pair<uint64,uint32> > hot;
+	for(uint32 i=0;i<PARTITION_SHARD_NUM;i++)
+		if(owners_[i]==hi && shard_load[i]>0)
+			hot.push_back(std::make_pair(shard_load[i],i));
+	std::sort(hot.rbegin(),hot.rend());
+	PartitionPlan *plan=new PartitionPlan(this,owner_num_,lock,sem);
+	uint64 hi_load=owner_load[hi],lo_load=owner_load[lo];
+	for(size_t i=0;i<hot.size() && plan->MoveNum()<PARTITION_MAX_MOVES;i++) {
+		uint64 load=hot[i].first;
+		if(load>hi_load || lo_load+load>=hi_load-load)
+			continue;
+		plan->AddMove(hot[i].second,hi,lo);
+		hi_load-=load;
+		lo_load+=load;
+	}
+	if(plan->MoveNum()==0) {
+		delete plan;
+		return NULL;
+	}
+	for(uint32 i=0;i<owner_num_;i++)
+		if(detached_[i])
+			plan->Leave(i);
+	plans_.push_back(plan);
+	return plan;
+}
+
+void Partitioner::Apply(PartitionPlan *plan)
+{
+	for(uint32 i=0;i<PARTITION_SHARD_NUM;i++) {
+		uint32 to=plan->Target(i);
+		if(to==PARTITION_NO_OWNER)
+			continue;
+		loads_[owners_[i]]->moved_out++;
+		loads_[to]->moved_in++;
+		owners_[i]=to;
+	}
+	rebalance_num_++;
+}
+
+void Partitioner::Detach(uint32 owner)
+{
+	ScopedLock lock(lock_);
+	detached_[owner]=true;
+	for(size_t i=0;i<plans_.size();) {
+		PartitionPlan *plan=plans_[i];
+		if(plan->Leave(owner))
+			FreePlan(plan);
+		else
+			i++;
+	}
+}
+
+void Partitioner::Retire(PartitionPlan *plan)
+{
+	ScopedLock lock(lock_);
+	FreePlan(plan);
+}
+
+void Partitioner::FreePlan(PartitionPlan *plan)
+{
+	for(uint32 i=0;i<owner_num_;i++)
+		loads_[i]->metas_in+=plan->SentNum(i);
+	std::vector<PartitionPlan *>::iterator iter=std::find(plans_.begin(),
+		plans_.end(),plan);
+	if(iter!=plans_.end())
+		plans_.erase(iter);
+	delete plan;
+}
+
+std::string Partitioner::ToString()
+{
+	std::stringstream ss;
+	for(uint32 i=0;i<owner_num_;i++) {
+		uint32 shard_num=0;
+		for(uint32 j=0;j<PARTITION_SHARD_NUM;j++)
+			if(owners_[j]==i)
+				shard_num++;
+		ss<<"detector "<<i<<": events="<<loads_[i]->total<<" shards="
+			<<shard_num<<" moved_in="<<loads_[i]->moved_in<<" moved_out="
+			<<loads_[i]->moved_out<<" metas_in="<<loads_[i]->metas_in
+			<<std::endl;
+	}
+	ss<<"rebalances: "<<rebalance_num_<<std::endl;
+	return ss.str();
+}
@@ -0,0 +1,145 @@
+#ifndef __CORE_PARTITION_H
+#define __CORE_PARTITION_H
+
+/**
+ * Adaptive address partitioning for the parallel detection.
+ *
+ * The address space is cut into 64-byte lines hashed into a fixed number
+ * of shards. Each shard is owned by one detection thread, which receives
+ * all memory events of the shard and counts them. From time to time the
+ * hottest shards of the most loaded owner are moved to the least loaded
+ * one. A move is planned here, published as an event in the sync log, and
+ * carried out by the detection threads when they reach that event: the
+ * old owner hands the shadow metas of the moved shards to the new owner.
+ */
+
+#include <string>
+#include <vector>
+#include "core/basictypes.h"
+#include "core/sync.h"
+
+#define PARTITION_LINE_BITS 6
+#define PARTITION_SHARD_BITS 10
+#define PARTITION_SHARD_NUM (1<<PARTITION_SHARD_BITS)
+#define PARTITION_NO_OWNER static_cast<uint32>(-1)
+//the least number of events in a period worth a rebalance
+#define PARTITION_MIN_LOAD (1<<16)
+//rebalance when the most loaded owner exceeds the average by a quarter
+#define PARTITION_IMBALANCE(max,avg) ((max)*4>(avg)*5)
+#define PARTITION_MAX_MOVES 32
+
+class Partitioner;
+
+//the shard moves of one rebalance. the detection threads meet here to
+//exchange the metas of the moved shards, the plan is freed once all of
+//them are done with it.
+class PartitionPlan {
+public:
+	PartitionPlan(Partitioner *partitioner,uint32 owner_num,Mutex *lock,
+		Semaphore *sem);
+	~PartitionPlan();
+
+	void AddMove(uint32 shard,uint32 from,uint32 to);
+	size_t MoveNum() { return move_num_; }
+	uint32 Source(uint32 shard) { return source_[shard]; }
+	uint32 Target(uint32 shard) { return target_[shard]; }
+	bool Outgoing(uint32 owner) { return outgoing_[owner]; }
+	//hand a meta to its new owner
+	void Send(uint32 to,void *meta);
+	//wait until every attached owner has sent its metas
+	void FinishSend(uint32 owner);
+	std::vector<void *> &Inbox(uint32 owner) { return inbox_[owner]; }
+	uint32 SentNum(uint32 owner) { return sent_num_[owner]; }
+	//the owner has taken its inbox, the plan must not be used afterwards
+	void Finish(uint32 owner);
+	//the owner has detached and will never reach the plan, true if the
+	//plan is not used anymore
+	bool Leave(uint32 owner);
+
+private:
+	enum OwnerState {
+		OWNER_PENDING,
+		OWNER_SENT,
+		OWNER_DONE,
+	};
+
+	void Arrive();
+
+	Partitioner *partitioner_;
+	uint32 owner_num_;
+	size_t move_num_;
+	std::vector<uint32> source_;
+	std::vector<uint32> target_;
+	std::vector<bool> outgoing_;
+	std::vector<std::vector<void *> > inbox_;
+	std::vector<uint32> sent_num_;
+	std::vector<OwnerState> states_;
+	uint32 sent_; //the owners done sending or detached
+	uint32 waiting_;
+	uint32 done_;
+	Mutex *lock_;
+	Semaphore *sem_;
+	DISALLOW_COPY_CONSTRUCTORS(PartitionPlan);
+};
+
+class Partitioner {
+public:
+	Partitioner(uint32 owner_num,Mutex *lock);
+	~Partitioner();
+
+	static uint32 Shard(address_t addr) {
+		return (uint32)(addr>>PARTITION_LINE_BITS) & (PARTITION_SHARD_NUM-1);
+	}
+	//producer side
+	uint32 Owner(address_t addr) { return owners_[Shard(addr)]; }
+	//consumer side, each owner only writes its own load
+	void Account(uint32 owner,address_t addr) {
+		OwnerLoad *load=loads_[owner];
+		load->shards[Shard(addr)]++;
+		load->total++;
+	}
+	//plan moving the hottest shards of the most loaded owner to the least
+	//loaded one, NULL if the load of the last period is balanced. the plan
+	//owns the lock and the semaphore, they are freed if there is no plan.
+	//the detached owners take no part in the plan.
+	PartitionPlan *Plan(Mutex *lock,Semaphore *sem);
+	//the owners change while the producers are stopped
+	void Apply(PartitionPlan *plan);
+	void Discard(PartitionPlan *plan) { Retire(plan); }
+	//the owner stops consuming, the pending plans stop waiting for it
+	void Detach(uint32 owner);
+	//free a plan nobody uses anymore, keeping its counts
+	void Retire(PartitionPlan *plan);
+	std::string ToString();
+
+private:
+	//allocated apart, so that the owners do not write to a shared line
+	struct OwnerLoad {
+		OwnerLoad():total(0),base(0),moved_in(0),moved_out(0),metas_in(0) {
+			shards.resize(PARTITION_SHARD_NUM,0);
+			bases.resize(PARTITION_SHARD_NUM,0);
+		}
+		std::vector<uint64> shards;
+		std::vector<uint64> bases; //the shard loads at the last plan
+		volatile uint64 total;
+		uint64 base;
+		uint32 moved_in;
+		uint32 moved_out;
+		uint32 metas_in;
+	};
+
+	//under the lock
+	void FreePlan(PartitionPlan *plan);
+
+	uint32 owner_num_;
+	uint32 owners_[PARTITION_SHARD_NUM];
+	std::vector<OwnerLoad *> loads_;
+	std::vector<bool> detached_;
+	//the plans some owner has not finished yet, under the lock
+	std::vector<PartitionPlan *> plans_;
+	uint32 rebalance_num_;
+	Mutex *lock_;
+	DISALLOW_COPY_CONSTRUCTORS(Partitioner);
+};
+
+#endif /* __CORE_PARTITION_H */
@@ -0,0 +1,226 @@
+#include "core/partition.h"
+#include <sstream>
+#include <vector>
+#include <pthread.h>
+#include <unistd.h>
+#include "core/unit_test.h"
+
+#define OWNER_NUM 4
+#define META_NUM 1000
+
+//count the sync objects handed to the plans, to see them all freed
+static volatile int live_sync_num=0;
+
+class CountedMutex:public SysMutex {
+public:
+	CountedMutex() { ATOMIC_ADD_AND_FETCH(&live_sync_num,1); }
+	~CountedMutex() { ATOMIC_SUB_AND_FETCH(&live_sync_num,1); }
+};
+
+class CountedSemaphore:public SysSemaphore {
+public:
+	CountedSemaphore():SysSemaphore(0) {
+		ATOMIC_ADD_AND_FETCH(&live_sync_num,1);
+	}
+	~CountedSemaphore() { ATOMIC_SUB_AND_FETCH(&live_sync_num,1); }
+};
+
+static address_t LineOfShard(uint32 shard,uint32 i)
+{
+	return ((address_t)i*PARTITION_SHARD_NUM+shard)<<PARTITION_LINE_BITS;
+}
+
+//every owner gets the same load on each of its shards
+static void AccountEvenly(Partitioner *partitioner,uint64 per_shard)
+{
+	for(uint32 shard=0;shard<PARTITION_SHARD_NUM;shard++) {
+		address_t addr=LineOfShard(shard,0);
+		for(uint64 i=0;i<per_shard;i++)
+			partitioner->Account(partitioner->Owner(addr),addr);
+	}
+}
+
+void TestBalancedLoad()
+{
+	Partitioner partitioner(OWNER_NUM,new SysMutex);
+	//too little load to plan anything
+	AccountEvenly(&partitioner,1);
+	EXPECT_TRUE(partitioner.Plan(new CountedMutex,new CountedSemaphore)==NULL);
+	EXPECT_EQ(live_sync_num,0);
+	//enough load but balanced
+	AccountEvenly(&partitioner,PARTITION_MIN_LOAD/PARTITION_SHARD_NUM+1);
+	EXPECT_TRUE(partitioner.Plan(new CountedMutex,new CountedSemaphore)==NULL);
+	EXPECT_EQ(live_sync_num,0);
+}
+
+//owner 0 gets a few hot shards on top of an even load
+static PartitionPlan *HotPlan(Partitioner *partitioner,std::vector<uint32> *hot)
+{
+	AccountEvenly(partitioner,PARTITION_MIN_LOAD/PARTITION_SHARD_NUM+1);
+	for(uint32 shard=0;shard<PARTITION_SHARD_NUM && hot->size()<8;shard++)
+		if(partitioner->Owner(LineOfShard(shard,0))==0)
+			hot->push_back(shard);
+	for(size_t i=0;i<hot->size();i++)
+		for(uint32 j=0;j<PARTITION_MIN_LOAD/4;j++)
+			partitioner->Account(0,LineOfShard((*hot)[i],j));
+	return partitioner->Plan(new CountedMutex,new CountedSemaphore);
+}
+
+void TestPlanAndApply()
+{
+	Partitioner partitioner(OWNER_NUM,new SysMutex);
+	std::vector<uint32> hot;
+	PartitionPlan *plan=HotPlan(&partitioner,&hot);
+	EXPECT_TRUE(plan!=NULL);
+	if(!plan)
+		return ;
+	EXPECT_TRUE(plan->MoveNum()>0 && plan->MoveNum()<=PARTITION_MAX_MOVES);
+	EXPECT_TRUE(plan->Outgoing(0));
+	//moving all the hot shards would overload the target
+	size_t hot_moved=0;
+	for(size_t i=0;i<hot.size();i++)
+		if(plan->Target(hot[i])!=PARTITION_NO_OWNER)
+			hot_moved++;
+	EXPECT_TRUE(hot_moved>0 && hot_moved<hot.size());
+	std::vector<uint32> owners(PARTITION_SHARD_NUM);
+	for(uint32 shard=0;shard<PARTITION_SHARD_NUM;shard++)
+		owners[shard]=partitioner.Owner(LineOfShard(shard,0));
+	partitioner.Apply(plan);
+	size_t moved=0;
+	for(uint32 shard=0;shard<PARTITION_SHARD_NUM;shard++) {
+		uint32 owner=partitioner.Owner(LineOfShard(shard,0));
+		if(plan->Target(shard)==PARTITION_NO_OWNER) {
+			EXPECT_EQ(owner,owners[shard]);
+			continue;
+		}
+		//only shards of the most loaded owner move
+		EXPECT_EQ(plan->Source(shard),0);
+		EXPECT_EQ(owners[shard],0);
+		EXPECT_EQ(owner,plan->Target(shard));
+		EXPECT_TRUE(owner!=0);
+		//every line of the shard follows it
+		EXPECT_EQ(partitioner.Owner(LineOfShard(shard,7)),owner);
+		moved++;
+	}
+	EXPECT_EQ(moved,plan->MoveNum());
+	//the load of the next period is counted from the plan on
+	EXPECT_TRUE(partitioner.Plan(new CountedMutex,new CountedSemaphore)==NULL);
+}
+
+struct Migration {
+	PartitionPlan *plan;
+	uint32 owner;
+	std::vector<uint32> received;
+};
+
+//the owners send their metas and meet, then take their inbox, as the
+//detectors do at a partition migrate event
+static void *MigrateThread(void *arg)
+{
+	Migration *migration=(Migration *)arg;
+	PartitionPlan *plan=migration->plan;
+	for(uint32 i=0;i<META_NUM;i++) {
+		uint32 to=(migration->owner+1+i%(OWNER_NUM-1))%OWNER_NUM;
+		plan->Send(to,(void *)(address_t)(migration->owner*META_NUM+i+1));
+	}
+	plan->FinishSend(migration->owner);
+	std::vector<void *> &inbox=plan->Inbox(migration->owner);
+	for(size_t i=0;i<inbox.size();i++)
+		migration->received.push_back((uint32)(address_t)inbox[i]);
+	plan->Finish(migration->owner);
+	return NULL;
+}
+
+//the owners below owner_num migrate, the others are detached. check that
+//every meta sent to a migrating owner reaches it once.
+static void Migrate(Partitioner *partitioner,PartitionPlan *plan,
+	uint32 owner_num,bool detach_late)
+{
+	pthread_t thds[OWNER_NUM];
+	Migration migrations[OWNER_NUM];
+	for(uint32 i=0;i<owner_num;i++) {
+		migrations[i].plan=plan;
+		migrations[i].owner=i;
+		pthread_create(&thds[i],NULL,MigrateThread,&migrations[i]);
+	}
+	if(detach_late) {
+		usleep(10000);
+		for(uint32 i=owner_num;i<OWNER_NUM;i++)
+			partitioner->Detach(i);
+	}
+	for(uint32 i=0;i<owner_num;i++)
+		pthread_join(thds[i],NULL);
+	std::vector<uint32> seen(OWNER_NUM*META_NUM+1,0);
+	for(uint32 i=0;i<owner_num;i++) {
+		for(size_t j=0;j<migrations[i].received.size();j++) {
+			uint32 meta=migrations[i].received[j];
+			uint32 from=(meta-1)/META_NUM;
+			EXPECT_TRUE(from!=i);
+			seen[meta]++;
+		}
+	}
+	for(uint32 meta=1;meta<=owner_num*META_NUM;meta++) {
+		uint32 from=(meta-1)/META_NUM,i=(meta-1)%META_NUM;
+		uint32 to=(from+1+i%(OWNER_NUM-1))%OWNER_NUM;
+		EXPECT_EQ(seen[meta],to<owner_num ? 1 : 0);
+	}
+	//the plan is freed by the last owner, its counts are kept
+	EXPECT_EQ(live_sync_num,0);
+	std::string stats=partitioner->ToString();
+	for(uint32 i=0;i<owner_num;i++) {
+		std::stringstream ss;
+		ss<<"metas_in="<<migrations[i].received.size()<<std::endl;
+		EXPECT_TRUE(stats.find(ss.str())!=std::string::npos);
+	}
+}
+
+void TestFinishSend()
+{
+	Partitioner partitioner(OWNER_NUM,new SysMutex);
+	std::vector<uint32> hot;
+	PartitionPlan *plan=HotPlan(&partitioner,&hot);
+	EXPECT_TRUE(plan!=NULL);
+	if(!plan)
+		return ;
+	partitioner.Apply(plan);
+	Migrate(&partitioner,plan,OWNER_NUM,false);
+	EXPECT_TRUE(partitioner.ToString().find("rebalances: 1")!=
+		std::string::npos);
+}
+
+//an owner that has detached is not waited for, whether it detaches before
+//the plan or while the others wait at it
+void TestDetachedOwner()
+{
+	Partitioner partitioner(OWNER_NUM,new SysMutex);
+	partitioner.Detach(OWNER_NUM-1);
+	//the detached owner is the least loaded one
+	for(uint32 i=1;i<OWNER_NUM-1;i++)
+		partitioner.Account(i,LineOfShard(i,0));
+	std::vector<uint32> hot;
+	PartitionPlan *plan=HotPlan(&partitioner,&hot);
+	EXPECT_TRUE(plan!=NULL);
+	if(!plan)
+		return ;
+	for(uint32 shard=0;shard<PARTITION_SHARD_NUM;shard++)
+		EXPECT_TRUE(plan->Target(shard)!=OWNER_NUM-1);
+	partitioner.Apply(plan);
+	Migrate(&partitioner,plan,OWNER_NUM-1,false);
+	Partitioner late(OWNER_NUM,new SysMutex);
+	hot.clear();
+	plan=HotPlan(&late,&hot);
+	EXPECT_TRUE(plan!=NULL);
+	if(!plan)
+		return ;
+	late.Apply(plan);
+	Migrate(&late,plan,OWNER_NUM-1,true);
+}
+
+int main(int argc,char *argv[])
+{
+	RUN_TEST(TestBalancedLoad);
+	RUN_TEST(TestPlanAndApply);
+	RUN_TEST(TestFinishSend);
+	RUN_TEST(TestDetachedOwner);
+	return UNIT_TEST_RESULT();
+}
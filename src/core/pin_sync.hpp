@@ -32,6 +32,7 @@ public:
 	bool IsWaiting() {return !PIN_SemaphoreIsSet(&semaphore_);}
 	void TimedWait(unsigned timeout) {PIN_SemaphoreTimedWait(&semaphore_,timeout);}
 	void Post() {PIN_SemaphoreSet(&semaphore_);}
+	void Clear() {PIN_SemaphoreClear(&semaphore_);}
 private:
 	PIN_SEMAPHORE semaphore_;
 };
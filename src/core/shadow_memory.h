@@ -0,0 +1,323 @@
+#ifndef __CORE_SHADOW_MEMORY_H
+#define __CORE_SHADOW_MEMORY_H
+
+/**
+ * Two-level, page-granular shadow memory.
+ *
+ * The address space is split into 4K pages. A lazily allocated first level
+ * directory points to second level tables of page pointers, and each page
+ * holds one slot per monitored unit. Lookup is three array indexings, pages
+ * are populated on first insertion and released as soon as their last slot
+ * is cleared. The directories cover 48-bit addresses (user space), the
+ * pages of any wider address are kept in a list searched linearly.
+ *
+ * Find and Insert may run concurrently as long as no two callers touch the
+ * same slot, directories and pages are published with compare-and-swap.
+ * Remove, Release, Clear and the iteration need exclusive access.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include "core/basictypes.h"
+#include "core/atomic.h"
+#include "core/log.h"
+
+#define SHADOW_ADDR_BITS 48
+#define SHADOW_PAGE_BITS 12
+#define SHADOW_L2_BITS 16
+#define SHADOW_L1_BITS (SHADOW_ADDR_BITS-SHADOW_L2_BITS-SHADOW_PAGE_BITS)
+
+template<typename T>
+class ShadowMemory {
+public:
+	//per-page slots plus the number of live slots in the page
+	class Page {
+	public:
+		explicit Page(size_t n):live(0) {
+			slots=new T*[n];
+			memset(slots,0,sizeof(T*)*n);
+		}
+		~Page() { delete [] slots; }
+
+		T **slots;
+		volatile size_t live;
+	private:
+		DISALLOW_COPY_CONSTRUCTORS(Page);
+	};
+
+	ShadowMemory():l1_(NULL),high_(NULL),unit_shift_(0),
+		slot_num_(1<<SHADOW_PAGE_BITS),page_num_(0),peak_page_num_(0),
+		l2_num_(0),live_num_(0) {}
+	~ShadowMemory() { Clear(); }
+
+	//keys are multiples of unit_size, so the slot index only needs its
+	//trailing zero bits; zero means byte granularity
+	void SetUnitSize(address_t unit_size) {
+		DEBUG_ASSERT(page_num_==0);
+		unit_shift_=0;
+		while(unit_size && !(unit_size & 1) && unit_shift_<SHADOW_PAGE_BITS) {
+			unit_size>>=1;
+			unit_shift_++;
+		}
+		slot_num_=1<<(SHADOW_PAGE_BITS-unit_shift_);
+	}
+
+	T *Find(address_t addr) {
+		Page *page=GetPage(addr,false);
+		if(!page)
+			return NULL;
+		return page->slots[SlotIndex(addr)];
+	}
+
+	void Insert(address_t addr,T *value) {
+		DEBUG_ASSERT(value);
+		Page *page=GetPage(addr,true);
+		T *&slot=page->slots[SlotIndex(addr)];
+		if(!slot) {
+			ATOMIC_ADD_AND_FETCH(&page->live,1);
+			ATOMIC_ADD_AND_FETCH(&live_num_,1);
+		}
+		slot=value;
+	}
+
+	//clear the slot and return the previous value
+	T *Remove(address_t addr) {
+		Page **pp=GetPageEntry(addr,false);
+		if(!pp || !*pp)
+			return NULL;
+		T *&slot=(*pp)->slots[SlotIndex(addr)];
+		T *value=slot;
+		if(value) {
+			slot=NULL;
+			live_num_--;
+			if(--(*pp)->live==0)
+				FreePage(pp);
+		}
+		return value;
+	}
+
+	//remove all values in [start_addr,end_addr), handing each to the
+	//visitor. unpopulated pages are skipped as a whole, emptied pages are
+	//released.
+	template<typename Visitor>
+	void Release(address_t start_addr,address_t end_addr,Visitor &visitor) {
+		address_t page_size=(address_t)1<<SHADOW_PAGE_BITS;
+		for(address_t pg_addr=start_addr;pg_addr<end_addr;) {
+			address_t pg_end=(pg_addr & ~(page_size-1))+page_size;
+			if(pg_end>end_addr || pg_end==0)
+				pg_end=end_addr;
+			Page **pp=GetPageEntry(pg_addr,false);
+			if(pp && *pp) {
+				size_t first=SlotIndex(pg_addr);
+				size_t last=SlotIndex(pg_end-1);
+				for(size_t i=first;i<=last && (*pp)->live>0;i++) {
+					T *value=(*pp)->slots[i];
+					if(!value)
+						continue;
+					(*pp)->slots[i]=NULL;
+					(*pp)->live--;
+					live_num_--;
+					visitor(value);
+				}
+				if((*pp)->live==0)
+					FreePage(pp);
+			}
+			pg_addr=pg_end;
+		}
+	}
+
+	void Clear() {
+		while(high_) {
+			HighPage *high=high_;
+			high_=high->next;
+			if(high->page)
+				page_num_--;
+			delete high->page;
+			delete high;
+		}
+		if(!l1_)
+			return ;
+		for(size_t i=0;i<((size_t)1<<SHADOW_L1_BITS);i++) {
+			if(!l1_[i])
+				continue;
+			for(size_t j=0;j<((size_t)1<<SHADOW_L2_BITS);j++)
+				delete l1_[i][j];
+			free(l1_[i]);
+		}
+		free(l1_);
+		l1_=NULL;
+		page_num_=0;
+		l2_num_=0;
+		live_num_=0;
+	}
+
+	//traversal over the live slots
+	void IterBegin() {
+		iter_l1_=0;
+		iter_l2_=0;
+		iter_slot_=0;
+		iter_high_=NULL;
+		IterSeek();
+	}
+	bool IterEnd() {
+		return iter_l1_>=((size_t)1<<SHADOW_L1_BITS) && !iter_high_;
+	}
+	void IterNext() {
+		iter_slot_++;
+		IterSeek();
+	}
+	T *IterCurr() {
+		if(iter_high_)
+			return iter_high_->page->slots[iter_slot_];
+		return l1_[iter_l1_][iter_l2_]->slots[iter_slot_];
+	}
+
+	//memory accounting
+	size_t GetPageNum() { return page_num_; }
+	size_t GetPeakPageNum() { return peak_page_num_; }
+	size_t GetLiveNum() { return live_num_; }
+	uint64 GetMemSize() {
+		uint64 size=0;
+		if(l1_)
+			size+=sizeof(Page **)*((size_t)1<<SHADOW_L1_BITS);
+		size+=(uint64)l2_num_*sizeof(Page *)*((size_t)1<<SHADOW_L2_BITS);
+		size+=(uint64)page_num_*(sizeof(Page)+sizeof(T *)*slot_num_);
+		return size;
+	}
+
+private:
+	//a page beyond the directories. the entries are only freed by Clear,
+	//so that the lookups can walk the list without a lock.
+	struct HighPage {
+		address_t pg_num;
+		Page *page;
+		HighPage *next;
+	};
+
+	size_t SlotIndex(address_t addr) {
+		return (addr & (((address_t)1<<SHADOW_PAGE_BITS)-1))>>unit_shift_;
+	}
+
+	Page **GetPageEntry(address_t addr,bool create) {
+		if(addr>>SHADOW_ADDR_BITS)
+			return GetHighPageEntry(addr,create);
+		size_t i1=(size_t)(addr>>(SHADOW_PAGE_BITS+SHADOW_L2_BITS));
+		size_t i2=(size_t)(addr>>SHADOW_PAGE_BITS) &
+			(((size_t)1<<SHADOW_L2_BITS)-1);
+		DEBUG_ASSERT(i1<((size_t)1<<SHADOW_L1_BITS));
+		if(!l1_) {
+			if(!create)
+				return NULL;
+			//calloc'ed so that untouched directory pages stay unbacked
+			Page ***l1=(Page ***)calloc((size_t)1<<SHADOW_L1_BITS,
+				sizeof(Page **));
+			if(!ATOMIC_BOOL_COMPARE_AND_SWAP(&l1_,(Page ***)NULL,l1))
+				free(l1);
+		}
+		if(!l1_[i1]) {
+			if(!create)
+				return NULL;
+			Page **l2=(Page **)calloc((size_t)1<<SHADOW_L2_BITS,sizeof(Page *));
+			if(ATOMIC_BOOL_COMPARE_AND_SWAP(&l1_[i1],(Page **)NULL,l2))
+				ATOMIC_ADD_AND_FETCH(&l2_num_,1);
+			else
+				free(l2);
+		}
+		return &l1_[i1][i2];
+	}
+
+	Page **GetHighPageEntry(address_t addr,bool create) {
+		address_t pg_num=addr>>SHADOW_PAGE_BITS;
+		HighPage *added=NULL;
+		while(true) {
+			HighPage *head=high_;
+			for(HighPage *high=head;high;high=high->next) {
+				if(high->pg_num==pg_num) {
+					delete added;
+					return &high->page;
+				}
+			}
+			if(!create)
+				return NULL;
+			if(!added) {
+				added=new HighPage;
+				added->pg_num=pg_num;
+				added->page=NULL;
+			}
+			added->next=head;
+			if(ATOMIC_BOOL_COMPARE_AND_SWAP(&high_,head,added))
+				return &added->page;
+		}
+	}
+
+	Page *GetPage(address_t addr,bool create) {
+		Page **pp=GetPageEntry(addr,create);
+		if(!pp)
+			return NULL;
+		if(!*pp && create) {
+			Page *page=new Page(slot_num_);
+			if(ATOMIC_BOOL_COMPARE_AND_SWAP(pp,(Page *)NULL,page)) {
+				size_t page_num=ATOMIC_ADD_AND_FETCH(&page_num_,1);
+				if(page_num>peak_page_num_)
+					peak_page_num_=page_num;
+			}
+			else
+				delete page;
+		}
+		return *pp;
+	}
+
+	void FreePage(Page **pp) {
+		delete *pp;
+		*pp=NULL;
+		page_num_--;
+	}
+
+	//move the iterator to the next live slot at or after the current one
+	void IterSeek() {
+		if(iter_l1_<((size_t)1<<SHADOW_L1_BITS)) {
+			for(;l1_ && iter_l1_<((size_t)1<<SHADOW_L1_BITS);
+				iter_l1_++,iter_l2_=0) {
+				if(!l1_[iter_l1_])
+					continue;
+				for(;iter_l2_<((size_t)1<<SHADOW_L2_BITS);iter_l2_++,iter_slot_=0) {
+					Page *page=l1_[iter_l1_][iter_l2_];
+					if(!page)
+						continue;
+					for(;iter_slot_<slot_num_;iter_slot_++)
+						if(page->slots[iter_slot_])
+							return ;
+				}
+			}
+			//the directories are done, go on with the high pages
+			iter_l1_=(size_t)1<<SHADOW_L1_BITS;
+			iter_high_=high_;
+			iter_slot_=0;
+		}
+		for(;iter_high_;iter_high_=iter_high_->next,iter_slot_=0) {
+			Page *page=iter_high_->page;
+			if(!page)
+				continue;
+			for(;iter_slot_<slot_num_;iter_slot_++)
+				if(page->slots[iter_slot_])
+					return ;
+		}
+	}
+
+	Page *** volatile l1_;
+	HighPage * volatile high_;
+	size_t unit_shift_;
+	size_t slot_num_;
+	volatile size_t page_num_;
+	size_t peak_page_num_;
+	volatile size_t l2_num_;
+	volatile size_t live_num_;
+	size_t iter_l1_;
+	size_t iter_l2_;
+	size_t iter_slot_;
+	HighPage *iter_high_;
+
+	DISALLOW_COPY_CONSTRUCTORS(ShadowMemory);
+};
+
+#endif /* __CORE_SHADOW_MEMORY_H */
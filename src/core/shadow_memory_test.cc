@@ -0,0 +1,99 @@
+#include "core/shadow_memory.h"
+#include <set>
+#include <vector>
+#include "core/unit_test.h"
+
+class Value {
+public:
+	explicit Value(address_t a):addr(a) {}
+	address_t addr;
+};
+
+struct Collector {
+	void operator()(Value *value) { values.push_back(value); }
+	std::vector<Value *> values;
+};
+
+//the addresses on both sides of the directory bound
+static std::vector<address_t> Addresses()
+{
+	std::vector<address_t> addrs;
+	address_t bound=(address_t)1<<SHADOW_ADDR_BITS;
+	addrs.push_back(0x1000);
+	addrs.push_back(bound-8);
+	addrs.push_back(bound);
+	addrs.push_back(bound+8);
+	addrs.push_back(bound+0x1000);
+	addrs.push_back(~(address_t)7);
+	return addrs;
+}
+
+void TestFindAndRemove()
+{
+	ShadowMemory<Value> table;
+	table.SetUnitSize(8);
+	std::vector<address_t> addrs=Addresses();
+	for(size_t i=0;i<addrs.size();i++)
+		table.Insert(addrs[i],new Value(addrs[i]));
+	EXPECT_EQ(table.GetLiveNum(),addrs.size());
+	EXPECT_EQ(table.GetPageNum(),addrs.size()-1);
+	for(size_t i=0;i<addrs.size();i++) {
+		Value *value=table.Find(addrs[i]);
+		EXPECT_TRUE(value && value->addr==addrs[i]);
+	}
+	//the wide addresses do not alias the low ones
+	EXPECT_TRUE(table.Find(0)==NULL);
+	EXPECT_TRUE(table.Find(8)==NULL);
+	//the iteration sees every value once
+	std::set<address_t> seen;
+	for(table.IterBegin();!table.IterEnd();table.IterNext())
+		seen.insert(table.IterCurr()->addr);
+	EXPECT_EQ(seen.size(),addrs.size());
+	for(size_t i=0;i<addrs.size();i++) {
+		Value *value=table.Remove(addrs[i]);
+		EXPECT_TRUE(value && value->addr==addrs[i]);
+		delete value;
+		EXPECT_TRUE(table.Find(addrs[i])==NULL);
+	}
+	EXPECT_EQ(table.GetLiveNum(),0);
+	EXPECT_EQ(table.GetPageNum(),0);
+	table.IterBegin();
+	EXPECT_TRUE(table.IterEnd());
+	//the freed high page is found again
+	address_t addr=(address_t)1<<SHADOW_ADDR_BITS;
+	table.Insert(addr,new Value(addr));
+	EXPECT_EQ(table.GetPageNum(),1);
+	delete table.Remove(addr);
+}
+
+void TestReleaseAcrossBound()
+{
+	ShadowMemory<Value> table;
+	table.SetUnitSize(8);
+	address_t bound=(address_t)1<<SHADOW_ADDR_BITS;
+	for(address_t addr=bound-0x2000;addr<bound+0x2000;addr+=0x100)
+		table.Insert(addr,new Value(addr));
+	size_t num=table.GetLiveNum();
+	Collector collector;
+	table.Release(bound-0x1000,bound+0x1000,collector);
+	EXPECT_EQ(collector.values.size(),0x2000/0x100);
+	for(size_t i=0;i<collector.values.size();i++) {
+		address_t addr=collector.values[i]->addr;
+		EXPECT_TRUE(addr>=bound-0x1000 && addr<bound+0x1000);
+		delete collector.values[i];
+	}
+	EXPECT_EQ(table.GetLiveNum(),num-collector.values.size());
+	EXPECT_EQ(table.GetPageNum(),2);
+	collector.values.clear();
+	table.Release(bound-0x2000,bound+0x2000,collector);
+	for(size_t i=0;i<collector.values.size();i++)
+		delete collector.values[i];
+	EXPECT_EQ(table.GetLiveNum(),0);
+}
+
+int main(int argc,char *argv[])
+{
+	RUN_TEST(TestFindAndRemove);
+	RUN_TEST(TestReleaseAcrossBound);
+	return UNIT_TEST_RESULT();
+}
@@ -53,7 +53,7 @@ private:
 	DISALLOW_COPY_CONSTRUCTORS(Image);
 };
 
-#define INVALID_INST_ID static_cast<inst_id_type>(-1)
+#define INVALID_INST_ID static_cast<inst_t>(-1)
 
 //An instruction in an image
 class Inst {
@@ -5,7 +5,10 @@
  * Define synchronizations.
  */
 #include <semaphore.h>
+#include <sched.h>
+#include <pthread.h>
 #include "core/basictypes.h"
+#include "core/atomic.h"
 
 
 //Mutex interface
@@ -64,6 +67,44 @@ private:
 	DISALLOW_COPY_CONSTRUCTORS(RWMutex);
 };
 
+//Mutex that also admits shared holders. Lock/Unlock give exclusive
+//ownership through the wrapped mutex, while a shared holder only bumps a
+//counter. Shared holders spin while an exclusive holder is inside, so it
+//suits hot paths where exclusive sections are rare and short.
+class SharedMutex:public Mutex {
+public:
+	explicit SharedMutex(Mutex *lock):lock_(lock),shared_(0),exclusive_(0) {}
+	~SharedMutex() { delete lock_; }
+
+	void Lock() {
+		lock_->Lock();
+		ATOMIC_BOOL_COMPARE_AND_SWAP(&exclusive_,0,1);
+		while(shared_)
+			sched_yield();
+	}
+	void Unlock() {
+		ATOMIC_BOOL_COMPARE_AND_SWAP(&exclusive_,1,0);
+		lock_->Unlock();
+	}
+	void LockShared() {
+		while(true) {
+			ATOMIC_ADD_AND_FETCH(&shared_,1);
+			if(!exclusive_)
+				return ;
+			ATOMIC_SUB_AND_FETCH(&shared_,1);
+			while(exclusive_)
+				sched_yield();
+		}
+	}
+	void UnlockShared() { ATOMIC_SUB_AND_FETCH(&shared_,1); }
+	Mutex *Clone() { return new SharedMutex(lock_->Clone()); }
+private:
+	Mutex *lock_;
+	volatile uint32 shared_;
+	volatile uint32 exclusive_;
+	DISALLOW_COPY_CONSTRUCTORS(SharedMutex);
+};
+
 //Local scoped lock
 class ScopedLock {
 public:
@@ -89,6 +130,32 @@ private:
 	DISALLOW_COPY_CONSTRUCTORS(ScopedLock);
 };
 
+//Local scoped shared lock
+class ScopedSharedLock {
+public:
+	explicit ScopedSharedLock(SharedMutex *mutex):mutex_(mutex) {
+		mutex_->LockShared();
+	}
+	~ScopedSharedLock() { mutex_->UnlockShared(); }
+private:
+	SharedMutex *mutex_;
+	DISALLOW_COPY_CONSTRUCTORS(ScopedSharedLock);
+};
+
+//define the mutex implemented by the linux, for the offline tools
+class SysMutex:public Mutex {
+public:
+	SysMutex() { pthread_mutex_init(&mutex_,NULL); }
+	~SysMutex() { pthread_mutex_destroy(&mutex_); }
+
+	void Lock() { pthread_mutex_lock(&mutex_); }
+	void Unlock() { pthread_mutex_unlock(&mutex_); }
+	Mutex *Clone() { return new SysMutex; }
+private:
+	pthread_mutex_t mutex_;
+	DISALLOW_COPY_CONSTRUCTORS(SysMutex);
+};
+
 //define the semphore implemented by the linux
 class SysSemaphore:public Semaphore {
 public:
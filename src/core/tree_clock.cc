@@ -0,0 +1,105 @@
+#include "core/tree_clock.h"
+
+void TreeClock::Grow(size_t n)
+{
+	if(parent_.size()>=n)
+		return ;
+	parent_.resize(n,TREE_NIL);
+	first_child_.resize(n,TREE_NIL);
+	next_.resize(n,TREE_NIL);
+	prev_.resize(n,TREE_NIL);
+	aclk_.resize(n,0);
+}
+
+void TreeClock::Touch(ClockVector &clks)
+{
+	if(!published_)
+		return ;
+	clks[root_]++;
+	published_=false;
+}
+
+void TreeClock::Detach(uint32 u)
+{
+	if(u>=parent_.size() || parent_[u]==TREE_NIL)
+		return ;
+	if(prev_[u]!=TREE_NIL)
+		next_[prev_[u]]=next_[u];
+	else
+		first_child_[parent_[u]]=next_[u];
+	if(next_[u]!=TREE_NIL)
+		prev_[next_[u]]=prev_[u];
+	parent_[u]=TREE_NIL;
+	prev_[u]=TREE_NIL;
+	next_[u]=TREE_NIL;
+}
+
+//children are kept in decreasing aclk order, a newly attached child is
+//always the latest learned one
+void TreeClock::PushChild(uint32 u,uint32 p,timestamp_t aclk)
+{
+	Grow((u>p?u:p)+1);
+	parent_[u]=p;
+	aclk_[u]=aclk;
+	prev_[u]=TREE_NIL;
+	next_[u]=first_child_[p];
+	if(next_[u]!=TREE_NIL)
+		prev_[next_[u]]=u;
+	first_child_[p]=u;
+}
+
+//post-order collection of the src nodes carrying newer clocks. the
+//children of u are skipped as soon as they were attached before the
+//time of u this clock already knows.
+void TreeClock::CollectUpdated(ClockVector &clks,TreeClock *src,
+	ClockVector &src_clks,uint32 u,NodeVector &updated,size_t &visits)
+{
+	timestamp_t known=clks[u];
+	for(uint32 v=src->first_child_[u];v!=TREE_NIL;v=src->next_[v]) {
+		visits++;
+		if(clks[v]<src_clks[v])
+			CollectUpdated(clks,src,src_clks,v,updated,visits);
+		else if(src->aclk_[v]<=known)
+			break;
+	}
+	updated.push_back(u);
+}
+
+size_t TreeClock::Join(ClockVector &clks,size_t &size,TreeClock *src,
+	ClockVector &src_clks)
+{
+	uint32 zr=src->root_;
+	if(zr==root_ || (zr<clks.size() && clks[zr]>=src_clks[zr]))
+		return 1;
+	if(clks.size()<src_clks.size())
+		clks.resize(src_clks.size(),0);
+	Grow(src_clks.size());
+
+	NodeVector updated;
+	size_t visits=1;
+	CollectUpdated(clks,src,src_clks,zr,updated,visits);
+	Touch(clks);
+	for(size_t i=0;i<updated.size();i++)
+		Detach(updated[i]);
+	//parents come out before their children
+	for(size_t i=updated.size();i>0;i--) {
+		uint32 u=updated[i-1];
+		if(clks[u]==0)
+			size++;
+		clks[u]=src_clks[u];
+		if(u==zr)
+			PushChild(u,root_,clks[root_]);
+		else
+			PushChild(u,src->parent_[u],src->aclk_[u]);
+	}
+	return visits;
+}
+
+void TreeClock::AttachToRoot(ClockVector &clks,uint32 u)
+{
+	if(u==root_)
+		return ;
+	Touch(clks);
+	Detach(u);
+	PushChild(u,root_,clks[root_]);
+}
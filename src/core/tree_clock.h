@@ -0,0 +1,69 @@
+#ifndef __CORE_TREE_CLOCK_H
+#define __CORE_TREE_CLOCK_H
+
+/**
+ * Tree clock overlay for a dense vector clock.
+ *
+ * The clock values themselves stay in the vector clock array, the tree
+ * only records through which thread each entry was learned (parent) and
+ * at which local time of the parent (aclk). Children are kept in
+ * decreasing aclk order, so a join can skip every subtree whose knowledge
+ * the receiver already has and touch only the entries that advanced.
+ *
+ * Pruning needs every published time of the root to carry a fixed
+ * knowledge. Only the thread clock of a timeline learns new entries, and if
+ * its current time has already been read by others, the root is ticked
+ * before the new entries are attached.
+ */
+
+#include <vector>
+#include "core/basictypes.h"
+
+#define TREE_NIL static_cast<uint32>(-1)
+
+class TreeClock {
+public:
+	typedef std::vector<timestamp_t> ClockVector;
+
+	explicit TreeClock(uint32 root):root_(root),published_(false) {
+		Grow(root+1);
+	}
+	~TreeClock() {}
+
+	uint32 Root() { return root_; }
+	//the current root time has been read by another clock
+	void Publish() { published_=true; }
+	//the root has been incremented
+	void Tick() { published_=false; }
+	//join the src tree into this tree. clks/size belong to this clock,
+	//src_clks to the source clock. returns the visited node number.
+	size_t Join(ClockVector &clks,size_t &size,TreeClock *src,
+		ClockVector &src_clks);
+	//an entry advanced by a plain join, it was learned now by root
+	void AttachToRoot(ClockVector &clks,uint32 u);
+	uint32 GetMemSize() {
+		return (sizeof(uint32)*4+sizeof(timestamp_t))*parent_.capacity();
+	}
+
+private:
+	typedef std::vector<uint32> NodeVector;
+
+	void Grow(size_t n);
+	void Touch(ClockVector &clks);
+	void Detach(uint32 u);
+	void PushChild(uint32 u,uint32 p,timestamp_t aclk);
+	void CollectUpdated(ClockVector &clks,TreeClock *src,ClockVector &src_clks,
+		uint32 u,NodeVector &updated,size_t &visits);
+
+	uint32 root_;
+	bool published_;
+	NodeVector parent_;
+	NodeVector first_child_;
+	NodeVector next_;
+	NodeVector prev_;
+	ClockVector aclk_;
+
+	//using default copy constructor
+};
+
+#endif /* __CORE_TREE_CLOCK_H */
@@ -0,0 +1,32 @@
+#ifndef __CORE_UNIT_TEST_H
+#define __CORE_UNIT_TEST_H
+
+/**
+ * Checks for the unit tests of the code running outside of Pin. A failed
+ * check is printed and counted, the test program returns the number of
+ * failed checks.
+ */
+
+#include <cstdio>
+
+static int unit_test_failures=0;
+
+#define EXPECT_TRUE(cond) do {												\
+	if(!(cond)) {															\
+		fprintf(stderr,"%s:%d: check failed: %s\n",__FILE__,__LINE__,#cond);	\
+		unit_test_failures++;												\
+	}																		\
+} while(0)
+
+#define EXPECT_EQ(a,b) EXPECT_TRUE((a)==(b))
+
+#define RUN_TEST(test) do {													\
+	int failures_=unit_test_failures;										\
+	test();																	\
+	fprintf(stderr,"%s %s\n",unit_test_failures==failures_?"PASS":"FAIL",	\
+		#test);																\
+} while(0)
+
+#define UNIT_TEST_RESULT() (unit_test_failures!=0)
+
+#endif /* __CORE_UNIT_TEST_H */
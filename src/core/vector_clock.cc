@@ -1,9 +1,16 @@
 #include "core/vector_clock.h"
+#include <cstdio>
 #include <sstream>
+#include "core/atomic.h"
+#include "core/log.h"
 
 volatile uint32 VectorClock::vc_joins_=0;
 volatile uint32 VectorClock::vc_assigns_=0;
 volatile uint32 VectorClock::vc_hb_cmps_=0;
+volatile uint64 VectorClock::vc_join_entries_=0;
+volatile uint32 VectorClock::vc_materializes_=0;
+bool VectorClock::tree_clock_=false;
+const VectorClock::ClockVector VectorClock::empty_clks_;
 
 #ifndef MAX
 #define MAX(a,b) (((a)>(b)) ? (a) : (b))
@@ -13,36 +20,109 @@ volatile uint32 VectorClock::vc_hb_cmps_=0;
 #define MIN(a,b) (((a)<(b)) ? (a) : (b))
 #endif
 
+//thread uid -> slot table, open addressing with linear probing. keys are
+//stored as uid+1 so that zero marks an empty entry. a slot is published
+//before its key, so lookups need no lock.
+#define VC_SLOT_TABLE_SIZE (VC_MAX_SLOTS<<1)
+
+struct SlotEntry {
+	volatile thread_t key;
+	volatile uint32 slot;
+};
+
+static SlotEntry slot_table[VC_SLOT_TABLE_SIZE];
+static volatile uint32 slot_num=0;
+static volatile uint32 slot_lock=0;
+thread_t VectorClock::slot_thds_[VC_MAX_SLOTS];
+
+uint32 VectorClock::LookupSlot(thread_t thdId)
+{
+	thread_t key=thdId+1;
+	for(size_t i=thdId & (VC_SLOT_TABLE_SIZE-1);;
+		i=(i+1) & (VC_SLOT_TABLE_SIZE-1)) {
+		thread_t curr_key=slot_table[i].key;
+		if(curr_key==key)
+			return slot_table[i].slot;
+		if(curr_key==0)
+			return VC_MAX_SLOTS;
+	}
+}
+
+uint32 VectorClock::AcquireSlot(thread_t thdId)
+{
+	uint32 slot=LookupSlot(thdId);
+	if(slot!=VC_MAX_SLOTS)
+		return slot;
+	while(!ATOMIC_BOOL_COMPARE_AND_SWAP(&slot_lock,0,1))
+		;
+	slot=LookupSlot(thdId);
+	if(slot==VC_MAX_SLOTS) {
+		//the slots of the exited threads stay in the clocks, they are not
+		//reused, so the run stops before the slot tables overflow
+		if(slot_num>=VC_MAX_SLOTS)
+			LOG_FMT_MSG(assertLog,"more than %d threads in the run, out of "
+				"vector clock slots\n",VC_MAX_SLOTS);
+		slot=slot_num;
+		size_t i=thdId & (VC_SLOT_TABLE_SIZE-1);
+		while(slot_table[i].key!=0)
+			i=(i+1) & (VC_SLOT_TABLE_SIZE-1);
+		slot_thds_[slot]=thdId;
+		slot_table[i].slot=slot;
+		__sync_synchronize();
+		slot_table[i].key=thdId+1;
+		slot_num++;
+	}
+	ATOMIC_BOOL_COMPARE_AND_SWAP(&slot_lock,1,0);
+	return slot;
+}
+
+VectorClock::Rep *VectorClock::Share(Rep *rep)
+{
+	if(rep)
+		ATOMIC_ADD_AND_FETCH(&rep->ref,1);
+	return rep;
+}
+
+void VectorClock::Release(Rep *rep)
+{
+	if(rep && ATOMIC_SUB_AND_FETCH(&rep->ref,1)==0)
+		delete rep;
+}
+
+VectorClock::Rep *VectorClock::Mutable()
+{
+	if(!rep_)
+		rep_=new Rep;
+	else if(rep_->ref>1) {
+		Rep *rep=new Rep(*rep_);
+		//the sharers keep the current time of this clock
+		if(rep->tree)
+			rep->tree->Publish();
+		Release(rep_);
+		rep_=rep;
+		vc_materializes_++;
+	}
+	return rep_;
+}
+
 bool VectorClock::HappensBefore(VectorClock *vc)
 {
 	vc_hb_cmps_++;
-	//define two iterators for sorted comparasion
-	ThreadClockMap::iterator curr_it=map_.begin();
-	ThreadClockMap::iterator vc_it=vc->map_.begin();
-	for(;curr_it!=map_.end();++curr_it) {
-		thread_t currThdId=curr_it->first;
-		timestamp_t currThdClk=curr_it->second;
-
-		bool valid=false;
-		//compare same thread's different clock in different vc
-		//ensure current thread vc's entry not greater than vc's entry
-		for(;vc_it!=vc->map_.end();vc_it++) {
-			thread_t vcThdId=vc_it->first;
-			timestamp_t vcThdClk=vc_it->second;
-
-			if(vcThdId==currThdId) {
-				if(vcThdClk>=currThdClk) {
-					valid=true;
-					++vc_it;
-				}
-				break;
-			}
-			//map is default sorted by the key
-			else if(vcThdId>currThdId) {
-				break;
-			}
-		}
-		if(!valid)
+	return LessEqual(vc);
+}
+
+bool VectorClock::LessEqual(VectorClock *vc)
+{
+	if(rep_==vc->rep_)
+		return true;
+	//every entry of current vc should not be greater than vc's entry
+	const ClockVector &clks=Clocks();
+	const ClockVector &vc_clks=vc->Clocks();
+	for(size_t i=0;i<clks.size();i++) {
+		timestamp_t clk=clks[i];
+		if(clk==0)
+			continue;
+		if(i>=vc_clks.size() || vc_clks[i]<clk)
 			return false;
 	}
 	return true;
@@ -51,37 +131,17 @@ bool VectorClock::HappensBefore(VectorClock *vc)
 bool VectorClock::PreciseHappensBefore(VectorClock *vc)
 {
 	vc_hb_cmps_++;
-	//define two iterators for sorted comparasion
-	ThreadClockMap::iterator curr_it=map_.begin();
-	ThreadClockMap::iterator vc_it=vc->map_.begin();
+	const ClockVector &clks=Clocks();
+	const ClockVector &vc_clks=vc->Clocks();
 	bool precise=false;
-	for(;curr_it!=map_.end();++curr_it) {
-		thread_t currThdId=curr_it->first;
-		timestamp_t currThdClk=curr_it->second;
-
-		bool valid=false;
-		//compare same thread's different clock in different vc
-		//ensure current thread vc's entry not greater than vc's entry
-		for(;vc_it!=vc->map_.end();vc_it++) {
-			thread_t vcThdId=vc_it->first;
-			timestamp_t vcThdClk=vc_it->second;
-
-			if(vcThdId==currThdId) {
-				if(vcThdClk>=currThdClk) {
-					if(vcThdClk>currThdClk)
-						precise=true;
-					valid=true;
-					++vc_it;
-				}
-				break;
-			}
-			//map is default sorted by the key
-			else if(vcThdId>currThdId) {
-				break;
-			}
-		}
-		if(!valid)
+	for(size_t i=0;i<clks.size();i++) {
+		timestamp_t clk=clks[i];
+		if(clk==0)
+			continue;
+		if(i>=vc_clks.size() || vc_clks[i]<clk)
 			return false;
+		if(vc_clks[i]>clk)
+			precise=true;
 	}
 	return precise;
 }
@@ -89,32 +149,14 @@ bool VectorClock::PreciseHappensBefore(VectorClock *vc)
 bool VectorClock::HappensAfter(VectorClock *vc)
 {
 	vc_hb_cmps_++;
-	//define two iterators for sorted comparasion
-	ThreadClockMap::iterator curr_it=map_.begin();
-	ThreadClockMap::iterator vc_it=vc->map_.begin();
-	for(;curr_it!=map_.end();++curr_it) {
-		thread_t currThdId=curr_it->first;
-		timestamp_t currThdClk=curr_it->second;
-
-		bool valid=false;
-		//compare same thread's different clock in different vc
-		//ensure vc entry not greater than current thread vc's entry
-		for(;vc_it!=vc->map_.end();vc_it++) {
-			thread_t vcThdId=vc_it->first;
-			timestamp_t vcThdClk=vc_it->second;
-
-			if(vcThdId==currThdId) {
-				if(vcThdClk <= currThdClk) {
-					valid=true;
-					++vc_it;
-				}
-				break;
-			}
-			else if(vcThdId>currThdId) {
-				break;
-			}
-		}
-		if(!valid)
+	//every entry of current vc should exist in vc and not be less than it
+	const ClockVector &clks=Clocks();
+	const ClockVector &vc_clks=vc->Clocks();
+	for(size_t i=0;i<clks.size();i++) {
+		timestamp_t clk=clks[i];
+		if(clk==0)
+			continue;
+		if(i>=vc_clks.size() || vc_clks[i]==0 || vc_clks[i]>clk)
 			return false;
 	}
 	return true;
@@ -123,67 +165,130 @@ bool VectorClock::HappensAfter(VectorClock *vc)
 //Merge two vector clock
 void VectorClock::Join(VectorClock *vc)
 {
-	for(ThreadClockMap::iterator it=vc->map_.begin();
-		it!=vc->map_.end();it++) {
-		ThreadClockMap::iterator mit=map_.find(it->first);
-		if(mit==map_.end())
-			map_[it->first]=it->second;
-		else
-			map_[it->first]=MAX(it->second,mit->second);
-	}
 	vc_joins_++;
+	if(!vc->rep_ || rep_==vc->rep_)
+		return ;
+	//nothing of its own to keep, share the joined clock instead
+	if(!tree_owner_ && LessEqual(vc)) {
+		Rep *rep=Share(vc->rep_);
+		Release(rep_);
+		rep_=rep;
+		return ;
+	}
+	TreeClock *vc_tree=vc->Tree();
+	if(vc_tree)
+		vc_tree->Publish();
+	Rep *rep=Mutable();
+	if(rep->tree && !tree_owner_)
+		DropTree(rep);
+	ClockVector &vc_clks=vc->rep_->clks;
+	//sublinear join, only the advanced subtrees are visited
+	if(rep->tree && vc_tree) {
+		vc_join_entries_+=rep->tree->Join(rep->clks,rep->size,vc_tree,vc_clks);
+		return ;
+	}
+	ClockVector &clks=rep->clks;
+	size_t vc_size=vc_clks.size();
+	if(clks.size()<vc_size)
+		clks.resize(vc_size,0);
+	for(size_t i=0;i<vc_size;i++) {
+		timestamp_t clk=vc_clks[i];
+		if(clk>clks[i]) {
+			if(clks[i]==0)
+				rep->size++;
+			clks[i]=clk;
+			if(rep->tree)
+				rep->tree->AttachToRoot(clks,i);
+		}
+	}
+	vc_join_entries_+=vc_size;
 }
 
-void VectorClock::Increment(thread_t thdId) 
+void VectorClock::Increment(thread_t thdId)
 {
-	ThreadClockMap::iterator it=map_.find(thdId);
-	if(it==map_.end())
-		map_[thdId]=1;
-	else
-		it->second++;
+	uint32 slot=AcquireSlot(thdId);
+	Rep *rep=Mutable();
+	if(slot>=rep->clks.size())
+		rep->clks.resize(slot+1,0);
+	if(rep->clks[slot]++==0)
+		rep->size++;
+	if(rep->tree && tree_owner_ && rep->tree->Root()==slot)
+		rep->tree->Tick();
+	else if(rep->tree)
+		DropTree(rep);
+	else if(tree_clock_ && rep->size==1 && rep->clks[slot]==1) {
+		//a fresh clock, the incremented thread owns its timeline
+		rep->tree=new TreeClock(slot);
+		tree_owner_=true;
+	}
 }
 
-timestamp_t VectorClock::GetClock(thread_t thdId) 
+timestamp_t VectorClock::GetClock(thread_t thdId)
 {
-	ThreadClockMap::iterator it=map_.find(thdId);
-	if(it==map_.end())
+	const ClockVector &clks=Clocks();
+	uint32 slot=LookupSlot(thdId);
+	if(slot>=clks.size())
 		return 0;
-	return it->second;
+	return clks[slot];
 }
 
 void VectorClock::SetClock(thread_t thdId,timestamp_t clk)
 {
-	map_[thdId]=clk;
+	if(clk==0) {
+		uint32 slot=LookupSlot(thdId);
+		if(slot<Clocks().size() && Clocks()[slot]!=0) {
+			Rep *rep=Mutable();
+			rep->clks[slot]=0;
+			rep->size--;
+			DropTree(rep);
+		}
+		return ;
+	}
+	uint32 slot=AcquireSlot(thdId);
+	Rep *rep=Mutable();
+	if(slot>=rep->clks.size())
+		rep->clks.resize(slot+1,0);
+	if(rep->clks[slot]==0)
+		rep->size++;
+	rep->clks[slot]=clk;
+	DropTree(rep);
 }
 
 bool VectorClock::Equal(VectorClock *vc)
 {
-	if(map_.size()!=vc->map_.size())
+	if(rep_==vc->rep_)
+		return true;
+	if(Size()!=vc->Size())
 		return false;
-	ThreadClockMap::iterator curr_it=map_.begin();
-	ThreadClockMap::iterator vc_it=vc->map_.begin();
-
-	for(;curr_it!=map_.end() && vc_it != vc->map_.end();++curr_it,vc_it++) {
-		if(curr_it->first!=vc_it->first || curr_it->second!=vc_it->second)
+	const ClockVector &clks=Clocks();
+	const ClockVector &vc_clks=vc->Clocks();
+	size_t len=MIN(clks.size(),vc_clks.size());
+	for(size_t i=0;i<len;i++) {
+		if(clks[i]!=vc_clks[i])
 			return false;
 	}
+	//equal sizes imply the longer tail is all zero
 	return true;
 }
 //for debug
 std::string VectorClock::ToString()
 {
+	const ClockVector &clks=Clocks();
 	std::stringstream ss;
 	ss<<"[";
-	for(ThreadClockMap::iterator it=map_.begin();it!=map_.end();it++)
-		ss<<"T"<<std::hex<<it->first<<":"<<std::dec<<it->second<<" ";
+	for(size_t i=0;i<clks.size();i++)
+		if(clks[i])
+			ss<<"T"<<std::hex<<slot_thds_[i]<<":"<<std::dec<<clks[i]<<" ";
 	ss<<"]";
 	return ss.str();
 }
 
 std::string VectorClock::OutputString()
 {
+	const ClockVector &clks=Clocks();
 	std::stringstream ss;
-	for(ThreadClockMap::iterator it=map_.begin();it!=map_.end();it++)
-		ss<<std::hex<<it->first<<":"<<std::dec<<it->second<<",";
+	for(size_t i=0;i<clks.size();i++)
+		if(clks[i])
+			ss<<std::hex<<slot_thds_[i]<<":"<<std::dec<<clks[i]<<",";
 	return ss.str();
-}
\ No newline at end of file
+}
@@ -2,62 +2,147 @@
 #define __CORE_VECTOR_CLOCK_H
 
 #include "core/basictypes.h"
-#include <map>
+#include "core/tree_clock.h"
+#include <vector>
 
-//accordion vector clock
+//the max number of distinct threads the vector clocks can index, the run
+//is aborted when more threads start
+#define VC_MAX_SLOTS (1<<16)
+
+//dense vector clock. thread uids are compacted into global slots and the
+//clocks are stored in a contiguous array indexed by slot. a zero clock
+//stands for an absent entry. when tree clocks are enabled, the clock of a
+//thread timeline (and its copies) also carries a tree clock overlay.
+//
+//the array is a reference counted, copy-on-write representation. copying
+//a clock (e.g. into a mutex meta on unlock) only shares it, a private copy
+//is materialized when a shared clock is modified, which for a thread clock
+//is its next increment.
 class VectorClock {
 public:
-	VectorClock() {}
-	~VectorClock() {}
+	VectorClock():rep_(NULL),it_(0),tree_owner_(false) {}
+	VectorClock(const VectorClock &vc):rep_(Share(vc.rep_)),it_(0),
+		tree_owner_(false) {}
+	~VectorClock() { Release(rep_); }
 
 	static volatile uint32 vc_joins_;
 	static volatile uint32 vc_assigns_;
 	static volatile uint32 vc_hb_cmps_;
+	static volatile uint64 vc_join_entries_;
+	static volatile uint32 vc_materializes_;
+
+	static void EnableTreeClock(bool enable) { tree_clock_=enable; }
+	//the dense slot of a thread, stable for the whole run
+	static uint32 ThreadSlot(thread_t thdId) { return AcquireSlot(thdId); }
 
 	bool HappensBefore(VectorClock *vc);
 	bool HappensAfter(VectorClock *vc);
 
 	bool PreciseHappensBefore(VectorClock *vc);
-	
+
 	void Join(VectorClock *vc);
 	void Increment(thread_t thdId);
 	timestamp_t GetClock(thread_t thdId);
 	void SetClock(thread_t thdId,timestamp_t clk);
 	bool Equal(VectorClock *vc);
 	bool Find(thread_t thdId) {
-		return map_.find(thdId)!=map_.end();
+		return GetClock(thdId)!=0;
 	}
 	size_t Size() {
-		return map_.size();
+		return rep_?rep_->size:0;
 	}
 	void Erase(thread_t thdId) {
-		map_.erase(thdId);
+		SetClock(thdId,0);
 	}
 	void Clear() {
-		map_.clear();
+		Release(rep_);
+		rep_=NULL;
+		tree_owner_=false;
 	}
 	std::string ToString();
 	std::string OutputString();
 	//vector clock iterate for traversal
-	void IterBegin() {it_=map_.begin();}
-	bool IterEnd() { return it_==map_.end(); }
-	void IterNext() {++it_;}
-	thread_t IterCurrThd() {return it_->first;}
-	timestamp_t IterCurrClk(){return it_->second;}
-	VectorClock & operator =(const VectorClock &vc) { 
-		map_=vc.map_;
+	void IterBegin() {
+		it_=0;
+		IterSkip();
+	}
+	bool IterEnd() { return it_>=Clocks().size(); }
+	void IterNext() {
+		++it_;
+		IterSkip();
+	}
+	thread_t IterCurrThd() {return slot_thds_[it_];}
+	timestamp_t IterCurrClk(){return rep_->clks[it_];}
+	VectorClock & operator =(const VectorClock &vc) {
+		if(rep_!=vc.rep_) {
+			Rep *rep=Share(vc.rep_);
+			Release(rep_);
+			rep_=rep;
+		}
+		//copies are snapshots, only the thread clock itself learns
+		tree_owner_=false;
 		vc_assigns_++;
-		return *this; 
+		return *this;
 	}
+	//a shared representation is accounted to each sharer proportionally
 	uint32 GetMemSize() {
-		return sizeof(ThreadClockMap::value_type)*map_.size();
+		if(!rep_)
+			return 0;
+		uint32 size=sizeof(Rep)+sizeof(timestamp_t)*rep_->clks.capacity();
+		if(rep_->tree)
+			size+=rep_->tree->GetMemSize();
+		return size/rep_->ref;
 	}
 protected:
-	typedef std::map<thread_t,timestamp_t> ThreadClockMap;
-	ThreadClockMap map_;
-	ThreadClockMap::iterator it_;
+	typedef std::vector<timestamp_t> ClockVector;
+
+	class Rep {
+	public:
+		Rep():size(0),ref(1),tree(NULL) {}
+		Rep(const Rep &rep):clks(rep.clks),size(rep.size),ref(1),
+			tree(rep.tree?new TreeClock(*rep.tree):NULL) {}
+		~Rep() { delete tree; }
+
+		ClockVector clks;
+		size_t size;
+		volatile uint32 ref;
+		TreeClock *tree;
+	private:
+		Rep &operator=(const Rep &);
+	};
+
+	//thread uid <-> slot mapping shared by all vector clocks
+	static uint32 LookupSlot(thread_t thdId);
+	static uint32 AcquireSlot(thread_t thdId);
+
+	bool LessEqual(VectorClock *vc);
+	static Rep *Share(Rep *rep);
+	static void Release(Rep *rep);
+	//the private representation to be modified
+	Rep *Mutable();
+	const ClockVector &Clocks() { return rep_?rep_->clks:empty_clks_; }
+	TreeClock *Tree() { return rep_?rep_->tree:NULL; }
+
+	//single entries set from outside break the knowledge closure the tree
+	//relies on, such a clock falls back to plain joins
+	void DropTree(Rep *rep) {
+		delete rep->tree;
+		rep->tree=NULL;
+		tree_owner_=false;
+	}
+	void IterSkip() {
+		const ClockVector &clks=Clocks();
+		while(it_<clks.size() && clks[it_]==0)
+			++it_;
+	}
+
+	Rep *rep_;
+	size_t it_;
+	bool tree_owner_;
 
-	//using default copy constructor
+	static const ClockVector empty_clks_;
+	static thread_t slot_thds_[VC_MAX_SLOTS];
+	static bool tree_clock_;
 };
 
-#endif
\ No newline at end of file
+#endif
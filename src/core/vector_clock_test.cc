@@ -0,0 +1,186 @@
+#include "core/vector_clock.h"
+#include <vector>
+#include "core/unit_test.h"
+
+#define THREAD_NUM 16
+#define LOCK_NUM 4
+#define STEP_NUM 20000
+
+static uint32 Random(uint32 *seed)
+{
+	*seed=*seed*1103515245+12345;
+	return (*seed>>16) & 0x7fff;
+}
+
+static std::vector<timestamp_t> Clocks(VectorClock *vc,thread_t thd_num)
+{
+	std::vector<timestamp_t> clks;
+	for(thread_t t=1;t<=thd_num;t++)
+		clks.push_back(vc->GetClock(t));
+	return clks;
+}
+
+//the joined entries are the maximum of both sides. a thread clock whose
+//time was already read may tick its own entry before learning.
+static void CheckJoin(thread_t self,const std::vector<timestamp_t> &before,
+	const std::vector<timestamp_t> &src,const std::vector<timestamp_t> &after)
+{
+	for(size_t i=0;i<after.size();i++) {
+		timestamp_t expected=before[i]>src[i]?before[i]:src[i];
+		if(i+1==self)
+			EXPECT_TRUE(after[i]==expected || after[i]==expected+1);
+		else
+			EXPECT_EQ(after[i],expected);
+	}
+}
+
+//threads release and acquire locks at random, every acquire is checked
+//against the plain join of the clocks
+static void RunLocks(bool tree_clock,uint32 seed)
+{
+	VectorClock::EnableTreeClock(tree_clock);
+	VectorClock thds[THREAD_NUM];
+	VectorClock locks[LOCK_NUM];
+	for(thread_t t=1;t<=THREAD_NUM;t++)
+		thds[t-1].Increment(t);
+	for(uint32 i=0;i<STEP_NUM;i++) {
+		thread_t t=Random(&seed)%THREAD_NUM+1;
+		VectorClock *thd=&thds[t-1];
+		VectorClock *lock=&locks[Random(&seed)%LOCK_NUM];
+		if(Random(&seed)%2) {
+			*lock=*thd;
+			thd->Increment(t);
+			continue;
+		}
+		std::vector<timestamp_t> before=Clocks(thd,THREAD_NUM);
+		std::vector<timestamp_t> src=Clocks(lock,THREAD_NUM);
+		thd->Join(lock);
+		CheckJoin(t,before,src,Clocks(thd,THREAD_NUM));
+		//the released clock is a snapshot
+		EXPECT_TRUE(Clocks(lock,THREAD_NUM)==src);
+		EXPECT_TRUE(lock->HappensBefore(thd));
+	}
+	VectorClock::EnableTreeClock(false);
+}
+
+void TestTreeClockJoin()
+{
+	for(uint32 seed=1;seed<=4;seed++) {
+		RunLocks(true,seed);
+		RunLocks(false,seed);
+	}
+}
+
+//once every thread knows the others, a join of a thread that moved
+//alone only visits the advanced entries
+void TestTreeClockPruning()
+{
+	VectorClock::EnableTreeClock(true);
+	VectorClock thds[THREAD_NUM];
+	VectorClock lock;
+	for(thread_t t=1;t<=THREAD_NUM;t++)
+		thds[t-1].Increment(t);
+	//a round of handoffs through one lock, twice
+	for(int round=0;round<2;round++) {
+		for(thread_t t=1;t<=THREAD_NUM;t++) {
+			thds[t-1].Join(&lock);
+			lock=thds[t-1];
+			thds[t-1].Increment(t);
+		}
+	}
+	for(thread_t t=1;t<=THREAD_NUM;t++)
+		EXPECT_TRUE(lock.GetClock(t)>0);
+	//both threads catch up, then only the first one moves on
+	thds[0].Join(&lock);
+	thds[1].Join(&lock);
+	thds[0].Increment(1);
+	lock=thds[0];
+	uint64 entries=VectorClock::vc_join_entries_;
+	thds[1].Join(&lock);
+	EXPECT_TRUE(VectorClock::vc_join_entries_-entries<THREAD_NUM/2);
+	EXPECT_TRUE(lock.HappensBefore(&thds[1]));
+	EXPECT_EQ(thds[1].GetClock(1),lock.GetClock(1));
+	VectorClock::EnableTreeClock(false);
+}
+
+//a copy shares the clock until one side changes
+void TestCopyOnWrite()
+{
+	VectorClock vc;
+	vc.Increment(1);
+	vc.Increment(2);
+	uint32 mem_size=vc.GetMemSize();
+	VectorClock copy(vc);
+	VectorClock assigned;
+	assigned=vc;
+	EXPECT_TRUE(copy.Equal(&vc) && assigned.Equal(&vc));
+	//the shared clock is accounted to each sharer
+	EXPECT_EQ(vc.GetMemSize(),mem_size/3);
+	uint32 materializes=VectorClock::vc_materializes_;
+	copy.Increment(1);
+	EXPECT_EQ(VectorClock::vc_materializes_,materializes+1);
+	EXPECT_EQ(copy.GetClock(1),2);
+	EXPECT_EQ(vc.GetClock(1),1);
+	EXPECT_EQ(assigned.GetClock(1),1);
+	EXPECT_TRUE(vc.HappensBefore(&copy) && !copy.HappensBefore(&vc));
+	//the last sharer changes its clock in place
+	assigned.SetClock(3,5);
+	EXPECT_EQ(VectorClock::vc_materializes_,materializes+2);
+	vc.Erase(2);
+	EXPECT_EQ(VectorClock::vc_materializes_,materializes+2);
+	EXPECT_EQ(vc.GetClock(2),0);
+	EXPECT_EQ(vc.Size(),1);
+	EXPECT_EQ(assigned.GetClock(2),1);
+	EXPECT_EQ(assigned.GetClock(3),5);
+	EXPECT_EQ(copy.GetClock(2),1);
+	EXPECT_EQ(copy.Size(),2);
+	//self assignment and clearing a sharer
+	assigned=assigned;
+	EXPECT_EQ(assigned.GetClock(3),5);
+	copy=assigned;
+	assigned.Clear();
+	EXPECT_EQ(assigned.Size(),0);
+	EXPECT_EQ(copy.GetClock(3),5);
+}
+
+//a join shares the joined clock if there is nothing to keep, and the
+//joined clock does not see the later changes of the receiver
+void TestJoinAfterShare()
+{
+	for(int tree_clock=0;tree_clock<2;tree_clock++) {
+		VectorClock::EnableTreeClock(tree_clock);
+		VectorClock thd1,thd2,lock,meta;
+		thd1.Increment(1);
+		thd2.Increment(2);
+		lock=thd1;
+		thd1.Increment(1);
+		meta.Join(&lock);
+		EXPECT_TRUE(meta.Equal(&lock));
+		meta.Increment(3);
+		EXPECT_EQ(lock.GetClock(3),0);
+		EXPECT_EQ(meta.GetClock(1),1);
+		thd2.Join(&lock);
+		EXPECT_EQ(thd2.GetClock(1),1);
+		EXPECT_EQ(lock.GetClock(2),0);
+		//the released time stays with the lock while the thread moves on
+		lock=thd2;
+		thd2.Increment(2);
+		thd1.Join(&lock);
+		EXPECT_EQ(lock.GetClock(2),1);
+		EXPECT_TRUE(thd2.GetClock(2)>=2);
+		EXPECT_EQ(thd1.GetClock(2),1);
+		EXPECT_TRUE(lock.HappensBefore(&thd1));
+		EXPECT_TRUE(!thd2.HappensBefore(&thd1));
+		EXPECT_TRUE(!thd1.HappensBefore(&thd2));
+	}
+	VectorClock::EnableTreeClock(false);
+}
+
+int main(int argc,char *argv[])
+{
+	RUN_TEST(TestTreeClockJoin);
+	RUN_TEST(TestTreeClockPruning);
+	RUN_TEST(TestCopyOnWrite);
+	RUN_TEST(TestJoinAfterShare);
+	return UNIT_TEST_RESULT();
+}
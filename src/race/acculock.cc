@@ -8,15 +8,7 @@ AccuLock::AccuLock():track_racy_inst_(false)
 
 AccuLock::~AccuLock()
 {
-	for(LockSetTable::iterator it=curr_lockset_table_.begin();
-		it!=curr_lockset_table_.end();it++) {
-		delete it->second;
-	}
 
-	for(LockSetTable::iterator it=curr_reader_lockset_table_.begin();
-		it!=curr_reader_lockset_table_.end();it++) {
-		delete it->second;
-	}
 }
 
 void AccuLock::Register()
@@ -45,10 +37,9 @@ void AccuLock::AfterPthreadMutexLock(thread_t curr_thd_id,timestamp_t curr_thd_c
 	LockCountIncrease();
 	ScopedLock lock(internal_lock_);
 	LockSet *curr_lockset;
-	if(curr_lockset_table_.find(curr_thd_id)==curr_lockset_table_.end() ||
-		!curr_lockset_table_[curr_thd_id])
-		curr_lockset_table_[curr_thd_id]=new LockSet;
-	curr_lockset=curr_lockset_table_[curr_thd_id];
+	if(!WriterLockSet(curr_thd_id))
+		WriterLockSet(curr_thd_id)=new LockSet;
+	curr_lockset=WriterLockSet(curr_thd_id);
 	DEBUG_ASSERT(curr_lockset);
 	curr_lockset->Add(addr);
 }
@@ -58,10 +49,10 @@ void AccuLock::BeforePthreadMutexUnlock(thread_t curr_thd_id,timestamp_t curr_th
 {
 	LockCountIncrease();
 	ScopedLock lock(internal_lock_);
-	LockSet *curr_lockset=curr_lockset_table_[curr_thd_id];
+	LockSet *curr_lockset=WriterLockSet(curr_thd_id);
 	DEBUG_ASSERT(curr_lockset && curr_lockset->Exist(addr));
 	curr_lockset->Remove(addr);
-	curr_vc_map_[curr_thd_id]->Increment(curr_thd_id);
+	GetThreadVC(curr_thd_id)->Increment(curr_thd_id);
 }
 
 void AccuLock::AfterPthreadRwlockRdlock(thread_t curr_thd_id,timestamp_t curr_thd_clk, 
@@ -71,9 +62,9 @@ void AccuLock::AfterPthreadRwlockRdlock(thread_t curr_thd_id,timestamp_t curr_th
 	ScopedLock lock(internal_lock_);
 	//only for readlock
 	LockSet *curr_reader_lockset;
-	if(!curr_reader_lockset_table_[curr_thd_id])
-		curr_reader_lockset_table_[curr_thd_id]=new LockSet;
-	curr_reader_lockset=curr_reader_lockset_table_[curr_thd_id];
+	if(!ReaderLockSet(curr_thd_id))
+		ReaderLockSet(curr_thd_id)=new LockSet;
+	curr_reader_lockset=ReaderLockSet(curr_thd_id);
 	DEBUG_ASSERT(curr_reader_lockset);
 	curr_reader_lockset->Add(addr);
 }
@@ -91,34 +82,30 @@ void AccuLock::BeforePthreadRwlockUnlock(thread_t curr_thd_id,timestamp_t curr_t
 	ScopedLock lock(internal_lock_);
 	bool found=false;
 	//search in reader lockset
-	if((curr_reader_lockset_table_.find(curr_thd_id)!=
-		curr_reader_lockset_table_.end()) && 
-		curr_reader_lockset_table_[curr_thd_id]!=NULL) {
+	if(ReaderLockSet(curr_thd_id)!=NULL) {
 
-		LockSet *curr_reader_lockset=curr_reader_lockset_table_[curr_thd_id];
+		LockSet *curr_reader_lockset=ReaderLockSet(curr_thd_id);
 		curr_reader_lockset->Remove(addr);
 		found=true;
 	}
-	if((curr_lockset_table_.find(curr_thd_id)!=curr_lockset_table_.end()) &&
-		curr_lockset_table_[curr_thd_id]!=NULL) {
-		LockSet *curr_lockset=curr_lockset_table_[curr_thd_id];
+	if(WriterLockSet(curr_thd_id)!=NULL) {
+		LockSet *curr_lockset=WriterLockSet(curr_thd_id);
 		curr_lockset->Remove(addr);
 		found=true;	
 	}
 
 	DEBUG_ASSERT(found);
-	curr_vc_map_[curr_thd_id]->Increment(curr_thd_id);
+	GetThreadVC(curr_thd_id)->Increment(curr_thd_id);
 }
 
 Detector::Meta *AccuLock::GetMeta(address_t iaddr)
 {
-	Meta::Table::iterator it=meta_table_.find(iaddr);
-	if(it==meta_table_.end()) {
-		Meta *meta=new AccuLockMeta(iaddr);
-		meta_table_[iaddr]=meta;
-		return meta;
+	Meta *meta=meta_table_.Find(iaddr);
+	if(!meta) {
+		meta=new AccuLockMeta(iaddr);
+		meta_table_.Insert(iaddr,meta);
 	}
-	return it->second;
+	return meta;
 }
 
 void AccuLock::ProcessRead(thread_t curr_thd_id,Meta *meta,Inst *inst)
@@ -126,7 +113,7 @@ void AccuLock::ProcessRead(thread_t curr_thd_id,Meta *meta,Inst *inst)
 	//INFO_PRINT("process read\n");
 	AccuLockMeta *acculock_meta=dynamic_cast<AccuLockMeta*>(meta);
 	DEBUG_ASSERT(acculock_meta);
-	VectorClock *curr_vc=curr_vc_map_[curr_thd_id];
+	VectorClock *curr_vc=GetThreadVC(curr_thd_id);
 	timestamp_t curr_clk=curr_vc->GetClock(curr_thd_id);
 
 	AccuLockMeta::Epoch &writer_epoch=acculock_meta->writer_epls_pair.first;
@@ -143,21 +130,19 @@ void AccuLock::ProcessRead(thread_t curr_thd_id,Meta *meta,Inst *inst)
 	acculock_meta->reader_epls_map[curr_thd_id].first.first=curr_thd_id;
 	acculock_meta->reader_epls_map[curr_thd_id].first.second=curr_clk;
 	
-	if(curr_lockset_table_.find(curr_thd_id)!=curr_lockset_table_.end() &&
-		curr_lockset_table_[curr_thd_id]!=NULL) {
+	if(WriterLockSet(curr_thd_id)!=NULL) {
 		//update lockset
 		acculock_meta->reader_epls_map[curr_thd_id].second=
-			*curr_lockset_table_[curr_thd_id];
+			*WriterLockSet(curr_thd_id);
 	}
 	//
-	if(curr_reader_lockset_table_.find(curr_thd_id)!=curr_reader_lockset_table_.end() 
-		&& curr_reader_lockset_table_[curr_thd_id]!=NULL) {
+	if(ReaderLockSet(curr_thd_id)!=NULL) {
 		acculock_meta->reader_epls_map[curr_thd_id].second.Join(
-			curr_reader_lockset_table_[curr_thd_id]);
+			ReaderLockSet(curr_thd_id));
 	}
 	// INFO_FMT_PRINT("addr:%lx\n",acculock_meta->addr);
 	// INFO_FMT_PRINT("reader_epoch:<%lx,%ld>\n",curr_thd_id,curr_clk);
-	// if(curr_lockset_table_[curr_thd_id]) {
+	// if(WriterLockSet(curr_thd_id)) {
 	// 	INFO_FMT_PRINT("reader_lockset :%s\n",
 	// 		acculock_meta->reader_epls_map[curr_thd_id].second.ToString().c_str());	
 	// }
@@ -206,7 +191,7 @@ void AccuLock::ProcessWrite(thread_t curr_thd_id,Meta *meta,Inst *inst)
 	//INFO_PRINT("process write\n");
 	AccuLockMeta *acculock_meta=dynamic_cast<AccuLockMeta*>(meta);
 	DEBUG_ASSERT(acculock_meta);
-	VectorClock *curr_vc=curr_vc_map_[curr_thd_id];
+	VectorClock *curr_vc=GetThreadVC(curr_thd_id);
 	timestamp_t curr_clk=curr_vc->GetClock(curr_thd_id);
 
 	//redudant write
@@ -226,9 +211,8 @@ void AccuLock::ProcessWrite(thread_t curr_thd_id,Meta *meta,Inst *inst)
 	//write-write race
 	if(writer_epoch.first!=curr_thd_id && 
 		writer_epoch.second > curr_vc->GetClock(writer_epoch.first)) {
-		if(curr_lockset_table_.find(curr_thd_id)!=curr_lockset_table_.end() &&
-			curr_lockset_table_[curr_thd_id])
-			writer_lockset->Merge(curr_lockset_table_[curr_thd_id]);
+		if(WriterLockSet(curr_thd_id))
+			writer_lockset->Merge(WriterLockSet(curr_thd_id));
 		else
 			writer_lockset->Clear();
 		if(writer_lockset->Empty()) {
@@ -243,10 +227,9 @@ void AccuLock::ProcessWrite(thread_t curr_thd_id,Meta *meta,Inst *inst)
 		}
 	}
 	else {
-		if(curr_lockset_table_.find(curr_thd_id)!=curr_lockset_table_.end() &&
-			curr_lockset_table_[curr_thd_id]) {
+		if(WriterLockSet(curr_thd_id)) {
 			acculock_meta->writer_epls_pair.second=
-											*curr_lockset_table_[curr_thd_id];
+											*WriterLockSet(curr_thd_id);
 		}
 	}
 	
@@ -265,7 +248,7 @@ void AccuLock::ProcessWrite(thread_t curr_thd_id,Meta *meta,Inst *inst)
 
 		if(reader_epoch.first!=curr_thd_id && 
 			reader_epoch.second>curr_vc->GetClock(reader_epoch.first)) {
-			if(reader_lockset->Disjoint(curr_lockset_table_[curr_thd_id])) {
+			if(reader_lockset->Disjoint(WriterLockSet(curr_thd_id))) {
 				
 				//PrintDebugRaceInfo("ACCULOCK",READTOWRITE,acculock_meta,curr_thd_id,inst);
 
@@ -10,7 +10,6 @@ namespace race{
 
 class AccuLock:public Detector {
 public:
-	typedef std::map<thread_t,LockSet *> LockSetTable;
 	
 	AccuLock();
 	~AccuLock();
@@ -61,10 +60,6 @@ protected:
 
 	//whether to track the racy inst
 	bool track_racy_inst_;
-	//locks having been protected current write accesses
-	LockSetTable curr_lockset_table_;
-	//locks having been proteced current read accesses
-	LockSetTable curr_reader_lockset_table_;
 private:
 	DISALLOW_COPY_CONSTRUCTORS(AccuLock);
 };
@@ -5,21 +5,27 @@
 
 namespace race {
 
-std::map<std::string,Detector::EventHandle> Detector::event_handle_table;
+Detector::EventHandle Detector::event_handle_table[EVENT_NUM];
 int Detector::prl_dtc_num=0;
 
-Detector::Detector():internal_lock_(NULL),race_db_(NULL),unit_size_(4),
-	filter_(NULL),vc_mem_size_(0),adhoc_sync_(NULL),loop_db_(NULL),
-	cond_wait_db_(NULL)
-{}
+Detector::Detector():internal_lock_(NULL),access_lock_(NULL),striped_(false),
+	race_db_(NULL),unit_size_(4),filter_(NULL),vc_mem_size_(0),adhoc_sync_(NULL),
+	loop_db_(NULL),cond_wait_db_(NULL),prl_dtc_idx_(0)
+{
+	thd_ctx_table_.resize(VC_MAX_SLOTS,NULL);
+	thd_ctxs_=&thd_ctx_table_;
+	for(int i=0;i<DETECTOR_STRIPE_NUM;i++)
+		stripe_locks_[i]=NULL;
+}
 
 Detector::~Detector() 
 {
 	delete internal_lock_;
+	for(int i=0;i<DETECTOR_STRIPE_NUM;i++)
+		delete stripe_locks_[i];
 	delete filter_;
-	for(std::map<thread_t,VectorClock *>::iterator it=curr_vc_map_.begin();
-		it!=curr_vc_map_.end();)
-		curr_vc_map_.erase(it++);
+	for(size_t i=0;i<thd_ctx_table_.size();i++)
+		delete thd_ctx_table_[i];
 	if(adhoc_sync_)
 		delete adhoc_sync_;
 	if(loop_db_)
@@ -30,9 +36,9 @@ Detector::~Detector()
 
 void Detector::SaveStatistics(const char *file_name)
 {
-	for(std::map<thread_t,VectorClock *>::iterator it=curr_vc_map_.begin();
-		it!=curr_vc_map_.end();it++)
-		vc_mem_size_+=it->second->GetMemSize();
+	for(size_t i=0;i<thd_ctx_table_.size();i++)
+		if(thd_ctx_table_[i] && thd_ctx_table_[i]->vc)
+			vc_mem_size_+=thd_ctx_table_[i]->vc->GetMemSize();
 
 	//split the director and name
 	// string tmp(file_name);
@@ -53,8 +59,15 @@ void Detector::SaveStatistics(const char *file_name)
 	out<<"vc_joins:    "<<VectorClock::vc_joins_<<std::endl;
 	out<<"vc_assigns:  "<<VectorClock::vc_assigns_<<std::endl;
 	out<<"vc_hb_cmps:  "<<VectorClock::vc_hb_cmps_<<std::endl;
+	out<<"vc_join_entries: "<<VectorClock::vc_join_entries_<<std::endl;
+	out<<"vc_materializes: "<<VectorClock::vc_materializes_<<std::endl;
 	out<<"vc_mem_size: "<<vc_mem_size_<<std::endl;
 
+	out<<"shadow_pages:     "<<meta_table_.GetPageNum()<<std::endl;
+	out<<"shadow_peak_pages:"<<meta_table_.GetPeakPageNum()<<std::endl;
+	out<<"shadow_metas:     "<<meta_table_.GetLiveNum()<<std::endl;
+	out<<"shadow_mem_size:  "<<meta_table_.GetMemSize()<<std::endl;
+
 	out<<"ls_itsecs:   "<<LockSet::ls_itsecs_<<std::endl;
 	out<<"ls_assigns:  "<<LockSet::ls_assigns_<<std::endl;
 	out<<"ls_allocas:  "<<LockSet::ls_allocas_<<std::endl;
@@ -92,6 +105,8 @@ void Detector::PrintDebugRaceInfo(const char *detector_name,RaceType race_type,
 void Detector::Register()
 {
 	knob_->RegisterInt("unit_size_","the monitoring granularity in bytes","4");
+	knob_->RegisterBool("tree_clock","whether to use tree clocks for thread and"
+		" sync vector clocks","0");
 	knob_->RegisterStr("loop_range_lines","the loop's start line and end line",
 		"0");
 	knob_->RegisterStr("exiting_cond_lines","spin reads in each loop",
@@ -102,10 +117,14 @@ void Detector::Register()
 
 void Detector::Setup(Mutex *lock,RaceDB *race_db)
 {
-	internal_lock_=lock;
+	//every non-striped event holds the lock exclusively
+	access_lock_=new SharedMutex(lock);
+	internal_lock_=access_lock_;
 	race_db_=race_db;
 	unit_size_=knob_->ValueInt("unit_size_");
-	filter_=new RegionFilter(internal_lock_->Clone());
+	VectorClock::EnableTreeClock(knob_->ValueBool("tree_clock"));
+	filter_=new RegionFilter(lock->Clone());
+	meta_table_.SetUnitSize(unit_size_);
 
 	//set analyzer descriptor
 	desc_.SetHookBeforeMem();
@@ -143,6 +162,12 @@ void Detector::Setup(Mutex *lock,RaceDB *race_db)
 		}
 		INFO_PRINT("=======cond_wait_lines end=======\n");
 	}
+	//ad-hoc sync analysis touches global state on every read
+	striped_=StripedAccess() && !adhoc_sync_;
+	if(striped_) {
+		for(int i=0;i<DETECTOR_STRIPE_NUM;i++)
+			stripe_locks_[i]=lock->Clone();
+	}
 	//parallelize the detection 
 	if(prl_dtc_num>0) {
 		REGISTER_EVENT_HANDLE(ImageLoad);
@@ -190,6 +215,7 @@ void Detector::Setup(Mutex *lock,RaceDB *race_db)
 		REGISTER_EVENT_HANDLE(BeforeSemPost);
 		REGISTER_EVENT_HANDLE(BeforeSemWait);
 		REGISTER_EVENT_HANDLE(AfterSemWait);
+		REGISTER_EVENT_HANDLE(PartitionMigrate);
 	}
 }
 
@@ -226,14 +252,14 @@ void Detector::ThreadStart(thread_t curr_thd_id,thread_t parent_thd_id)
 	curr_vc->Increment(curr_thd_id);
 	if(parent_thd_id!=INVALID_THD_ID) {
 		//not the main thread
-		VectorClock *parent_vc=curr_vc_map_[parent_thd_id];
+		VectorClock *parent_vc=GetThreadVC(parent_thd_id);
 		DEBUG_ASSERT(parent_vc);
 		curr_vc->Join(parent_vc);
 		parent_vc->Increment(parent_thd_id);
 	}
-	curr_vc_map_[curr_thd_id]=curr_vc;
-	//init atomic map
-	atomic_map_[curr_thd_id]=false;
+	ThreadContext *ctx=GetThreadContext(curr_thd_id);
+	ctx->vc=curr_vc;
+	ctx->atomic=false;
 }
 
 void Detector::ThreadExit(thread_t curr_thd_id,timestamp_t curr_thd_clk)
@@ -249,10 +275,62 @@ void Detector::BeforeMemRead(thread_t curr_thd_id, timestamp_t curr_thd_clk,
 	Inst *inst, address_t addr, size_t size)
 {
 	ReadInstCountIncrease();
+	if(striped_) {
+		ProcessStripedAccess(curr_thd_id,inst,addr,size,false);
+		return ;
+	}
+	ScopedLock lock(internal_lock_);
+	ProcessMemRead(curr_thd_id,inst,addr,size);
+}
+
+void Detector::BeforeMemWrite(thread_t curr_thd_id, timestamp_t curr_thd_clk,
+	Inst *inst, address_t addr, size_t size)
+{
+	WriteInstCountIncrease();
+	if(striped_) {
+		ProcessStripedAccess(curr_thd_id,inst,addr,size,true);
+		return ;
+	}
+	ScopedLock lock(internal_lock_);
+	ProcessMemWrite(curr_thd_id,inst,addr,size);
+}
+
+//the run keeps the order of its events, only the lock is taken once
+void Detector::BeforeMemBatch(EventRecord *recs,size_t num)
+{
+	if(striped_) {
+		for(size_t i=0;i<num;i++) {
+			bool is_write=recs[i].id==BEFORE_MEM_WRITE;
+			if(is_write)
+				WriteInstCountIncrease();
+			else
+				ReadInstCountIncrease();
+			ProcessStripedAccess(recs[i].mem.thd_id,recs[i].mem.inst,
+				recs[i].mem.addr,recs[i].mem.size,is_write);
+		}
+		return ;
+	}
 	ScopedLock lock(internal_lock_);
+	for(size_t i=0;i<num;i++) {
+		if(recs[i].id==BEFORE_MEM_WRITE) {
+			WriteInstCountIncrease();
+			ProcessMemWrite(recs[i].mem.thd_id,recs[i].mem.inst,
+				recs[i].mem.addr,recs[i].mem.size);
+		}
+		else {
+			ReadInstCountIncrease();
+			ProcessMemRead(recs[i].mem.thd_id,recs[i].mem.inst,
+				recs[i].mem.addr,recs[i].mem.size);
+		}
+	}
+}
+
+void Detector::ProcessMemRead(thread_t curr_thd_id,Inst *inst,address_t addr,
+	size_t size)
+{
 	if(FilterAccess(addr))
 		return;
-	if(atomic_map_[curr_thd_id])
+	if(GetThreadContext(curr_thd_id)->atomic)
 		return;
 	// //process write->spinning read sync
 	// if(loop_db_)
@@ -305,14 +383,12 @@ void Detector::BeforeMemRead(thread_t curr_thd_id, timestamp_t curr_thd_clk,
 	}
 }
 
-void Detector::BeforeMemWrite(thread_t curr_thd_id, timestamp_t curr_thd_clk,
-	Inst *inst, address_t addr, size_t size)
+void Detector::ProcessMemWrite(thread_t curr_thd_id,Inst *inst,address_t addr,
+	size_t size)
 {
-	WriteInstCountIncrease();
-	ScopedLock lock(internal_lock_);
 	if(FilterAccess(addr))
 		return ;
-	if(atomic_map_[curr_thd_id])
+	if(GetThreadContext(curr_thd_id)->atomic)
 		return ;
 
 	// //process write->spinning read sync
@@ -340,7 +416,7 @@ void Detector::BeforeMemWrite(thread_t curr_thd_id, timestamp_t curr_thd_clk,
 	// }
 	//keep the lastest write
 	if(adhoc_sync_) {
-		adhoc_sync_->AddOrUpdateWriteMeta(curr_thd_id,curr_vc_map_[curr_thd_id],
+		adhoc_sync_->AddOrUpdateWriteMeta(curr_thd_id,GetThreadVC(curr_thd_id),
 			inst,start_addr,end_addr);
 	}
 
@@ -350,13 +426,74 @@ void Detector::BeforeMemWrite(thread_t curr_thd_id, timestamp_t curr_thd_clk,
 		ProcessWrite(curr_thd_id,meta,inst);
 	}
 }
+//the access holds the internal lock shared, so it only excludes the events
+//holding it exclusively, and the stripes covering its units
+void Detector::ProcessStripedAccess(thread_t curr_thd_id,Inst *inst,
+	address_t addr,size_t size,bool is_write)
+{
+	ScopedSharedLock lock(access_lock_);
+	if(FilterAccess(addr))
+		return ;
+	if(GetThreadContext(curr_thd_id)->atomic)
+		return ;
+	address_t start_addr=UNIT_DOWN_ALIGN(addr,unit_size_);
+	address_t end_addr=UNIT_UP_ALIGN(addr+size,unit_size_);
+	if(unit_size_==0)
+		end_addr=addr+1;
+	LockStripes(start_addr,end_addr);
+	for(address_t iaddr=start_addr;iaddr<end_addr;) {
+		Meta *meta=GetMeta(iaddr);
+		DEBUG_ASSERT(meta);
+		if(is_write)
+			ProcessWrite(curr_thd_id,meta,inst);
+		else
+			ProcessRead(curr_thd_id,meta,inst);
+		if(unit_size_==0)
+			break;
+		iaddr+=unit_size_;
+	}
+	UnlockStripes(start_addr,end_addr);
+}
+
+//stripes are always taken in increasing index order
+void Detector::LockStripes(address_t start_addr,address_t end_addr)
+{
+	size_t first=StripeIndex(start_addr);
+	size_t num=((end_addr-1)>>DETECTOR_STRIPE_SHIFT)-
+		(start_addr>>DETECTOR_STRIPE_SHIFT)+1;
+	if(num>=DETECTOR_STRIPE_NUM) {
+		for(size_t i=0;i<DETECTOR_STRIPE_NUM;i++)
+			stripe_locks_[i]->Lock();
+		return ;
+	}
+	//wrapped range, the low stripes come first
+	if(first+num>DETECTOR_STRIPE_NUM) {
+		for(size_t i=0;i<first+num-DETECTOR_STRIPE_NUM;i++)
+			stripe_locks_[i]->Lock();
+		num=DETECTOR_STRIPE_NUM-first;
+	}
+	for(size_t i=first;i<first+num;i++)
+		stripe_locks_[i]->Lock();
+}
+
+void Detector::UnlockStripes(address_t start_addr,address_t end_addr)
+{
+	size_t first=StripeIndex(start_addr);
+	size_t num=((end_addr-1)>>DETECTOR_STRIPE_SHIFT)-
+		(start_addr>>DETECTOR_STRIPE_SHIFT)+1;
+	if(num>=DETECTOR_STRIPE_NUM)
+		num=DETECTOR_STRIPE_NUM;
+	for(size_t i=0;i<num;i++)
+		stripe_locks_[(first+i) & (DETECTOR_STRIPE_NUM-1)]->Unlock();
+}
+
 //atomic inst doesn't need to be considered
 void Detector::BeforeAtomicInst(thread_t curr_thd_id,timestamp_t curr_thd_clk, 
 	Inst *inst,std::string type, address_t addr)
 {
 	VolatileCountIncrease();
 	ScopedLock lock(internal_lock_);
-	atomic_map_[curr_thd_id]=true;
+	GetThreadContext(curr_thd_id)->atomic=true;
 	if(loop_db_)
 		ProcessSRLSync(curr_thd_id,inst);
 	if(cond_wait_db_)
@@ -368,7 +505,7 @@ void Detector::AfterAtomicInst(thread_t curr_thd_id,timestamp_t curr_thd_clk,
 	Inst *inst,std::string type, address_t addr)
 {
 	ScopedLock lock(internal_lock_);
-	atomic_map_[curr_thd_id]=false;
+	GetThreadContext(curr_thd_id)->atomic=false;
 }
 
 void Detector::BeforePthreadJoin(thread_t curr_thd_id,timestamp_t curr_thd_clk,
@@ -385,15 +522,16 @@ void Detector::AfterPthreadJoin(thread_t curr_thd_id,timestamp_t curr_thd_clk,
 	Inst *inst,thread_t child_thd_id)
 {
 	ScopedLock lock(internal_lock_);
-	VectorClock *curr_vc=curr_vc_map_[curr_thd_id];
-	VectorClock *child_vc=curr_vc_map_[child_thd_id];
+	VectorClock *curr_vc=GetThreadVC(curr_thd_id);
+	VectorClock *child_vc=GetThreadVC(child_thd_id);
 	curr_vc->Join(child_vc);
 	curr_vc->Increment(curr_thd_id);
 	// remove the child thread vc
 	if(loop_db_ || cond_wait_db_)
 		return ;
-	delete curr_vc_map_[child_thd_id];
-	curr_vc_map_.erase(child_thd_id);		
+	ThreadContext *child_ctx=GetThreadContext(child_thd_id);
+	delete child_ctx->vc;
+	child_ctx->vc=NULL;
 }
 
 void Detector::AfterPthreadCreate(thread_t currThdId,timestamp_t currThdClk,
@@ -801,6 +939,33 @@ void Detector::AllocAddrRegion(address_t addr,size_t size)
 
 }
 
+//every attached detector reaches the plan at the same cut of the event
+//stream. the old owners send before waiting, so the exchange can not
+//block, and the detached ones are not waited for.
+void Detector::PartitionMigrate(PartitionPlan *plan)
+{
+	if(plan->Outgoing(prl_dtc_idx_)) {
+		std::vector<Meta *> metas;
+		for(meta_table_.IterBegin();!meta_table_.IterEnd();meta_table_.IterNext()) {
+			Meta *meta=meta_table_.IterCurr();
+			if(plan->Source(Partitioner::Shard(meta->addr))==prl_dtc_idx_)
+				metas.push_back(meta);
+		}
+		for(size_t i=0;i<metas.size();i++) {
+			meta_table_.Remove(metas[i]->addr);
+			plan->Send(plan->Target(Partitioner::Shard(metas[i]->addr)),metas[i]);
+		}
+	}
+	plan->FinishSend(prl_dtc_idx_);
+	std::vector<void *> &inbox=plan->Inbox(prl_dtc_idx_);
+	for(size_t i=0;i<inbox.size();i++) {
+		Meta *meta=(Meta *)inbox[i];
+		meta_table_.Insert(meta->addr,meta);
+	}
+	inbox.clear();
+	plan->Finish(prl_dtc_idx_);
+}
+
 void Detector::FreeAddrRegion(address_t addr)
 {
 
@@ -809,15 +974,9 @@ void Detector::FreeAddrRegion(address_t addr)
 	size_t size=filter_->RemoveRegion(addr,false);
 	address_t start_addr=UNIT_DOWN_ALIGN(addr,unit_size_);
 	address_t end_addr=UNIT_UP_ALIGN(addr+size,unit_size_);
-	//for memory
-	for(address_t iaddr=start_addr;iaddr<end_addr;iaddr += unit_size_) {
-		Meta::Table::iterator it=meta_table_.find(iaddr);
-		if(it!=meta_table_.end()) {
-			//for every meta
-			ProcessFree(it->second);
-			meta_table_.erase(it);
-		}
-	}
+	//for memory, release the shadow pages in bulk
+	MetaFreer freer(this);
+	meta_table_.Release(start_addr,end_addr,freer);
 	//for mutex
 	for(address_t iaddr=start_addr;iaddr<end_addr;iaddr += unit_size_) {
 		MutexMeta::Table::iterator it=mutex_meta_table_.find(iaddr);
@@ -933,13 +1092,14 @@ Detector::SemMeta *Detector::GetSemMeta(address_t iaddr)
 void Detector::ReportRace(Meta *meta, thread_t t0, Inst *i0,
 	RaceEventType p0, thread_t t1, Inst *i1,RaceEventType p1)
 {
-	race_db_->CreateRace(meta->addr,t0,i0,p0,t1,i1,p1,false);
+	//striped accesses report concurrently, the race db locks for itself
+	race_db_->CreateRace(meta->addr,t0,i0,p0,t1,i1,p1,striped_);
 }
 
 
 void Detector::ProcessLock(thread_t curr_thd_id,MutexMeta *meta)
 {
-	VectorClock *curr_vc=curr_vc_map_[curr_thd_id];
+	VectorClock *curr_vc=GetThreadVC(curr_thd_id);
 	DEBUG_ASSERT(curr_vc);
 	curr_vc->Join(&meta->vc);
 
@@ -947,7 +1107,7 @@ void Detector::ProcessLock(thread_t curr_thd_id,MutexMeta *meta)
 
 void Detector::ProcessUnlock(thread_t curr_thd_id,MutexMeta *meta)
 {
-	VectorClock *curr_vc=curr_vc_map_[curr_thd_id];
+	VectorClock *curr_vc=GetThreadVC(curr_thd_id);
 	//update the mutex vector clock
 	meta->vc=*curr_vc;
 	curr_vc->Increment(curr_thd_id);
@@ -955,7 +1115,7 @@ void Detector::ProcessUnlock(thread_t curr_thd_id,MutexMeta *meta)
 
 void Detector::ProcessNotify(thread_t curr_thd_id,CondMeta *meta)
 {
-	VectorClock *curr_vc=curr_vc_map_[curr_thd_id];
+	VectorClock *curr_vc=GetThreadVC(curr_thd_id);
 	DEBUG_ASSERT(curr_vc);
 
 	//iterate the wait table,join vector clock
@@ -973,7 +1133,7 @@ void Detector::ProcessNotify(thread_t curr_thd_id,CondMeta *meta)
 
 void Detector::ProcessPreWait(thread_t curr_thd_id,CondMeta *meta)
 {
-	VectorClock *curr_vc=curr_vc_map_[curr_thd_id];
+	VectorClock *curr_vc=GetThreadVC(curr_thd_id);
 	DEBUG_ASSERT(curr_vc);
 	meta->wait_table[curr_thd_id]=*curr_vc;
 	curr_vc->Increment(curr_thd_id);
@@ -981,7 +1141,7 @@ void Detector::ProcessPreWait(thread_t curr_thd_id,CondMeta *meta)
 
 void Detector::ProcessPostWait(thread_t curr_thd_id,CondMeta *meta)
 {
-	VectorClock *curr_vc=curr_vc_map_[curr_thd_id];
+	VectorClock *curr_vc=GetThreadVC(curr_thd_id);
 	CondMeta::VectorClockMap::iterator wit=meta->wait_table.find(curr_thd_id);
 	DEBUG_ASSERT(wit!=meta->wait_table.end());
 
@@ -1001,7 +1161,7 @@ void Detector::ProcessPostWait(thread_t curr_thd_id,CondMeta *meta)
 
 void Detector::ProcessPreBarrier(thread_t curr_thd_id,BarrierMeta *meta)
 {
-	VectorClock *curr_vc=curr_vc_map_[curr_thd_id];
+	VectorClock *curr_vc=GetThreadVC(curr_thd_id);
 	DEBUG_ASSERT(curr_vc);
 	meta->wait_vc.Join(curr_vc);
 	meta->waiter++;
@@ -1009,7 +1169,7 @@ void Detector::ProcessPreBarrier(thread_t curr_thd_id,BarrierMeta *meta)
 
 void Detector::ProcessPostBarrier(thread_t curr_thd_id,BarrierMeta *meta)
 {
-	VectorClock *curr_vc=curr_vc_map_[curr_thd_id];
+	VectorClock *curr_vc=GetThreadVC(curr_thd_id);
 	DEBUG_ASSERT(curr_vc);
 	curr_vc->Join(&meta->wait_vc);
 	curr_vc->Increment(curr_thd_id);
@@ -1019,7 +1179,7 @@ void Detector::ProcessPostBarrier(thread_t curr_thd_id,BarrierMeta *meta)
 
 void Detector::ProcessBeforeSemPost(thread_t curr_thd_id,SemMeta *meta)
 {
-	VectorClock *curr_vc=curr_vc_map_[curr_thd_id];
+	VectorClock *curr_vc=GetThreadVC(curr_thd_id);
 	//update the semaphore vector clock
 	meta->vc.Join(curr_vc);
 	curr_vc->Increment(curr_thd_id);
@@ -1027,7 +1187,7 @@ void Detector::ProcessBeforeSemPost(thread_t curr_thd_id,SemMeta *meta)
 
 void Detector::ProcessAfterSemWait(thread_t curr_thd_id,SemMeta *meta)
 {
-	VectorClock *curr_vc=curr_vc_map_[curr_thd_id];
+	VectorClock *curr_vc=GetThreadVC(curr_thd_id);
 	DEBUG_ASSERT(curr_vc);
 	curr_vc->Join(&meta->vc);
 	curr_vc->Increment(curr_thd_id);
@@ -1057,7 +1217,7 @@ AdhocSync::WriteMeta *Detector::ProcessAdhocRead(thread_t curr_thd_id,Inst *rd_i
 				end_addr);
 			if(wr_meta) {
 				adhoc_sync_->BuildWriteReadSync(wr_meta,
-					curr_vc_map_[wr_meta->GetLastestThread()],curr_vc_map_[curr_thd_id]);
+					GetThreadVC(wr_meta->GetLastestThread()),GetThreadVC(curr_thd_id));
 				//some races may have been detected in the write access
 				adhoc_sync_->SameAddrReadMetas(curr_thd_id,start_addr,end_addr,result);
 			}
@@ -1076,7 +1236,7 @@ void Detector::ProcessSRLSync(thread_t curr_thd_id,Inst *curr_inst)
 		GetSpinRelevantWriteThread(curr_thd_id);
 	if(spin_rlt_wrthd!=0)
 		loop_db_->ProcessWriteReadSync(curr_thd_id,curr_inst,
-			curr_vc_map_[spin_rlt_wrthd],curr_vc_map_[curr_thd_id]);
+			GetThreadVC(spin_rlt_wrthd),GetThreadVC(curr_thd_id));
 }
 
 void Detector::ProcessSRLRead(thread_t curr_thd_id,Inst *curr_inst,address_t addr)
@@ -1148,7 +1308,7 @@ void Detector::ProcessLockSignalWrite(thread_t curr_thd_id,address_t addr)
 		return ;
 	//add the lock write meta
 	cond_wait_db_->AddLockSignalWriteMeta(curr_thd_id,
-		*curr_vc_map_[curr_thd_id],addr,lk_addr);
+		*GetThreadVC(curr_thd_id),addr,lk_addr);
 }
  
 bool Detector::ProcessCWLRead(thread_t curr_thd_id,Inst *curr_inst,address_t addr)
@@ -1164,12 +1324,12 @@ bool Detector::ProcessCWLRead(thread_t curr_thd_id,Inst *curr_inst,
 	address_t addr,std::string &file_name,int line)
 {
 	return cond_wait_db_->ProcessCondWaitRead(curr_thd_id,curr_inst,
-		*curr_vc_map_[curr_thd_id],addr,file_name,line);
+		*GetThreadVC(curr_thd_id),addr,file_name,line);
 }
 
 void Detector::ProcessCWLSync(thread_t curr_thd_id,Inst *curr_inst)
 {
 	cond_wait_db_->ProcessSignalCondWaitSync(curr_thd_id,curr_inst,
-		*curr_vc_map_[curr_thd_id]);
+		*GetThreadVC(curr_thd_id));
 }
 } //namespace race
\ No newline at end of file
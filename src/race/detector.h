@@ -8,12 +8,14 @@
 #include "core/analyzer.h"
 #include "core/vector_clock.h"
 #include "core/filter.h"
+#include "core/shadow_memory.h"
 #include "race/race.h"
 #include "core/lock_set.h"
 #include "race/adhoc_sync.h"
 #include "race/loop.h"
 #include "race/cond_wait.h"
 #include "core/event.h"
+#include "core/partition.h"
 #include "core/log.h"
 
 #define EVENT_HANDLE_ARG_0
@@ -27,16 +29,26 @@
 #define EVENT_HANDLE_ARG(i) EVENT_HANDLE_ARG_##i 
 
 #define EVENT_HANDLE(Name,NUM_ARGS)                                     \
-  static void Name##EventHandle (Detector *dtc,EventBase *eb)  {        \
-    EVENT_CLASS(Name) *event = (EVENT_CLASS(Name) *) eb;                \
+  static void Name##EventHandle (Detector *dtc,EventRecord *rec)  {     \
+    EVENT_CLASS(Name) *event = (EVENT_CLASS(Name) *) rec->event;        \
     dtc->Name(EVENT_HANDLE_ARG(NUM_ARGS));                              \
     DELETE_EVENT(event);                                                \
   }
 
-//class static function pointer
+//memory events are plain records
+#define MEMORY_EVENT_HANDLE(Name)                                       \
+  static void Name##EventHandle (Detector *dtc,EventRecord *rec)  {     \
+    dtc->Name(rec->mem.thd_id,rec->mem.thd_clk,rec->mem.inst,           \
+      rec->mem.addr,rec->mem.size);                                     \
+  }
+
+//class static function pointer, indexed by the event id
 #define REGISTER_EVENT_HANDLE(Name)                                     \
-  if(event_handle_table.find(#Name)==event_handle_table.end())          \
-    event_handle_table[#Name]=&Detector::Name##EventHandle
+  event_handle_table[EVENT_CLASS(Name)::ID]=&Detector::Name##EventHandle
+
+//memory accesses of stripe-safe detectors lock a stripe of 64-byte lines
+#define DETECTOR_STRIPE_NUM 256
+#define DETECTOR_STRIPE_SHIFT 6
 
 namespace race {
 
@@ -64,10 +76,12 @@ public:
   //read-write
   virtual void BeforeMemRead(thread_t curr_thd_id, timestamp_t curr_thd_clk,
     Inst *inst, address_t addr, size_t size);
-  EVENT_HANDLE(BeforeMemRead,5);
+  MEMORY_EVENT_HANDLE(BeforeMemRead);
   virtual void BeforeMemWrite(thread_t curr_thd_id, timestamp_t curr_thd_clk,
     Inst *inst, address_t addr, size_t size);
-  EVENT_HANDLE(BeforeMemWrite,5);
+  MEMORY_EVENT_HANDLE(BeforeMemWrite);
+  //a run of memory events handled under one lock
+  virtual void BeforeMemBatch(EventRecord *recs,size_t num);
   
   //atomic inst
   virtual void BeforeAtomicInst(thread_t curr_thd_id,
@@ -202,29 +216,63 @@ public:
   virtual void AfterSemWait(thread_t curr_thd_id,timestamp_t curr_thd_clk,
       Inst *inst,address_t addr);
   EVENT_HANDLE(AfterSemWait,4);
+  //hand the shadow metas of the moved address shards over
+  virtual void PartitionMigrate(PartitionPlan *plan);
+  EVENT_HANDLE(PartitionMigrate,1);
 
   address_t GetUnitSize() {
     return unit_size_;
   }
   void SaveStatistics(const char *file_name);
   //unified event handle function pointer
-  typedef void (*EventHandle)(Detector *,EventBase *);
-  static EventHandle GetEventHandle(std::string name) {
-    if(event_handle_table.find(name)==event_handle_table.end())
-        return NULL;
-    return event_handle_table[name];
+  typedef void (*EventHandle)(Detector *,EventRecord *);
+  static EventHandle GetEventHandle(uint32 id) {
+    return id<EVENT_NUM?event_handle_table[id]:NULL;
+  }
+  //events without a handle are only released
+  static void HandleEvent(Detector *dtc,EventRecord *rec) {
+    EventHandle eh=GetEventHandle(rec->id);
+    if(eh)
+      (*eh)(dtc,rec);
+    else if(!rec->IsMemory())
+      DELETE_EVENT(rec->event);
   }
 
-  static std::map<std::string,EventHandle> event_handle_table;
+  //runs of memory events go through a single call
+  static void HandleEvents(Detector *dtc,EventRecord *recs,size_t num) {
+    for(size_t i=0;i<num;) {
+      size_t run=0;
+      while(i+run<num && IsBatchedMemory(recs[i+run].id))
+        run++;
+      if(run>0) {
+        dtc->BeforeMemBatch(recs+i,run);
+        i+=run;
+      }
+      else
+        HandleEvent(dtc,&recs[i++]);
+    }
+  }
+  static bool IsBatchedMemory(uint32 id) {
+    return (id==BEFORE_MEM_READ || id==BEFORE_MEM_WRITE) &&
+      GetEventHandle(id);
+  }
+
+  static EventHandle event_handle_table[EVENT_NUM];
   static void SetParallelDetectorNumber(int num) { prl_dtc_num=num; }
   static bool ParallelDetection() { return prl_dtc_num>0; }
+  void SetPartitionIndex(uint32 idx) { prl_dtc_idx_=idx; }
+  //whether the access checks only read the thread clocks and lock sets,
+  //so that the detector can be attached to a shared HbEngine
+  virtual bool SharedSync() { return false; }
+  //read and update the thread contexts of the owner from now on
+  void ShareThreadContexts(Detector *owner) { thd_ctxs_=owner->thd_ctxs_; }
 protected:
   typedef std::map<int,Loop> LoopTable;
   typedef std::tr1::unordered_map<std::string,LoopTable *> LoopMap;
 	//the abstract meta data for the memory
 	class Meta {
 	public:
-		typedef std::tr1::unordered_map<address_t,Meta *> Table;
+		typedef ShadowMemory<Meta> Table;
 		explicit Meta(address_t a):addr(a) {}
 		virtual ~Meta() {}
 
@@ -277,8 +325,54 @@ protected:
     VectorClock vc;
   };
 
+  //per-thread detector state, indexed by the thread's vector clock slot
+  class ThreadContext {
+  public:
+    typedef std::vector<ThreadContext *> Table;
+    ThreadContext():vc(NULL),atomic(false),writer_lockset(NULL),
+      reader_lockset(NULL) {}
+    ~ThreadContext() {
+      delete vc;
+      delete writer_lockset;
+      delete reader_lockset;
+    }
+
+    VectorClock *vc;
+    bool atomic; //whether executing atomic inst.
+    //locks held in write mode and in read mode, for lockset detectors
+    LockSet *writer_lockset;
+    LockSet *reader_lockset;
+  private:
+    DISALLOW_COPY_CONSTRUCTORS(ThreadContext);
+  };
+
+  //contexts are created by the thread itself or under the internal lock,
+  //so the lookup needs no lock
+  ThreadContext *GetThreadContext(thread_t thd_id) {
+    ThreadContext *&ctx=(*thd_ctxs_)[VectorClock::ThreadSlot(thd_id)];
+    if(!ctx)
+      ctx=new ThreadContext;
+    return ctx;
+  }
+  VectorClock *GetThreadVC(thread_t thd_id) {
+    return GetThreadContext(thd_id)->vc;
+  }
+  LockSet *&WriterLockSet(thread_t thd_id) {
+    return GetThreadContext(thd_id)->writer_lockset;
+  }
+  LockSet *&ReaderLockSet(thread_t thd_id) {
+    return GetThreadContext(thd_id)->reader_lockset;
+  }
+
 	void AllocAddrRegion(address_t addr,size_t size);
 	void FreeAddrRegion(address_t addr);
+	//hand the released shadow metas back to the detector
+	class MetaFreer {
+	public:
+		explicit MetaFreer(Detector *d):detector(d) {}
+		void operator()(Meta *meta) { detector->ProcessFree(meta); }
+		Detector *detector;
+	};
 	bool FilterAccess(address_t addr) {return filter_->Filter(addr,false);}
 
 	void ReportRace(Meta *meta,thread_t t0,Inst *i0,RaceEventType p0,
@@ -309,6 +403,21 @@ protected:
 
 	virtual void ProcessRead(thread_t curr_thd_id,Meta *meta,Inst *inst)=0;
 	virtual void ProcessWrite(thread_t curr_thd_id,Meta *meta,Inst *inst)=0;
+  //whether ProcessRead/ProcessWrite only touch the given meta and the
+  //current thread's clock, so that accesses can run under address stripes
+  virtual bool StripedAccess() { return false; }
+  void ProcessStripedAccess(thread_t curr_thd_id,Inst *inst,address_t addr,
+    size_t size,bool is_write);
+  size_t StripeIndex(address_t addr) {
+    return (addr>>DETECTOR_STRIPE_SHIFT) & (DETECTOR_STRIPE_NUM-1);
+  }
+  void LockStripes(address_t start_addr,address_t end_addr);
+  void UnlockStripes(address_t start_addr,address_t end_addr);
+  //the memory accesses under the internal lock
+  void ProcessMemRead(thread_t curr_thd_id,Inst *inst,address_t addr,
+    size_t size);
+  void ProcessMemWrite(thread_t curr_thd_id,Inst *inst,address_t addr,
+    size_t size);
 
 	virtual void ProcessFree(Meta *meta)=0;
   virtual void ProcessFree(MutexMeta *meta);
@@ -334,6 +443,10 @@ protected:
   void ProcessCWLSync(thread_t curr_thd_id,Inst *curr_inst);
 
 	Mutex *internal_lock_;
+	//shared view of internal_lock_, taken by striped memory accesses
+	SharedMutex *access_lock_;
+	Mutex *stripe_locks_[DETECTOR_STRIPE_NUM];
+	bool striped_;
 	RaceDB *race_db_;
 	address_t unit_size_;
 	RegionFilter *filter_;
@@ -344,8 +457,9 @@ protected:
   BarrierMeta::Table barrier_meta_table_;
   SemMeta::Table sem_meta_table_;
 
-	std::map<thread_t,VectorClock *> curr_vc_map_;
-	std::map<thread_t,bool> atomic_map_; //whether executing atomic inst.
+	ThreadContext::Table thd_ctx_table_;
+  //the own table, or the one of the engine sharing the sync
+  ThreadContext::Table *thd_ctxs_;
   uint64 vc_mem_size_;
   //dynamic ad-hoc
   AdhocSync *adhoc_sync_;
@@ -355,6 +469,8 @@ protected:
   CondWaitDB *cond_wait_db_;
   //parallel detector number
   static int prl_dtc_num;
+  //the owner index of this detector in the address partition
+  uint32 prl_dtc_idx_;
 };
 
 
@@ -0,0 +1,563 @@
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <pthread.h>
+#include <unistd.h>
+#include "core/access_cache.h"
+#include "core/cmdline_knob.h"
+#include "core/detection_queue.h"
+#include "core/unit_test.h"
+#include "race/djit.h"
+#include "race/eraser.h"
+#include "race/fast_track.h"
+#include "race/hb_engine.h"
+#include "race/race.pb.h"
+
+using namespace race;
+
+#define TEST_RACE_DB_PATH "/tmp/race_detector_test.db"
+#define HEAP_START 0x10000000
+#define HEAP_SIZE 0x10000
+#define LOCK_ADDR 0x20000000
+#define PRL_DTC_NUM 2
+#define PRL_BATCH_SIZE 64
+
+//feeds the events of the threads to an analyzer as the execution control
+//does. with the cache on, a repeated access is dropped in the same epoch
+//when the analyzer takes it.
+class Driver {
+public:
+	Driver(Analyzer *analyzer,bool cache):analyzer_(analyzer),cache_(cache),
+		gen_(0) {}
+	~Driver() {
+		for(CacheMap::iterator it=caches_.begin();it!=caches_.end();it++)
+			delete it->second;
+	}
+
+	void Start(thread_t thd_id,thread_t parent_thd_id) {
+		gen_++;
+		caches_[thd_id]=new AccessCache;
+		epochs_[thd_id]=0;
+		analyzer_->ThreadStart(thd_id,parent_thd_id);
+	}
+	void Malloc(thread_t thd_id,address_t addr,size_t size) {
+		epochs_[thd_id]++;
+		analyzer_->AfterMalloc(thd_id,0,NULL,size,addr);
+	}
+	void Lock(thread_t thd_id,address_t addr) {
+		epochs_[thd_id]++;
+		analyzer_->AfterPthreadMutexLock(thd_id,0,NULL,addr);
+	}
+	void Unlock(thread_t thd_id,address_t addr) {
+		epochs_[thd_id]++;
+		analyzer_->BeforePthreadMutexUnlock(thd_id,0,NULL,addr);
+	}
+	void Read(thread_t thd_id,Inst *inst,address_t addr) {
+		if(!Repeated(thd_id,inst,addr,false))
+			analyzer_->BeforeMemRead(thd_id,0,inst,addr,4);
+	}
+	void Write(thread_t thd_id,Inst *inst,address_t addr) {
+		if(!Repeated(thd_id,inst,addr,true))
+			analyzer_->BeforeMemWrite(thd_id,0,inst,addr,4);
+	}
+
+private:
+	typedef std::map<thread_t,AccessCache *> CacheMap;
+
+	bool Repeated(thread_t thd_id,Inst *inst,address_t addr,bool is_write) {
+		return cache_ && analyzer_->CachedAccess() &&
+			caches_[thd_id]->Hit(inst,addr,4,is_write,epochs_[thd_id],gen_);
+	}
+
+	Analyzer *analyzer_;
+	bool cache_;
+	uint32 gen_;
+	CacheMap caches_;
+	std::map<thread_t,uint64> epochs_;
+};
+
+static void Initialize()
+{
+	Knob::Initialize(new CmdlineKnob);
+	Eraser eraser;
+	eraser.Register();
+	Djit djit;
+	djit.Register();
+	FastTrack fast_track;
+	fast_track.Register();
+	HbEngine hb_engine;
+	hb_engine.Register();
+}
+
+static std::vector<Inst *> CreateInsts(StaticInfo *sinfo,int num)
+{
+	Image *image=sinfo->CreateImage("detector_test");
+	std::vector<Inst *> insts;
+	for(int i=0;i<num;i++)
+		insts.push_back(sinfo->CreateInst(image,0x100+i*4));
+	return insts;
+}
+
+//the dynamic races as saved by the race db, an event is written as
+//thread:inst:type in the order of the race
+static std::multiset<std::string> Races(RaceDB *race_db,StaticInfo *sinfo)
+{
+	race_db->Save(TEST_RACE_DB_PATH,sinfo);
+	RaceDBProto proto;
+	std::fstream in(TEST_RACE_DB_PATH,std::ios::in | std::ios::binary);
+	proto.ParseFromIstream(&in);
+	in.close();
+	remove(TEST_RACE_DB_PATH);
+	std::map<uint32,const StaticRaceEventProto *> events;
+	for(int i=0;i<proto.static_event_size();i++)
+		events[proto.static_event(i).id()]=&proto.static_event(i);
+	std::multiset<std::string> races;
+	for(int i=0;i<proto.race_size();i++) {
+		const RaceProto &race=proto.race(i);
+		std::stringstream ss;
+		ss<<std::hex<<race.addr();
+		for(int j=0;j<race.event_size();j++) {
+			const StaticRaceEventProto *e=events[race.event(j).static_id()];
+			ss<<" "<<race.event(j).thd_id()<<":"<<e->inst_id()<<":"<<
+				e->type();
+		}
+		races.insert(ss.str());
+	}
+	return races;
+}
+
+//T1 writes x with no lock, T2 accesses x under a lock, then T1 writes x
+//again with the same inst in the same epoch. a write of T2 finds the empty
+//lockset at once, after a read of T2 only the second write of T1 does.
+static std::multiset<std::string> EraserRun(bool t2_writes,bool cache)
+{
+	StaticInfo sinfo(new NullMutex);
+	std::vector<Inst *> insts=CreateInsts(&sinfo,2);
+	RaceDB race_db(new NullMutex);
+	Eraser eraser;
+	eraser.Setup(new NullMutex,&race_db);
+	Driver driver(&eraser,cache);
+	address_t x=HEAP_START+0x40;
+	driver.Start(1,INVALID_THD_ID);
+	driver.Malloc(1,HEAP_START,HEAP_SIZE);
+	driver.Start(2,1);
+	driver.Write(1,insts[0],x);
+	driver.Lock(2,LOCK_ADDR);
+	if(t2_writes)
+		driver.Write(2,insts[1],x);
+	else
+		driver.Read(2,insts[1],x);
+	driver.Unlock(2,LOCK_ADDR);
+	driver.Write(1,insts[0],x);
+	return Races(&race_db,&sinfo);
+}
+
+void TestEraserRepeatedWrite()
+{
+	for(int t2_writes=0;t2_writes<2;t2_writes++) {
+		std::multiset<std::string> races=EraserRun(t2_writes,false);
+		EXPECT_EQ(races.size(),1);
+		//the lockset detector does not take the cache, so nothing is lost
+		EXPECT_TRUE(EraserRun(t2_writes,true)==races);
+	}
+	//the read of T2 races with the second write of T1
+	std::stringstream ss;
+	ss<<std::hex<<HEAP_START+0x40<<" 2:2:"<<RACE_EVENT_READ<<" 1:1:"<<
+		RACE_EVENT_WRITE;
+	EXPECT_TRUE(EraserRun(false,false).count(ss.str())==1);
+}
+
+//the hb detectors with a same epoch check take the cache, the others and an
+//engine with any of them attached do not
+void TestCachedAccess()
+{
+	RaceDB race_db(new NullMutex);
+	Eraser eraser;
+	eraser.Setup(new NullMutex,&race_db);
+	Djit djit;
+	djit.Setup(new NullMutex,&race_db);
+	FastTrack fast_track;
+	fast_track.Setup(new NullMutex,&race_db);
+	EXPECT_TRUE(!eraser.CachedAccess());
+	EXPECT_TRUE(djit.CachedAccess());
+	EXPECT_TRUE(!fast_track.CachedAccess());
+
+	HbEngine djit_engine;
+	djit_engine.Setup(new NullMutex,&race_db);
+	EXPECT_TRUE(djit_engine.Attach(&djit));
+	EXPECT_TRUE(djit_engine.CachedAccess());
+	HbEngine mixed_engine;
+	mixed_engine.Setup(new NullMutex,&race_db);
+	EXPECT_TRUE(mixed_engine.Attach(&djit));
+	EXPECT_TRUE(mixed_engine.Attach(&eraser));
+	EXPECT_TRUE(!mixed_engine.CachedAccess());
+}
+
+//the threads access a few units by turns and lock now and then. every
+//access is issued twice, so the second one hits the cache.
+static std::multiset<std::string> DjitRun(bool cache)
+{
+	StaticInfo sinfo(new NullMutex);
+	std::vector<Inst *> insts=CreateInsts(&sinfo,4);
+	RaceDB race_db(new NullMutex);
+	Djit djit;
+	djit.Setup(new NullMutex,&race_db);
+	Driver driver(&djit,cache);
+	driver.Start(1,INVALID_THD_ID);
+	driver.Malloc(1,HEAP_START,HEAP_SIZE);
+	driver.Start(2,1);
+	driver.Start(3,1);
+	for(int i=0;i<200;i++) {
+		thread_t t=1+i%3;
+		Inst *inst=insts[i%4];
+		address_t addr=HEAP_START+(i%5)*4;
+		bool locked=i%7==0;
+		if(locked)
+			driver.Lock(t,LOCK_ADDR);
+		for(int k=0;k<2;k++) {
+			if(i%2)
+				driver.Write(t,inst,addr);
+			else
+				driver.Read(t,inst,addr);
+		}
+		if(locked)
+			driver.Unlock(t,LOCK_ADDR);
+	}
+	return Races(&race_db,&sinfo);
+}
+
+void TestDjitCache()
+{
+	std::multiset<std::string> races=DjitRun(false);
+	EXPECT_TRUE(races.size()>0);
+	EXPECT_TRUE(DjitRun(true)==races);
+}
+
+enum OpType {
+	OP_START,
+	OP_MALLOC,
+	OP_LOCK,
+	OP_UNLOCK,
+	OP_READ,
+	OP_WRITE,
+	OP_MIGRATE, //a rebalance, only taken by the parallel run
+};
+
+//an event of the script, arg is the parent thread or the inst index
+struct Op {
+	OpType type;
+	thread_t thd_id;
+	uint64 arg;
+	address_t addr;
+};
+
+typedef std::vector<Op> Script;
+
+static void AddOp(Script *script,OpType type,thread_t thd_id,uint64 arg,
+	address_t addr)
+{
+	Op op={type,thd_id,arg,addr};
+	script->push_back(op);
+}
+
+//a line of the heap, the lines of the script all hash to distinct shards
+static address_t Line(uint32 k)
+{
+	return HEAP_START+(address_t)k*2*(1<<PARTITION_LINE_BITS);
+}
+
+//one turn of a thread on every unit of the hot lines, reps times
+static void AddTurn(Script *script,thread_t thd_id,bool locked,bool is_write,
+	uint32 inst,uint32 lines,uint32 reps)
+{
+	if(locked)
+		AddOp(script,OP_LOCK,thd_id,0,LOCK_ADDR);
+	for(uint32 r=0;r<reps;r++)
+		for(uint32 k=0;k<lines;k++)
+			for(address_t u=0;u<(1<<PARTITION_LINE_BITS);u+=4)
+				AddOp(script,is_write?OP_WRITE:OP_READ,thd_id,inst,Line(k)+u);
+	if(locked)
+		AddOp(script,OP_UNLOCK,thd_id,0,LOCK_ADDR);
+}
+
+//the threads take turns on a few lines owned by the first detector, mostly
+//under a lock, until the load calls for a rebalance. then a third thread
+//races with the accesses made before the move.
+static Script MigrateScript()
+{
+	Script script;
+	AddOp(&script,OP_START,1,INVALID_THD_ID,0);
+	AddOp(&script,OP_MALLOC,1,0,HEAP_START);
+	AddOp(&script,OP_START,2,1,0);
+	AddOp(&script,OP_START,3,1,0);
+	uint32 turns=PARTITION_MIN_LOAD/(16*16*4)+4;
+	for(uint32 i=0;i<turns;i++) {
+		thread_t t=1+i%2;
+		AddTurn(&script,t,i%10!=9,t==1,i%4,16,4);
+	}
+	AddOp(&script,OP_MIGRATE,0,0,0);
+	AddTurn(&script,3,false,true,0,16,1);
+	AddTurn(&script,1,true,false,1,16,1);
+	AddTurn(&script,2,true,true,2,16,1);
+	return script;
+}
+
+static std::multiset<std::string> SerialRun(const Script &script)
+{
+	StaticInfo sinfo(new NullMutex);
+	std::vector<Inst *> insts=CreateInsts(&sinfo,4);
+	RaceDB race_db(new NullMutex);
+	FastTrack fast_track;
+	fast_track.Setup(new NullMutex,&race_db);
+	Driver driver(&fast_track,false);
+	for(size_t i=0;i<script.size();i++) {
+		const Op &op=script[i];
+		switch(op.type) {
+		case OP_START: driver.Start(op.thd_id,op.arg); break;
+		case OP_MALLOC: driver.Malloc(op.thd_id,op.addr,HEAP_SIZE); break;
+		case OP_LOCK: driver.Lock(op.thd_id,op.addr); break;
+		case OP_UNLOCK: driver.Unlock(op.thd_id,op.addr); break;
+		case OP_READ: driver.Read(op.thd_id,insts[op.arg],op.addr); break;
+		case OP_WRITE: driver.Write(op.thd_id,insts[op.arg],op.addr); break;
+		default: break;
+		}
+	}
+	return Races(&race_db,&sinfo);
+}
+
+struct Detection {
+	DetectionQueue *queue;
+	Detector *detector;
+};
+
+//the loop of a detection thread in the profiler
+static void *DetectionThread(void *arg)
+{
+	Detection *detection=(Detection *)arg;
+	DetectionQueue *queue=detection->queue;
+	EventRecord recs[PRL_BATCH_SIZE];
+	while(true) {
+		size_t num=queue->PopBatch(recs,PRL_BATCH_SIZE);
+		if(num>0)
+			Detector::HandleEvents(detection->detector,recs,num);
+		else if(queue->Closed() && queue->Empty())
+			break;
+		else
+			queue->Wait();
+	}
+	queue->Detach();
+	return NULL;
+}
+
+//routes the events of the threads to the detection threads as the
+//execution control does. the events of two threads between the same sync
+//events may reach a unit in any order, so each turn is drained before the
+//next one starts.
+class Producer {
+public:
+	Producer():moved_(0),last_thd_id_(INVALID_THD_ID) {
+		log_=new EventLog(new SysMutex,PRL_DTC_NUM,0,new SysSemaphore(0));
+		partitioner_=new Partitioner(PRL_DTC_NUM,new SysMutex);
+		for(uint32 i=0;i<PRL_DTC_NUM;i++) {
+			DetectionQueue *queue=new DetectionQueue(log_,partitioner_,i,100,
+				4,new SysSemaphore(0));
+			for(uint32 tid=1;tid<4;tid++)
+				queue->AttachRing(tid,new SysSemaphore(0));
+			queues_.push_back(queue);
+		}
+	}
+	~Producer() {
+		for(BufferMap::iterator it=buffs_.begin();it!=buffs_.end();it++)
+			for(uint32 i=0;i<PRL_DTC_NUM;i++)
+				delete it->second[i];
+		for(uint32 i=0;i<PRL_DTC_NUM;i++)
+			delete queues_[i];
+		delete log_;
+		delete partitioner_;
+	}
+
+	DetectionQueue *Queue(uint32 idx) { return queues_[idx]; }
+	Partitioner *GetPartitioner() { return partitioner_; }
+	size_t Moved() { return moved_; }
+
+	void Start(thread_t thd_id,thread_t parent_thd_id) {
+		for(uint32 i=0;i<PRL_DTC_NUM;i++)
+			buffs_[thd_id].push_back(new EventBuffer);
+		seqs_[thd_id]=0;
+		Log(thd_id,CREATE_EVENT(ThreadStart,thd_id,parent_thd_id));
+	}
+	void Malloc(thread_t thd_id,address_t addr,size_t size) {
+		Log(thd_id,CREATE_EVENT(AfterMalloc,thd_id,0,NULL,size,addr));
+	}
+	void Lock(thread_t thd_id,address_t addr) {
+		Log(thd_id,CREATE_EVENT(AfterPthreadMutexLock,thd_id,0,NULL,addr));
+	}
+	void Unlock(thread_t thd_id,address_t addr) {
+		Log(thd_id,CREATE_EVENT(BeforePthreadMutexUnlock,thd_id,0,NULL,addr));
+	}
+	void Access(thread_t thd_id,Inst *inst,address_t addr,bool is_write) {
+		Turn(thd_id);
+		EventRecord rec;
+		rec.id=is_write?BEFORE_MEM_WRITE:BEFORE_MEM_READ;
+		rec.seq=seqs_[thd_id];
+		rec.mem.thd_id=thd_id;
+		rec.mem.thd_clk=0;
+		rec.mem.inst=inst;
+		rec.mem.addr=addr;
+		rec.mem.size=4;
+		uint32 index=partitioner_->Owner(addr);
+		EventBuffer *buff=buffs_[thd_id][index];
+		if(buff->Full())
+			queues_[index]->Flush(thd_id,buff);
+		buff->Push(rec);
+	}
+	//plan a rebalance on the load so far and cut the log there, false if
+	//the load is balanced
+	bool Migrate() {
+		Drain();
+		PartitionPlan *plan=partitioner_->Plan(new SysMutex,
+			new SysSemaphore(0));
+		if(!plan)
+			return false;
+		moved_=plan->MoveNum();
+		EVENT_CLASS(PartitionMigrate) *event=CREATE_EVENT(PartitionMigrate,plan);
+		event->set_ref(PRL_DTC_NUM);
+		uint64 seq=log_->Append(event,EVENT_LOG_NO_RING);
+		for(SeqMap::iterator it=seqs_.begin();it!=seqs_.end();it++)
+			it->second=seq;
+		partitioner_->Apply(plan);
+		Notify();
+		return true;
+	}
+	void Close() {
+		Drain();
+		for(uint32 i=0;i<PRL_DTC_NUM;i++)
+			queues_[i]->Close();
+	}
+
+private:
+	typedef std::map<thread_t,std::vector<EventBuffer *> > BufferMap;
+	typedef std::map<thread_t,uint64> SeqMap;
+
+	void Log(thread_t thd_id,EventBase *event) {
+		Turn(thd_id);
+		Flush(thd_id);
+		event->set_ref(PRL_DTC_NUM);
+		seqs_[thd_id]=log_->Append(event,thd_id);
+		Notify();
+	}
+	void Turn(thread_t thd_id) {
+		if(thd_id==last_thd_id_)
+			return ;
+		Drain();
+		last_thd_id_=thd_id;
+	}
+	void Flush(thread_t thd_id) {
+		std::vector<EventBuffer *> &buffs=buffs_[thd_id];
+		for(uint32 i=0;i<buffs.size();i++)
+			if(!buffs[i]->Empty())
+				queues_[i]->Flush(thd_id,buffs[i]);
+	}
+	void Notify() {
+		for(uint32 i=0;i<PRL_DTC_NUM;i++)
+			queues_[i]->Notify();
+	}
+	//wait until the detection threads have taken every event so far
+	void Drain() {
+		if(last_thd_id_!=INVALID_THD_ID)
+			Flush(last_thd_id_);
+		for(uint32 i=0;i<PRL_DTC_NUM;i++)
+			while(!queues_[i]->Empty())
+				usleep(100);
+	}
+
+	EventLog *log_;
+	Partitioner *partitioner_;
+	std::vector<DetectionQueue *> queues_;
+	BufferMap buffs_;
+	SeqMap seqs_;
+	size_t moved_;
+	thread_t last_thd_id_;
+};
+
+//each detection thread reports to its own race db, merged in the order of
+//the detectors as the profiler does
+static std::multiset<std::string> ParallelRun(const Script &script,
+	size_t *moved)
+{
+	StaticInfo sinfo(new NullMutex);
+	std::vector<Inst *> insts=CreateInsts(&sinfo,4);
+	Detector::SetParallelDetectorNumber(PRL_DTC_NUM);
+	Producer *producer=new Producer;
+	std::vector<RaceDB *> race_dbs;
+	Detection detections[PRL_DTC_NUM];
+	pthread_t threads[PRL_DTC_NUM];
+	for(uint32 i=0;i<PRL_DTC_NUM;i++) {
+		race_dbs.push_back(new RaceDB(new NullMutex));
+		detections[i].queue=producer->Queue(i);
+		detections[i].detector=new FastTrack;
+		detections[i].detector->Setup(new NullMutex,race_dbs[i]);
+		detections[i].detector->SetPartitionIndex(i);
+		pthread_create(&threads[i],NULL,DetectionThread,&detections[i]);
+	}
+	for(size_t i=0;i<script.size();i++) {
+		const Op &op=script[i];
+		switch(op.type) {
+		case OP_START: producer->Start(op.thd_id,op.arg); break;
+		case OP_MALLOC: producer->Malloc(op.thd_id,op.addr,HEAP_SIZE); break;
+		case OP_LOCK: producer->Lock(op.thd_id,op.addr); break;
+		case OP_UNLOCK: producer->Unlock(op.thd_id,op.addr); break;
+		case OP_READ:
+			producer->Access(op.thd_id,insts[op.arg],op.addr,false);
+			break;
+		case OP_WRITE:
+			producer->Access(op.thd_id,insts[op.arg],op.addr,true);
+			break;
+		case OP_MIGRATE: EXPECT_TRUE(producer->Migrate()); break;
+		}
+	}
+	producer->Close();
+	for(uint32 i=0;i<PRL_DTC_NUM;i++) {
+		pthread_join(threads[i],NULL);
+		delete detections[i].detector;
+	}
+	*moved=producer->Moved();
+	//the hot lines started on the first detector, some of them have moved
+	uint32 moved_lines=0;
+	for(uint32 k=0;k<16;k++)
+		moved_lines+=producer->GetPartitioner()->Owner(Line(k))!=0;
+	EXPECT_EQ(moved_lines,*moved);
+	delete producer;
+	Detector::SetParallelDetectorNumber(0);
+	RaceDB race_db(new NullMutex);
+	for(uint32 i=0;i<PRL_DTC_NUM;i++) {
+		race_db.Merge(race_dbs[i],false);
+		delete race_dbs[i];
+	}
+	return Races(&race_db,&sinfo);
+}
+
+//the detection threads hand the metas of the moved lines over at the
+//rebalance, so the races after it pair with the accesses before it as in
+//a serial run
+void TestParallelMigrate()
+{
+	Script script=MigrateScript();
+	std::multiset<std::string> races=SerialRun(script);
+	EXPECT_TRUE(races.size()>0);
+	size_t moved=0;
+	EXPECT_TRUE(ParallelRun(script,&moved)==races);
+	EXPECT_TRUE(moved>0);
+}
+
+int main(int argc,char *argv[])
+{
+	Initialize();
+	RUN_TEST(TestEraserRepeatedWrite);
+	RUN_TEST(TestCachedAccess);
+	RUN_TEST(TestDjitCache);
+	RUN_TEST(TestParallelMigrate);
+	return UNIT_TEST_RESULT();
+}
@@ -29,13 +29,12 @@ void Djit::Setup(Mutex *lock,RaceDB *race_db)
 
 Detector::Meta *Djit::GetMeta(address_t iaddr)
 {
-	Meta::Table::iterator it=meta_table_.find(iaddr);
-	if(it==meta_table_.end()) {
-		Meta *meta=new DjitMeta(iaddr);
-		meta_table_[iaddr]=meta;
-		return meta;
+	Meta *meta=meta_table_.Find(iaddr);
+	if(!meta) {
+		meta=new DjitMeta(iaddr);
+		meta_table_.Insert(iaddr,meta);
 	}
-	return it->second;
+	return meta;
 }
 
 void Djit::ProcessRead(thread_t curr_thd_id,Meta *meta,Inst *inst)
@@ -44,7 +43,7 @@ void Djit::ProcessRead(thread_t curr_thd_id,Meta *meta,Inst *inst)
 	//cast the meta
 	DjitMeta *djit_meta=dynamic_cast<DjitMeta *>(meta);
 	DEBUG_ASSERT(djit_meta);
-	VectorClock *curr_vc=curr_vc_map_[curr_thd_id];
+	VectorClock *curr_vc=GetThreadVC(curr_thd_id);
 
 	// INFO_FMT_PRINT("addr:%lx\n",djit_meta->addr);
 	// INFO_FMT_PRINT("writer_vc:%s\n",djit_meta->reader_vc.ToString().c_str());
@@ -52,7 +51,7 @@ void Djit::ProcessRead(thread_t curr_thd_id,Meta *meta,Inst *inst)
 
 	//same time-frame's read access
 	if(djit_meta->reader_vc.GetClock(curr_thd_id) == 
-		curr_vc_map_[curr_thd_id]->GetClock(curr_thd_id))
+		GetThreadVC(curr_thd_id)->GetClock(curr_thd_id))
 		return ;
 
 	//check writers
@@ -93,7 +92,7 @@ void Djit::ProcessWrite(thread_t curr_thd_id,Meta *meta,Inst *inst)
 	DjitMeta *djit_meta=dynamic_cast<DjitMeta*>(meta);
 	DEBUG_ASSERT(djit_meta);
 	//get the current vector clock
-	VectorClock *curr_vc=curr_vc_map_[curr_thd_id];
+	VectorClock *curr_vc=GetThreadVC(curr_thd_id);
 	// INFO_FMT_PRINT("addr:%lx\n",djit_meta->addr);
 	// INFO_FMT_PRINT("writer_vc:%s\n",djit_meta->writer_vc.ToString().c_str());
 	// INFO_FMT_PRINT("curr_vc:%s\n",curr_vc->ToString().c_str());
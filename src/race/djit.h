@@ -19,6 +19,10 @@ public:
 	void Register();
 	bool Enabled();
 	void Setup(Mutex *lock,RaceDB *race_db);
+	//a repeat in the same epoch finds the current clock of its thread in the
+	//vcs of its metas and returns before any check. the ad-hoc sync analysis
+	//counts the spinning reads, so it needs every one of them.
+	bool CachedAccess() { return !adhoc_sync_; }
 
 protected:
 	//the meta data for the memory access
@@ -43,6 +47,13 @@ protected:
 	virtual void ProcessRead(thread_t curr_thd_id,Meta *meta,Inst *inst);
 	virtual void ProcessWrite(thread_t curr_thd_id,Meta *meta,Inst *inst);
 	virtual void ProcessFree(Meta *meta);
+	virtual bool StripedAccess() { return true; }
+	//under the hb engine a rwlock orders its readers only with the writers,
+	//its clock takes the clocks of all the readers at the last unlock.
+	//alone, a rwlock is handled as a mutex, which also orders a reader
+	//after the readers which unlocked before it, so fewer races between
+	//read sections are reported.
+	virtual bool SharedSync() { return true; }
 	//whether to track the racy inst
 	bool track_racy_inst_;
 private:
@@ -7,12 +7,6 @@ Eraser::Eraser():track_racy_inst_(false)
 
 Eraser::~Eraser() 
 {
-	for(LockSetTable::iterator it=reader_lock_set_table_.begin();
-		it!=reader_lock_set_table_.end();it++) 
-		delete it->second;
-	for(LockSetTable::iterator it=writer_lock_set_table_.begin();
-		it!=writer_lock_set_table_.end();it++) 
-		delete it->second;
 }
 
 void Eraser::Register()
@@ -37,13 +31,12 @@ void Eraser::Setup(Mutex *lock,RaceDB *race_db)
 
 Detector::Meta * Eraser::GetMeta(address_t iaddr)
 {
-	Meta::Table::iterator it=meta_table_.find(iaddr);
-	if(it==meta_table_.end()) {
-		Meta *meta=new EraserMeta(iaddr);
-		meta_table_[iaddr]=meta;
-		return meta;
+	Meta *meta=meta_table_.Find(iaddr);
+	if(!meta) {
+		meta=new EraserMeta(iaddr);
+		meta_table_.Insert(iaddr,meta);
 	}
-	return it->second;
+	return meta;
 }
 
 void Eraser::AfterPthreadMutexLock(thread_t curr_thd_id,timestamp_t curr_thd_clk, 
@@ -74,8 +67,8 @@ void Eraser::BeforePthreadMutexUnlock(thread_t curr_thd_id,timestamp_t curr_thd_
 {
 	LockCountIncrease();
 	ScopedLock lock(internal_lock_);
-	LockSet *curr_writer_lock_set=writer_lock_set_table_[curr_thd_id];
-	LockSet *curr_reader_lock_set=reader_lock_set_table_[curr_thd_id];
+	LockSet *curr_writer_lock_set=WriterLockSet(curr_thd_id);
+	LockSet *curr_reader_lock_set=ReaderLockSet(curr_thd_id);
 	DEBUG_ASSERT(curr_writer_lock_set && curr_reader_lock_set);
 	//
 	curr_writer_lock_set->Remove(addr);
@@ -138,8 +131,8 @@ void Eraser::BeforePthreadRwlockUnlock(thread_t curr_thd_id,timestamp_t curr_thd
 {
 	LockCountIncrease();
 	ScopedLock lock(internal_lock_);
-	LockSet *curr_writer_lock_set=writer_lock_set_table_[curr_thd_id];
-	LockSet *curr_reader_lock_set=reader_lock_set_table_[curr_thd_id];
+	LockSet *curr_writer_lock_set=WriterLockSet(curr_thd_id);
+	LockSet *curr_reader_lock_set=ReaderLockSet(curr_thd_id);
 	DEBUG_ASSERT(curr_writer_lock_set && curr_reader_lock_set);
 	DEBUG_ASSERT(lock_reference_map_[addr]>0);
 
@@ -163,8 +156,8 @@ void Eraser::ProcessRead(thread_t curr_thd_id,Meta *meta,Inst *inst)
 	if(eraser_meta->state==EraserMeta::MEM_STATE_READ_SHARED || 
 		eraser_meta->state==EraserMeta::MEM_STATE_SHARED_MODIFIED) {
 
-		LockSet *curr_writer_lock_set=writer_lock_set_table_[curr_thd_id];
-		LockSet *curr_reader_lock_set=reader_lock_set_table_[curr_thd_id];
+		LockSet *curr_writer_lock_set=WriterLockSet(curr_thd_id);
+		LockSet *curr_reader_lock_set=ReaderLockSet(curr_thd_id);
 		//
 		// INFO_PRINT("READ :read shared or shared modified\n");
 		// INFO_FMT_PRINT("eraser_meta->writer_lock_set:%s\n",
@@ -219,8 +212,8 @@ void Eraser::ProcessWrite(thread_t curr_thd_id,Meta *meta,Inst *inst)
 	UpdateMemoryState(curr_thd_id,RACE_EVENT_WRITE,eraser_meta);
 	if(eraser_meta->state==EraserMeta::MEM_STATE_READ_SHARED || 
 		eraser_meta->state==EraserMeta::MEM_STATE_SHARED_MODIFIED) {
-		LockSet *curr_writer_lock_set=writer_lock_set_table_[curr_thd_id];
-		LockSet *curr_reader_lock_set=reader_lock_set_table_[curr_thd_id];
+		LockSet *curr_writer_lock_set=WriterLockSet(curr_thd_id);
+		LockSet *curr_reader_lock_set=ReaderLockSet(curr_thd_id);
 
 		// INFO_PRINT("WRITE:read shared or shared modified\n");
 		// INFO_FMT_PRINT("eraser_meta->writer_lock_set:%s\n",
@@ -290,10 +283,10 @@ void Eraser::UpdateMemoryState(thread_t curr_thd_id,RaceEventType race_event_typ
 		else
 			eraser_meta->state=EraserMeta::MEM_STATE_VIRGIN;
 		eraser_meta->thread_id=curr_thd_id;
-		if(writer_lock_set_table_[curr_thd_id]!=NULL)
-			eraser_meta->writer_lock_set=*writer_lock_set_table_[curr_thd_id];
-		if(reader_lock_set_table_[curr_thd_id]!=NULL)
-			eraser_meta->reader_lock_set=*reader_lock_set_table_[curr_thd_id];
+		if(WriterLockSet(curr_thd_id)!=NULL)
+			eraser_meta->writer_lock_set=*WriterLockSet(curr_thd_id);
+		if(ReaderLockSet(curr_thd_id)!=NULL)
+			eraser_meta->reader_lock_set=*ReaderLockSet(curr_thd_id);
 	} 
 	else if(eraser_meta->state==EraserMeta::MEM_STATE_VIRGIN) {
 		if(curr_thd_id==eraser_meta->thread_id && 
@@ -322,30 +315,18 @@ void Eraser::UpdateMemoryState(thread_t curr_thd_id,RaceEventType race_event_typ
 
 LockSet *Eraser::GetWriterLockSet(thread_t curr_thd_id)
 {
-	LockSet *curr_lock_set=NULL;
-	LockSetTable::iterator it;
-	if((it=writer_lock_set_table_.find(curr_thd_id))==writer_lock_set_table_.end()
-		|| writer_lock_set_table_[curr_thd_id]==NULL) {
+	LockSet *&curr_lock_set=WriterLockSet(curr_thd_id);
+	if(!curr_lock_set)
 		curr_lock_set=new LockSet;
-		writer_lock_set_table_[curr_thd_id]=curr_lock_set;
-	}
-	else
-		curr_lock_set=it->second;
 	return curr_lock_set;
 }
 
 
 LockSet *Eraser::GetReaderLockSet(thread_t curr_thd_id)
 {
-	LockSet *curr_lock_set=NULL;
-	LockSetTable::iterator it;
-	if((it=reader_lock_set_table_.find(curr_thd_id))==reader_lock_set_table_.end()
-		|| reader_lock_set_table_[curr_thd_id]==NULL) {
+	LockSet *&curr_lock_set=ReaderLockSet(curr_thd_id);
+	if(!curr_lock_set)
 		curr_lock_set=new LockSet;
-		reader_lock_set_table_[curr_thd_id]=curr_lock_set;
-	}
-	else
-		curr_lock_set=it->second;
 	return curr_lock_set;
 }
 
@@ -12,7 +12,6 @@ namespace race {
 
 class Eraser:public Detector {
 public:
-	typedef std::map<thread_t,LockSet *> LockSetTable;
 	typedef std::tr1::unordered_map<address_t,uint32> LockReferenceMap;
 	Eraser();
 	~Eraser();
@@ -42,7 +41,7 @@ public:
     // we should discard all vc operations
     void ThreadStart(thread_t curr_thd_id,thread_t parent_thd_id) {
     	ScopedLock lock(internal_lock_);
-		atomic_map_[curr_thd_id]=false;
+		GetThreadContext(curr_thd_id)->atomic=false;
 	}
     void AfterPthreadJoin(thread_t curr_thd_id,timestamp_t curr_thd_clk, 
 		Inst *inst,thread_t child_thd_id) {}
@@ -105,10 +104,13 @@ protected:
 	void ProcessRead(thread_t cutt_thd_id,Meta *meta,Inst *inst);
 	void ProcessWrite(thread_t cutt_thd_id,Meta *meta,Inst *inst);
 	void ProcessFree(Meta *meta);
+	//the hb engine keeps the lock sets of each thread on its own, a rwlock
+	//leaves the sets of a thread at its unlock. alone, the rwlock holders
+	//are counted across the threads and a reader keeps the lock in its sets
+	//until the last holder unlocks, which hides more races.
+	bool SharedSync() { return true; }
 	//whether to track the racy inst
 	bool track_racy_inst_;
-	LockSetTable writer_lock_set_table_;
-	LockSetTable reader_lock_set_table_;
 
 	LockReferenceMap lock_reference_map_;
 
@@ -31,13 +31,12 @@ void FastTrack::Setup(Mutex *lock,RaceDB *race_db)
 
 Detector::Meta *FastTrack::GetMeta(address_t iaddr)
 {
-	Meta::Table::iterator it=meta_table_.find(iaddr);
-	if(it==meta_table_.end()) {
-		Meta *meta=new FtMeta(iaddr);
-		meta_table_[iaddr]=meta;
-		return meta;
+	Meta *meta=meta_table_.Find(iaddr);
+	if(!meta) {
+		meta=new FtMeta(iaddr);
+		meta_table_.Insert(iaddr,meta);
 	}
-	return it->second;
+	return meta;
 }
 
 Detector::MutexMeta *FastTrack::GetMutexMeta(address_t iaddr)
@@ -59,7 +58,7 @@ void FastTrack::AfterPthreadRwlockRdlock(thread_t curr_thd_id,timestamp_t curr_t
 	DEBUG_ASSERT(UNIT_DOWN_ALIGN(addr,unit_size_) == addr);
 	RwlockMeta *meta=dynamic_cast<RwlockMeta *>(GetMutexMeta(addr));
 	DEBUG_ASSERT(meta);
-	VectorClock *curr_vc=curr_vc_map_[curr_thd_id];
+	VectorClock *curr_vc=GetThreadVC(curr_thd_id);
 	DEBUG_ASSERT(curr_vc);
 	curr_vc->Join(&meta->vc);
 	meta->ref_count++;
@@ -74,7 +73,7 @@ void FastTrack::AfterPthreadRwlockWrlock(thread_t curr_thd_id,timestamp_t curr_t
 	DEBUG_ASSERT(UNIT_DOWN_ALIGN(addr,unit_size_) == addr);
 	RwlockMeta *meta=dynamic_cast<RwlockMeta *>(GetMutexMeta(addr));
 	DEBUG_ASSERT(meta);
-	VectorClock *curr_vc=curr_vc_map_[curr_thd_id];
+	VectorClock *curr_vc=GetThreadVC(curr_thd_id);
 	DEBUG_ASSERT(curr_vc);
 	curr_vc->Join(&meta->vc);
 	DEBUG_ASSERT(meta->ref_count==0);
@@ -89,7 +88,7 @@ void FastTrack::BeforePthreadRwlockUnlock(thread_t curr_thd_id,timestamp_t curr_
 	DEBUG_ASSERT(UNIT_DOWN_ALIGN(addr,unit_size_) == addr);
 	RwlockMeta *meta=dynamic_cast<RwlockMeta *>(GetMutexMeta(addr));
 	DEBUG_ASSERT(meta);
-	VectorClock *curr_vc=curr_vc_map_[curr_thd_id];
+	VectorClock *curr_vc=GetThreadVC(curr_thd_id);
 	DEBUG_ASSERT(curr_vc);
 	//update the wait vector clock
 	meta->wait_vc.Join(curr_vc);
@@ -106,7 +105,7 @@ void FastTrack::ProcessRead(thread_t curr_thd_id,Meta *meta,Inst *inst)
 	//INFO_PRINT("process read\n");
 	FtMeta *ft_meta=dynamic_cast<FtMeta*>(meta);
 	DEBUG_ASSERT(ft_meta);
-	VectorClock *curr_vc=curr_vc_map_[curr_thd_id];
+	VectorClock *curr_vc=GetThreadVC(curr_thd_id);
 	timestamp_t curr_clk=curr_vc->GetClock(curr_thd_id);
 	//same epoch
 	// INFO_FMT_PRINT("addr:%lx\n",meta->addr);
@@ -127,16 +126,15 @@ void FastTrack::ProcessRead(thread_t curr_thd_id,Meta *meta,Inst *inst)
 
 		ft_meta->racy=true;
 		thread_t thd_id=ft_meta->writer_epoch.first;
-		DEBUG_ASSERT(ft_meta->writer_inst_table.find(thd_id)!=
-			ft_meta->writer_inst_table.end() && 
-			ft_meta->writer_inst_table[thd_id]!=NULL);
-		Inst *writer_inst=ft_meta->writer_inst_table[thd_id];
+		DEBUG_ASSERT(ft_meta->writer_inst);
+		Inst *writer_inst=ft_meta->writer_inst;
 		ReportRace(ft_meta,thd_id,writer_inst,RACE_EVENT_WRITE,
 					curr_thd_id,inst,RACE_EVENT_READ);
 	}
 	//read_shared
 	if(ft_meta->shared) {
-		ft_meta->reader_vc.SetClock(curr_thd_id,curr_clk);
+		ft_meta->shared->reader_vc.SetClock(curr_thd_id,curr_clk);
+		ft_meta->shared->reader_inst_table[curr_thd_id]=inst;
 	}
 	else {
 		//exclusive
@@ -155,15 +153,15 @@ void FastTrack::ProcessRead(thread_t curr_thd_id,Meta *meta,Inst *inst)
 		}
 		else {
 			//INFO_PRINT("read share\n");
-			ft_meta->reader_vc.SetClock(curr_thd_id,curr_clk);
-			ft_meta->reader_vc.SetClock(reader_epoch_thd,reader_epoch_clk);
-			ft_meta->shared=true;
+			InflateReadShared(ft_meta);
+			ft_meta->shared->reader_vc.SetClock(curr_thd_id,curr_clk);
+			ft_meta->shared->reader_inst_table[curr_thd_id]=inst;
 		}
 	}
-	ft_meta->reader_inst_table[curr_thd_id]=inst;
+	ft_meta->reader_inst=inst;
 	//update race inst set if needed
 	if(track_racy_inst_)
-		ft_meta->race_inst_set.insert(inst);
+		AddRacyInst(ft_meta,inst);
 	//INFO_PRINT("process read end\n");
 }
 
@@ -173,7 +171,7 @@ void FastTrack::ProcessWrite(thread_t curr_thd_id,Meta *meta,Inst *inst)
 	//INFO_PRINT("process write\n");
 	FtMeta *ft_meta=dynamic_cast<FtMeta*>(meta);
 	DEBUG_ASSERT(ft_meta);
-	VectorClock *curr_vc=curr_vc_map_[curr_thd_id];
+	VectorClock *curr_vc=GetThreadVC(curr_thd_id);
 	timestamp_t curr_clk=curr_vc->GetClock(curr_thd_id);
 	// INFO_FMT_PRINT("addr:%lx\n",meta->addr);
 	// INFO_FMT_PRINT("writer_epoch-thd:%lx,writer_epoch-clk:%ld\n",
@@ -195,10 +193,8 @@ void FastTrack::ProcessWrite(thread_t curr_thd_id,Meta *meta,Inst *inst)
 
 		ft_meta->racy=true;
 		thread_t thd_id=ft_meta->writer_epoch.first;
-		DEBUG_ASSERT(ft_meta->writer_inst_table.find(thd_id)!=
-			ft_meta->writer_inst_table.end() && 
-			ft_meta->writer_inst_table[thd_id]!=NULL);
-		Inst *writer_inst=ft_meta->writer_inst_table[thd_id];
+		DEBUG_ASSERT(ft_meta->writer_inst);
+		Inst *writer_inst=ft_meta->writer_inst;
 		ReportRace(ft_meta,thd_id,writer_inst,RACE_EVENT_WRITE,
 					curr_thd_id,inst,RACE_EVENT_WRITE);
 	}
@@ -214,49 +210,48 @@ void FastTrack::ProcessWrite(thread_t curr_thd_id,Meta *meta,Inst *inst)
 
 			ft_meta->racy=true;
 			thread_t thd_id=ft_meta->reader_epoch.first;
-			DEBUG_ASSERT(ft_meta->reader_inst_table.find(thd_id)!=
-				ft_meta->reader_inst_table.end() && 
-				ft_meta->reader_inst_table[thd_id]!=NULL);
-			Inst *reader_inst=ft_meta->reader_inst_table[thd_id];
+			DEBUG_ASSERT(ft_meta->reader_inst);
+			Inst *reader_inst=ft_meta->reader_inst;
 			ReportRace(ft_meta,thd_id,reader_inst,RACE_EVENT_READ,
 					curr_thd_id,inst,RACE_EVENT_WRITE);		
 		}
 	}
 	//read occurs in multi threads
 	else {
-		for(ft_meta->reader_vc.IterBegin();!ft_meta->reader_vc.IterEnd();
-			ft_meta->reader_vc.IterNext()) {
-			thread_t thd_id=ft_meta->reader_vc.IterCurrThd();
-			timestamp_t clk=ft_meta->reader_vc.IterCurrClk();
+		VectorClock &reader_vc=ft_meta->shared->reader_vc;
+		FtMeta::InstMap &reader_inst_table=ft_meta->shared->reader_inst_table;
+		for(reader_vc.IterBegin();!reader_vc.IterEnd();reader_vc.IterNext()) {
+			thread_t thd_id=reader_vc.IterCurrThd();
+			timestamp_t clk=reader_vc.IterCurrClk();
 			if(curr_thd_id!=thd_id && clk>curr_vc->GetClock(thd_id)) {
 
 				//PrintDebugRaceInfo("FASTTRACK",READTOWRITE,ft_meta,curr_thd_id,inst);
 
 				ft_meta->racy=true;
 
-				DEBUG_ASSERT(ft_meta->reader_inst_table.find(thd_id)!=
-					ft_meta->reader_inst_table.end() && 
-					ft_meta->reader_inst_table[thd_id]!=NULL);
-				Inst *reader_inst=ft_meta->reader_inst_table[thd_id];
+				DEBUG_ASSERT(reader_inst_table.find(thd_id)!=
+					reader_inst_table.end() && reader_inst_table[thd_id]!=NULL);
+				Inst *reader_inst=reader_inst_table[thd_id];
 				ReportRace(ft_meta,thd_id,reader_inst,RACE_EVENT_READ,
 					curr_thd_id,inst,RACE_EVENT_WRITE);
 			}
 		}
 
 		//discard the read vc
-		ft_meta->reader_vc.Clear();
-		ft_meta->shared=false;
+		delete ft_meta->shared;
+		ft_meta->shared=NULL;
 		ft_meta->reader_epoch.first=ft_meta->reader_epoch.second=0;
+		ft_meta->reader_inst=NULL;
 	}
 	
 	//update writer-epoch
 	ft_meta->writer_epoch.first=curr_thd_id;
 	ft_meta->writer_epoch.second=curr_clk;
 
-	ft_meta->writer_inst_table[curr_thd_id]=inst;
+	ft_meta->writer_inst=inst;
 	//update race inst set if needed
 	if(track_racy_inst_)
-		ft_meta->race_inst_set.insert(inst);
+		AddRacyInst(ft_meta,inst);
 
 	//INFO_PRINT("process write end\n");
 }
@@ -267,15 +262,15 @@ void FastTrack::AfterPthreadJoin(thread_t curr_thd_id,timestamp_t curr_thd_clk,
 {
 	//INFO_PRINT("pthread join \n");
 	Detector::AfterPthreadJoin(curr_thd_id,curr_thd_clk,inst,child_thd_id);
+	ScopedLock lock(internal_lock_);
 	//remove the reader vector clock's entrys
-	for(Meta::Table::iterator it=meta_table_.begin();it!=meta_table_.end();
-		it++) {
-		FtMeta *ft_meta=dynamic_cast<FtMeta*>(it->second);
-		if(ft_meta->reader_vc.Find(child_thd_id)) {
-			ft_meta->reader_vc.Erase(child_thd_id);
-			if(ft_meta->reader_vc.Size()<=1)
+	for(meta_table_.IterBegin();!meta_table_.IterEnd();meta_table_.IterNext()) {
+		FtMeta *ft_meta=dynamic_cast<FtMeta*>(meta_table_.IterCurr());
+		if(ft_meta->shared && ft_meta->shared->reader_vc.Find(child_thd_id)) {
+			ft_meta->shared->reader_vc.Erase(child_thd_id);
+			if(ft_meta->shared->reader_vc.Size()<=1)
 				//thread local
-				ft_meta->shared=false;
+				DeflateReadShared(ft_meta);
 		}
 	}
 	//INFO_PRINT("pthread join end\n");
@@ -286,7 +281,7 @@ void FastTrack::AfterPthreadMutexLock(thread_t curr_thd_id,timestamp_t curr_thd_
 {
 	Detector::AfterPthreadMutexLock(curr_thd_id,curr_thd_clk,inst,addr);
 	//merge the reader vector clock
-	// curr_thd_clk=curr_vc_map_[curr_thd_id]->GetClock(curr_thd_id);
+	// curr_thd_clk=GetThreadVC(curr_thd_id)->GetClock(curr_thd_id);
 	// for(Meta::Table::iterator it=meta_table_.begin();it!=meta_table_.end();
 	// 	it++) {
 	// 	FtMeta *ft_meta=dynamic_cast<FtMeta*>(it->second);
@@ -310,13 +305,48 @@ void FastTrack::ProcessFree(Meta *meta)
 	FtMeta *ft_meta=dynamic_cast<FtMeta *>(meta);
 	DEBUG_ASSERT(ft_meta);
 	//update the racy inst set if needed
-	if(track_racy_inst_ && ft_meta->racy) {
-		for(FtMeta::InstSet::iterator it=ft_meta->race_inst_set.begin();
-			it!=ft_meta->race_inst_set.end();it++) {
+	if(track_racy_inst_ && ft_meta->racy && ft_meta->race_inst_set) {
+		for(FtMeta::InstSet::iterator it=ft_meta->race_inst_set->begin();
+			it!=ft_meta->race_inst_set->end();it++) {
 			race_db_->SetRacyInst(*it,true);
 		}
 	}
 	delete ft_meta;
 }
 
+//the exclusive reader epoch becomes the first entry of the out-of-line
+//reader vector clock
+void FastTrack::InflateReadShared(FtMeta *ft_meta)
+{
+	DEBUG_ASSERT(!ft_meta->shared);
+	ft_meta->shared=new FtMeta::ReadShared;
+	thread_t thd_id=ft_meta->reader_epoch.first;
+	ft_meta->shared->reader_vc.SetClock(thd_id,ft_meta->reader_epoch.second);
+	ft_meta->shared->reader_inst_table[thd_id]=ft_meta->reader_inst;
+}
+
+//back to exclusive, the remaining reader (if any) becomes the reader epoch
+void FastTrack::DeflateReadShared(FtMeta *ft_meta)
+{
+	VectorClock &reader_vc=ft_meta->shared->reader_vc;
+	ft_meta->reader_epoch.first=ft_meta->reader_epoch.second=0;
+	ft_meta->reader_inst=NULL;
+	reader_vc.IterBegin();
+	if(!reader_vc.IterEnd()) {
+		thread_t thd_id=reader_vc.IterCurrThd();
+		ft_meta->reader_epoch.first=thd_id;
+		ft_meta->reader_epoch.second=reader_vc.IterCurrClk();
+		ft_meta->reader_inst=ft_meta->shared->reader_inst_table[thd_id];
+	}
+	delete ft_meta->shared;
+	ft_meta->shared=NULL;
+}
+
+void FastTrack::AddRacyInst(FtMeta *ft_meta,Inst *inst)
+{
+	if(!ft_meta->race_inst_set)
+		ft_meta->race_inst_set=new FtMeta::InstSet;
+	ft_meta->race_inst_set->insert(inst);
+}
+
 } //namespace race
\ No newline at end of file
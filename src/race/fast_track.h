@@ -34,24 +34,39 @@ public:
 	virtual void BeforePthreadRwlockUnlock(thread_t curr_thd_id,timestamp_t curr_thd_clk, 
 		Inst *inst,address_t addr);
 protected:
-	//the meta data for memory
+	//the meta data for memory. the inline cell only keeps the last write
+	//and read epochs with their instructions, the reader vector clock is
+	//inflated out of line once the unit becomes read-shared.
 	class FtMeta:public Meta {
 	public:
 		typedef std::set<Inst *> InstSet;
 		typedef std::map<thread_t,Inst*> InstMap;
 
-		explicit FtMeta(address_t a):Meta(a),shared(false),racy(false),
-		writer_epoch(Epoch(0,0)),reader_epoch(Epoch(0,0))
+		class ReadShared {
+		public:
+			ReadShared() {}
+			~ReadShared() {}
+			VectorClock reader_vc;
+			InstMap reader_inst_table;
+		private:
+			DISALLOW_COPY_CONSTRUCTORS(ReadShared);
+		};
+
+		explicit FtMeta(address_t a):Meta(a),writer_epoch(Epoch(0,0)),
+		reader_epoch(Epoch(0,0)),writer_inst(NULL),reader_inst(NULL),
+		shared(NULL),race_inst_set(NULL),racy(false)
 		{}
-		~FtMeta() {}
-		VectorClock reader_vc;
-		InstMap writer_inst_table;
-		InstMap reader_inst_table;
-		bool shared;
-		bool racy;
+		~FtMeta() {
+			delete shared;
+			delete race_inst_set;
+		}
 		Epoch writer_epoch;
 		Epoch reader_epoch;
-		InstSet race_inst_set;
+		Inst *writer_inst;
+		Inst *reader_inst;
+		ReadShared *shared;
+		InstSet *race_inst_set;
+		bool racy;
 	};
 
 	class RwlockMeta:public MutexMeta {
@@ -67,8 +82,15 @@ protected:
 	virtual void ProcessRead(thread_t curr_thd_id,Meta *meta,Inst *inst);
 	virtual void ProcessWrite(thread_t curr_thd_id,Meta *meta,Inst *inst);
 	virtual void ProcessFree(Meta *meta);
+	virtual bool StripedAccess() { return true; }
+	//the hb engine keeps the rwlock clocks the way FastTrack does alone, the
+	//readers are only ordered with the writers
+	virtual bool SharedSync() { return true; }
 
 	virtual MutexMeta *GetMutexMeta(address_t addr);
+	void InflateReadShared(FtMeta *ft_meta);
+	void DeflateReadShared(FtMeta *ft_meta);
+	void AddRacyInst(FtMeta *ft_meta,Inst *inst);
 	//whether to track the racy inst
 	bool track_racy_inst_;
 private:
@@ -0,0 +1,233 @@
+#include "race/hb_engine.h"
+#include "core/log.h"
+
+namespace race {
+
+HbEngine::HbEngine() {}
+
+HbEngine::~HbEngine() {}
+
+void HbEngine::Register()
+{
+	Detector::Register();
+	knob_->RegisterBool("enable_hb_engine","whether track the synchronization"
+		" once for all the enabled detectors that can share it","0");
+}
+
+bool HbEngine::Enabled()
+{
+	return knob_->ValueBool("enable_hb_engine");
+}
+
+bool HbEngine::Attach(Detector *checker)
+{
+	if(!checker->SharedSync())
+		return false;
+	checker->ShareThreadContexts(this);
+	checkers_.push_back(checker);
+	return true;
+}
+
+bool HbEngine::CachedAccess()
+{
+	for(size_t i=0;i<checkers_.size();i++)
+		if(!checkers_[i]->CachedAccess())
+			return false;
+	return true;
+}
+
+void HbEngine::ImageLoad(Image *image,address_t low_addr,address_t high_addr,
+	address_t data_start,size_t data_size,address_t bss_start,size_t bss_size)
+{
+	Detector::ImageLoad(image,low_addr,high_addr,data_start,data_size,
+		bss_start,bss_size);
+	for(size_t i=0;i<checkers_.size();i++)
+		checkers_[i]->ImageLoad(image,low_addr,high_addr,data_start,data_size,
+			bss_start,bss_size);
+}
+
+void HbEngine::ImageUnload(Image *image,address_t low_addr,address_t high_addr,
+	address_t data_start,size_t data_size,address_t bss_start,size_t bss_size)
+{
+	Detector::ImageUnload(image,low_addr,high_addr,data_start,data_size,
+		bss_start,bss_size);
+	for(size_t i=0;i<checkers_.size();i++)
+		checkers_[i]->ImageUnload(image,low_addr,high_addr,data_start,data_size,
+			bss_start,bss_size);
+}
+
+void HbEngine::ThreadStart(thread_t curr_thd_id,thread_t parent_thd_id)
+{
+	Detector::ThreadStart(curr_thd_id,parent_thd_id);
+	ScopedLock lock(internal_lock_);
+	ThreadContext *ctx=GetThreadContext(curr_thd_id);
+	if(!ctx->writer_lockset)
+		ctx->writer_lockset=new LockSet;
+	if(!ctx->reader_lockset)
+		ctx->reader_lockset=new LockSet;
+}
+
+//the accesses hold the engine lock shared, so the thread contexts do not
+//change under the checks. each detector takes its own lock.
+void HbEngine::BeforeMemRead(thread_t curr_thd_id,timestamp_t curr_thd_clk,
+	Inst *inst,address_t addr,size_t size)
+{
+	ScopedSharedLock lock(access_lock_);
+	for(size_t i=0;i<checkers_.size();i++)
+		checkers_[i]->BeforeMemRead(curr_thd_id,curr_thd_clk,inst,addr,size);
+}
+
+void HbEngine::BeforeMemWrite(thread_t curr_thd_id,timestamp_t curr_thd_clk,
+	Inst *inst,address_t addr,size_t size)
+{
+	ScopedSharedLock lock(access_lock_);
+	for(size_t i=0;i<checkers_.size();i++)
+		checkers_[i]->BeforeMemWrite(curr_thd_id,curr_thd_clk,inst,addr,size);
+}
+
+void HbEngine::BeforeMemBatch(EventRecord *recs,size_t num)
+{
+	ScopedSharedLock lock(access_lock_);
+	for(size_t i=0;i<checkers_.size();i++)
+		checkers_[i]->BeforeMemBatch(recs,num);
+}
+
+void HbEngine::AfterPthreadMutexLock(thread_t curr_thd_id,timestamp_t curr_thd_clk,
+	Inst *inst,address_t addr)
+{
+	Detector::AfterPthreadMutexLock(curr_thd_id,curr_thd_clk,inst,addr);
+	ScopedLock lock(internal_lock_);
+	AddLock(curr_thd_id,addr,true);
+}
+
+void HbEngine::BeforePthreadMutexUnlock(thread_t curr_thd_id,timestamp_t curr_thd_clk,
+	Inst *inst,address_t addr)
+{
+	Detector::BeforePthreadMutexUnlock(curr_thd_id,curr_thd_clk,inst,addr);
+	ScopedLock lock(internal_lock_);
+	RemoveLock(curr_thd_id,addr);
+}
+
+void HbEngine::AfterPthreadRwlockRdlock(thread_t curr_thd_id,timestamp_t curr_thd_clk,
+	Inst *inst,address_t addr)
+{
+	LockCountIncrease();
+	ScopedLock lock(internal_lock_);
+	DEBUG_ASSERT(UNIT_DOWN_ALIGN(addr,unit_size_) == addr);
+	RwlockMeta *meta=dynamic_cast<RwlockMeta *>(GetMutexMeta(addr));
+	DEBUG_ASSERT(meta);
+	VectorClock *curr_vc=GetThreadVC(curr_thd_id);
+	DEBUG_ASSERT(curr_vc);
+	curr_vc->Join(&meta->vc);
+	meta->ref_count++;
+	AddLock(curr_thd_id,addr,false);
+}
+
+void HbEngine::AfterPthreadRwlockWrlock(thread_t curr_thd_id,timestamp_t curr_thd_clk,
+	Inst *inst,address_t addr)
+{
+	LockCountIncrease();
+	ScopedLock lock(internal_lock_);
+	DEBUG_ASSERT(UNIT_DOWN_ALIGN(addr,unit_size_) == addr);
+	RwlockMeta *meta=dynamic_cast<RwlockMeta *>(GetMutexMeta(addr));
+	DEBUG_ASSERT(meta);
+	VectorClock *curr_vc=GetThreadVC(curr_thd_id);
+	DEBUG_ASSERT(curr_vc);
+	curr_vc->Join(&meta->vc);
+	meta->ref_count++;
+	AddLock(curr_thd_id,addr,true);
+}
+
+void HbEngine::BeforePthreadRwlockUnlock(thread_t curr_thd_id,timestamp_t curr_thd_clk,
+	Inst *inst,address_t addr)
+{
+	LockCountIncrease();
+	ScopedLock lock(internal_lock_);
+	DEBUG_ASSERT(UNIT_DOWN_ALIGN(addr,unit_size_) == addr);
+	RwlockMeta *meta=dynamic_cast<RwlockMeta *>(GetMutexMeta(addr));
+	DEBUG_ASSERT(meta);
+	VectorClock *curr_vc=GetThreadVC(curr_thd_id);
+	DEBUG_ASSERT(curr_vc);
+	//the last holder publishes the clocks of all the holders
+	meta->wait_vc.Join(curr_vc);
+	if(meta->ref_count>0)
+		meta->ref_count--;
+	if(meta->ref_count==0) {
+		meta->vc=meta->wait_vc;
+		meta->wait_vc.Clear();
+	}
+	curr_vc->Increment(curr_thd_id);
+	RemoveLock(curr_thd_id,addr);
+}
+
+void HbEngine::AfterMalloc(thread_t curr_thd_id,timestamp_t curr_thd_clk,
+	Inst *inst,size_t size,address_t addr)
+{
+	Detector::AfterMalloc(curr_thd_id,curr_thd_clk,inst,size,addr);
+	for(size_t i=0;i<checkers_.size();i++)
+		checkers_[i]->AfterMalloc(curr_thd_id,curr_thd_clk,inst,size,addr);
+}
+
+void HbEngine::AfterCalloc(thread_t curr_thd_id,timestamp_t curr_thd_clk,
+	Inst *inst,size_t nmemb,size_t size,address_t addr)
+{
+	Detector::AfterCalloc(curr_thd_id,curr_thd_clk,inst,nmemb,size,addr);
+	for(size_t i=0;i<checkers_.size();i++)
+		checkers_[i]->AfterCalloc(curr_thd_id,curr_thd_clk,inst,nmemb,size,addr);
+}
+
+void HbEngine::BeforeRealloc(thread_t curr_thd_id,timestamp_t curr_thd_clk,
+	Inst *inst,address_t ori_addr,size_t size)
+{
+	Detector::BeforeRealloc(curr_thd_id,curr_thd_clk,inst,ori_addr,size);
+	for(size_t i=0;i<checkers_.size();i++)
+		checkers_[i]->BeforeRealloc(curr_thd_id,curr_thd_clk,inst,ori_addr,size);
+}
+
+void HbEngine::AfterRealloc(thread_t curr_thd_id,timestamp_t curr_thd_clk,
+	Inst *inst,address_t ori_addr,size_t size,address_t new_addr)
+{
+	Detector::AfterRealloc(curr_thd_id,curr_thd_clk,inst,ori_addr,size,new_addr);
+	for(size_t i=0;i<checkers_.size();i++)
+		checkers_[i]->AfterRealloc(curr_thd_id,curr_thd_clk,inst,ori_addr,size,
+			new_addr);
+}
+
+void HbEngine::BeforeFree(thread_t curr_thd_id,timestamp_t curr_thd_clk,
+	Inst *inst,address_t addr)
+{
+	Detector::BeforeFree(curr_thd_id,curr_thd_clk,inst,addr);
+	for(size_t i=0;i<checkers_.size();i++)
+		checkers_[i]->BeforeFree(curr_thd_id,curr_thd_clk,inst,addr);
+}
+
+//mutexes and rwlocks share the table
+Detector::MutexMeta *HbEngine::GetMutexMeta(address_t iaddr)
+{
+	MutexMeta::Table::iterator it=mutex_meta_table_.find(iaddr);
+	if(it==mutex_meta_table_.end()) {
+		MutexMeta *meta=new RwlockMeta;
+		mutex_meta_table_[iaddr]=meta;
+		return meta;
+	}
+	return it->second;
+}
+
+void HbEngine::AddLock(thread_t curr_thd_id,address_t addr,bool is_write)
+{
+	ThreadContext *ctx=GetThreadContext(curr_thd_id);
+	DEBUG_ASSERT(ctx->writer_lockset && ctx->reader_lockset);
+	ctx->reader_lockset->Add(addr);
+	if(is_write)
+		ctx->writer_lockset->Add(addr);
+}
+
+void HbEngine::RemoveLock(thread_t curr_thd_id,address_t addr)
+{
+	ThreadContext *ctx=GetThreadContext(curr_thd_id);
+	DEBUG_ASSERT(ctx->writer_lockset && ctx->reader_lockset);
+	ctx->writer_lockset->Remove(addr);
+	ctx->reader_lockset->Remove(addr);
+}
+
+} //namespace race
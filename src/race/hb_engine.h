@@ -0,0 +1,104 @@
+#ifndef __RACE_HB_ENGINE_H
+#define __RACE_HB_ENGINE_H
+
+/**
+ * Shared happens-before engine.
+ *
+ * The engine tracks the synchronization of the program once, the thread
+ * vector clocks and the locks held by each thread, and feeds the memory
+ * accesses to the detectors attached to it. An attached detector only
+ * checks the accesses against its own shadow metas, reading the thread
+ * contexts of the engine, so running several detectors costs one sync
+ * pipeline plus one access check per detector.
+ *
+ * Only the detectors whose checks rely on nothing but these thread
+ * contexts can be attached, see Detector::SharedSync. The sync events are
+ * not forwarded, so the bookkeeping a detector does on its own at a sync
+ * event is skipped. The engine runs as a serial analyzer.
+ */
+
+#include <vector>
+#include "core/basictypes.h"
+#include "race/detector.h"
+#include "race/race.h"
+
+namespace race {
+
+class HbEngine:public Detector {
+public:
+	HbEngine();
+	~HbEngine();
+
+	void Register();
+	bool Enabled();
+	//the detector is set up and deleted by the caller
+	bool Attach(Detector *checker);
+	size_t CheckerNum() { return checkers_.size(); }
+	//the engine checks nothing on its own
+	bool CachedAccess();
+
+	void ImageLoad(Image *image,address_t low_addr,address_t high_addr,
+		address_t data_start,size_t data_size,address_t bss_start,
+		size_t bss_size);
+	void ImageUnload(Image *image,address_t low_addr,address_t high_addr,
+		address_t data_start,size_t data_size,address_t bss_start,
+		size_t bss_size);
+	void ThreadStart(thread_t curr_thd_id,thread_t parent_thd_id);
+	void BeforeMemRead(thread_t curr_thd_id,timestamp_t curr_thd_clk,
+		Inst *inst,address_t addr,size_t size);
+	void BeforeMemWrite(thread_t curr_thd_id,timestamp_t curr_thd_clk,
+		Inst *inst,address_t addr,size_t size);
+	void BeforeMemBatch(EventRecord *recs,size_t num);
+
+	void AfterPthreadMutexLock(thread_t curr_thd_id,timestamp_t curr_thd_clk,
+		Inst *inst,address_t addr);
+	void BeforePthreadMutexUnlock(thread_t curr_thd_id,timestamp_t curr_thd_clk,
+		Inst *inst,address_t addr);
+	void AfterPthreadRwlockRdlock(thread_t curr_thd_id,timestamp_t curr_thd_clk,
+		Inst *inst,address_t addr);
+	void AfterPthreadRwlockWrlock(thread_t curr_thd_id,timestamp_t curr_thd_clk,
+		Inst *inst,address_t addr);
+	void BeforePthreadRwlockUnlock(thread_t curr_thd_id,timestamp_t curr_thd_clk,
+		Inst *inst,address_t addr);
+
+	void AfterMalloc(thread_t curr_thd_id,timestamp_t curr_thd_clk,
+		Inst *inst,size_t size,address_t addr);
+	void AfterCalloc(thread_t curr_thd_id,timestamp_t curr_thd_clk,
+		Inst *inst,size_t nmemb,size_t size,address_t addr);
+	void BeforeRealloc(thread_t curr_thd_id,timestamp_t curr_thd_clk,
+		Inst *inst,address_t ori_addr,size_t size);
+	void AfterRealloc(thread_t curr_thd_id,timestamp_t curr_thd_clk,
+		Inst *inst,address_t ori_addr,size_t size,address_t new_addr);
+	void BeforeFree(thread_t curr_thd_id,timestamp_t curr_thd_clk,
+		Inst *inst,address_t addr);
+protected:
+	//readers of a rwlock are not ordered with each other, the lock passes
+	//the clocks of all of them to the next holder
+	class RwlockMeta:public MutexMeta {
+	public:
+		RwlockMeta():ref_count(0) {}
+		~RwlockMeta() {}
+		int ref_count;
+		VectorClock wait_vc;
+	};
+
+	MutexMeta *GetMutexMeta(address_t addr);
+	//the lock sets: a lock held for writing protects both kinds of accesses,
+	//a lock held for reading only protects reads
+	void AddLock(thread_t curr_thd_id,address_t addr,bool is_write);
+	void RemoveLock(thread_t curr_thd_id,address_t addr);
+
+	//the engine checks no access itself
+	Meta *GetMeta(address_t iaddr) { return NULL; }
+	void ProcessRead(thread_t curr_thd_id,Meta *meta,Inst *inst) {}
+	void ProcessWrite(thread_t curr_thd_id,Meta *meta,Inst *inst) {}
+	void ProcessFree(Meta *meta) {}
+
+	std::vector<Detector *> checkers_;
+private:
+	DISALLOW_COPY_CONSTRUCTORS(HbEngine);
+};
+
+} //namespace race
+
+#endif /* __RACE_HB_ENGINE_H */
@@ -8,12 +8,6 @@ Helgrind::Helgrind():track_racy_inst_(false)
 
 Helgrind::~Helgrind()
 {
-	for(LockSetTable::iterator it=writer_lock_set_table_.begin();
-		it!=writer_lock_set_table_.end();it++)
-		delete it->second;
-	for(LockSetTable::iterator it=reader_lock_set_table_.begin();
-		it!=reader_lock_set_table_.end();it++)
-		delete it->second;
 }
 
 void Helgrind::Register()
@@ -55,9 +49,8 @@ void Helgrind::AfterPthreadJoin(thread_t curr_thd_id,timestamp_t curr_thd_clk,
 	Detector::AfterPthreadJoin(curr_thd_id,curr_thd_clk,inst,child_thd_id);
 	create_segment_map_[curr_thd_id]=SEGMENT_NEW;	
 
-	for(Meta::Table::iterator it=meta_table_.begin();it!=meta_table_.end();
-		it++) {
-		HgMeta *hg_meta=dynamic_cast<HgMeta *>(it->second);
+	for(meta_table_.IterBegin();!meta_table_.IterEnd();meta_table_.IterNext()) {
+		HgMeta *hg_meta=dynamic_cast<HgMeta *>(meta_table_.IterCurr());
 		//remove the thread
 		if(hg_meta->thread_set.find(child_thd_id)!= hg_meta->thread_set.end())
 			hg_meta->thread_set.erase(child_thd_id);
@@ -90,13 +83,12 @@ void Helgrind::AfterPthreadJoin(thread_t curr_thd_id,timestamp_t curr_thd_clk,
 
 Detector::Meta * Helgrind::GetMeta(address_t iaddr)
 {
-	Meta::Table::iterator it=meta_table_.find(iaddr);
-	if(it==meta_table_.end()) {
-		Meta *meta=new HgMeta(iaddr);
-		meta_table_[iaddr]=meta;
-		return meta;
+	Meta *meta=meta_table_.Find(iaddr);
+	if(!meta) {
+		meta=new HgMeta(iaddr);
+		meta_table_.Insert(iaddr,meta);
 	}
-	return it->second;
+	return meta;
 }
 
 void Helgrind::AfterPthreadMutexLock(thread_t curr_thd_id,
@@ -118,8 +110,8 @@ void Helgrind::BeforePthreadMutexUnlock(thread_t curr_thd_id,
 {
 	LockCountIncrease();
 	ScopedLock lock(internal_lock_);
-	LockSet *curr_writer_lock_set=writer_lock_set_table_[curr_thd_id];
-	LockSet *curr_reader_lock_set=reader_lock_set_table_[curr_thd_id];
+	LockSet *curr_writer_lock_set=WriterLockSet(curr_thd_id);
+	LockSet *curr_reader_lock_set=ReaderLockSet(curr_thd_id);
 	DEBUG_ASSERT(curr_writer_lock_set && curr_reader_lock_set);
 	//
 	curr_writer_lock_set->Remove(addr);
@@ -165,8 +157,8 @@ void Helgrind::BeforePthreadRwlockUnlock(thread_t curr_thd_id,
 {
 	LockCountIncrease();
 	ScopedLock lock(internal_lock_);
-	LockSet *curr_writer_lock_set=writer_lock_set_table_[curr_thd_id];
-	LockSet *curr_reader_lock_set=reader_lock_set_table_[curr_thd_id];
+	LockSet *curr_writer_lock_set=WriterLockSet(curr_thd_id);
+	LockSet *curr_reader_lock_set=ReaderLockSet(curr_thd_id);
 	DEBUG_ASSERT(curr_writer_lock_set && curr_reader_lock_set);
 
 	DEBUG_ASSERT(lock_reference_map_[addr]>0);
@@ -268,7 +260,7 @@ void Helgrind::ProcessRead(thread_t curr_thd_id,Meta *meta,Inst *inst)
 
 	UpdateMemoryState(curr_thd_id,RACE_EVENT_READ,hg_meta,inst);
 	// INFO_FMT_PRINT("segment:%s\n",hg_meta->segment.vc.ToString().c_str());
-	// INFO_FMT_PRINT("curr_vc:%s\n",curr_vc_map_[curr_thd_id]->ToString().c_str());
+	// INFO_FMT_PRINT("curr_vc:%s\n",GetThreadVC(curr_thd_id)->ToString().c_str());
 	// INFO_FMT_PRINT("lockset:%s\n",hg_meta->lock_set.ToString().c_str());
 	// INFO_FMT_PRINT("state:%d\n",hg_meta->state);
 	//racy
@@ -305,7 +297,7 @@ void Helgrind::ProcessWrite(thread_t curr_thd_id,Meta *meta,Inst *inst)
 
 	UpdateMemoryState(curr_thd_id,RACE_EVENT_WRITE,hg_meta,inst);
 	// INFO_FMT_PRINT("segment:%s\n",hg_meta->segment.vc.ToString().c_str());
-	// INFO_FMT_PRINT("curr_vc:%s\n",curr_vc_map_[curr_thd_id]->ToString().c_str());
+	// INFO_FMT_PRINT("curr_vc:%s\n",GetThreadVC(curr_thd_id)->ToString().c_str());
 	// INFO_FMT_PRINT("lock_set:%s\n",hg_meta->lock_set.ToString().c_str());
 	// INFO_FMT_PRINT("thread_set size:%ld\n",hg_meta->thread_set.size());
 	// INFO_FMT_PRINT("state:%d\n",hg_meta->state);
@@ -341,8 +333,8 @@ void Helgrind::ProcessWrite(thread_t curr_thd_id,Meta *meta,Inst *inst)
 void Helgrind::ChangeStateExclusiveRead(thread_t curr_thd_id,RaceEventType race_event_type,
 	HgMeta *hg_meta,VectorClock *curr_vc,Inst *inst)
 {
-	LockSet *curr_reader_lock_set=reader_lock_set_table_[curr_thd_id];
-	LockSet *curr_writer_lock_set=writer_lock_set_table_[curr_thd_id];
+	LockSet *curr_reader_lock_set=ReaderLockSet(curr_thd_id);
+	LockSet *curr_writer_lock_set=WriterLockSet(curr_thd_id);
 	Segment curr_segment(*curr_vc,curr_thd_id,race_event_type);
 	
 	if(race_event_type==RACE_EVENT_READ) {
@@ -401,8 +393,8 @@ void Helgrind::ChangeStateExclusiveRead(thread_t curr_thd_id,RaceEventType race_
 void Helgrind::ChangeStateExclusiveWrite(thread_t curr_thd_id,RaceEventType race_event_type,
 	HgMeta *hg_meta,VectorClock *curr_vc,Inst *inst)
 {
-	LockSet *curr_reader_lock_set=reader_lock_set_table_[curr_thd_id];
-	LockSet *curr_writer_lock_set=writer_lock_set_table_[curr_thd_id];
+	LockSet *curr_reader_lock_set=ReaderLockSet(curr_thd_id);
+	LockSet *curr_writer_lock_set=WriterLockSet(curr_thd_id);
 	Segment curr_segment(*curr_vc,curr_thd_id,race_event_type);
 	
 	if(race_event_type==RACE_EVENT_READ) {
@@ -462,8 +454,8 @@ void Helgrind::ChangeStateExclusiveWrite(thread_t curr_thd_id,RaceEventType race
 void Helgrind::ChangeStateSharedRead(thread_t curr_thd_id,RaceEventType race_event_type,
 	HgMeta *hg_meta,VectorClock *curr_vc,Inst *inst)
 {
-	LockSet *curr_reader_lock_set=reader_lock_set_table_[curr_thd_id];
-	LockSet *curr_writer_lock_set=writer_lock_set_table_[curr_thd_id];
+	LockSet *curr_reader_lock_set=ReaderLockSet(curr_thd_id);
+	LockSet *curr_writer_lock_set=WriterLockSet(curr_thd_id);
 	Segment curr_segment(*curr_vc,curr_thd_id,race_event_type);
 	//shared_read--------->shared_read
 	if(race_event_type==RACE_EVENT_READ) {
@@ -492,8 +484,8 @@ void Helgrind::ChangeStateSharedModified(thread_t curr_thd_id,RaceEventType race
 	HgMeta *hg_meta,VectorClock *curr_vc,Inst *inst)
 {
 	//INFO_PRINT("shared modified\n");
-	LockSet *curr_reader_lock_set=reader_lock_set_table_[curr_thd_id];
-	LockSet *curr_write_lock_set=writer_lock_set_table_[curr_thd_id];
+	LockSet *curr_reader_lock_set=ReaderLockSet(curr_thd_id);
+	LockSet *curr_write_lock_set=WriterLockSet(curr_thd_id);
 	Segment curr_segment(*curr_vc,curr_thd_id,race_event_type);
 	// INFO_FMT_PRINT("curr_lock_set:%s\n",curr_write_lock_set->ToString().c_str());
 	// INFO_FMT_PRINT("curr_segment vc:%s\n",curr_segment.vc.ToString().c_str());
@@ -550,7 +542,7 @@ void Helgrind::ChangeStateNew(thread_t curr_thd_id,RaceEventType race_event_type
 void Helgrind::UpdateMemoryState(thread_t curr_thd_id,RaceEventType race_event_type,
 	HgMeta *hg_meta,Inst *inst)
 {
-	VectorClock *curr_vc=curr_vc_map_[curr_thd_id];
+	VectorClock *curr_vc=GetThreadVC(curr_thd_id);
 	hg_meta->lastop_table[curr_thd_id]=race_event_type;
 	//INFO_FMT_PRINT("update memory state:%d,address:0x%lx\n",hg_meta->state,hg_meta->addr);
 	switch(hg_meta->state) {
@@ -576,29 +568,17 @@ void Helgrind::UpdateMemoryState(thread_t curr_thd_id,RaceEventType race_event_t
 
 LockSet *Helgrind::GetWriterLockSet(thread_t curr_thd_id)
 {
-	LockSet *curr_lock_set=NULL;
-	LockSetTable::iterator it;
-	if((it=writer_lock_set_table_.find(curr_thd_id))==writer_lock_set_table_.end()
-		|| writer_lock_set_table_[curr_thd_id]==NULL) {
+	LockSet *&curr_lock_set=WriterLockSet(curr_thd_id);
+	if(!curr_lock_set)
 		curr_lock_set=new LockSet;
-		writer_lock_set_table_[curr_thd_id]=curr_lock_set;
-	}
-	else
-		curr_lock_set=it->second;
 	return curr_lock_set;
 }
 
 LockSet *Helgrind::GetReaderLockSet(thread_t curr_thd_id)
 {
-	LockSet *curr_lock_set=NULL;
-	LockSetTable::iterator it;
-	if((it=reader_lock_set_table_.find(curr_thd_id))==reader_lock_set_table_.end()
-		|| reader_lock_set_table_[curr_thd_id]==NULL) {
+	LockSet *&curr_lock_set=ReaderLockSet(curr_thd_id);
+	if(!curr_lock_set)
 		curr_lock_set=new LockSet;
-		reader_lock_set_table_[curr_thd_id]=curr_lock_set;
-	}
-	else
-		curr_lock_set=it->second;
 	return curr_lock_set;
 }
 
@@ -16,7 +16,6 @@ namespace race {
 
 class Helgrind:public Detector{
 public:
-	typedef std::map<thread_t,LockSet *> LockSetTable;
 	typedef std::map<thread_t,char> CreateSegmentMap;
 	typedef std::tr1::unordered_map<address_t,uint32> LockReferenceMap;
 	typedef std::map<thread_t,RaceEventType> LastopTable;
@@ -121,8 +120,6 @@ protected:
 	void ProcessFree(Meta *meta);
 
 	bool track_racy_inst_;
-	LockSetTable writer_lock_set_table_;
-	LockSetTable reader_lock_set_table_;
 	CreateSegmentMap create_segment_map_;
 	LockReferenceMap lock_reference_map_;
 private:
@@ -32,13 +32,12 @@ void LiteRace::Setup(Mutex *lock,RaceDB *race_db)
 
 Detector::Meta *LiteRace::GetMeta(address_t iaddr)
 {
-	Meta::Table::iterator it=meta_table_.find(iaddr);
-	if(it==meta_table_.end()) {
-		Meta *meta=new LrMeta(iaddr);
-		meta_table_[iaddr]=meta;
-		return meta;
+	Meta *meta=meta_table_.Find(iaddr);
+	if(!meta) {
+		meta=new LrMeta(iaddr);
+		meta_table_.Insert(iaddr,meta);
 	}
-	return it->second;
+	return meta;
 }
 
 void LiteRace::UpdateRate(LrMeta *meta)
@@ -40,6 +40,7 @@ protected:
 	void ProcessRead(thread_t curr_thd_id,Meta *meta,Inst *inst);
 	void ProcessWrite(thread_t curr_thd_id,Meta *meta,Inst *inst);
 	//do nothing for ProcessFree
+	//the sampling only looks at the metas, the sync is shared as for Djit
 
 	SampType samp_type_;
 	uint32 rate_param_;
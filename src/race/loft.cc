@@ -75,11 +75,11 @@ void Loft::ProcessUnlock(thread_t curr_thd_id,MutexMeta *meta)
 		//very important
 		if(thread_lastrldlock_map_[curr_thd_id]==loftmutex_meta
 			&& (loftmutex_meta->vc.GetClock(curr_thd_id) >=
-			curr_vc_map_[curr_thd_id]->GetClock(curr_thd_id)) ) {
+			GetThreadVC(curr_thd_id)->GetClock(curr_thd_id)) ) {
 			//update the last released thread of mutex
 			loftmutex_meta->lastrld_thd_id=curr_thd_id;
 			//current thread vc add
-			curr_vc_map_[curr_thd_id]->Increment(curr_thd_id);
+			GetThreadVC(curr_thd_id)->Increment(curr_thd_id);
 			return ;
 		}
 	}
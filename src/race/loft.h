@@ -32,6 +32,8 @@ protected:
 	MutexMeta *GetMutexMeta(address_t addr);
 	void ProcessLock(thread_t curr_thd_id,MutexMeta *meta);
 	void ProcessUnlock(thread_t curr_thd_id,MutexMeta *meta);
+	//the lock clocks differ from the shared ones
+	bool SharedSync() { return false; }
 
 	//thread and last released lock mapping
 	ThreadMutexMap thread_lastrldlock_map_;
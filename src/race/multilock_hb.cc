@@ -8,10 +8,6 @@ MultiLockHb::MultiLockHb():track_racy_inst_(false)
 
 MultiLockHb::~MultiLockHb()
 {
-	for(LockSetTable::iterator it=curr_lockset_table_.begin();
-		it!=curr_lockset_table_.end();it++) {
-		delete it->second;
-	}
 }
 
 void MultiLockHb::Register()
@@ -42,10 +38,9 @@ void MultiLockHb::AfterPthreadMutexLock(thread_t curr_thd_id,timestamp_t curr_th
 	if(cond_wait_db_)
 		cond_wait_db_->AddLastestLock(curr_thd_id,addr);
 	LockSet *curr_lockset;
-	if(curr_lockset_table_.find(curr_thd_id)==curr_lockset_table_.end() ||
-		!curr_lockset_table_[curr_thd_id])
-		curr_lockset_table_[curr_thd_id]=new LockSet;
-	curr_lockset=curr_lockset_table_[curr_thd_id];
+	if(!WriterLockSet(curr_thd_id))
+		WriterLockSet(curr_thd_id)=new LockSet;
+	curr_lockset=WriterLockSet(curr_thd_id);
 	DEBUG_ASSERT(curr_lockset);
 	curr_lockset->Add(addr);
 	
@@ -59,7 +54,7 @@ void MultiLockHb::BeforePthreadMutexUnlock(thread_t curr_thd_id,timestamp_t curr
 	if(loop_db_) {
 		ProcessSRLSync(curr_thd_id,inst);
 		//increase the current thread's timestamp
-		VectorClock *curr_vc=curr_vc_map_[curr_thd_id];
+		VectorClock *curr_vc=GetThreadVC(curr_thd_id);
 		curr_vc->Increment(curr_thd_id);
 	}
 	if(cond_wait_db_) {
@@ -68,7 +63,7 @@ void MultiLockHb::BeforePthreadMutexUnlock(thread_t curr_thd_id,timestamp_t curr
 		cond_wait_db_->RemoveUnactivedLockWritesMeta(curr_thd_id,
 			addr);
 	}
-	LockSet *curr_lockset=curr_lockset_table_[curr_thd_id];
+	LockSet *curr_lockset=WriterLockSet(curr_thd_id);
 	DEBUG_ASSERT(curr_lockset && curr_lockset->Exist(addr));
 	curr_lockset->Remove(addr);
 }
@@ -80,10 +75,9 @@ void MultiLockHb::AfterPthreadRwlockRdlock(thread_t curr_thd_id,timestamp_t curr
 	LockCountIncrease();
 	ScopedLock lock(internal_lock_);
 	LockSet *curr_reader_lockset;
-	if(curr_reader_lockset_table_.find(curr_thd_id)==curr_reader_lockset_table_.end()||
-		!curr_reader_lockset_table_[curr_thd_id])
-		curr_reader_lockset_table_[curr_thd_id]=new LockSet;
-	curr_reader_lockset=curr_reader_lockset_table_[curr_thd_id];
+	if(!ReaderLockSet(curr_thd_id))
+		ReaderLockSet(curr_thd_id)=new LockSet;
+	curr_reader_lockset=ReaderLockSet(curr_thd_id);
 	DEBUG_ASSERT(curr_reader_lockset);
 	curr_reader_lockset->Add(addr);
 }
@@ -111,17 +105,14 @@ void MultiLockHb::BeforePthreadRwlockUnlock(thread_t curr_thd_id,timestamp_t cur
 	}
 	bool found=false;
 	//search in reader lockset
-	if((curr_reader_lockset_table_.find(curr_thd_id)!=
-		curr_reader_lockset_table_.end()) && 
-		curr_reader_lockset_table_[curr_thd_id]!=NULL) {
+	if(ReaderLockSet(curr_thd_id)!=NULL) {
 
-		LockSet *curr_reader_lockset=curr_reader_lockset_table_[curr_thd_id];
+		LockSet *curr_reader_lockset=ReaderLockSet(curr_thd_id);
 		curr_reader_lockset->Remove(addr);
 		found=true;
 	}
-	if((curr_lockset_table_.find(curr_thd_id)!=curr_lockset_table_.end()) &&
-		curr_lockset_table_[curr_thd_id]!=NULL) {
-		LockSet *curr_lockset=curr_lockset_table_[curr_thd_id];
+	if(WriterLockSet(curr_thd_id)!=NULL) {
+		LockSet *curr_lockset=WriterLockSet(curr_thd_id);
 		curr_lockset->Remove(addr);
 		found=true;	
 	}
@@ -130,20 +121,19 @@ void MultiLockHb::BeforePthreadRwlockUnlock(thread_t curr_thd_id,timestamp_t cur
 
 Detector::Meta *MultiLockHb::GetMeta(address_t iaddr)
 {
-	Meta::Table::iterator it=meta_table_.find(iaddr);
-	if(it==meta_table_.end()) {
-		Meta *meta=new MlMeta(iaddr);
-		meta_table_[iaddr]=meta;
-		return meta;
+	Meta *meta=meta_table_.Find(iaddr);
+	if(!meta) {
+		meta=new MlMeta(iaddr);
+		meta_table_.Insert(iaddr,meta);
 	}
-	return it->second;
+	return meta;
 }
 
 void MultiLockHb::update_on_read(timestamp_t curr_clk,thread_t curr_thd,LockSet* curr_lockset,
 	MlMeta *ml_meta)
 {
 	DEBUG_ASSERT(curr_lockset);
-	curr_lockset->Join(curr_reader_lockset_table_[curr_thd]);
+	curr_lockset->Join(ReaderLockSet(curr_thd));
 	
 	//INFO_FMT_PRINT("update_on_read read_lockset :%s\n",curr_lockset->ToString().c_str());
 	//skip all redudant read accesses
@@ -274,15 +264,14 @@ void MultiLockHb::ProcessRead(thread_t curr_thd_id,Meta *meta,Inst *inst)
 		// }
 		ProcessCWLRead(curr_thd_id,inst,ml_meta->addr);
 	}
-	VectorClock *curr_vc=curr_vc_map_[curr_thd_id];
+	VectorClock *curr_vc=GetThreadVC(curr_thd_id);
 	timestamp_t curr_clk=curr_vc->GetClock(curr_thd_id);	
-	if(curr_lockset_table_.find(curr_thd_id)==curr_lockset_table_.end() ||
-		curr_lockset_table_[curr_thd_id]==NULL) {
+	if(!WriterLockSet(curr_thd_id)) {
 		//trivial lockset
-		curr_lockset_table_[curr_thd_id]=new LockSet;	
+		WriterLockSet(curr_thd_id)=new LockSet;	
 	}
 	//temporary lockset-union of writer_lockset and reader_lockset
-	LockSet lock_set=*curr_lockset_table_[curr_thd_id];
+	LockSet lock_set=*WriterLockSet(curr_thd_id);
 	update_on_read(curr_clk,curr_thd_id,&lock_set,ml_meta);
 
 	//write-read race
@@ -364,15 +353,14 @@ void MultiLockHb::ProcessWrite(thread_t curr_thd_id,Meta *meta,Inst *inst)
 		ProcessCWLCalledFuncWrite(curr_thd_id,ml_meta->addr);
 	}
 
-	VectorClock *curr_vc=curr_vc_map_[curr_thd_id];
+	VectorClock *curr_vc=GetThreadVC(curr_thd_id);
 	timestamp_t curr_clk=curr_vc->GetClock(curr_thd_id);
-	if(curr_lockset_table_.find(curr_thd_id)==curr_lockset_table_.end() ||
-		curr_lockset_table_[curr_thd_id]==NULL) {
+	if(!WriterLockSet(curr_thd_id)) {
 		//trivial lockset
-		curr_lockset_table_[curr_thd_id]=new LockSet;	
+		WriterLockSet(curr_thd_id)=new LockSet;	
 	}
 
-	update_on_write(curr_clk,curr_thd_id,curr_lockset_table_[curr_thd_id],
+	update_on_write(curr_clk,curr_thd_id,WriterLockSet(curr_thd_id),
 		ml_meta);
 	//write-write race
 	MlMeta::ThreadElspVecMap::iterator it=ml_meta->writer_elspvec_map.begin();
@@ -387,11 +375,11 @@ void MultiLockHb::ProcessWrite(thread_t curr_thd_id,Meta *meta,Inst *inst)
 			elsp_it!=writer_elsp_vec->end();elsp_it++) {
 
 			// INFO_FMT_PRINT("current lockset:%s\n",
-			// 	curr_lockset_table_[curr_thd_id]->ToString().c_str());
+			// 	WriterLockSet(curr_thd_id)->ToString().c_str());
 			// INFO_FMT_PRINT("writer_elsp:%s\n",(*elsp_it)->second.ToString().c_str());
 
 			if((*elsp_it)->first>thd_clk && 
-				(*elsp_it)->second.Disjoint(curr_lockset_table_[curr_thd_id])) {
+				(*elsp_it)->second.Disjoint(WriterLockSet(curr_thd_id))) {
 
 				// PrintDebugRaceInfo("MULTILOCK_HB",WRITETOWRITE,ml_meta,curr_thd_id,inst);
 
@@ -420,14 +408,14 @@ void MultiLockHb::ProcessWrite(thread_t curr_thd_id,Meta *meta,Inst *inst)
 					loop_db_->SetSpinRelevantWriteThreadAndInst(it->first,curr_thd_id,
 						inst);
 					//current write is protected by the common lock
-					if(!(*elsp_it)->second.Disjoint(curr_lockset_table_[curr_thd_id])) {
+					if(!(*elsp_it)->second.Disjoint(WriterLockSet(curr_thd_id))) {
 						loop_db_->SetSpinRelevantWriteLocked(it->first,true);
 					}
 				}
 			}
 
 			if((*elsp_it)->first>thd_clk && 
-				(*elsp_it)->second.Disjoint(curr_lockset_table_[curr_thd_id])) {
+				(*elsp_it)->second.Disjoint(WriterLockSet(curr_thd_id))) {
 				// PrintDebugRaceInfo("MULTILOCK_HB",READTOWRITE,ml_meta,curr_thd_id,inst);
 				ml_meta->racy=true;
 				Inst *reader_inst=ml_meta->reader_inst_table[thd_id];
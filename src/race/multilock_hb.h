@@ -12,7 +12,6 @@ namespace race {
 
 class MultiLockHb:public Detector {
 public:
-	typedef std::map<thread_t,LockSet *> LockSetTable;
 	MultiLockHb();
 	~MultiLockHb();
 
@@ -59,8 +58,6 @@ protected:
 
 	//whether to track the racy inst
 	bool track_racy_inst_;
-	LockSetTable curr_lockset_table_;
-	LockSetTable curr_reader_lockset_table_;
 private:
 	void update_on_read(timestamp_t curr_clk,thread_t curr_thd,LockSet *curr_lockset,
 		MlMeta *ml_meta);
@@ -5,6 +5,7 @@ protodefs += \
 
 srcs += \
   race/detector.cc \
+  race/hb_engine.cc \
   race/djit.cc \
   race/eraser.cc \
   race/race_track.cc \
@@ -28,12 +29,17 @@ srcs += \
   race/pre_group.cc \
   race/profiler.cpp \
   race/profiler_main.cpp \
+  race/replayer.cc \
+  race/replayer_main.cc \
   race/race.cc \
   race/race.pb.cc
 
 pintools += \
 	race_profiler.so
 
+exes += \
+	race_replayer
+
 race_profiler_objs := \
   race/membug.o \
   race/verifier.o \
@@ -46,6 +52,7 @@ race_profiler_objs := \
 
 race_objs := \
   race/detector.o \
+  race/hb_engine.o \
   race/djit.o \
   race/eraser.o \
   race/race_track.o \
@@ -69,4 +76,51 @@ race_objs := \
   race/adhoc_sync.o \
   race/race.o \
   race/race.pb.o
-  
+
+race_replayer_objs := \
+  race/replayer.o \
+  race/replayer_main.o \
+  race/detector.o \
+  race/hb_engine.o \
+  race/djit.o \
+  race/eraser.o \
+  race/race_track.o \
+  race/helgrind.o \
+  race/thread_sanitizer.o \
+  race/fast_track.o \
+  race/literace.o \
+  race/acculock.o \
+  race/multilock_hb.o \
+  race/loft.o \
+  race/simple_lock.o \
+  race/simplelock_plus.o \
+  race/loop.o \
+  race/cond_wait.o \
+  race/adhoc_sync.o \
+  race/race.o \
+  race/race.pb.o \
+  tracer/loader.o \
+  $(tracer_objs) \
+  $(core_offline_objs)
+
+# the unit tests of the offline code, run by make test
+srcs += \
+  race/detector_test.cc
+
+tests += \
+  race_detector_test
+
+race_detector_test_objs := \
+  race/detector_test.o \
+  race/detector.o \
+  race/hb_engine.o \
+  race/djit.o \
+  race/eraser.o \
+  race/fast_track.o \
+  race/loop.o \
+  race/cond_wait.o \
+  race/adhoc_sync.o \
+  race/race.o \
+  race/race.pb.o \
+  core/detection_queue.o \
+  $(core_offline_objs)
@@ -53,6 +53,13 @@ void PreGroup::BeforeMemWrite(thread_t curr_thd_id, timestamp_t curr_thd_clk,
 	RecordPStmtLogicalTime(curr_thd_id,inst);
 }
 
+void PreGroup::BeforeMemBatch(EventRecord *recs,size_t num)
+{
+	ScopedLock lock(internal_lock_);
+	for(size_t i=0;i<num;i++)
+		RecordPStmtLogicalTime(recs[i].mem.thd_id,recs[i].mem.inst);
+}
+
 void PreGroup::BeforeAtomicInst(thread_t curr_thd_id,timestamp_t curr_thd_clk, 
 	Inst *inst,std::string type, address_t addr)
 {
@@ -67,7 +74,7 @@ inline void PreGroup::RecordPStmtLogicalTime(thread_t curr_thd_id,Inst *inst)
 		return ;
 	//directly type cast
 	SortedPStmt *sorted_pstmt=(SortedPStmt *)pstmt;
-	VectorClock *curr_vc=curr_vc_map_[curr_thd_id];
+	VectorClock *curr_vc=GetThreadVC(curr_thd_id);
 	VectorClock &vc=sorted_pstmt->GetVectorClock();
 	//first access the stmt or dfferent vector clock 
 	if(vc.GetClock(curr_thd_id)!=curr_vc->GetClock(curr_thd_id)) {
@@ -24,6 +24,7 @@ public:
 		Inst *inst, address_t addr, size_t size);
 	void BeforeMemWrite(thread_t curr_thd_id, timestamp_t curr_thd_clk,
 		Inst *inst, address_t addr, size_t size);
+	void BeforeMemBatch(EventRecord *recs,size_t num);
 	void BeforeAtomicInst(thread_t curr_thd_id,timestamp_t curr_thd_clk, 
 		Inst *inst,std::string type, address_t addr);
 	void Export();
@@ -13,11 +13,12 @@ void Profiler::HandlePreSetup()
 	knob_->RegisterStr("race_report","the output race report path","race.rp");
 
 	//======================data race detection=====================
-	// djit_analyzer_=new Djit;
-	// djit_analyzer_->Register();
+	//the detectors which can share the sync of the hb engine
+	djit_analyzer_=new Djit;
+	djit_analyzer_->Register();
 
-	// eraser_analyzer_=new Eraser();
-	// eraser_analyzer_->Register();
+	eraser_analyzer_=new Eraser();
+	eraser_analyzer_->Register();
 
 	// race_track_analyzer_=new RaceTrack();
 	// race_track_analyzer_->Register();
@@ -28,11 +29,11 @@ void Profiler::HandlePreSetup()
 	// thread_sanitizer_analyzer_=new ThreadSanitizer();
 	// thread_sanitizer_analyzer_->Register();
 	
-	// fast_track_analyzer_=new FastTrack();
-	// fast_track_analyzer_->Register();
+	fast_track_analyzer_=new FastTrack();
+	fast_track_analyzer_->Register();
 
-	// literace_analyzer_=new LiteRace();
-	// literace_analyzer_->Register();	
+	literace_analyzer_=new LiteRace();
+	literace_analyzer_->Register();
 
 	// loft_analyzer_=new Loft();
 	// loft_analyzer_->Register();
@@ -49,6 +50,9 @@ void Profiler::HandlePreSetup()
 	// simplelock_plus_analyzer_=new SimpleLockPlus();
 	// simplelock_plus_analyzer_->Register();
 
+	hb_engine_analyzer_=new HbEngine();
+	hb_engine_analyzer_->Register();
+
 	//==============================end============================
 
 	//======================data race verifier=====================
@@ -78,107 +82,166 @@ void Profiler::HandlePostSetup()
 	//create race report
 	race_rp_=new RaceReport(CreateMutex());
 	//======================data race detection=====================
+	if(GetParallelDetectorNumber()>0)
+		SetupParallelDetection();
+	else
+		SetupDetectors();
+	//==============================end============================
 
-	//add  data race detector
-	// if(djit_analyzer_->Enabled()) {
-	// 	djit_analyzer_->Setup(CreateMutex(),race_db_);
-	// 	AddAnalyzer(djit_analyzer_);
+	//======================data race verifier=====================
+	// if(verifier_analyzer_->Enabled()) {
+	// 	LoadPStmts();
+	// 	verifier_analyzer_->Setup(CreateMutex(),CreateMutex(),race_db_,
+	//		prace_db_);
+	// 	AddAnalyzer(verifier_analyzer_);
+	// }
+
+	// if(verifier_sl_analyzer_->Enabled()) {
+	// 	LoadPStmts();
+	// 	verifier_sl_analyzer_->Setup(CreateMutex(),CreateMutex(),
+	//		race_db_,prace_db_);
+	// 	AddAnalyzer(verifier_sl_analyzer_);
 	// }
 
-	// if(eraser_analyzer_->Enabled()) {
-	// 	eraser_analyzer_->Setup(CreateMutex(),race_db_);
-	// 	AddAnalyzer(eraser_analyzer_);
+	if(verifier_ml_analyzer_->Enabled()) {
+		LoadPStmts();
+		verifier_ml_analyzer_->Setup(CreateMutex(),CreateMutex(),
+			race_db_,prace_db_);
+		AddAnalyzer(verifier_ml_analyzer_);
+	}
+
+	// if(pre_group_analyzer_->Enabled()) {
+	// 	LoadPStmts2();
+	// 	pre_group_analyzer_->Setup(CreateMutex(),prace_db_);
+	// 	AddAnalyzer(pre_group_analyzer_);
 	// }
+
+	// if(prl_vrf_ml_analyzer_->Enabled()) {
+	// 	LoadPStmts();
+	// 	prl_vrf_ml_analyzer_->SetTlsKey(app_thd_key);
+	// 	prl_vrf_ml_analyzer_->SetParallelVerifierNumber(knob_->ValueInt(
+	// 		"parallel_verifier_number"));
+	// 	prl_vrf_ml_analyzer_->Setup(CreateMutex(),CreateMutex(),
+	// 		race_db_,prace_db_);
+	// 	AddAnalyzer(prl_vrf_ml_analyzer_);
+	// }
+	//==============================end============================
+}
+
+void Profiler::SetupDetectors()
+{
+	//track the sync once for the detectors sharing it, set up before them
+	if(hb_engine_analyzer_->Enabled())
+		hb_engine_analyzer_->Setup(CreateMutex(),race_db_);
+
+	//add  data race detector
+	if(djit_analyzer_->Enabled()) {
+		djit_analyzer_->Setup(CreateMutex(),race_db_);
+		AddDetector(djit_analyzer_);
+	}
+
+	if(eraser_analyzer_->Enabled()) {
+		eraser_analyzer_->Setup(CreateMutex(),race_db_);
+		AddDetector(eraser_analyzer_);
+	}
 	
 	// if(race_track_analyzer_->Enabled()) {
 	// 	race_track_analyzer_->Setup(CreateMutex(),race_db_);
-	// 	AddAnalyzer(race_track_analyzer_);
+	// 	AddDetector(race_track_analyzer_);
 	// }	
 
 	// if(helgrind_analyzer_->Enabled()) {
 	// 	helgrind_analyzer_->Setup(CreateMutex(),race_db_);
-	// 	AddAnalyzer(helgrind_analyzer_);
+	// 	AddDetector(helgrind_analyzer_);
 	// }	
 
 	// if(thread_sanitizer_analyzer_->Enabled()) {
 	// 	thread_sanitizer_analyzer_->Setup(CreateMutex(),race_db_);
-	// 	AddAnalyzer(thread_sanitizer_analyzer_);
+	// 	AddDetector(thread_sanitizer_analyzer_);
 	// }
 
-	// if(fast_track_analyzer_->Enabled()) {
-	// 	fast_track_analyzer_->Setup(CreateMutex(),race_db_);
-	// 	AddAnalyzer(fast_track_analyzer_);
-	// }
+	if(fast_track_analyzer_->Enabled()) {
+		fast_track_analyzer_->Setup(CreateMutex(),race_db_);
+		AddDetector(fast_track_analyzer_);
+	}
 
-	// if(literace_analyzer_->Enabled()) {
-	// 	literace_analyzer_->Setup(CreateMutex(),race_db_);
-	// 	AddAnalyzer(literace_analyzer_);
-	// }	
+	if(literace_analyzer_->Enabled()) {
+		literace_analyzer_->Setup(CreateMutex(),race_db_);
+		AddDetector(literace_analyzer_);
+	}
 
 	// if(loft_analyzer_->Enabled()) {
 	// 	loft_analyzer_->Setup(CreateMutex(),race_db_);
-	// 	AddAnalyzer(loft_analyzer_);
+	// 	AddDetector(loft_analyzer_);
 	// }
 
 	// if(acculock_analyzer_->Enabled()) {
 	// 	acculock_analyzer_->Setup(CreateMutex(),race_db_);
-	// 	AddAnalyzer(acculock_analyzer_);
+	// 	AddDetector(acculock_analyzer_);
 	// }
 
 	// if(multilock_hb_analyzer_->Enabled()) {
 	// 	multilock_hb_analyzer_->Setup(CreateMutex(),race_db_);
-	// 	AddAnalyzer(multilock_hb_analyzer_);
+	// 	AddDetector(multilock_hb_analyzer_);
 	// }
 
 	// if(simple_lock_analyzer_->Enabled()) {
 	// 	simple_lock_analyzer_->Setup(CreateMutex(),race_db_);
-	// 	AddAnalyzer(simple_lock_analyzer_);
+	// 	AddDetector(simple_lock_analyzer_);
 	// }
 
 	// if(simplelock_plus_analyzer_->Enabled()) {
 	// 	simplelock_plus_analyzer_->Setup(CreateMutex(),race_db_);
-	// 	AddAnalyzer(simplelock_plus_analyzer_);
-	// }
-	//==============================end============================
-
-	//======================data race verifier=====================
-	// if(verifier_analyzer_->Enabled()) {
-	// 	LoadPStmts();
-	// 	verifier_analyzer_->Setup(CreateMutex(),CreateMutex(),race_db_,
-	//		prace_db_);
-	// 	AddAnalyzer(verifier_analyzer_);
-	// }
-
-	// if(verifier_sl_analyzer_->Enabled()) {
-	// 	LoadPStmts();
-	// 	verifier_sl_analyzer_->Setup(CreateMutex(),CreateMutex(),
-	//		race_db_,prace_db_);
-	// 	AddAnalyzer(verifier_sl_analyzer_);
+	// 	AddDetector(simplelock_plus_analyzer_);
 	// }
 
-	if(verifier_ml_analyzer_->Enabled()) {
-		LoadPStmts();
-		verifier_ml_analyzer_->Setup(CreateMutex(),CreateMutex(),
-			race_db_,prace_db_);
-		AddAnalyzer(verifier_ml_analyzer_);
+	//the engine only runs for the detectors attached to it
+	if(hb_engine_analyzer_->Enabled()) {
+		if(hb_engine_analyzer_->CheckerNum()>0)
+			AddAnalyzer(hb_engine_analyzer_);
+		else
+			INFO_PRINT("no enabled detector can share the hb engine\n");
 	}
+}
 
-	// if(pre_group_analyzer_->Enabled()) {
-	// 	LoadPStmts2();
-	// 	pre_group_analyzer_->Setup(CreateMutex(),prace_db_);
-	// 	AddAnalyzer(pre_group_analyzer_);
-	// }
+//each detection thread runs its own instance of the single enabled
+//detector on the events of its address shards
+void Profiler::SetupParallelDetection()
+{
+	int detector_num=djit_analyzer_->Enabled()+eraser_analyzer_->Enabled()+
+		fast_track_analyzer_->Enabled()+literace_analyzer_->Enabled();
+	if(detector_num!=1)
+		Abort("parallel detection runs exactly one of the djit, eraser,"
+			" fast_track and literace detectors.\n");
+	//the producers split the accesses into units of the detectors
+	unit_size_=knob_->ValueInt("unit_size_");
+	if(unit_size_==0)
+		Abort("parallel detection needs a nonzero unit_size_.\n");
+	if(hb_engine_analyzer_->Enabled())
+		INFO_PRINT("the hb engine does not run with parallel detection\n");
+	Detector::SetParallelDetectorNumber(GetParallelDetectorNumber());
+	prl_race_dbs_.resize(GetParallelDetectorNumber(),NULL);
+}
 
-	// if(prl_vrf_ml_analyzer_->Enabled()) {
-	// 	LoadPStmts();
-	// 	prl_vrf_ml_analyzer_->SetTlsKey(app_thd_key);
-	// 	prl_vrf_ml_analyzer_->SetParallelVerifierNumber(knob_->ValueInt(
-	// 		"parallel_verifier_number"));
-	// 	prl_vrf_ml_analyzer_->Setup(CreateMutex(),CreateMutex(),
-	// 		race_db_,prace_db_);
-	// 	AddAnalyzer(prl_vrf_ml_analyzer_);
-	// }
-	//==============================end============================
+Detector *Profiler::CreateParallelDetector()
+{
+	if(djit_analyzer_->Enabled())
+		return new Djit;
+	if(eraser_analyzer_->Enabled())
+		return new Eraser;
+	if(fast_track_analyzer_->Enabled())
+		return new FastTrack;
+	return new LiteRace;
+}
+
+//a detector sharing the sync is fed by the engine, the others analyze the
+//events on their own
+void Profiler::AddDetector(Detector *detector)
+{
+	if(hb_engine_analyzer_ && hb_engine_analyzer_->Enabled() &&
+		hb_engine_analyzer_->Attach(detector))
+		return ;
+	AddAnalyzer(detector);
 }
 
 bool Profiler::HandleIgnoreMemAccess(IMG img)
@@ -211,6 +274,18 @@ void Profiler::HandleProgramExit()
 	// //simple_lock_analyzer_->SaveStatistics("statistics");
 	// //simplelock_plus_analyzer_->SaveStatistics("statistics");
 
+	//======================parallel detection=====================
+	//the detection threads have terminated, merge their races in the
+	//order of the detectors
+	for(size_t i=0;i<prl_race_dbs_.size();i++) {
+		if(!prl_race_dbs_[i])
+			continue;
+		race_db_->Merge(prl_race_dbs_[i],false);
+		delete prl_race_dbs_[i];
+	}
+	prl_race_dbs_.clear();
+	//==============================end============================
+
 	//save race db
 	race_db_->Save(knob_->ValueStr("race_out"),sinfo_);
 	//save race report
@@ -218,17 +293,18 @@ void Profiler::HandleProgramExit()
 	delete race_db_;
 	delete race_rp_;
 	//======================data race detection=====================
-	// delete eraser_analyzer_;
-	// delete djit_analyzer_;
+	delete eraser_analyzer_;
+	delete djit_analyzer_;
 	// delete helgrind_analyzer_;
 	// delete thread_sanitizer_analyzer_;
-	// delete fast_track_analyzer_;
-	// delete literace_analyzer_;
+	delete fast_track_analyzer_;
+	delete literace_analyzer_;
 	// delete loft_analyzer_;
 	// delete multilock_hb_analyzer_;
 	// delete acculock_analyzer_;
 	// delete simple_lock_analyzer_;
 	// delete simplelock_plus_analyzer_;
+	delete hb_engine_analyzer_;
 
 	//==============================end============================
 
@@ -249,53 +325,32 @@ void Profiler::HandleProgramExit()
 	// delete prl_vrf_ml_analyzer_;
 	// delete prace_db_;
 	//==============================end============================	
-
-	//======================parallel detection=====================
-	// ATOMIC_NAND_AND_FETCH(&exit_flag_,0);
-	// size_t prl_dtc_num=GetParallelDetectorNumber();
-	// while(exit_num_!=prl_dtc_num)
-	// 	Sleep(1000);
-	//==============================end============================
 }
 
+//the detector of each detection thread reports to its own race db, the dbs
+//are merged at the exit
 void Profiler::HandleCreateDetectionThread(thread_t thd_id)
 {
-	// //create a new detector for each detection thread
-	// Detector *dtc=new MultiLockHb;
-	// if(!dtc->ParallelDetection())
-	// 	dtc->SetParallelDetectorNumber(GetParallelDetectorNumber());
-	// LockKernel();
-	// dtc->Register();
-	// //here we not firstly register the enable_djit in the HandlePreStepup,
-	// //so do not need to use the Enabled(); otherwise, can update the originl
-	// //value to 0
-	// dtc->Setup(CreateNullMutex(),race_db_);
-	// UnlockKernel();
-	// if(unit_size_==0)
-	// 	unit_size_=dtc->GetUnitSize();
-	// //get the eventbase from the queue
-	// while(true) {
-	// 	EventBase *eb=GetEventBase(thd_id);
-	// 	if(eb==NULL) {
-	// 		goto fini;			
-	// 	}
-	// 	else {
-	// 		Detector::EventHandle eh=dtc->GetEventHandle(eb->name());
-	// 		if(eh==NULL)
-	// 			goto fini;
-	// 		else {
-	// 			// INFO_FMT_PRINT("============event name:[%s]==========\n",eb->name().c_str());
-	// 			(*eh)(dtc,eb); //execute the event handle
-	// 			goto fini;
-	// 		}
-	// 	}
-	// fini:
-	// 	if(IsProcessExiting() && DetectionDequeEmpty(thd_id))
-	// 		break;
-	// }
-	// delete dtc;
-	// ATOMIC_ADD_AND_FETCH(&exit_num_,1);
-	// ExitThread(0);
+	uint32 idx=GetDetectorIndex(thd_id);
+	RaceDB *race_db=new RaceDB(CreateNullMutex());
+	LockKernel();
+	Detector *dtc=CreateParallelDetector();
+	dtc->Setup(CreateNullMutex(),race_db);
+	dtc->SetPartitionIndex(idx);
+	prl_race_dbs_[idx]=race_db;
+	UnlockKernel();
+	//get the events from the queue by batches
+	std::vector<EventRecord> recs(GetEventBatchSize());
+	while(true) {
+		size_t num=GetEvents(thd_id,&recs[0],recs.size());
+		if(num>0)
+			Detector::HandleEvents(dtc,&recs[0],num); //execute the event handles
+		else if(DetectionDequeClosed(thd_id) && DetectionDequeEmpty(thd_id))
+			break;
+		else
+			WaitEvent(thd_id); //spin, then block until events arrive
+	}
+	delete dtc;
 }
 
 void Profiler::HandleCreateVerificationThread(thread_t thd_id)
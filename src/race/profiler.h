@@ -16,6 +16,7 @@
 #include "race/multilock_hb.h"
 #include "race/simple_lock.h"
 #include "race/simplelock_plus.h"
+#include "race/hb_engine.h"
 #include "race/potential_race.h"
 #include "race/verifier.h"
 #include "race/verifier_sl.h"
@@ -41,6 +42,7 @@ public:
 			multilock_hb_analyzer_(NULL),
 			simple_lock_analyzer_(NULL),
 			simplelock_plus_analyzer_(NULL),
+			hb_engine_analyzer_(NULL),
 			prace_db_(NULL),
 			verifier_analyzer_(NULL),
 			verifier_sl_analyzer_(NULL),
@@ -73,6 +75,7 @@ protected:
 	MultiLockHb *multilock_hb_analyzer_;
 	SimpleLock *simple_lock_analyzer_;
 	SimpleLockPlus *simplelock_plus_analyzer_;
+	HbEngine *hb_engine_analyzer_;
 	//==============================end============================
 
 	//======================data race verifier=====================
@@ -86,7 +89,13 @@ protected:
 	volatile size_t exit_num_;
 	volatile unsigned exit_flag_;
 	address_t unit_size_;
+	//the race db of each detection thread, by the detector index
+	std::vector<RaceDB *> prl_race_dbs_;
 private:
+	void SetupDetectors();
+	void SetupParallelDetection();
+	Detector *CreateParallelDetector();
+	void AddDetector(Detector *detector);
 	void LoadPStmts();
 	void LoadPStmts2();
 	void StartWaitVerification();
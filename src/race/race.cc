@@ -149,6 +149,19 @@ bool RaceDB::RacyInst(Inst *inst,bool locking)
 	return racy_inst_set_.find(inst)!=racy_inst_set_.end();
 }
 
+void RaceDB::Merge(RaceDB *db,bool locking)
+{
+	ScopedLock lock(internal_lock_,locking);
+	for(Race::Vec::iterator iter=db->race_vec_.begin();
+		iter!=db->race_vec_.end();iter++) {
+		RaceEvent::Vec &event_vec=(*iter)->event_vec_;
+		CreateRace((*iter)->addr_,event_vec[0]->thd_id(),event_vec[0]->inst(),
+			event_vec[0]->type(),event_vec[1]->thd_id(),event_vec[1]->inst(),
+			event_vec[1]->type(),false);
+	}
+	racy_inst_set_.insert(db->racy_inst_set_.begin(),db->racy_inst_set_.end());
+}
+
 void RaceDB::Load(const std::string &db_name,StaticInfo *sinfo)
 {
 	RaceDBProto proto;
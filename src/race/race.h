@@ -138,6 +138,8 @@ namespace race
 			std::map<Race*,RaceEvent*> &result,bool locking);
 		void SetRacyInst(Inst *inst,bool locking);
 		bool RacyInst(Inst *inst,bool locking);
+		//add the races and racy insts another db found in this execution
+		void Merge(RaceDB *db,bool locking);
 
 		void Load(const std::string &db_name,StaticInfo *sinfo);
 		void Save(const std::string &db_name,StaticInfo *sinfo);
@@ -8,12 +8,6 @@ RaceTrack::RaceTrack():track_racy_inst_(false)
 
 RaceTrack::~RaceTrack()
 {
-	for(LockSetTable::iterator it=reader_lock_set_table_.begin();
-		it!=reader_lock_set_table_.end();it++) 
-		delete it->second;
-	for(LockSetTable::iterator it=writer_lock_set_table_.begin();
-		it!=writer_lock_set_table_.end();it++) 
-		delete it->second;
 }
 
 void RaceTrack::Register()
@@ -38,13 +32,12 @@ void RaceTrack::Setup(Mutex *lock,RaceDB *race_db)
 
 Detector::Meta * RaceTrack::GetMeta(address_t iaddr)
 {
-	Meta::Table::iterator it=meta_table_.find(iaddr);
-	if(it==meta_table_.end()) {
-		Meta *meta=new RtMeta(iaddr);
-		meta_table_[iaddr]=meta;
-		return meta;
+	Meta *meta=meta_table_.Find(iaddr);
+	if(!meta) {
+		meta=new RtMeta(iaddr);
+		meta_table_.Insert(iaddr,meta);
 	}
-	return it->second;
+	return meta;
 }
 
 void RaceTrack::AfterPthreadMutexLock(thread_t curr_thd_id,timestamp_t curr_thd_clk, 
@@ -71,8 +64,8 @@ void RaceTrack::BeforePthreadMutexUnlock(thread_t curr_thd_id,timestamp_t curr_t
 	Inst *inst,address_t addr)
 {
 	ScopedLock lock(internal_lock_);
-	LockSet *curr_writer_lock_set=writer_lock_set_table_[curr_thd_id];
-	LockSet *curr_reader_lock_set=reader_lock_set_table_[curr_thd_id];
+	LockSet *curr_writer_lock_set=WriterLockSet(curr_thd_id);
+	LockSet *curr_reader_lock_set=ReaderLockSet(curr_thd_id);
 	DEBUG_ASSERT(curr_writer_lock_set && curr_reader_lock_set);
 	//
 	curr_writer_lock_set->Remove(addr);
@@ -129,8 +122,8 @@ void RaceTrack::BeforePthreadRwlockUnlock(thread_t curr_thd_id,timestamp_t curr_
 {
 
 	ScopedLock lock(internal_lock_);
-	LockSet *curr_writer_lock_set=writer_lock_set_table_[curr_thd_id];
-	LockSet *curr_reader_lock_set=reader_lock_set_table_[curr_thd_id];
+	LockSet *curr_writer_lock_set=WriterLockSet(curr_thd_id);
+	LockSet *curr_reader_lock_set=ReaderLockSet(curr_thd_id);
 	DEBUG_ASSERT(curr_writer_lock_set && curr_reader_lock_set);
 	DEBUG_ASSERT(lock_reference_map_[addr]>0);
 
@@ -253,7 +246,7 @@ void RaceTrack::UpdateMemoryState(thread_t curr_thd_id,RaceEventType race_event_
 	// 	it!=rt_meta->thread_set.end();it++)
 	// 	INFO_FMT_PRINT("[%lx:%ld] ",it->first,it->second);
 
-	// INFO_FMT_PRINT("\ncurr_vc:%s\n",curr_vc_map_[curr_thd_id]->ToString().c_str());
+	// INFO_FMT_PRINT("\ncurr_vc:%s\n",GetThreadVC(curr_thd_id)->ToString().c_str());
 	// INFO_FMT_PRINT("state:%d\n",rt_meta->state);
 	//constructed initially
 	if(rt_meta->state==RtMeta::MEM_STATE_VIRGIN) {
@@ -352,7 +345,7 @@ void RaceTrack::UpdateMemoryState(thread_t curr_thd_id,RaceEventType race_event_
 
 void RaceTrack::MergeThreadSet(thread_t curr_thd_id,RtMeta *rt_meta)
 {
-	VectorClock *curr_vc=curr_vc_map_[curr_thd_id];
+	VectorClock *curr_vc=GetThreadVC(curr_thd_id);
 	for(RtMeta::ThreadSet::iterator it=rt_meta->thread_set.begin();
 		it!=rt_meta->thread_set.end();) {
 		if(it->second<=curr_vc->GetClock((*it).first))
@@ -366,8 +359,8 @@ void RaceTrack::MergeThreadSet(thread_t curr_thd_id,RtMeta *rt_meta)
 void RaceTrack::MergeLockSet(thread_t curr_thd_id,RaceEventType race_event_type,
 	RtMeta *rt_meta)
 {
-	LockSet *curr_writer_lock_set=writer_lock_set_table_[curr_thd_id];
-	LockSet *curr_reader_lock_set=reader_lock_set_table_[curr_thd_id];
+	LockSet *curr_writer_lock_set=WriterLockSet(curr_thd_id);
+	LockSet *curr_reader_lock_set=ReaderLockSet(curr_thd_id);
 	if(race_event_type==RACE_EVENT_READ) {
 		rt_meta->reader_lock_set.Merge(curr_reader_lock_set);
 		rt_meta->writer_lock_set.Merge(curr_reader_lock_set);
@@ -381,8 +374,8 @@ void RaceTrack::MergeLockSet(thread_t curr_thd_id,RaceEventType race_event_type,
 void RaceTrack::InitializeLockSet(thread_t curr_thd_id,RaceEventType race_event_type,
 	RtMeta *rt_meta)
 {
-	LockSet *curr_writer_lock_set=writer_lock_set_table_[curr_thd_id];
-	LockSet *curr_reader_lock_set=reader_lock_set_table_[curr_thd_id];
+	LockSet *curr_writer_lock_set=WriterLockSet(curr_thd_id);
+	LockSet *curr_reader_lock_set=ReaderLockSet(curr_thd_id);
 	rt_meta->reader_lock_set.Clear();
 	rt_meta->writer_lock_set.Clear();
 	if(race_event_type==RACE_EVENT_READ && curr_reader_lock_set) {
@@ -395,30 +388,18 @@ void RaceTrack::InitializeLockSet(thread_t curr_thd_id,RaceEventType race_event_
 
 LockSet *RaceTrack::GetWriterLockSet(thread_t curr_thd_id)
 {
-	LockSet *curr_lock_set=NULL;
-	LockSetTable::iterator it;
-	if((it=writer_lock_set_table_.find(curr_thd_id))==writer_lock_set_table_.end()
-		|| writer_lock_set_table_[curr_thd_id]==NULL) {
+	LockSet *&curr_lock_set=WriterLockSet(curr_thd_id);
+	if(!curr_lock_set)
 		curr_lock_set=new LockSet;
-		writer_lock_set_table_[curr_thd_id]=curr_lock_set;
-	}
-	else
-		curr_lock_set=it->second;
 	return curr_lock_set;
 }
 
 
 LockSet *RaceTrack::GetReaderLockSet(thread_t curr_thd_id)
 {
-	LockSet *curr_lock_set=NULL;
-	LockSetTable::iterator it;
-	if((it=reader_lock_set_table_.find(curr_thd_id))==reader_lock_set_table_.end()
-		|| reader_lock_set_table_[curr_thd_id]==NULL) {
+	LockSet *&curr_lock_set=ReaderLockSet(curr_thd_id);
+	if(!curr_lock_set)
 		curr_lock_set=new LockSet;
-		reader_lock_set_table_[curr_thd_id]=curr_lock_set;
-	}
-	else
-		curr_lock_set=it->second;
 	return curr_lock_set;
 }
 
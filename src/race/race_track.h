@@ -14,7 +14,6 @@ namespace race {
 
 class RaceTrack:public Detector {
 public:
-	typedef std::map<thread_t,LockSet *> LockSetTable;
 	typedef std::tr1::unordered_map<address_t,uint32> LockReferenceMap;
 	RaceTrack();
 	~RaceTrack();
@@ -79,8 +78,6 @@ protected:
 	//whether to track the racy inst
 	bool track_racy_inst_;
 
-	LockSetTable writer_lock_set_table_;
-	LockSetTable reader_lock_set_table_;
 
 	LockReferenceMap lock_reference_map_;
 private:
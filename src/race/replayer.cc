@@ -0,0 +1,232 @@
+#include "race/replayer.h"
+#include <cassert>
+#include "core/log.h"
+#include "race/djit.h"
+#include "race/eraser.h"
+#include "race/race_track.h"
+#include "race/helgrind.h"
+#include "race/thread_sanitizer.h"
+#include "race/fast_track.h"
+#include "race/literace.h"
+#include "race/loft.h"
+#include "race/acculock.h"
+#include "race/multilock_hb.h"
+#include "race/simple_lock.h"
+#include "race/simplelock_plus.h"
+
+namespace race {
+
+Replayer::Replayer():race_db_(NULL),race_rp_(NULL),hb_engine_analyzer_(NULL)
+{}
+
+Replayer::~Replayer()
+{
+	for(size_t i=0;i<workers_.size();i++)
+		delete workers_[i];
+	for(size_t i=0;i<detectors_.size();i++)
+		delete detectors_[i];
+	delete hb_engine_analyzer_;
+	delete race_db_;
+	delete race_rp_;
+}
+
+void Replayer::HandlePreSetup()
+{
+	tracer::Loader::HandlePreSetup();
+	knob_->RegisterStr("race_in","the input race database path","race.db");
+	knob_->RegisterStr("race_out","the output race database path","race.db");
+	knob_->RegisterStr("race_report","the output race report path","race.rp");
+
+	knob_->RegisterInt("replay_workers","the number of threads detecting on"
+		" disjoint address shards of the trace, 0 replays it in one thread","0");
+
+	CreateDetectors();
+	for(size_t i=0;i<detectors_.size();i++)
+		detectors_[i]->Register();
+	hb_engine_analyzer_->Register();
+}
+
+void Replayer::HandlePostSetup()
+{
+	tracer::Loader::HandlePostSetup();
+	//load race db
+	race_db_=new RaceDB(CreateMutex());
+	race_db_->Load(knob_->ValueStr("race_in"),sinfo_);
+	//create race report
+	race_rp_=new RaceReport(CreateMutex());
+
+	//the ad-hoc sync analyses look up the races of any address
+	int worker_num=knob_->ValueInt("replay_workers");
+	if(worker_num>1 && (knob_->ValueStr("loop_range_lines")!="0" ||
+		knob_->ValueStr("exiting_cond_lines")!="0")) {
+		INFO_PRINT("ad-hoc sync analysis, replay in one thread\n");
+		worker_num=0;
+	}
+	//the workers own whole lines, a unit must not straddle two of them
+	int unit_size=knob_->ValueInt("unit_size_");
+	if(worker_num>1 && (unit_size<=0 ||
+		(1<<PARTITION_LINE_BITS)%unit_size!=0)) {
+		INFO_PRINT("unit size does not divide a line, replay in one thread\n");
+		worker_num=0;
+	}
+	if(worker_num<=1) {
+		SetupDetectors();
+		return ;
+	}
+	for(int i=0;i<worker_num;i++) {
+		ReplayWorker *worker=new ReplayWorker(i,worker_num);
+		worker->knob_=knob_;
+		worker->sinfo_=sinfo_;
+		worker->Setup();
+		workers_.push_back(worker);
+	}
+}
+
+void Replayer::HandleStart()
+{
+	if(workers_.empty()) {
+		tracer::Loader::HandleStart();
+		return ;
+	}
+	std::vector<pthread_t> threads(workers_.size());
+	for(size_t i=0;i<workers_.size();i++) {
+		int res=pthread_create(&threads[i],NULL,WorkerThread,workers_[i]);
+		assert(!res);
+	}
+	for(size_t i=0;i<workers_.size();i++)
+		pthread_join(threads[i],NULL);
+	//in the worker order, so that the merged db does not depend on timing
+	for(size_t i=0;i<workers_.size();i++)
+		race_db_->Merge(workers_[i]->race_db_,false);
+}
+
+void *Replayer::WorkerThread(void *arg)
+{
+	((ReplayWorker *)arg)->Start();
+	return NULL;
+}
+
+void Replayer::HandleExit()
+{
+	tracer::Loader::HandleExit();
+	//save race db
+	race_db_->Save(knob_->ValueStr("race_out"),sinfo_);
+	//save race report
+	race_rp_->Save(knob_->ValueStr("race_report"),race_db_);
+}
+
+//every detector can run on a trace, each one has its own enable knob
+void Replayer::CreateDetectors()
+{
+	detectors_.push_back(new Djit);
+	detectors_.push_back(new Eraser);
+	detectors_.push_back(new RaceTrack);
+	detectors_.push_back(new Helgrind);
+	detectors_.push_back(new ThreadSanitizer);
+	detectors_.push_back(new FastTrack);
+	detectors_.push_back(new LiteRace);
+	detectors_.push_back(new Loft);
+	detectors_.push_back(new AccuLock);
+	detectors_.push_back(new MultiLockHb);
+	detectors_.push_back(new SimpleLock);
+	detectors_.push_back(new SimpleLockPlus);
+	hb_engine_analyzer_=new HbEngine;
+}
+
+void Replayer::SetupDetectors()
+{
+	//track the sync once for the detectors sharing it, set up before them
+	if(hb_engine_analyzer_->Enabled())
+		hb_engine_analyzer_->Setup(CreateMutex(),race_db_);
+	for(size_t i=0;i<detectors_.size();i++) {
+		if(detectors_[i]->Enabled()) {
+			detectors_[i]->Setup(CreateMutex(),race_db_);
+			AddDetector(detectors_[i]);
+		}
+	}
+	//the engine only runs for the detectors attached to it
+	if(hb_engine_analyzer_->Enabled()) {
+		if(hb_engine_analyzer_->CheckerNum()>0)
+			AddAnalyzer(hb_engine_analyzer_);
+		else
+			INFO_PRINT("no enabled detector can share the hb engine\n");
+	}
+}
+
+//same as the online profiler
+void Replayer::AddDetector(Detector *detector)
+{
+	if(hb_engine_analyzer_->Enabled() && hb_engine_analyzer_->Attach(detector))
+		return ;
+	AddAnalyzer(detector);
+}
+
+ReplayWorker::ReplayWorker(uint32 idx,uint32 worker_num):idx_(idx),
+	worker_num_(worker_num)
+{}
+
+ReplayWorker::~ReplayWorker()
+{
+	//owned by the replayer
+	knob_=NULL;
+	sinfo_=NULL;
+}
+
+//the detectors are registered by the replayer, each worker reads the trace
+//in its own thread
+void ReplayWorker::Setup()
+{
+	trace_log_=new tracer::TraceLog(knob_->ValueStr("trace_log_path"));
+	race_db_=new RaceDB(CreateMutex());
+	CreateDetectors();
+	SetupDetectors();
+}
+
+void ReplayWorker::HandleBeforeMemRead(tracer::LogEntry *e)
+{
+	address_t addr=e->arg(0),end=addr+e->arg(1);
+	while(NextOwned(e,addr,end))
+		Replayer::HandleBeforeMemRead(e);
+}
+
+void ReplayWorker::HandleAfterMemRead(tracer::LogEntry *e)
+{
+	address_t addr=e->arg(0),end=addr+e->arg(1);
+	while(NextOwned(e,addr,end))
+		Replayer::HandleAfterMemRead(e);
+}
+
+void ReplayWorker::HandleBeforeMemWrite(tracer::LogEntry *e)
+{
+	address_t addr=e->arg(0),end=addr+e->arg(1);
+	while(NextOwned(e,addr,end))
+		Replayer::HandleBeforeMemWrite(e);
+}
+
+void ReplayWorker::HandleAfterMemWrite(tracer::LogEntry *e)
+{
+	address_t addr=e->arg(0),end=addr+e->arg(1);
+	while(NextOwned(e,addr,end))
+		Replayer::HandleAfterMemWrite(e);
+}
+
+//the lines are a multiple of the unit size, checked at setup, so the
+//detectors check the same units of the narrowed accesses
+bool ReplayWorker::NextOwned(tracer::LogEntry *e,address_t &addr,
+	address_t end)
+{
+	while(addr<end && !Owned(addr))
+		addr=(addr|((1<<PARTITION_LINE_BITS)-1))+1;
+	if(addr>=end)
+		return false;
+	address_t start=addr;
+	while(addr<end && Owned(addr))
+		addr=(addr|((1<<PARTITION_LINE_BITS)-1))+1;
+	if(addr>end)
+		addr=end;
+	e->set_arg(0,start);
+	e->set_arg(1,addr-start);
+	return true;
+}
+
+} //namespace race
@@ -0,0 +1,81 @@
+#ifndef __RACE_REPLAYER_H
+#define __RACE_REPLAYER_H
+
+/**
+ * Offline race detection.
+ *
+ * The replayer loads a trace recorded by the tracer profiler and feeds it
+ * to the enabled detectors through the same analyzer callbacks as online,
+ * outside of Pin. The static info and the trace of the recording run are
+ * all it needs, so a detection can be rerun on any machine.
+ *
+ * The detection can be spread over several workers. Each worker reads the
+ * whole trace on its own and runs its own detectors with its own race db.
+ * All workers see every sync event, but a memory access only reaches the
+ * worker owning its 64-byte lines, see Partitioner::Shard. The race dbs of
+ * the workers are merged once all of them are done.
+ */
+
+#include <vector>
+#include <pthread.h>
+#include "core/basictypes.h"
+#include "tracer/loader.h"
+#include "race/race.h"
+#include "race/detector.h"
+#include "race/hb_engine.h"
+
+namespace race {
+
+class ReplayWorker;
+
+class Replayer:public tracer::Loader {
+public:
+	Replayer();
+	~Replayer();
+protected:
+	void HandlePreSetup();
+	void HandlePostSetup();
+	void HandleStart();
+	void HandleExit();
+	void CreateDetectors();
+	void SetupDetectors();
+	void AddDetector(Detector *detector);
+	static void *WorkerThread(void *arg);
+
+	RaceDB *race_db_;
+	RaceReport *race_rp_;
+	HbEngine *hb_engine_analyzer_;
+	std::vector<Detector *> detectors_;
+	std::vector<ReplayWorker *> workers_;
+private:
+	DISALLOW_COPY_CONSTRUCTORS(Replayer);
+};
+
+//a worker shares the knobs and the static info of the replayer
+class ReplayWorker:public Replayer {
+public:
+	ReplayWorker(uint32 idx,uint32 worker_num);
+	~ReplayWorker();
+
+	void Setup();
+protected:
+	void HandleBeforeMemRead(tracer::LogEntry *e);
+	void HandleAfterMemRead(tracer::LogEntry *e);
+	void HandleBeforeMemWrite(tracer::LogEntry *e);
+	void HandleAfterMemWrite(tracer::LogEntry *e);
+
+	bool Owned(address_t addr) {
+		return Partitioner::Shard(addr)%worker_num_==idx_;
+	}
+	//narrow the access of the entry to the next owned lines in [addr,end)
+	bool NextOwned(tracer::LogEntry *e,address_t &addr,address_t end);
+
+	uint32 idx_;
+	uint32 worker_num_;
+private:
+	DISALLOW_COPY_CONSTRUCTORS(ReplayWorker);
+};
+
+} //namespace race
+
+#endif /* __RACE_REPLAYER_H */
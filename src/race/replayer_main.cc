@@ -0,0 +1,13 @@
+#include "race/replayer.h"
+
+int main(int argc,char *argv[])
+{
+	race::Replayer *replayer=new race::Replayer;
+	replayer->Initialize();
+	replayer->PreSetup();
+	replayer->Parse(argc,argv);
+	replayer->PostSetup();
+	replayer->Start();
+	replayer->Exit();
+	delete replayer;
+}
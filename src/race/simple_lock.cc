@@ -79,13 +79,12 @@ void SimpleLock::BeforePthreadRwlockUnlock(thread_t curr_thd_id,timestamp_t curr
 
 Detector::Meta *SimpleLock::GetMeta(address_t iaddr)
 {
-	Meta::Table::iterator it=meta_table_.find(iaddr);
-	if(it==meta_table_.end()) {
-		Meta *meta=new SlMeta(iaddr);
-		meta_table_[iaddr]=meta;
-		return meta;
+	Meta *meta=meta_table_.Find(iaddr);
+	if(!meta) {
+		meta=new SlMeta(iaddr);
+		meta_table_.Insert(iaddr,meta);
 	}
-	return it->second;
+	return meta;
 }
 
 
@@ -94,7 +93,7 @@ void SimpleLock::ProcessRead(thread_t curr_thd_id,Meta *meta,Inst *inst)
 	//INFO_FMT_PRINT("process read:%lx\n",meta->addr);
 	SlMeta *sl_meta=dynamic_cast<SlMeta*>(meta);
 	DEBUG_ASSERT(sl_meta);
-	VectorClock *curr_vc=curr_vc_map_[curr_thd_id];
+	VectorClock *curr_vc=GetThreadVC(curr_thd_id);
 	timestamp_t curr_clk=curr_vc->GetClock(curr_thd_id);
 	//
 	if(!sl_meta->reader_clpl_map[curr_thd_id])
@@ -184,7 +183,7 @@ void SimpleLock::ProcessWrite(thread_t curr_thd_id,Meta *meta,Inst *inst)
 	//INFO_FMT_PRINT("process write:%lx\n",meta->addr);
 	SlMeta *sl_meta=dynamic_cast<SlMeta*>(meta);
 	DEBUG_ASSERT(sl_meta);
-	VectorClock *curr_vc=curr_vc_map_[curr_thd_id];
+	VectorClock *curr_vc=GetThreadVC(curr_thd_id);
 	timestamp_t curr_clk=curr_vc->GetClock(curr_thd_id);
 	//
 	if(!sl_meta->writer_clpl_map[curr_thd_id])
@@ -73,20 +73,19 @@ void SimpleLockPlus::BeforePthreadRwlockUnlock(thread_t curr_thd_id,timestamp_t
 
 Detector::Meta *SimpleLockPlus::GetMeta(address_t iaddr)
 {
-	Meta::Table::iterator it=meta_table_.find(iaddr);
-	if(it==meta_table_.end()) {
-		Meta *meta=new SlpMeta(iaddr);
-		meta_table_[iaddr]=meta;
-		return meta;
+	Meta *meta=meta_table_.Find(iaddr);
+	if(!meta) {
+		meta=new SlpMeta(iaddr);
+		meta_table_.Insert(iaddr,meta);
 	}
-	return it->second;
+	return meta;
 }
 
 void SimpleLockPlus::ProcessRead(thread_t curr_thd_id,Meta *meta,Inst *inst)
 {
 	SlpMeta *slp_meta=dynamic_cast<SlpMeta*>(meta);
 	DEBUG_ASSERT(slp_meta);
-	VectorClock *curr_vc=curr_vc_map_[curr_thd_id];
+	VectorClock *curr_vc=GetThreadVC(curr_thd_id);
 	timestamp_t curr_clk=curr_vc->GetClock(curr_thd_id);
 
 	if(slp_meta->reader_clip_map.find(curr_thd_id)==slp_meta->reader_clip_map.end())
@@ -140,7 +139,7 @@ void SimpleLockPlus::ProcessWrite(thread_t curr_thd_id,Meta *meta,Inst *inst)
 {
 	SlpMeta *slp_meta=dynamic_cast<SlpMeta*>(meta);
 	DEBUG_ASSERT(slp_meta);
-	VectorClock *curr_vc=curr_vc_map_[curr_thd_id];
+	VectorClock *curr_vc=GetThreadVC(curr_thd_id);
 	timestamp_t curr_clk=curr_vc->GetClock(curr_thd_id);
 
 	if(slp_meta->writer_clip_map.find(curr_thd_id)==slp_meta->writer_clip_map.end())
@@ -60,13 +60,12 @@ void ThreadSanitizer::AfterPthreadJoin(thread_t curr_thd_id,timestamp_t curr_thd
 
 Detector::Meta * ThreadSanitizer::GetMeta(address_t iaddr)
 {
-	Meta::Table::iterator it=meta_table_.find(iaddr);
-	if(it==meta_table_.end()) {
-		Meta *meta=new ThreadSanitizerMeta(iaddr);
-		meta_table_[iaddr]=meta;
-		return meta;
+	Meta *meta=meta_table_.Find(iaddr);
+	if(!meta) {
+		meta=new ThreadSanitizerMeta(iaddr);
+		meta_table_.Insert(iaddr,meta);
 	}
-	return it->second;
+	return meta;
 }
 
 void ThreadSanitizer::AfterPthreadMutexLock(thread_t curr_thd_id,
@@ -91,8 +90,8 @@ void ThreadSanitizer::BeforePthreadMutexUnlock(thread_t curr_thd_id,
 {
 	LockCountIncrease();
 	ScopedLock lock(internal_lock_);
-	LockSet *curr_writer_lock_set=writer_lock_set_table_[curr_thd_id];
-	LockSet *curr_reader_lock_set=reader_lock_set_table_[curr_thd_id];
+	LockSet *curr_writer_lock_set=WriterLockSet(curr_thd_id);
+	LockSet *curr_reader_lock_set=ReaderLockSet(curr_thd_id);
 	DEBUG_ASSERT(curr_writer_lock_set && curr_reader_lock_set);
 	//
 	curr_writer_lock_set->Remove(addr);
@@ -115,7 +114,7 @@ void ThreadSanitizer::AfterPthreadRwlockRdlock(thread_t curr_thd_id,
 	//if there have been sync operation
 	if(lock_epoch_map_[addr].size()>0) {
 		const Epoch &epoch=lock_epoch_map_[addr][0];
-		curr_vc_map_[curr_thd_id]->SetClock(epoch.first,epoch.second);
+		GetThreadVC(curr_thd_id)->SetClock(epoch.first,epoch.second);
 	}
 	//reader lock reference counting 
 	if(lock_reference_map_.find(addr)!=lock_reference_map_.end())
@@ -145,7 +144,7 @@ void ThreadSanitizer::AfterPthreadRwlockWrlock(thread_t curr_thd_id,
 		std::vector<Epoch> &epoch_vector=lock_epoch_map_[addr];
 		for(std::vector<Epoch>::iterator it=epoch_vector.begin()
 			;it<epoch_vector.end();it++) {
-			curr_vc_map_[curr_thd_id]->SetClock(it->first,it->second);
+			GetThreadVC(curr_thd_id)->SetClock(it->first,it->second);
 		}
 	}
 	//writer lock refenrence counting
@@ -161,8 +160,8 @@ void ThreadSanitizer::BeforePthreadRwlockUnlock(thread_t curr_thd_id,
 {
 	LockCountIncrease();
 	ScopedLock lock(internal_lock_);
-	LockSet *curr_writer_lock_set=writer_lock_set_table_[curr_thd_id];
-	LockSet *curr_reader_lock_set=reader_lock_set_table_[curr_thd_id];
+	LockSet *curr_writer_lock_set=WriterLockSet(curr_thd_id);
+	LockSet *curr_reader_lock_set=ReaderLockSet(curr_thd_id);
 	DEBUG_ASSERT(curr_writer_lock_set && curr_reader_lock_set);
 
 	DEBUG_ASSERT(lock_reference_map_[addr]>0);
@@ -178,7 +177,7 @@ void ThreadSanitizer::BeforePthreadRwlockUnlock(thread_t curr_thd_id,
 	SyncEvent(curr_thd_id);
 
 	lock_epoch_map_[addr].push_back(std::make_pair(curr_thd_id,
-		curr_vc_map_[curr_thd_id]->GetClock(curr_thd_id)));
+		GetThreadVC(curr_thd_id)->GetClock(curr_thd_id)));
 
 	create_segment_map_[curr_thd_id]=true;
 }
@@ -511,8 +510,8 @@ Segment *ThreadSanitizer::GetSegment(thread_t curr_thd_id)
 	Segment *old_segment=NULL;
 	ClearExpiredSegments();
 	if(create_segment_map_[curr_thd_id]) {
-		segment=new Segment(curr_thd_id,writer_lock_set_table_[curr_thd_id],
-			reader_lock_set_table_[curr_thd_id],*curr_vc_map_[curr_thd_id]);
+		segment=new Segment(curr_thd_id,WriterLockSet(curr_thd_id),
+			ReaderLockSet(curr_thd_id),*GetThreadVC(curr_thd_id));
 		//waiting for next new segment
 		create_segment_map_[curr_thd_id]=false;
 		segment->UpReference();
@@ -531,30 +530,18 @@ Segment *ThreadSanitizer::GetSegment(thread_t curr_thd_id)
 
 LockSet *ThreadSanitizer::GetWriterLockSet(thread_t curr_thd_id)
 {
-	LockSet *curr_lock_set=NULL;
-	LockSetTable::iterator it;
-	if((it=writer_lock_set_table_.find(curr_thd_id))==writer_lock_set_table_.end()
-		|| writer_lock_set_table_[curr_thd_id]==NULL) {
+	LockSet *&curr_lock_set=WriterLockSet(curr_thd_id);
+	if(!curr_lock_set)
 		curr_lock_set=new LockSet;
-		writer_lock_set_table_[curr_thd_id]=curr_lock_set;
-	}
-	else
-		curr_lock_set=it->second;
 	return curr_lock_set;
 }
 
 
 LockSet *ThreadSanitizer::GetReaderLockSet(thread_t curr_thd_id)
 {
-	LockSet *curr_lock_set=NULL;
-	LockSetTable::iterator it;
-	if((it=reader_lock_set_table_.find(curr_thd_id))==reader_lock_set_table_.end()
-		|| reader_lock_set_table_[curr_thd_id]==NULL) {
+	LockSet *&curr_lock_set=ReaderLockSet(curr_thd_id);
+	if(!curr_lock_set)
 		curr_lock_set=new LockSet;
-		reader_lock_set_table_[curr_thd_id]=curr_lock_set;
-	}
-	else
-		curr_lock_set=it->second;
 	return curr_lock_set;
 }
 
@@ -14,7 +14,6 @@ namespace race {
 
 class ThreadSanitizer:public Detector {
 public:
-	typedef std::map<thread_t,LockSet *> LockSetTable;
 	typedef std::map<thread_t,Segment *> SegmentTable;
 	typedef std::set<Segment *>SegmentSet;
 	typedef std::map<thread_t,bool> CreateSegmentMap;
@@ -102,8 +101,6 @@ protected:
 	//whether to track the racy inst
 	bool track_racy_inst_;
 	//
-	LockSetTable writer_lock_set_table_;
-	LockSetTable reader_lock_set_table_;
 	//
 	SegmentTable segment_table_;
 	CreateSegmentMap create_segment_map_;
@@ -116,7 +113,7 @@ private:
 	LockSet *GetWriterLockSet(thread_t curr_thd_id);
 	LockSet *GetReaderLockSet(thread_t curr_thd_id);
 	Segment *GetSegment(thread_t curr_thd_id);
-	void SyncEvent(thread_t curr_thd_id) { curr_vc_map_[curr_thd_id]->Increment(curr_thd_id); }
+	void SyncEvent(thread_t curr_thd_id) { GetThreadVC(curr_thd_id)->Increment(curr_thd_id); }
 	ThreadSanitizerMeta::signature_t SegmentSign(Segment *segment);
 	void ClearExpiredSegments();
 
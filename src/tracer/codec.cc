@@ -0,0 +1,122 @@
+#include "tracer/codec.h"
+#include <cstring>
+
+namespace tracer
+{
+
+#define LOG_CODEC_NO_POS static_cast<uint32>(-1)
+
+//a sequence of literals and a match, the last one has no match
+size_t LogCodec::Compress(const uint8 *src,size_t len,uint8 *dst,size_t cap)
+{
+	uint32 table[1<<LOG_CODEC_HASH_BITS];
+	memset(table,0xff,sizeof(table));
+	size_t ip=0,anchor=0,op=0;
+	while(ip+LOG_CODEC_MIN_MATCH<=len) {
+		uint32 hash=Hash(src+ip);
+		uint32 cand=table[hash];
+		table[hash]=ip;
+		if(cand==LOG_CODEC_NO_POS || ip-cand>LOG_CODEC_MAX_OFFSET ||
+			memcmp(src+cand,src+ip,LOG_CODEC_MIN_MATCH)!=0) {
+			ip++;
+			continue;
+		}
+		size_t match=LOG_CODEC_MIN_MATCH;
+		while(ip+match<len && src[cand+match]==src[ip+match])
+			match++;
+		size_t lit=ip-anchor;
+		size_t extra=match-LOG_CODEC_MIN_MATCH;
+		if(op>=cap)
+			return 0;
+		uint8 *token=dst+op++;
+		*token=((lit<15 ? lit : 15)<<4) | (extra<15 ? extra : 15);
+		if(lit>=15 && !PutLength(lit-15,dst,&op,cap))
+			return 0;
+		if(op+lit+2>cap)
+			return 0;
+		memcpy(dst+op,src+anchor,lit);
+		op+=lit;
+		dst[op++]=(uint8)(ip-cand);
+		dst[op++]=(uint8)((ip-cand)>>8);
+		if(extra>=15 && !PutLength(extra-15,dst,&op,cap))
+			return 0;
+		ip+=match;
+		anchor=ip;
+	}
+	if(anchor<len) {
+		size_t lit=len-anchor;
+		if(op>=cap)
+			return 0;
+		dst[op++]=(lit<15 ? lit : 15)<<4;
+		if(lit>=15 && !PutLength(lit-15,dst,&op,cap))
+			return 0;
+		if(op+lit>cap)
+			return 0;
+		memcpy(dst+op,src+anchor,lit);
+		op+=lit;
+	}
+	return op;
+}
+
+bool LogCodec::Decompress(const uint8 *src,size_t len,uint8 *dst,
+	size_t raw_len)
+{
+	size_t ip=0,op=0;
+	while(ip<len) {
+		uint8 token=src[ip++];
+		size_t lit=token>>4;
+		if(lit==15 && !GetLength(src,len,&ip,&lit))
+			return false;
+		if(ip+lit>len || op+lit>raw_len)
+			return false;
+		memcpy(dst+op,src+ip,lit);
+		ip+=lit;
+		op+=lit;
+		if(ip==len)
+			break;
+		if(ip+2>len)
+			return false;
+		size_t offset=src[ip] | (src[ip+1]<<8);
+		ip+=2;
+		size_t match=token & 0xf;
+		if(match==15 && !GetLength(src,len,&ip,&match))
+			return false;
+		match+=LOG_CODEC_MIN_MATCH;
+		if(offset==0 || offset>op || op+match>raw_len)
+			return false;
+		//byte by byte, the match may overlap the output
+		const uint8 *from=dst+op-offset;
+		for(size_t i=0;i<match;i++)
+			dst[op+i]=from[i];
+		op+=match;
+	}
+	return op==raw_len;
+}
+
+bool LogCodec::PutLength(size_t len,uint8 *dst,size_t *op,size_t cap)
+{
+	while(len>=255) {
+		if(*op>=cap)
+			return false;
+		dst[(*op)++]=255;
+		len-=255;
+	}
+	if(*op>=cap)
+		return false;
+	dst[(*op)++]=(uint8)len;
+	return true;
+}
+
+bool LogCodec::GetLength(const uint8 *src,size_t len,size_t *ip,size_t *val)
+{
+	uint8 byte;
+	do {
+		if(*ip>=len)
+			return false;
+		byte=src[(*ip)++];
+		*val+=byte;
+	} while(byte==255);
+	return true;
+}
+
+} //namespace tracer
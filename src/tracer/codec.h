@@ -0,0 +1,42 @@
+#ifndef __TRACER_CODEC_H
+#define __TRACER_CODEC_H
+
+/**
+ * The codec of the trace slices.
+ *
+ * The records of a slice are already deltas, so the slice is only packed by
+ * an LZ-style byte codec: a sequence is a token of the literal and the
+ * match lengths, the literals, and the 16-bit offset of the match. A match
+ * may overlap the bytes it copies, which covers the runs. A slice is coded
+ * on its own, the decoder needs nothing but the slice and its raw size.
+ */
+
+#include "core/basictypes.h"
+
+namespace tracer
+{
+
+#define LOG_CODEC_MIN_MATCH 4
+#define LOG_CODEC_MAX_OFFSET 0xffff
+#define LOG_CODEC_HASH_BITS 12
+
+class LogCodec {
+public:
+	//return the coded size, 0 if the coded slice does not fit in cap
+	static size_t Compress(const uint8 *src,size_t len,uint8 *dst,size_t cap);
+	//return false if the coded slice is corrupted
+	static bool Decompress(const uint8 *src,size_t len,uint8 *dst,
+		size_t raw_len);
+private:
+	static uint32 Hash(const uint8 *ptr) {
+		uint32 val=ptr[0] | (ptr[1]<<8) | (ptr[2]<<16) | ((uint32)ptr[3]<<24);
+		return (val*2654435761U)>>(32-LOG_CODEC_HASH_BITS);
+	}
+	//a length beyond the token nibble, in bytes of 255 and the rest
+	static bool PutLength(size_t len,uint8 *dst,size_t *op,size_t cap);
+	static bool GetLength(const uint8 *src,size_t len,size_t *ip,size_t *val);
+};
+
+} //namespace tracer
+
+#endif //__TRACER_CODEC_H
@@ -0,0 +1,125 @@
+#include "tracer/codec.h"
+#include <cstring>
+#include <vector>
+#include "core/unit_test.h"
+
+using namespace tracer;
+
+//the worst case coded size of a slice, a single run of literals
+static size_t Bound(size_t len)
+{
+	return len+len/255+16;
+}
+
+//compress and decompress, return the coded size
+static size_t RoundTrip(const std::vector<uint8> &raw)
+{
+	size_t len=raw.size();
+	std::vector<uint8> coded(Bound(len)+1);
+	std::vector<uint8> decoded(len+1,0xcc);
+	size_t size=LogCodec::Compress(len?&raw[0]:NULL,len,&coded[0],Bound(len));
+	EXPECT_TRUE(size>0 || len==0);
+	EXPECT_TRUE(LogCodec::Decompress(&coded[0],size,&decoded[0],len));
+	EXPECT_TRUE(len==0 || memcmp(&raw[0],&decoded[0],len)==0);
+	//nothing is written past the raw size
+	EXPECT_EQ(decoded[len],0xcc);
+	return size;
+}
+
+static void Random(std::vector<uint8> &raw,size_t len)
+{
+	for(size_t i=0;i<len;i++)
+		raw.push_back((uint8)rand());
+}
+
+void TestSmallSlices()
+{
+	for(size_t len=0;len<64;len++) {
+		std::vector<uint8> raw;
+		for(size_t i=0;i<len;i++)
+			raw.push_back((uint8)(i%3));
+		RoundTrip(raw);
+	}
+}
+
+//runs and short periods are coded as matches overlapping their output
+void TestOverlappingMatches()
+{
+	std::vector<uint8> zeros(100000,0);
+	EXPECT_TRUE(RoundTrip(zeros)<1000);
+	for(size_t period=1;period<=8;period++) {
+		std::vector<uint8> raw;
+		Random(raw,period);
+		while(raw.size()<5000)
+			raw.push_back(raw[raw.size()-period]);
+		EXPECT_TRUE(RoundTrip(raw)<100);
+	}
+	//literals and matches longer than the token nibble
+	std::vector<uint8> raw;
+	for(int i=0;i<20;i++) {
+		Random(raw,300+i);
+		raw.insert(raw.end(),270+i,(uint8)i);
+	}
+	RoundTrip(raw);
+}
+
+//a repeat is only found up to 16-bit offsets
+void TestOffsetLimit()
+{
+	std::vector<uint8> block;
+	Random(block,4096);
+	size_t sizes[2];
+	for(size_t far=0;far<2;far++) {
+		std::vector<uint8> raw(block);
+		//a run between, which leaves the hash table of the block alone
+		raw.insert(raw.end(),LOG_CODEC_MAX_OFFSET-block.size()+far,0);
+		raw.insert(raw.end(),block.begin(),block.end());
+		sizes[far]=RoundTrip(raw);
+	}
+	//the repeat at the largest offset is a match, one byte further it is not
+	EXPECT_TRUE(sizes[0]+block.size()/2<sizes[1]);
+}
+
+//random bytes do not shrink, a cap below the raw size is refused
+void TestIncompressible()
+{
+	std::vector<uint8> raw;
+	Random(raw,70000);
+	size_t size=RoundTrip(raw);
+	EXPECT_TRUE(size>=raw.size() && size<=Bound(raw.size()));
+	std::vector<uint8> coded(raw.size());
+	EXPECT_EQ(LogCodec::Compress(&raw[0],raw.size(),&coded[0],raw.size()-1),0);
+}
+
+//a damaged slice is refused or decoded within the raw size
+void TestCorruptedSlices()
+{
+	std::vector<uint8> raw;
+	for(int i=0;i<50;i++) {
+		Random(raw,20);
+		raw.insert(raw.end(),30,(uint8)i);
+	}
+	std::vector<uint8> coded(Bound(raw.size()));
+	size_t size=LogCodec::Compress(&raw[0],raw.size(),&coded[0],coded.size());
+	std::vector<uint8> decoded(raw.size()+1);
+	for(int i=0;i<2000;i++) {
+		std::vector<uint8> damaged(coded.begin(),coded.begin()+size);
+		damaged[rand()%size]^=1+rand()%255;
+		decoded[raw.size()]=0xcc;
+		LogCodec::Decompress(&damaged[0],size,&decoded[0],raw.size());
+		EXPECT_EQ(decoded[raw.size()],0xcc);
+	}
+	EXPECT_TRUE(!LogCodec::Decompress(&coded[0],size-1,&decoded[0],raw.size()));
+	EXPECT_TRUE(!LogCodec::Decompress(&coded[0],size,&decoded[0],raw.size()-1));
+}
+
+int main(int argc,char *argv[])
+{
+	srand(1);
+	RUN_TEST(TestSmallSlices);
+	RUN_TEST(TestOverlappingMatches);
+	RUN_TEST(TestOffsetLimit);
+	RUN_TEST(TestIncompressible);
+	RUN_TEST(TestCorruptedSlices);
+	return UNIT_TEST_RESULT();
+}
@@ -0,0 +1,18 @@
+#include <cstdio>
+#include "tracer/log.h"
+
+//convert a trace log of the protobuf format to the binary one
+int main(int argc,char *argv[])
+{
+	if(argc!=3) {
+		fprintf(stderr,"usage: %s <protobuf trace log> <trace log>\n",argv[0]);
+		return 1;
+	}
+	log_init(new NullMutex);
+	if(!tracer::TraceLog::ConvertProto(argv[1],argv[2])) {
+		fprintf(stderr,"failed to convert %s\n",argv[1]);
+		return 1;
+	}
+	log_fini();
+	return 0;
+}
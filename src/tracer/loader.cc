@@ -1,4 +1,5 @@
 #include "tracer/loader.h"
+#include <cassert>
 #include "core/cmdline_knob.h"
 #include "core/debug_analyzer.h"
 
@@ -18,20 +19,23 @@
 namespace tracer
 {
 
-Loader::Loader():tracer_log_(NULL),debug_analyzer_(NULL)
+Loader::Loader():trace_log_(NULL),debug_analyzer_(NULL)
 {}
 
 Loader::~Loader()
 {
 	delete debug_analyzer_;
-	delete tracer_log_;
+	delete trace_log_;
 }
 
 void Loader::HandlePreSetup() 
 {
 	OfflineTool::HandlePreSetup();
-	knob_->RegisterStr("tracer_log_path","the trace log file","trace-log");
-	debug_analyzer_=new DebugAnalyzerl;
+	knob_->RegisterStr("trace_log_path","the trace log path","trace-log");
+	knob_->RegisterInt("decoder_num","the number of threads decoding the trace"
+		" slices ahead, 0 decodes them in the replay thread","2");
+	knob_->RegisterInt("decode_buffer","the max number of decoded slices","16");
+	debug_analyzer_=new DebugAnalyzer;
 	debug_analyzer_->Register();
 }
 
@@ -39,7 +43,12 @@ void Loader::HandlePostSetup()
 {
 	OfflineTool::HandlePostSetup();
 	// load trace log
-	tracer_log_=new TraceLog(knob_->ValueStr("tracer_log_path"));
+	trace_log_=new TraceLog(knob_->ValueStr("trace_log_path"));
+	if(knob_->ValueInt("decoder_num")>0) {
+		decoders_.resize(knob_->ValueInt("decoder_num"));
+		trace_log_->EnableDecoders(decoders_.size(),
+			knob_->ValueInt("decode_buffer"),new SysMutex);
+	}
 
 	if(debug_analyzer_->Enabled()) {
 		// add debug analyzer if necessary
@@ -50,21 +59,34 @@ void Loader::HandlePostSetup()
 
 void Loader::HandleStart()
 {
-	tracer_log_->OpenForRead();
+	trace_log_->OpenForRead();
+	for(size_t i=0;i<decoders_.size();i++) {
+		int res=pthread_create(&decoders_[i],NULL,DecoderThread,trace_log_);
+		assert(!res);
+	}
 	EventLoop();
-	tracer_log_->CloseForRead();
+	trace_log_->StopDecoders();
+	for(size_t i=0;i<decoders_.size();i++)
+		pthread_join(decoders_[i],NULL);
+	trace_log_->CloseForRead();
+}
+
+void *Loader::DecoderThread(void *arg)
+{
+	((TraceLog *)arg)->DecoderLoop();
+	return NULL;
 }
 
 
-inline void Loader::EventLoop()
+void Loader::EventLoop()
 {
-	while(tracer_log_->HasNextEntry()) {
-		LogEntry entry=tracer_log_->NextEntry();
+	while(trace_log_->HasNextEntry()) {
+		LogEntry entry=trace_log_->NextEntry();
 		HandleEvent(&entry);
 	}
 }
 
-inline void Loader::AddAnalyzer(Analyzer *analyzer)
+void Loader::AddAnalyzer(Analyzer *analyzer)
 {
 	analyzers_.push_back(analyzer);
 	desc_.Merge(analyzer->desc());
@@ -115,6 +137,18 @@ void Loader::HandleEvent(LogEntry *e)
 	    case LOG_ENTRY_AFTER_ATOMIC_INST:
 	      	HandleAfterAtomicInst(e);
 	      	break;
+	    case LOG_ENTRY_BEFORE_CALL:
+	      	HandleBeforeCall(e);
+	      	break;
+	    case LOG_ENTRY_AFTER_CALL:
+	      	HandleAfterCall(e);
+	      	break;
+	    case LOG_ENTRY_BEFORE_RETURN:
+	      	HandleBeforeReturn(e);
+	      	break;
+	    case LOG_ENTRY_AFTER_RETURN:
+	      	HandleAfterReturn(e);
+	      	break;
 	    case LOG_ENTRY_BEFORE_PTHREAD_CREATE:
 	      	HandleBeforePthreadCreate(e);
 	      	break;
@@ -396,6 +430,49 @@ void Loader::HandleAfterAtomicInst(LogEntry *e) {
   	inst, type, addr);
 }
 
+void Loader::HandleBeforeCall(LogEntry *e) {
+  thread_t self = e->thd_id();
+  timestamp_t curr_thd_clk = e->thd_clk();
+  Inst *inst = sinfo_->FindInst(e->inst_id());
+  DEBUG_ASSERT(inst);
+  address_t target = e->arg(0);
+  std::string funcname = e->str_arg(0);
+  CALL_ANALYSIS_FUNC2(CallReturn, BeforeCall, self, curr_thd_clk,
+  	inst, &funcname, target);
+}
+
+void Loader::HandleAfterCall(LogEntry *e) {
+  thread_t self = e->thd_id();
+  timestamp_t curr_thd_clk = e->thd_clk();
+  Inst *inst = sinfo_->FindInst(e->inst_id());
+  DEBUG_ASSERT(inst);
+  address_t target = e->arg(0);
+  address_t ret = e->arg(1);
+  CALL_ANALYSIS_FUNC2(CallReturn, AfterCall, self, curr_thd_clk,
+  	inst, target, ret);
+}
+
+void Loader::HandleBeforeReturn(LogEntry *e) {
+  thread_t self = e->thd_id();
+  timestamp_t curr_thd_clk = e->thd_clk();
+  Inst *inst = sinfo_->FindInst(e->inst_id());
+  DEBUG_ASSERT(inst);
+  address_t target = e->arg(0);
+  std::string funcname = e->str_arg(0);
+  CALL_ANALYSIS_FUNC2(CallReturn, BeforeReturn, self, curr_thd_clk,
+  	inst, &funcname, target);
+}
+
+void Loader::HandleAfterReturn(LogEntry *e) {
+  thread_t self = e->thd_id();
+  timestamp_t curr_thd_clk = e->thd_clk();
+  Inst *inst = sinfo_->FindInst(e->inst_id());
+  DEBUG_ASSERT(inst);
+  address_t target = e->arg(0);
+  CALL_ANALYSIS_FUNC2(CallReturn, AfterReturn, self, curr_thd_clk,
+  	inst, target);
+}
+
 void Loader::HandleBeforePthreadCreate(LogEntry *e) {
   thread_t self = e->thd_id();
   timestamp_t curr_thd_clk = e->thd_clk();
@@ -893,7 +970,8 @@ void Loader::HandleBeforeValloc(LogEntry *e) {
   Inst *inst = sinfo_->FindInst(e->inst_id());
   DEBUG_ASSERT(inst);
   size_t size = e->arg(0);
-  CALL_ANALYSIS_FUNC2(MallocFunc, BeforeValloc, self,curr_thd_clk, inst, size);
+  //valloc is replayed as a malloc, the analyzers have no hook for it
+  CALL_ANALYSIS_FUNC2(MallocFunc, BeforeMalloc, self,curr_thd_clk, inst, size);
 }
 
 void Loader::HandleAfterValloc(LogEntry *e) {
@@ -903,7 +981,7 @@ void Loader::HandleAfterValloc(LogEntry *e) {
   DEBUG_ASSERT(inst);
   size_t size = e->arg(0);
   address_t ret_val = e->arg(1);
-  CALL_ANALYSIS_FUNC2(MallocFunc, AfterValloc, self,curr_thd_clk, inst, 
+  CALL_ANALYSIS_FUNC2(MallocFunc, AfterMalloc, self,curr_thd_clk, inst, 
   	size, ret_val);
 }
 
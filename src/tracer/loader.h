@@ -11,12 +11,15 @@
 #define __TRACER_LOADER_H
 
 #include <list>
+#include <vector>
+#include <pthread.h>
 #include "core/basictypes.h"
 #include "core/sync.h"
 #include "core/log.h"
 #include "core/offline_tool.h"
 #include "core/descriptor.h"
 #include "core/analyzer.h"
+#include "core/debug_analyzer.h"
 #include "tracer/log.h"
 
 namespace tracer
@@ -47,6 +50,10 @@ protected:
 	virtual void HandleAfterMemWrite(LogEntry *e);
 	virtual void HandleBeforeAtomicInst(LogEntry *e);
 	virtual void HandleAfterAtomicInst(LogEntry *e);
+	virtual void HandleBeforeCall(LogEntry *e);
+	virtual void HandleAfterCall(LogEntry *e);
+	virtual void HandleBeforeReturn(LogEntry *e);
+	virtual void HandleAfterReturn(LogEntry *e);
 	virtual void HandleBeforePthreadCreate(LogEntry *e);
 	virtual void HandleAfterPthreadCreate(LogEntry *e);
 	virtual void HandleBeforePthreadJoin(LogEntry *e);
@@ -99,8 +106,10 @@ protected:
 	void EventLoop();
 	void HandleEvent(LogEntry *e);
 	void AddAnalyzer(Analyzer *analyzer);
+	static void *DecoderThread(void *arg);
 
 	TraceLog *trace_log_;
+	std::vector<pthread_t> decoders_;
 	AnalyzerContainer analyzers_;
 	Descriptor desc_;
 	DebugAnalyzer *debug_analyzer_;
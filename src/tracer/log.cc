@@ -1,50 +1,669 @@
-#include "trace/log.h"
+#include "tracer/log.h"
+#include "tracer/codec.h"
 #include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
 #include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
-#include "core/log.h"
 
 namespace tracer
 {
 
-#define LOG_SLICE_SIZE (1024 *128)
+#define LOG_MAGIC 0x4c425452 //"RTBL"
+#define LOG_VERSION 3
+//the layout byte of a record
+#define LOG_LAYOUT_ARG_MASK 0xf
+#define LOG_LAYOUT_STR_SHIFT 4
+#define LOG_LAYOUT_STR_MASK 0x3
+#define LOG_LAYOUT_HAS_CLK 0x40
+#define LOG_LAYOUT_HAS_INST 0x80
+//a writer table slot freed by an exited thread, it can be claimed again
+#define LOG_WRITER_REMOVED ((LogWriter *)1)
 
-TraceLog::TraceLog(const std::string &path):path_(path),mode_(OP_MODE_INVALID),
-	meta_(NULL),curr_slice_(NULL),entry_cursor_(0),has_next_(false)
+std::string LogEntry::str_arg(int index)
+{
+	if(index>=0 && index<(int)rec_->str_arg_num)
+		return log_->GetString(rec_->str_args[index]);
+	return std::string();
+}
+
+void LogEntry::add_str_arg(std::string &val)
+{
+	DEBUG_ASSERT(rec_->str_arg_num<LOG_MAX_STR_ARG_NUM);
+	rec_->str_args[rec_->str_arg_num++]=log_->InternString(val,writer_);
+}
+
+void LogEntry::set_str_arg(int index,std::string &val)
+{
+	DEBUG_ASSERT(index>=0 && index<(int)rec_->str_arg_num);
+	rec_->str_args[index]=log_->InternString(val,writer_);
+}
+
+LogSlice::LogSlice():fd(-1),last(false),len(0),rec_num(0)
+{
+	buf=new uint8[LOG_SLICE_HEADER_SIZE+LOG_SLICE_SIZE];
+	out=new uint8[LOG_SLICE_HEADER_SIZE+LOG_SLICE_SIZE];
+}
+
+LogSlice::~LogSlice()
+{
+	delete [] buf;
+	delete [] out;
+}
+
+SliceWriter::SliceWriter(Mutex *lock,bool compress):lock_(lock),
+	compress_(compress),full_sem_(NULL),pending_sem_(NULL),done_sem_(NULL),
+	raw_bytes_(0),stored_bytes_(0)
+{}
+
+SliceWriter::~SliceWriter()
+{
+	for(size_t i=0;i<free_.size();i++)
+		delete free_[i];
+	delete full_sem_;
+	delete pending_sem_;
+	delete done_sem_;
+	delete lock_;
+}
+
+void SliceWriter::EnableThread(uint32 max_pending)
+{
+	full_sem_=new SysSemaphore(0);
+	pending_sem_=new SysSemaphore(max_pending>0 ? max_pending : 1);
+	done_sem_=new SysSemaphore(0);
+}
+
+//a NULL slice stops the thread, the slices before it are all written
+void SliceWriter::Loop()
+{
+	DEBUG_ASSERT(ThreadEnabled());
+	while(true) {
+		full_sem_->Wait();
+		LogSlice *slice;
+		{
+			ScopedLock lock(lock_);
+			DEBUG_ASSERT(!queue_.empty());
+			slice=queue_.front();
+			queue_.pop_front();
+		}
+		if(!slice)
+			break;
+		Write(slice);
+		Recycle(slice);
+		pending_sem_->Post();
+	}
+	done_sem_->Post();
+}
+
+//a new slice is allocated if the free list is empty, the number of the
+//queued slices is bounded by Put
+LogSlice *SliceWriter::Get()
+{
+	{
+		ScopedLock lock(lock_);
+		if(!free_.empty()) {
+			LogSlice *slice=free_.back();
+			free_.pop_back();
+			return slice;
+		}
+	}
+	return new LogSlice;
+}
+
+void SliceWriter::Put(LogSlice *slice)
+{
+	if(!ThreadEnabled()) {
+		Write(slice);
+		Recycle(slice);
+		return ;
+	}
+	pending_sem_->Wait();
+	{
+		ScopedLock lock(lock_);
+		queue_.push_back(slice);
+	}
+	full_sem_->Post();
+}
+
+void SliceWriter::Close()
+{
+	if(!ThreadEnabled())
+		return ;
+	{
+		ScopedLock lock(lock_);
+		queue_.push_back(NULL);
+	}
+	full_sem_->Post();
+	done_sem_->Wait();
+}
+
+//the payload is stored raw if packing does not make it smaller
+void SliceWriter::Write(LogSlice *slice)
+{
+	if(slice->rec_num>0) {
+		uint32 raw_size=slice->len-LOG_SLICE_HEADER_SIZE;
+		uint32 stored_size=0;
+		uint8 *buf=slice->buf;
+		if(compress_)
+			stored_size=LogCodec::Compress(slice->buf+LOG_SLICE_HEADER_SIZE,
+				raw_size,slice->out+LOG_SLICE_HEADER_SIZE,raw_size-1);
+		if(stored_size>0)
+			buf=slice->out;
+		else
+			stored_size=raw_size;
+		memcpy(buf,&stored_size,sizeof(stored_size));
+		memcpy(buf+4,&raw_size,sizeof(raw_size));
+		memcpy(buf+8,&slice->rec_num,sizeof(slice->rec_num));
+		size_t len=LOG_SLICE_HEADER_SIZE+stored_size;
+		size_t done=0;
+		while(done<len) {
+			ssize_t res=write(slice->fd,buf+done,len-done);
+			assert(res>0);
+			done+=res;
+		}
+		ATOMIC_ADD_AND_FETCH(&raw_bytes_,LOG_SLICE_HEADER_SIZE+raw_size);
+		ATOMIC_ADD_AND_FETCH(&stored_bytes_,len);
+	}
+	if(slice->last)
+		close(slice->fd);
+}
+
+void SliceWriter::Recycle(LogSlice *slice)
+{
+	slice->fd=-1;
+	slice->last=false;
+	slice->len=0;
+	slice->rec_num=0;
+	ScopedLock lock(lock_);
+	free_.push_back(slice);
+}
+
+SliceReader::SliceReader():thd_id_(INVALID_THD_ID),data_(NULL),raw_(NULL),
+	pos_(0),end_(0),last_clk_(0),last_inst_(0),last_addr_(0)
+{}
+
+SliceReader::~SliceReader()
+{
+	delete [] raw_;
+}
+
+//a raw slice is decoded in place, a packed one is unpacked first. the
+//header sizes are checked by LogStream::OpenForRead.
+bool SliceReader::Begin(const uint8 *header,thread_t thd_id)
+{
+	uint32 stored_size,raw_size;
+	memcpy(&stored_size,header,sizeof(stored_size));
+	memcpy(&raw_size,header+4,sizeof(raw_size));
+	DEBUG_ASSERT(raw_size<=LOG_SLICE_SIZE);
+	const uint8 *payload=header+LOG_SLICE_HEADER_SIZE;
+	pos_=0;
+	end_=0;
+	if(stored_size==raw_size)
+		data_=payload;
+	else {
+		if(!raw_)
+			raw_=new uint8[LOG_SLICE_SIZE];
+		if(!LogCodec::Decompress(payload,stored_size,raw_,raw_size))
+			return false;
+		data_=raw_;
+	}
+	thd_id_=thd_id;
+	pos_=0;
+	end_=raw_size;
+	last_clk_=0;
+	last_inst_=0;
+	last_addr_=0;
+	return true;
+}
+
+//a damaged record is rejected before anything is written out of bounds
+bool SliceReader::Decode(LogRecord *rec)
+{
+	if(end_-pos_<2)
+		return false;
+	rec->type=(LogEntryType)data_[pos_++];
+	uint8 layout=data_[pos_++];
+	rec->thd_id=thd_id_;
+	rec->arg_num=layout & LOG_LAYOUT_ARG_MASK;
+	rec->str_arg_num=(layout>>LOG_LAYOUT_STR_SHIFT) & LOG_LAYOUT_STR_MASK;
+	if(rec->arg_num>LOG_MAX_ARG_NUM || rec->str_arg_num>LOG_MAX_STR_ARG_NUM)
+		return false;
+	int64 delta;
+	uint64 val;
+	rec->thd_clk=0;
+	if(layout & LOG_LAYOUT_HAS_CLK) {
+		if(!GetSigned(&delta))
+			return false;
+		last_clk_+=delta;
+		rec->thd_clk=last_clk_;
+	}
+	rec->inst_id=INVALID_INST_ID;
+	if(layout & LOG_LAYOUT_HAS_INST) {
+		if(!GetSigned(&delta))
+			return false;
+		last_inst_+=delta;
+		rec->inst_id=last_inst_;
+	}
+	if(rec->arg_num>0) {
+		if(!GetSigned(&delta))
+			return false;
+		last_addr_+=delta;
+		rec->args[0]=last_addr_;
+	}
+	for(uint32 i=1;i<rec->arg_num;i++) {
+		if(!GetVarint(&val))
+			return false;
+		rec->args[i]=val;
+	}
+	for(uint32 i=0;i<rec->str_arg_num;i++) {
+		if(!GetVarint(&val))
+			return false;
+		rec->str_args[i]=(uint32)val;
+	}
+	return true;
+}
+
+bool SliceReader::GetMark(uint64 *len,uint64 *ts)
+{
+	return GetVarint(len) && GetVarint(ts);
+}
+
+//a varint runs to the end of the slice and to ten bytes at most
+inline bool SliceReader::GetVarint(uint64 *val)
+{
+	uint64 res=0;
+	for(int shift=0;shift<64 && pos_<end_;shift+=7) {
+		uint8 byte=data_[pos_++];
+		res|=(uint64)(byte & 0x7f)<<shift;
+		if(!(byte & 0x80)) {
+			*val=res;
+			return true;
+		}
+	}
+	return false;
+}
+
+LogStream::LogStream(thread_t thd_id):thd_id_(thd_id),fd_(-1),writer_(NULL),
+	slice_(NULL),buf_(NULL),buf_len_(0),slice_rec_num_(0),rec_num_(0),
+	base_(NULL),size_(0),next_slice_(0),last_clk_(0),last_inst_(0),
+	last_addr_(0)
 {}
 
+LogStream::~LogStream()
+{
+	if(slice_)
+		CloseForWrite();
+	if(base_)
+		CloseForRead();
+}
+
+bool LogStream::OpenForWrite(const std::string &file_name,SliceWriter *writer)
+{
+	fd_=open(file_name.c_str(),O_WRONLY | O_CREAT | O_TRUNC,0644);
+	if(fd_<0)
+		return false;
+	writer_=writer;
+	slice_=writer_->Get();
+	buf_=slice_->buf;
+	buf_len_=LOG_SLICE_HEADER_SIZE;
+	slice_rec_num_=0;
+	ResetDelta();
+	return true;
+}
+
+//the last slice goes out even if it is empty, it closes the file
+void LogStream::CloseForWrite()
+{
+	slice_->fd=fd_;
+	slice_->last=true;
+	slice_->len=buf_len_;
+	slice_->rec_num=slice_rec_num_;
+	writer_->Put(slice_);
+	slice_=NULL;
+	buf_=NULL;
+	fd_=-1;
+}
+
+void LogStream::Encode(LogRecord *rec)
+{
+	Reserve();
+	DEBUG_ASSERT(rec->arg_num<=LOG_MAX_ARG_NUM &&
+		rec->str_arg_num<=LOG_MAX_STR_ARG_NUM);
+	uint8 layout=rec->arg_num | (rec->str_arg_num<<LOG_LAYOUT_STR_SHIFT);
+	if(rec->thd_clk!=0)
+		layout|=LOG_LAYOUT_HAS_CLK;
+	if(rec->inst_id!=INVALID_INST_ID)
+		layout|=LOG_LAYOUT_HAS_INST;
+	buf_[buf_len_++]=(uint8)rec->type;
+	buf_[buf_len_++]=layout;
+	if(layout & LOG_LAYOUT_HAS_CLK) {
+		PutSigned((int64)(rec->thd_clk-last_clk_));
+		last_clk_=rec->thd_clk;
+	}
+	if(layout & LOG_LAYOUT_HAS_INST) {
+		PutSigned((int64)rec->inst_id-(int64)last_inst_);
+		last_inst_=rec->inst_id;
+	}
+	if(rec->arg_num>0) {
+		PutSigned((int64)(rec->args[0]-last_addr_));
+		last_addr_=rec->args[0];
+	}
+	for(uint32 i=1;i<rec->arg_num;i++)
+		PutVarint(rec->args[i]);
+	for(uint32 i=0;i<rec->str_arg_num;i++)
+		PutVarint(rec->str_args[i]);
+	slice_rec_num_++;
+	rec_num_++;
+}
+
+void LogStream::PutMark(uint64 len,uint64 ts)
+{
+	Reserve();
+	PutVarint(len);
+	PutVarint(ts);
+	slice_rec_num_++;
+	rec_num_++;
+}
+
+bool LogStream::OpenForRead(const std::string &file_name)
+{
+	int fd=open(file_name.c_str(),O_RDONLY);
+	if(fd<0)
+		return false;
+	struct stat sb;
+	if(fstat(fd,&sb)) {
+		close(fd);
+		return false;
+	}
+	size_=sb.st_size;
+	slices_.clear();
+	next_slice_=0;
+	if(size_>0) {
+		void *addr=mmap(NULL,size_,PROT_READ,MAP_PRIVATE,fd,0);
+		if(addr==MAP_FAILED) {
+			close(fd);
+			return false;
+		}
+		base_=(const uint8 *)addr;
+	}
+	close(fd);
+	//hop over the slice headers, a record or a mark takes two bytes at least
+	size_t pos=0;
+	while(pos<size_) {
+		uint32 stored_size,raw_size,rec_num;
+		if(size_-pos<LOG_SLICE_HEADER_SIZE) {
+			CloseForRead();
+			return false;
+		}
+		memcpy(&stored_size,base_+pos,sizeof(stored_size));
+		memcpy(&raw_size,base_+pos+4,sizeof(raw_size));
+		memcpy(&rec_num,base_+pos+8,sizeof(rec_num));
+		if(raw_size>LOG_SLICE_SIZE || stored_size>raw_size ||
+			rec_num>raw_size/2 ||
+			size_-pos-LOG_SLICE_HEADER_SIZE<stored_size) {
+			CloseForRead();
+			return false;
+		}
+		slices_.push_back(pos);
+		pos+=LOG_SLICE_HEADER_SIZE+stored_size;
+	}
+	return true;
+}
+
+void LogStream::CloseForRead()
+{
+	if(base_)
+		munmap((void *)base_,size_);
+	base_=NULL;
+	size_=0;
+	slices_.clear();
+}
+
+bool LogStream::HasNext()
+{
+	return reader_.HasNext() || next_slice_<slices_.size();
+}
+
+bool LogStream::Decode(LogRecord *rec)
+{
+	while(!reader_.HasNext())
+		if(!BeginSlice())
+			return false;
+	return reader_.Decode(rec);
+}
+
+bool LogStream::GetMark(uint64 *len,uint64 *ts)
+{
+	while(!reader_.HasNext())
+		if(!BeginSlice())
+			return false;
+	return reader_.GetMark(len,ts);
+}
+
+uint32 LogStream::SliceRecordNum(size_t idx)
+{
+	uint32 rec_num;
+	memcpy(&rec_num,base_+slices_[idx]+8,sizeof(rec_num));
+	return rec_num;
+}
+
+bool LogStream::DecodeSlice(size_t idx,SliceReader *reader,LogRecord *recs)
+{
+	if(!reader->Begin(base_+slices_[idx],thd_id_))
+		return false;
+	uint32 rec_num=SliceRecordNum(idx);
+	for(uint32 i=0;i<rec_num;i++)
+		if(!reader->Decode(&recs[i]))
+			return false;
+	return !reader->HasNext();
+}
+
+inline void LogStream::PutVarint(uint64 val)
+{
+	while(val>=0x80) {
+		buf_[buf_len_++]=(uint8)val | 0x80;
+		val>>=7;
+	}
+	buf_[buf_len_++]=(uint8)val;
+}
+
+inline void LogStream::Reserve()
+{
+	if(buf_len_+LOG_MAX_RECORD_SIZE>LOG_SLICE_HEADER_SIZE+LOG_SLICE_SIZE)
+		FlushSlice();
+}
+
+void LogStream::FlushSlice()
+{
+	if(slice_rec_num_==0)
+		return ;
+	slice_->fd=fd_;
+	slice_->len=buf_len_;
+	slice_->rec_num=slice_rec_num_;
+	writer_->Put(slice_);
+	slice_=writer_->Get();
+	buf_=slice_->buf;
+	buf_len_=LOG_SLICE_HEADER_SIZE;
+	slice_rec_num_=0;
+	ResetDelta();
+}
+
+bool LogStream::BeginSlice()
+{
+	if(next_slice_>=slices_.size())
+		return false;
+	return reader_.Begin(base_+slices_[next_slice_++],thd_id_);
+}
+
+LogMerger::~LogMerger()
+{
+	Close();
+}
+
+bool LogMerger::Open(const std::vector<std::string> &file_names,
+	const std::vector<thread_t> &thd_ids)
+{
+	mark_lens_.resize(file_names.size(),0);
+	for(uint32 i=0;i<file_names.size();i++) {
+		marks_.push_back(new LogStream(thd_ids[i]));
+		if(!marks_[i]->OpenForRead(file_names[i]))
+			return false;
+		Push(i);
+	}
+	return true;
+}
+
+void LogMerger::Close()
+{
+	for(size_t i=0;i<marks_.size();i++)
+		delete marks_[i];
+	marks_.clear();
+	while(!queue_.empty())
+		queue_.pop();
+	corrupted_=false;
+}
+
+bool LogMerger::NextRun(uint32 *idx,uint64 *len)
+{
+	if(queue_.empty())
+		return false;
+	*idx=queue_.top().second;
+	queue_.pop();
+	*len=mark_lens_[*idx];
+	Push(*idx);
+	return true;
+}
+
+void LogMerger::Push(uint32 idx)
+{
+	if(!marks_[idx]->HasNext())
+		return ;
+	uint64 ts;
+	if(!marks_[idx]->GetMark(&mark_lens_[idx],&ts)) {
+		corrupted_=true;
+		return ;
+	}
+	queue_.push(MergeKey(ts,idx));
+}
+
+LogWriter::LogWriter(uint32 idx,thread_t thd_id):idx(idx),stream(thd_id),
+	marks(thd_id),has_rec(false),rec_ts(0),last_ts(0),run_len(0)
+{}
+
+LogWriter::~LogWriter()
+{}
+
+TraceLog::TraceLog(const std::string &path,Mutex *lock,bool compress)
+	:path_(path),mode_(OP_MODE_INVALID),uid_(0),lock_(lock),writer_num_(0),
+	curr_ts_(0),decoder_num_(0),buffer_num_(0),decode_lock_(NULL),
+	free_sem_(NULL),ready_sem_(NULL),plan_stream_(0),plan_len_(0),
+	plan_seq_(0),plan_done_(false),take_seq_(0),next_rec_(NULL),
+	corrupted_(false),run_stream_(0),run_len_(0),rec_num_(0)
+{
+	if(!lock_)
+		lock_=new NullMutex;
+	slice_writer_=new SliceWriter(lock_->Clone(),compress);
+	for(uint32 i=0;i<LOG_WRITER_TABLE_SIZE;i++)
+		writer_table_[i]=NULL;
+}
+
+TraceLog::~TraceLog()
+{
+	for(uint32 i=0;i<LOG_WRITER_TABLE_SIZE;i++)
+		if(writer_table_[i]!=LOG_WRITER_REMOVED)
+			delete writer_table_[i];
+	for(size_t i=0;i<closed_writers_.size();i++)
+		delete closed_writers_[i];
+	for(size_t i=0;i<streams_.size();i++)
+		delete streams_[i];
+	//the decoder threads are gone
+	for(size_t i=0;i<free_decoded_.size();i++)
+		delete free_decoded_[i];
+	for(std::tr1::unordered_map<uint64,DecodedSlice *>::iterator it=
+		ready_decoded_.begin();it!=ready_decoded_.end();it++)
+		delete it->second;
+	for(size_t i=0;i<curr_decoded_.size();i++)
+		delete curr_decoded_[i];
+	delete free_sem_;
+	delete ready_sem_;
+	delete decode_lock_;
+	delete slice_writer_;
+	delete lock_;
+}
+
+void TraceLog::EnableDecoders(uint32 decoder_num,uint32 buffer_num,
+	Mutex *lock)
+{
+	DEBUG_ASSERT(mode_==OP_MODE_INVALID);
+	decoder_num_=decoder_num;
+	buffer_num_=buffer_num;
+	decode_lock_=lock;
+}
+
 void TraceLog::OpenForRead()
 {
 	//set the mode
 	mode_=OP_MODE_READ;
 	//prepare dir
 	PrepareDirForRead();
-	//read meta
-	std::stringstream meta_ss;
-	meta_ss<<path_<<"/meta";
-	std::fstream meta_in;
-	meta_in.open(meta_ss.str().c_str(),std::ios::in | std::ios::binary);
-	DEBUG_ASSERT(meta_in.is_open());
-	meta_=new LogMetaProto;
-	//deserialize
-	meta->ParseFromIstream(&meta_in);
-	meta_in.close();
-	//read the first slice
-	std::stringstream slice_ss;
-	slice_ss<<path_<<"/1";
-	std::fstream slice_in;
-	slice_in.open(slice_in.str().c_str(),std::ios::in | std::ios::binary);
-	DEBUG_ASSERT(slice_in.is_open());
-	curr_slice_=new LogSliceProto;
-	curr_slice_->ParseFromIstream(&slice_in);
-	slice_in.close();
-
-	DEBUG_ASSERT(meta->uid()==curr_slice_->uid());
-	//set the cursor
-	entry_cursor_=0;
-	if(curr_slice_->entry_size())
-		has_next_=true;
+	//read meta, which creates the streams
+	ReadMeta();
+	run_len_=0;
+	next_rec_=NULL;
+	corrupted_=false;
+	//a damaged stream leaves no entry to read
+	std::vector<std::string> marks_names;
+	for(uint32 i=0;i<streams_.size();i++) {
+		if(!streams_[i]->OpenForRead(StreamFileName(i)))
+			SetCorrupted();
+		marks_names.push_back(MarksFileName(i));
+	}
+	bool res=merger_.Open(marks_names,thd_ids_);
+	if(!res)
+		SetCorrupted();
+	if(decoder_num_==0)
+		return ;
+	//the reader holds a slice per stream at most, one more slice keeps the
+	//decoders going
+	if(buffer_num_<streams_.size()+1)
+		buffer_num_=streams_.size()+1;
+	res=plan_merger_.Open(marks_names,thd_ids_);
+	if(!res)
+		SetCorrupted();
+	plan_len_=0;
+	plan_pos_.resize(streams_.size(),0);
+	plan_end_.resize(streams_.size(),0);
+	plan_slice_.resize(streams_.size(),0);
+	plan_seq_=0;
+	plan_done_=false;
+	for(uint32 i=0;i<buffer_num_;i++)
+		free_decoded_.push_back(new DecodedSlice);
+	curr_decoded_.resize(streams_.size(),NULL);
+	curr_pos_.resize(streams_.size(),0);
+	take_seq_=0;
+	free_sem_=new SysSemaphore(buffer_num_);
+	ready_sem_=new SysSemaphore(0);
+}
+
+//the slices decoded but not read are dropped, the decoders return once
+//they see the plan is done
+void TraceLog::StopDecoders()
+{
+	if(decoder_num_==0)
+		return ;
+	{
+		ScopedLock lock(decode_lock_);
+		plan_done_=true;
+	}
+	for(uint32 i=0;i<decoder_num_;i++)
+		free_sem_->Post();
 }
 
 void TraceLog::OpenForWrite()
@@ -53,76 +672,223 @@ void TraceLog::OpenForWrite()
 	mode_=OP_MODE_WRITE;
 	//clear and create path
 	PrepareDirForWrite();
-	//create meta
-	trace_log_t uid=GenUid();
-	meta_=new LogMetaProto;
-	meta_->set_uid(uid);
-	meta_->set_slice_count(1);
-	//create the current slice
-	curr_slice_=new LogSliceProto;
-	curr_slice_->set_uid(uid);
-	curr_slice_->set_slice_no(meta_->slice_count());	
+	uid_=GenUid();
+	writer_num_=0;
+	curr_ts_=0;
+	rec_num_=0;
 }
 
 void TraceLog::CloseForRead()
 {
 	//reclaim resource
-	curr_slice_->Clear();
-	meta_->Clear();
+	merger_.Close();
+	plan_merger_.Close();
+	for(size_t i=0;i<streams_.size();i++)
+		streams_[i]->CloseForRead();
 }
 
+//the threads are done. the records after the last sync entry of a thread
+//are put into its last run, nothing orders them with the later runs of
+//the other threads.
 void TraceLog::CloseForWrite()
 {
-	//write current slice
-	std::stringstream slice_ss;
-	slice_ss<<path_<<"/"<<std::dec<<curr_slice_->slice_no();
-	std::fstream slice_out;
-	slice_out.open(slice_ss.str().c_str(),std::ios::out | std::ios::trunc |
-		std::ios::binary);
-	assert(slice_out.is_open());
-	curr_slice_->SerializeToOstream(&slice_out);
-	slice_out.close();
-	//write meta
-	std::stringstream meta_ss;
-	meta_ss<<path_<<"/meta";
-	std::fstream meta_out;
-	meta_out.open(meta_ss.str().c_str(),std::ios::out | std::ios::trunc |
-		std::ios::binary);
-	assert(meta_out.is_open());
-	meta_->SerializeToOstream(&meta_out);
-	meta_out.close();
-	//reclaim resource
-	curr_slice_->Clear();
-	meta_->Clear();
+	std::vector<LogWriter *> writers(writer_num_,(LogWriter *)NULL);
+	for(uint32 i=0;i<LOG_WRITER_TABLE_SIZE;i++) {
+		LogWriter *writer=writer_table_[i];
+		if(!writer || writer==LOG_WRITER_REMOVED)
+			continue;
+		FinishWriter(writer);
+		writers[writer->idx]=writer;
+	}
+	for(size_t i=0;i<closed_writers_.size();i++)
+		writers[closed_writers_[i]->idx]=closed_writers_[i];
+	slice_writer_->Close();
+	for(size_t i=0;i<writers.size();i++) {
+		DEBUG_ASSERT(writers[i]);
+		rec_num_+=writers[i]->stream.RecordNum();
+		thd_ids_.push_back(writers[i]->stream.thd_id());
+	}
+	WriteMeta();
+}
+
+//the thread is done, its streams are closed and its slot is freed for the
+//threads starting later. the writer is kept for the meta, without its
+//slices and string ids.
+void TraceLog::CloseWriter(thread_t thd_id)
+{
+	DEBUG_ASSERT(mode_==OP_MODE_WRITE);
+	uint32 slot=(uint32)(thd_id & (LOG_WRITER_TABLE_SIZE-1));
+	for(uint32 i=0;i<LOG_WRITER_TABLE_SIZE;i++) {
+		LogWriter *writer=writer_table_[slot];
+		if(!writer)
+			return ;
+		if(writer!=LOG_WRITER_REMOVED && writer->stream.thd_id()==thd_id) {
+			FinishWriter(writer);
+			StringIndexMap().swap(writer->strings);
+			{
+				ScopedLock lock(lock_);
+				closed_writers_.push_back(writer);
+			}
+			//the writer stays valid for the threads probing past it
+			writer_table_[slot]=LOG_WRITER_REMOVED;
+			return ;
+		}
+		slot=(slot+1) & (LOG_WRITER_TABLE_SIZE-1);
+	}
 }
 
+//the next entry is read ahead, a damaged trace ends at the damage
 bool TraceLog::HasNextEntry()
 {
 	DEBUG_ASSERT(mode_==OP_MODE_READ);
-	if(!has_next_)
-		SwitchSliceForRead();
-	return has_next_;
+	if(next_rec_)
+		return true;
+	if(corrupted_)
+		return false;
+	while(run_len_==0) {
+		if(!merger_.NextRun(&run_stream_,&run_len_)) {
+			if(merger_.corrupted())
+				SetCorrupted();
+			return false;
+		}
+	}
+	run_len_--;
+	next_rec_=ReadRecord();
+	if(!next_rec_) {
+		SetCorrupted();
+		return false;
+	}
+	return true;
 }
 
 LogEntry TraceLog::NextEntry()
 {
 	DEBUG_ASSERT(mode_==OP_MODE_READ);
-	DEBUG_ASSERT(has_next_);
-	DEBUG_ASSERT(entry_cursor_>=0 && entry_cursor_<curr_slice_->entry_size());
-	LogEntryProto *entry_proto=curr_slice_->mutable_entry(entry_cursor_++);
-	if(entry_cursor_==curr_slice_->entry_size())
-		has_next_=false;
-	return LogEntry(entry_proto);
+	DEBUG_ASSERT(next_rec_);
+	LogRecord *rec=next_rec_;
+	next_rec_=NULL;
+	return LogEntry(this,rec,NULL);
 }
 
-LogEntry TraceLog::NewEntry()
+//the record of the current run, NULL if it is damaged
+LogRecord *TraceLog::ReadRecord()
+{
+	LogRecord *rec=NULL;
+	if(decoder_num_==0) {
+		if(!streams_[run_stream_]->Decode(&curr_rec_))
+			return NULL;
+		rec=&curr_rec_;
+	}
+	else {
+		//the slices are taken in the order the plan gave them out
+		DecodedSlice *decoded=curr_decoded_[run_stream_];
+		if(!decoded || curr_pos_[run_stream_]==decoded->recs.size()) {
+			if(decoded)
+				ReleaseDecoded(decoded);
+			decoded=TakeDecoded(take_seq_++);
+			DEBUG_ASSERT(decoded->stream==run_stream_);
+			curr_decoded_[run_stream_]=decoded;
+			curr_pos_[run_stream_]=0;
+			if(decoded->corrupted)
+				return NULL;
+		}
+		rec=&decoded->recs[curr_pos_[run_stream_]++];
+	}
+	for(uint32 i=0;i<rec->str_arg_num;i++)
+		if(rec->str_args[i]>=strings_.size())
+			return NULL;
+	return rec;
+}
+
+void TraceLog::SetCorrupted()
+{
+	if(corrupted_)
+		return ;
+	corrupted_=true;
+	fprintf(stderr, "the trace log is corrupted, the replay stops.\n");
+}
+
+//a decoder takes a free slice before the next job, so the slices are
+//given out in the order of the plan
+void TraceLog::DecoderLoop()
+{
+	SliceReader reader;
+	while(true) {
+		free_sem_->Wait();
+		DecodedSlice *decoded=NULL;
+		uint32 stream,slice;
+		{
+			ScopedLock lock(decode_lock_);
+			if(NextJob(&stream,&slice)) {
+				DEBUG_ASSERT(!free_decoded_.empty());
+				decoded=free_decoded_.back();
+				free_decoded_.pop_back();
+				decoded->seq=plan_seq_++;
+				decoded->stream=stream;
+			}
+		}
+		if(!decoded) {
+			//wake up the next decoder
+			free_sem_->Post();
+			return ;
+		}
+		LogStream *log_stream=streams_[stream];
+		decoded->corrupted=true;
+		if(slice<log_stream->SliceNum()) {
+			decoded->recs.resize(log_stream->SliceRecordNum(slice));
+			decoded->corrupted=decoded->recs.empty() ||
+				!log_stream->DecodeSlice(slice,&reader,&decoded->recs[0]);
+		}
+		{
+			ScopedLock lock(decode_lock_);
+			ready_decoded_[decoded->seq]=decoded;
+		}
+		ready_sem_->Post();
+	}
+}
+
+//the entry is encoded when the thread asks for the next one, or on close
+LogEntry TraceLog::NewEntry(thread_t thd_id)
 {
 	DEBUG_ASSERT(mode_==OP_MODE_WRITE);
-	if(curr_slice_->entry_size()>=LOG_SLICE_SIZE)
-		SwitchSliceForWrite();
-	//allocate the memory for the entry
-	LogEntryProto *entry_proto=curr_slice_->add_entry();
-	return LogEntry(entry_proto);
+	LogWriter *writer=GetWriter(thd_id);
+	Commit(writer);
+	writer->rec.Clear();
+	writer->rec.thd_id=thd_id;
+	writer->has_rec=true;
+	return LogEntry(this,&writer->rec,writer);
+}
+
+//the timestamp is taken at the call, so that the entry is ordered as the
+//sync operation it records
+LogEntry TraceLog::NewSyncEntry(thread_t thd_id)
+{
+	LogEntry entry=NewEntry(thd_id);
+	entry.writer_->rec_ts=ATOMIC_ADD_AND_FETCH(&curr_ts_,1);
+	return entry;
+}
+
+//the threads look up their own ids first, the table is only locked on a
+//miss
+uint32 TraceLog::InternString(const std::string &str,LogWriter *writer)
+{
+	StringIndexMap::iterator it=writer->strings.find(str);
+	if(it!=writer->strings.end())
+		return it->second;
+	uint32 id;
+	{
+		ScopedLock lock(lock_);
+		it=string_idx_map_.find(str);
+		if(it!=string_idx_map_.end())
+			id=it->second;
+		else {
+			id=strings_.size();
+			strings_.push_back(str);
+			string_idx_map_[str]=id;
+		}
+	}
+	writer->strings[str]=id;
+	return id;
 }
 
 trace_log_t TraceLog::GenUid()
@@ -130,46 +896,219 @@ trace_log_t TraceLog::GenUid()
 	return (trace_log_t)time(NULL);
 }
 
-void TraceLog::SwitchSliceForRead()
+void TraceLog::Commit(LogWriter *writer)
 {
-	DEBUG_ASSERT(mode_==OP_MODE_READ);
-	uint32 curr_slice_no=curr_slice_->slice_no();
-	uint32 next_slice_no=curr_slice_no+1;
-	curr_slice_->Clear();
-	//check whether the slice exists
-	std::stringstream slice_ss;
-	slice_ss<<path_<<"/"<<std::dec<<next_slice_no;
-	std::fstream slice_in;
-	slice_in.open(slice_ss.str().c_str(),std::ios::in | std::ios::binary);
-	if(slice_in.is_open()) {
-		curr_slice_->ParseFromIstream(&slice_in);
-		slice_in.close();
-		DEBUG_ASSERT(curr_slice_->entry_size());
-		entry_cursor_=0;
-		has_next_=true;
-	} else
-		has_next_=false;
+	if(!writer->has_rec)
+		return ;
+	writer->stream.Encode(&writer->rec);
+	writer->run_len++;
+	//a sync entry ends the run
+	if(writer->rec_ts!=0) {
+		writer->marks.PutMark(writer->run_len,writer->rec_ts);
+		writer->last_ts=writer->rec_ts;
+		writer->run_len=0;
+		writer->rec_ts=0;
+	}
+	writer->has_rec=false;
 }
 
-void TraceLog::SwitchSliceForWrite()
+//only the thread itself inserts its id, so a thread never races with
+//another one for the same id. the whole probe chain is searched before
+//the first free slot in it is claimed, by a swap which publishes the
+//writer set up before.
+LogWriter *TraceLog::GetWriter(thread_t thd_id)
 {
-	DEBUG_ASSERT(mode_==OP_MODE_WRITE);
-	uint32 curr_slice_no=curr_slice_->slice_no();
-	uint32 next_slice_no=curr_slice_no+1;
-	//save the current slice
-	std::stringstream slice_ss;
-	slice_ss<<path_<<"/"<<std::dec<<curr_slice_no;
-	std::fstream slice_out;
-	slice_out.open(slice_ss.str().c_str(),std::ios::out | std::ios::trunc |
-		std::ios::binary);
-	assert(slice_out.is_open());
-	curr_slice_->SerializeToOstream(&slice_out);
-	slice_out.close();
-	curr_slice_->Clear();
-	//create the new slice
-	curr_slice_->set_uid(meta_->uid());
-	curr_slice_->set_slice_no(next_slice_no);
-	meta_->set_slice_count(next_slice_no);
+	LogWriter *created=NULL;
+	while(true) {
+		uint32 slot=(uint32)(thd_id & (LOG_WRITER_TABLE_SIZE-1));
+		uint32 free_slot=LOG_WRITER_TABLE_SIZE;
+		LogWriter *free_writer=NULL;
+		for(uint32 i=0;i<LOG_WRITER_TABLE_SIZE;i++) {
+			LogWriter *writer=writer_table_[slot];
+			if(!writer || writer==LOG_WRITER_REMOVED) {
+				if(free_slot==LOG_WRITER_TABLE_SIZE) {
+					free_slot=slot;
+					free_writer=writer;
+				}
+				if(!writer)
+					break;
+			}
+			else if(writer->stream.thd_id()==thd_id)
+				return writer;
+			slot=(slot+1) & (LOG_WRITER_TABLE_SIZE-1);
+		}
+		if(free_slot==LOG_WRITER_TABLE_SIZE) {
+			fprintf(stderr, "too many live threads for the trace log.\n");
+			assert(0);
+		}
+		if(!created) {
+			uint32 idx=ATOMIC_FETCH_AND_ADD(&writer_num_,1);
+			created=new LogWriter(idx,thd_id);
+			bool res=created->stream.OpenForWrite(StreamFileName(idx),
+				slice_writer_);
+			res=res && created->marks.OpenForWrite(MarksFileName(idx),
+				slice_writer_);
+			assert(res);
+		}
+		if(ATOMIC_BOOL_COMPARE_AND_SWAP(&writer_table_[free_slot],
+			free_writer,created))
+			return created;
+		//taken by another thread, search again
+	}
+}
+
+//the last run of the writer goes into the marks and its files are closed
+void TraceLog::FinishWriter(LogWriter *writer)
+{
+	Commit(writer);
+	if(writer->run_len>0)
+		writer->marks.PutMark(writer->run_len,writer->last_ts);
+	writer->run_len=0;
+	writer->stream.CloseForWrite();
+	writer->marks.CloseForWrite();
+}
+
+//the merge of the reader, on the marks only. a slice is planned when the
+//first run reaching into it is.
+bool TraceLog::NextJob(uint32 *stream,uint32 *slice)
+{
+	while(!plan_done_) {
+		if(plan_len_==0) {
+			if(!plan_merger_.NextRun(&plan_stream_,&plan_len_))
+				plan_done_=true;
+			continue;
+		}
+		uint32 idx=plan_stream_;
+		bool planned=false;
+		if(plan_pos_[idx]==plan_end_[idx]) {
+			*stream=idx;
+			//the marks run past the stream, the decoder marks the missing
+			//slice damaged and the plan stops
+			if(plan_slice_[idx]>=streams_[idx]->SliceNum()) {
+				*slice=plan_slice_[idx];
+				plan_done_=true;
+				return true;
+			}
+			*slice=plan_slice_[idx]++;
+			plan_end_[idx]+=streams_[idx]->SliceRecordNum(*slice);
+			planned=true;
+		}
+		uint64 len=plan_end_[idx]-plan_pos_[idx];
+		if(len>plan_len_)
+			len=plan_len_;
+		plan_pos_[idx]+=len;
+		plan_len_-=len;
+		if(planned)
+			return true;
+	}
+	return false;
+}
+
+DecodedSlice *TraceLog::TakeDecoded(uint64 seq)
+{
+	while(true) {
+		{
+			ScopedLock lock(decode_lock_);
+			std::tr1::unordered_map<uint64,DecodedSlice *>::iterator it=
+				ready_decoded_.find(seq);
+			if(it!=ready_decoded_.end()) {
+				DecodedSlice *decoded=it->second;
+				ready_decoded_.erase(it);
+				return decoded;
+			}
+		}
+		ready_sem_->Wait();
+	}
+}
+
+void TraceLog::ReleaseDecoded(DecodedSlice *decoded)
+{
+	{
+		ScopedLock lock(decode_lock_);
+		free_decoded_.push_back(decoded);
+	}
+	free_sem_->Post();
+}
+
+std::string TraceLog::StreamFileName(uint32 idx)
+{
+	std::stringstream ss;
+	ss<<path_<<"/stream"<<std::dec<<idx;
+	return ss.str();
+}
+
+std::string TraceLog::MarksFileName(uint32 idx)
+{
+	std::stringstream ss;
+	ss<<path_<<"/marks"<<std::dec<<idx;
+	return ss.str();
+}
+
+//the meta: magic, version, uid, the numbers of streams, strings and
+//records, then the thread of each stream and the string table
+void TraceLog::ReadMeta()
+{
+	std::string meta_name=path_+"/meta";
+	FILE *meta_in=fopen(meta_name.c_str(),"rb");
+	assert(meta_in);
+	uint32 magic=0,version=0,stream_num=0,string_num=0;
+	size_t res=fread(&magic,sizeof(magic),1,meta_in);
+	if(res!=1 || magic!=LOG_MAGIC) {
+		fprintf(stderr, "not a binary trace log, convert it first.\n");
+		assert(0);
+	}
+	res=fread(&version,sizeof(version),1,meta_in);
+	assert(res==1 && version==LOG_VERSION);
+	res=fread(&uid_,sizeof(uid_),1,meta_in);
+	res+=fread(&stream_num,sizeof(stream_num),1,meta_in);
+	res+=fread(&string_num,sizeof(string_num),1,meta_in);
+	res+=fread(&rec_num_,sizeof(rec_num_),1,meta_in);
+	assert(res==4);
+	for(uint32 i=0;i<stream_num;i++) {
+		thread_t thd_id;
+		res=fread(&thd_id,sizeof(thd_id),1,meta_in);
+		assert(res==1);
+		streams_.push_back(new LogStream(thd_id));
+		thd_ids_.push_back(thd_id);
+	}
+	for(uint32 i=0;i<string_num;i++) {
+		uint32 len;
+		res=fread(&len,sizeof(len),1,meta_in);
+		assert(res==1);
+		std::string str(len,'\0');
+		if(len>0) {
+			res=fread(&str[0],1,len,meta_in);
+			assert(res==len);
+		}
+		strings_.push_back(str);
+		string_idx_map_[str]=i;
+	}
+	fclose(meta_in);
+}
+
+void TraceLog::WriteMeta()
+{
+	std::string meta_name=path_+"/meta";
+	FILE *meta_out=fopen(meta_name.c_str(),"wb");
+	assert(meta_out);
+	uint32 magic=LOG_MAGIC,version=LOG_VERSION;
+	uint32 stream_num=thd_ids_.size(),string_num=strings_.size();
+	fwrite(&magic,sizeof(magic),1,meta_out);
+	fwrite(&version,sizeof(version),1,meta_out);
+	fwrite(&uid_,sizeof(uid_),1,meta_out);
+	fwrite(&stream_num,sizeof(stream_num),1,meta_out);
+	fwrite(&string_num,sizeof(string_num),1,meta_out);
+	fwrite(&rec_num_,sizeof(rec_num_),1,meta_out);
+	for(uint32 i=0;i<stream_num;i++) {
+		thread_t thd_id=thd_ids_[i];
+		fwrite(&thd_id,sizeof(thd_id),1,meta_out);
+	}
+	for(uint32 i=0;i<string_num;i++) {
+		uint32 len=strings_[i].size();
+		fwrite(&len,sizeof(len),1,meta_out);
+		fwrite(strings_[i].data(),1,len,meta_out);
+	}
+	fclose(meta_out);
 }
 
 void TraceLog::PrepareDirForRead()
@@ -196,4 +1135,69 @@ void TraceLog::PrepareDirForWrite()
 	assert(!res);
 }
 
-} //namespace tracer
\ No newline at end of file
+//the protobuf trace is a meta and the numbered slices of the entries
+bool TraceLog::ConvertProto(const std::string &proto_path,
+	const std::string &path)
+{
+	std::stringstream meta_ss;
+	meta_ss<<proto_path<<"/meta";
+	std::fstream meta_in;
+	meta_in.open(meta_ss.str().c_str(),std::ios::in | std::ios::binary);
+	if(!meta_in.is_open())
+		return false;
+	LogMetaProto meta;
+	bool res=meta.ParseFromIstream(&meta_in);
+	meta_in.close();
+	if(!res)
+		return false;
+	TraceLog log(path);
+	log.OpenForWrite();
+	LogSliceProto slice;
+	bool complete=true;
+	for(uint32 slice_no=1;slice_no<=meta.slice_count();slice_no++) {
+		std::stringstream slice_ss;
+		slice_ss<<proto_path<<"/"<<std::dec<<slice_no;
+		std::fstream slice_in;
+		slice_in.open(slice_ss.str().c_str(),std::ios::in | std::ios::binary);
+		if(!slice_in.is_open()) {
+			complete=false;
+			break;
+		}
+		slice.Clear();
+		res=slice.ParseFromIstream(&slice_in);
+		slice_in.close();
+		if(!res || slice.uid()!=meta.uid()) {
+			complete=false;
+			break;
+		}
+		for(int i=0;i<slice.entry_size();i++) {
+			const LogEntryProto &proto=slice.entry(i);
+			//a record holds a bounded number of arguments
+			if(proto.arg_size()>LOG_MAX_ARG_NUM ||
+				proto.str_arg_size()>LOG_MAX_STR_ARG_NUM) {
+				complete=false;
+				break;
+			}
+			//each entry is a sync one, which keeps the recorded order
+			thread_t thd_id=proto.has_thd_id() ? proto.thd_id() : INVALID_THD_ID;
+			LogEntry entry=log.NewSyncEntry(thd_id);
+			entry.set_type(proto.type());
+			if(proto.has_thd_clk())
+				entry.set_thd_clk(proto.thd_clk());
+			if(proto.has_inst_id())
+				entry.set_inst_id(proto.inst_id());
+			for(int j=0;j<proto.arg_size();j++)
+				entry.add_arg(proto.arg(j));
+			for(int j=0;j<proto.str_arg_size();j++) {
+				std::string str=proto.str_arg(j);
+				entry.add_str_arg(str);
+			}
+		}
+		if(!complete)
+			break;
+	}
+	log.CloseForWrite();
+	return complete;
+}
+
+} //namespace tracer
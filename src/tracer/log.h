@@ -1,7 +1,50 @@
 #ifndef __TRACER_LOG_H
 #define __TRACER_LOG_H
 
+/**
+ * The trace log.
+ *
+ * A trace is a directory holding one binary stream per thread, the marks
+ * of each stream and a meta file. A record of a stream is a fixed two-byte
+ * header, the entry type and the field layout, followed by varints: the
+ * clock and the instruction are deltas to the previous record of the
+ * thread, so is the first argument, which is the address for most entries.
+ * The thread is implied by the stream.
+ *
+ * Each thread writes its own stream without a lock. Only the sync entries
+ * take a global logical timestamp, an atomic increment, and each of them
+ * ends a run of the stream, which is kept in the marks as the run length
+ * and the timestamp. The reader merges the runs of all streams in the
+ * order of their timestamps, so that the accesses of a thread come right
+ * before the next sync entry of the thread. This keeps the program order
+ * and the order of the sync entries, which is a valid interleaving. The
+ * merge only depends on the trace, so each replay gives the same order.
+ *
+ * Each stream is cut into slices which reset the deltas, so that a slice
+ * is decoded on its own. The records are encoded into a slice buffer per
+ * stream. A full slice is handed to the slice writer, which packs it with
+ * LogCodec and writes it out, on a writer thread if there is one, and the
+ * stream takes an empty slice from the free list. The files are mapped for
+ * reading and each slice is unpacked into a buffer of the stream as the
+ * records are decoded.
+ *
+ * The slices can also be decoded ahead by a pool of decoder threads. The
+ * merge is replayed on the marks alone to find the order in which the
+ * slices are first needed, the decoders take the slices in that order and
+ * the reader takes the decoded slices in the same order, whatever order
+ * the decoders finish in. The decoded slices are bounded, a decoder waits
+ * until the reader is done with one.
+ *
+ * Traces of the older protobuf format can be converted by ConvertProto.
+ */
+
+#include <string>
+#include <vector>
+#include <queue>
+#include <deque>
+#include <tr1/unordered_map>
 #include "core/basictypes.h"
+#include "core/log.h"
 #include "core/static_info.h"
 #include "core/sync.h"
 #include "tracer/log.pb.h"
@@ -9,66 +52,291 @@
 namespace tracer
 {
 
-class TraceLog;
-
-class LogEntry {
-public:
-	~LogEntry();
+#define LOG_MAX_ARG_NUM 8
+#define LOG_MAX_STR_ARG_NUM 2
+//the bytes of a slice, without its header
+#define LOG_SLICE_SIZE (1024*64)
+//the stored size, the raw size and the number of records
+#define LOG_SLICE_HEADER_SIZE 12
+//two header bytes, two 64-bit and the argument varints
+#define LOG_MAX_RECORD_SIZE (2+10*(2+LOG_MAX_ARG_NUM)+5*LOG_MAX_STR_ARG_NUM)
+//the slots of the writer table, a power of two above the number of the
+//live threads
+#define LOG_WRITER_TABLE_SIZE 4096
 
-	LogEntryType type() { return proto_->type(); }
+class TraceLog;
+struct LogWriter;
 
-	thread_t thd_id() {
-		if(proto_->has_thd_id())
-			return proto_->thd_id();
-		return INVALID_THD_ID;
+//the decoded form of an entry
+struct LogRecord {
+	void Clear() {
+		type=LOG_ENTRY_INVALID;
+		thd_id=INVALID_THD_ID;
+		thd_clk=0;
+		inst_id=INVALID_INST_ID;
+		arg_num=0;
+		str_arg_num=0;
 	}
 
-	timestamp_t thd_clk() {
-		if(proto_->has_thd_clK())
-			return proto_->thd_clk();
-		return 0;
-	}
+	LogEntryType type;
+	thread_t thd_id;
+	timestamp_t thd_clk;
+	inst_t inst_id;
+	uint32 arg_num;
+	uint32 str_arg_num;
+	address_t args[LOG_MAX_ARG_NUM];
+	uint32 str_args[LOG_MAX_STR_ARG_NUM]; //the ids in the string table
+};
 
-	inst_t inst_id() {
-		if(proto_->has_inst_id())
-			return proto_->inst_id();
-		return INVALID_INST_ID;
-	}
+class LogEntry {
+public:
+	~LogEntry() {}
+
+	LogEntryType type() { return rec_->type; }
+	thread_t thd_id() { return rec_->thd_id; }
+	timestamp_t thd_clk() { return rec_->thd_clk; }
+	inst_t inst_id() { return rec_->inst_id; }
+	uint32 arg_num() { return rec_->arg_num; }
+	uint32 str_arg_num() { return rec_->str_arg_num; }
 	//return the argument address in the stack (char *)
 	address_t arg(int index) {
-		if(index>=0 && index<proto_->arg_size())
-			return proto_->arg(index);
+		if(index>=0 && index<(int)rec_->arg_num)
+			return rec_->args[index];
 		return 0;
 	}
 	//return the copy of the argument in the stack
-	std::string str_arg(int index) {
-		if(index>=0 && index<proto_->str_arg_size())
-			return proto_->str_arg(index);
-		return std::string();
-	}
+	std::string str_arg(int index);
 
-	void set_type(LogEntryType type) { proto_->set_type(type); }
-  	void set_thd_id(thread_t thd_id) { proto_->set_thd_id(thd_id); }
-  	void set_thd_clk(timestamp_t thd_clk) { proto_->set_thd_clk(thd_clk); }
-  	void set_inst_id(inst_t inst_id) { proto_->set_inst_id(inst_id); }
-  	void add_arg(address_t val) { proto_->add_arg(val); }
-  	void set_arg(int index, address_t val) { proto_->set_arg(index, val); }
-  	void add_str_arg(std::string &val) { proto_->add_str_arg(val); }
-  	void set_str_arg(int index,std::string &val) {
-  		proto_->set_str_arg(index,val);
-  	}
+	void set_type(LogEntryType type) { rec_->type=type; }
+	void set_thd_id(thread_t thd_id) { rec_->thd_id=thd_id; }
+	void set_thd_clk(timestamp_t thd_clk) { rec_->thd_clk=thd_clk; }
+	void set_inst_id(inst_t inst_id) { rec_->inst_id=inst_id; }
+	void add_arg(address_t val) {
+		DEBUG_ASSERT(rec_->arg_num<LOG_MAX_ARG_NUM);
+		rec_->args[rec_->arg_num++]=val;
+	}
+	void set_arg(int index,address_t val) {
+		DEBUG_ASSERT(index>=0 && index<(int)rec_->arg_num);
+		rec_->args[index]=val;
+	}
+	void add_str_arg(std::string &val);
+	void set_str_arg(int index,std::string &val);
 protected:
-	explicit LogEntry(LogEntryProto *proto):proto_(proto) {}
-	LogEntryProto *proto_;
+	LogEntry(TraceLog *log,LogRecord *rec,LogWriter *writer)
+		:log_(log),rec_(rec),writer_(writer) {}
+	TraceLog *log_;
+	LogRecord *rec_;
+	LogWriter *writer_; //NULL when reading
 private:
 	friend class TraceLog;
 };
 
+//a full slice on its way to the file
+struct LogSlice {
+	LogSlice();
+	~LogSlice();
+
+	int fd;
+	bool last; //close the file after the slice
+	uint8 *buf; //the header and the payload
+	size_t len;
+	uint32 rec_num;
+	uint8 *out; //the packed slice
+private:
+	DISALLOW_COPY_CONSTRUCTORS(LogSlice);
+};
+
+//writes the full slices of all the streams. without a writer thread a
+//slice is written by the thread which filled it.
+class SliceWriter {
+public:
+	//the lock guards the free list and the queue, it is owned by the writer
+	SliceWriter(Mutex *lock,bool compress);
+	~SliceWriter();
+
+	//hand the slices to a writer thread, at most max_pending of them wait
+	//in the queue, the streams block beyond that
+	void EnableThread(uint32 max_pending);
+	bool ThreadEnabled() { return full_sem_!=NULL; }
+	//the body of the writer thread, returns after Close
+	void Loop();
+	LogSlice *Get();
+	void Put(LogSlice *slice);
+	//wait until the queued slices are written
+	void Close();
+	uint64 RawBytes() { return raw_bytes_; }
+	uint64 StoredBytes() { return stored_bytes_; }
+
+private:
+	void Write(LogSlice *slice);
+	void Recycle(LogSlice *slice);
+
+	Mutex *lock_;
+	bool compress_;
+	std::vector<LogSlice *> free_;
+	std::deque<LogSlice *> queue_;
+	Semaphore *full_sem_;
+	Semaphore *pending_sem_;
+	Semaphore *done_sem_;
+	volatile uint64 raw_bytes_;
+	volatile uint64 stored_bytes_;
+	DISALLOW_COPY_CONSTRUCTORS(SliceWriter);
+};
+
+//decodes the records of one slice
+class SliceReader {
+public:
+	SliceReader();
+	~SliceReader();
+
+	//unpack the slice at the header if it is packed. the reading calls
+	//return false on a damaged slice.
+	bool Begin(const uint8 *header,thread_t thd_id);
+	bool HasNext() { return pos_<end_; }
+	bool Decode(LogRecord *rec);
+	bool GetMark(uint64 *len,uint64 *ts);
+
+private:
+	bool GetVarint(uint64 *val);
+	bool GetSigned(int64 *val) {
+		uint64 raw;
+		if(!GetVarint(&raw))
+			return false;
+		*val=(int64)(raw>>1)^-(int64)(raw&1);
+		return true;
+	}
+
+	thread_t thd_id_;
+	const uint8 *data_; //the payload of the slice
+	uint8 *raw_; //the unpacked payload
+	size_t pos_;
+	size_t end_;
+	timestamp_t last_clk_;
+	inst_t last_inst_;
+	address_t last_addr_;
+	DISALLOW_COPY_CONSTRUCTORS(SliceReader);
+};
+
+//a byte stream made of slices, either a thread stream or its marks
+class LogStream {
+public:
+	explicit LogStream(thread_t thd_id);
+	~LogStream();
+
+	thread_t thd_id() { return thd_id_; }
+	//write side, the file is closed by the writer after the last slice
+	bool OpenForWrite(const std::string &file_name,SliceWriter *writer);
+	void CloseForWrite();
+	void Encode(LogRecord *rec);
+	void PutMark(uint64 len,uint64 ts);
+	uint64 RecordNum() { return rec_num_; }
+	//read side, the file is mapped and its slices are indexed. the reading
+	//calls return false on a damaged stream.
+	bool OpenForRead(const std::string &file_name);
+	void CloseForRead();
+	bool HasNext();
+	bool Decode(LogRecord *rec);
+	bool GetMark(uint64 *len,uint64 *ts);
+	size_t SliceNum() { return slices_.size(); }
+	uint32 SliceRecordNum(size_t idx);
+	//decode a whole slice, apart from the sequential reading
+	bool DecodeSlice(size_t idx,SliceReader *reader,LogRecord *recs);
+
+private:
+	void PutVarint(uint64 val);
+	void PutSigned(int64 val) { PutVarint((uint64)((val<<1)^(val>>63))); }
+	//make room for one more record
+	void Reserve();
+	void FlushSlice();
+	void ResetDelta() { last_clk_=0; last_inst_=0; last_addr_=0; }
+	//the next slice of the sequential reading
+	bool BeginSlice();
+
+	thread_t thd_id_;
+	int fd_;
+	SliceWriter *writer_;
+	LogSlice *slice_;
+	uint8 *buf_; //the buffer of the current slice
+	size_t buf_len_;
+	uint32 slice_rec_num_;
+	uint64 rec_num_;
+	const uint8 *base_;
+	size_t size_;
+	std::vector<size_t> slices_; //the offsets of the slice headers
+	size_t next_slice_;
+	SliceReader reader_;
+	timestamp_t last_clk_;
+	inst_t last_inst_;
+	address_t last_addr_;
+
+	DISALLOW_COPY_CONSTRUCTORS(LogStream);
+};
+
+//merges the runs of the streams in the order of their timestamps. the
+//trailing run of a thread keeps the timestamp of its last sync entry, the
+//order of the streams breaks the ties.
+class LogMerger {
+public:
+	LogMerger():corrupted_(false) {}
+	~LogMerger();
+
+	bool Open(const std::vector<std::string> &file_names,
+		const std::vector<thread_t> &thd_ids);
+	void Close();
+	//the stream and the length of the next run
+	bool NextRun(uint32 *idx,uint64 *len);
+	//a damaged mark ended its stream
+	bool corrupted() { return corrupted_; }
+
+private:
+	typedef std::pair<uint64,uint32> MergeKey; //the timestamp and the stream
+	typedef std::priority_queue<MergeKey,std::vector<MergeKey>,
+		std::greater<MergeKey> > MergeQueue;
+
+	//queue the next run of the stream
+	void Push(uint32 idx);
+
+	std::vector<LogStream *> marks_;
+	std::vector<uint64> mark_lens_; //the length of the queued run
+	MergeQueue queue_;
+	bool corrupted_;
+	DISALLOW_COPY_CONSTRUCTORS(LogMerger);
+};
+
+//a slice decoded ahead of the reader
+struct DecodedSlice {
+	uint64 seq; //the order in which the slice is first needed
+	uint32 stream;
+	bool corrupted;
+	std::vector<LogRecord> recs;
+};
+
+typedef std::tr1::unordered_map<std::string,uint32> StringIndexMap;
+
+//the writing side of a thread, only touched by the thread itself
+struct LogWriter {
+	LogWriter(uint32 idx,thread_t thd_id);
+	~LogWriter();
+
+	uint32 idx;
+	LogStream stream;
+	LogStream marks;
+	LogRecord rec; //the record handed out last
+	bool has_rec;
+	uint64 rec_ts; //the timestamp of the record, 0 if it is not a sync one
+	uint64 last_ts;
+	uint64 run_len; //the records since the last mark
+	StringIndexMap strings; //the string ids known to the thread
+private:
+	DISALLOW_COPY_CONSTRUCTORS(LogWriter);
+};
+
 typedef uint64 trace_log_t;
 class TraceLog {
 public:
-	TraceLog(const std::string &path);
-	~TraceLog() {}
+	//the lock only guards the string table, it is owned by the log
+	TraceLog(const std::string &path,Mutex *lock=NULL,bool compress=true);
+	~TraceLog();
 
 	void OpenForRead();
 	void OpenForWrite();
@@ -76,31 +344,102 @@ public:
 	void CloseForWrite();
 	bool HasNextEntry();
 	LogEntry NextEntry();
-	LogEntry NewEntry();
+	//the entries of a thread are only written by the thread, a sync entry
+	//is ordered with the sync entries of all the threads
+	LogEntry NewEntry(thread_t thd_id);
+	LogEntry NewSyncEntry(thread_t thd_id);
+	//the thread writes no more entries, its files are closed
+	void CloseWriter(thread_t thd_id);
+	SliceWriter *slice_writer() { return slice_writer_; }
+	//decode the slices ahead in decoder_num threads, which run
+	//DecoderLoop. call it before OpenForRead, the lock is owned by the log.
+	void EnableDecoders(uint32 decoder_num,uint32 buffer_num,Mutex *lock);
+	//the body of a decoder thread, returns when there is no slice left
+	void DecoderLoop();
+	//make the decoders return, call it before CloseForRead
+	void StopDecoders();
+
+	uint32 InternString(const std::string &str,LogWriter *writer);
+	const std::string &GetString(uint32 id) { return strings_[id]; }
+	//convert a trace of the protobuf format
+	static bool ConvertProto(const std::string &proto_path,
+		const std::string &path);
 
 protected:
 	typedef enum {
-		OP_MODE_INVALID=0;
+		OP_MODE_INVALID=0,
 		OP_MODE_READ,
 		OP_MODE_WRITE
 	} OpMode;
-
 	trace_log_t GenUid();
-	void SwitchSliceForRead();
-	void SwitchSliceFirWrite();
+	//append the entry handed out last by the writer
+	void Commit(LogWriter *writer);
+	//find the writer of the thread, or create it
+	LogWriter *GetWriter(thread_t thd_id);
+	void FinishWriter(LogWriter *writer);
+	//the next slice to decode, by the merge on the marks
+	bool NextJob(uint32 *stream,uint32 *slice);
+	//the decoded slice of the given order, waits for the decoders
+	DecodedSlice *TakeDecoded(uint64 seq);
+	void ReleaseDecoded(DecodedSlice *decoded);
+	LogRecord *ReadRecord();
+	void SetCorrupted();
+	std::string StreamFileName(uint32 idx);
+	std::string MarksFileName(uint32 idx);
+	void ReadMeta();
+	void WriteMeta();
 	void PrepareDirForRead();
 	void PrepareDirForWrite();
 
 	std::string path_;
 	OpMode mode_;
-	LogMetaProto *meta_;
-	LogSloceProto *curr_slice_;
-	int entry_cursor_;
-	bool has_next_;
+	trace_log_t uid_;
+	Mutex *lock_;
+	SliceWriter *slice_writer_;
+	//write side, a free slot is claimed by a compare and swap. the writers
+	//of the exited threads are kept apart, under the lock.
+	LogWriter *volatile writer_table_[LOG_WRITER_TABLE_SIZE];
+	volatile uint32 writer_num_;
+	std::vector<LogWriter *> closed_writers_;
+	volatile uint64 curr_ts_;
+	//read side
+	std::vector<LogStream *> streams_;
+	std::vector<thread_t> thd_ids_;
+	LogMerger merger_;
+	//the decoders, the plan, the free and the decoded slices are guarded
+	//by the decode lock
+	uint32 decoder_num_;
+	uint32 buffer_num_;
+	Mutex *decode_lock_;
+	Semaphore *free_sem_;
+	Semaphore *ready_sem_;
+	LogMerger plan_merger_;
+	uint32 plan_stream_;
+	uint64 plan_len_;
+	std::vector<uint64> plan_pos_; //the records of each stream planned
+	std::vector<uint64> plan_end_; //the end of the last slice planned
+	std::vector<uint32> plan_slice_;
+	uint64 plan_seq_;
+	bool plan_done_;
+	std::vector<DecodedSlice *> free_decoded_;
+	std::tr1::unordered_map<uint64,DecodedSlice *> ready_decoded_;
+	//the slice each stream is read from, and the position in it
+	std::vector<DecodedSlice *> curr_decoded_;
+	std::vector<uint32> curr_pos_;
+	uint64 take_seq_;
+	std::vector<std::string> strings_;
+	StringIndexMap string_idx_map_;
+	LogRecord curr_rec_;
+	LogRecord *next_rec_; //the entry read ahead
+	bool corrupted_;
+	//the current run
+	uint32 run_stream_;
+	uint64 run_len_;
+	uint64 rec_num_;
 private:
 	DISALLOW_COPY_CONSTRUCTORS(TraceLog);
 };
 
 } //namespace tracer
 
-#endif //__TRACER_LOG_H
\ No newline at end of file
+#endif //__TRACER_LOG_H
@@ -0,0 +1,299 @@
+#include "tracer/log.h"
+#include <cstdio>
+#include <sstream>
+#include <vector>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "core/unit_test.h"
+
+using namespace tracer;
+
+#define TEST_LOG_PATH "/tmp/tracer_log_test"
+//one sync entry every that many entries of a thread
+#define SYNC_PERIOD 10
+
+static std::string LockName(uint64 i)
+{
+	std::stringstream ss;
+	ss<<"lock"<<i%5;
+	return ss.str();
+}
+
+//the entries of a thread carry the thread and their position in it, the
+//sync ones also carry their global order
+static void WriteEntry(TraceLog *log,thread_t thd_id,uint64 i,uint64 *seq)
+{
+	if(i%SYNC_PERIOD==0) {
+		LogEntry entry=log->NewSyncEntry(thd_id);
+		entry.set_type(LOG_ENTRY_AFTER_PTHREAD_MUTEX_LOCK);
+		entry.set_thd_clk(i+1);
+		entry.add_arg(0x1000+i%5);
+		entry.add_arg((*seq)++);
+		std::string name=LockName(i);
+		entry.add_str_arg(name);
+		return ;
+	}
+	LogEntry entry=log->NewEntry(thd_id);
+	entry.set_type(LOG_ENTRY_BEFORE_MEM_READ);
+	entry.set_thd_clk(i+1);
+	entry.set_inst_id(i%7);
+	//a wide address moves back and forth
+	entry.add_arg(((address_t)thd_id<<40)+(i%3)*0x100000+i*8);
+	entry.add_arg(i%2 ? 4 : 8);
+	entry.add_arg(i);
+}
+
+//the threads write by turns, so their sync entries are ordered by turns
+static void WriteTrace(bool compress,uint32 thd_num,uint64 rec_num)
+{
+	TraceLog log(TEST_LOG_PATH,NULL,compress);
+	log.OpenForWrite();
+	uint64 seq=0;
+	for(uint64 i=0;i<rec_num;i++)
+		for(thread_t t=1;t<=thd_num;t++)
+			WriteEntry(&log,t,i,&seq);
+	log.CloseForWrite();
+}
+
+static void *SliceWriterThread(void *arg)
+{
+	((TraceLog *)arg)->slice_writer()->Loop();
+	return NULL;
+}
+
+static void *DecoderThread(void *arg)
+{
+	((TraceLog *)arg)->DecoderLoop();
+	return NULL;
+}
+
+//read the trace back and check every entry, return the number read. the
+//k-th thread has the id k*stride.
+static uint64 ReadTrace(uint32 thd_num,uint64 rec_num,uint32 decoder_num,
+	thread_t stride=1)
+{
+	TraceLog log(TEST_LOG_PATH);
+	if(decoder_num)
+		log.EnableDecoders(decoder_num,4,new SysMutex);
+	log.OpenForRead();
+	std::vector<pthread_t> decoders(decoder_num);
+	for(uint32 i=0;i<decoder_num;i++)
+		pthread_create(&decoders[i],NULL,DecoderThread,&log);
+	std::vector<uint64> next(thd_num+1,0);
+	uint64 seq=0,num=0;
+	while(log.HasNextEntry()) {
+		LogEntry entry=log.NextEntry();
+		num++;
+		thread_t t=entry.thd_id()/stride;
+		if(entry.thd_id()%stride!=0 || t<1 || t>thd_num) {
+			unit_test_failures++;
+			continue;
+		}
+		uint64 i=next[t]++;
+		EXPECT_EQ(entry.thd_clk(),i+1);
+		if(i%SYNC_PERIOD==0) {
+			EXPECT_EQ(entry.type(),LOG_ENTRY_AFTER_PTHREAD_MUTEX_LOCK);
+			EXPECT_EQ(entry.arg_num(),2);
+			EXPECT_EQ(entry.arg(0),0x1000+i%5);
+			EXPECT_EQ(entry.arg(1),seq++);
+			EXPECT_EQ(entry.str_arg_num(),1);
+			EXPECT_TRUE(entry.str_arg(0)==LockName(i));
+			continue;
+		}
+		EXPECT_EQ(entry.type(),LOG_ENTRY_BEFORE_MEM_READ);
+		EXPECT_EQ(entry.inst_id(),i%7);
+		EXPECT_EQ(entry.arg_num(),3);
+		EXPECT_EQ(entry.arg(0),
+			((address_t)entry.thd_id()<<40)+(i%3)*0x100000+i*8);
+		EXPECT_EQ(entry.arg(1),i%2 ? 4 : 8);
+		EXPECT_EQ(entry.arg(2),i);
+		EXPECT_EQ(entry.str_arg_num(),0);
+	}
+	log.StopDecoders();
+	for(uint32 i=0;i<decoder_num;i++)
+		pthread_join(decoders[i],NULL);
+	log.CloseForRead();
+	//a whole trace has every entry of every thread
+	for(thread_t t=1;num==thd_num*rec_num && t<=thd_num;t++)
+		EXPECT_EQ(next[t],rec_num);
+	return num;
+}
+
+static void PatchStream(size_t off,uint8 byte,size_t len)
+{
+	int fd=open(TEST_LOG_PATH "/stream0",O_WRONLY);
+	EXPECT_TRUE(fd>=0);
+	for(size_t i=0;i<len;i++) {
+		ssize_t res=pwrite(fd,&byte,1,off+i);
+		EXPECT_EQ(res,1);
+	}
+	close(fd);
+}
+
+static size_t StreamSize()
+{
+	struct stat sb;
+	if(stat(TEST_LOG_PATH "/stream0",&sb))
+		return 0;
+	return sb.st_size;
+}
+
+static size_t OpenFdNum()
+{
+	size_t num=0;
+	DIR *dir=opendir("/proc/self/fd");
+	if(!dir)
+		return 0;
+	while(readdir(dir))
+		num++;
+	closedir(dir);
+	return num;
+}
+
+#define WRITER_THD_NUM 600
+#define WRITER_BATCH 8
+//many thread ids fall into each slot of the writer table
+#define WRITER_STRIDE (LOG_WRITER_TABLE_SIZE/WRITER_BATCH+1)
+
+struct Writer {
+	TraceLog *log;
+	SysMutex *sync_lock; //orders the global order with the timestamps
+	uint64 *seq;
+	thread_t thd_id;
+	uint64 rec_num;
+};
+
+static void *WriterThread(void *arg)
+{
+	Writer *writer=(Writer *)arg;
+	for(uint64 i=0;i<writer->rec_num;i++) {
+		if(i%SYNC_PERIOD==0) {
+			ScopedLock lock(writer->sync_lock);
+			WriteEntry(writer->log,writer->thd_id,i,writer->seq);
+		}
+		else
+			WriteEntry(writer->log,writer->thd_id,i,writer->seq);
+	}
+	writer->log->CloseWriter(writer->thd_id);
+	return NULL;
+}
+
+//short lived threads write at the same time, each one leaves no file open
+//and frees its slot for the next ones
+void TestThreadWriters()
+{
+	uint64 rec_num=500;
+	size_t fd_num=OpenFdNum();
+	for(int async=0;async<2;async++) {
+		//the writers share the string table and the free slices
+		TraceLog log(TEST_LOG_PATH,new SysMutex);
+		pthread_t slice_writer;
+		if(async) {
+			log.slice_writer()->EnableThread(4);
+			pthread_create(&slice_writer,NULL,SliceWriterThread,&log);
+		}
+		log.OpenForWrite();
+		SysMutex sync_lock;
+		uint64 seq=0;
+		for(uint32 k=1;k<=WRITER_THD_NUM;k+=WRITER_BATCH) {
+			pthread_t thds[WRITER_BATCH];
+			Writer writers[WRITER_BATCH];
+			for(uint32 j=0;j<WRITER_BATCH;j++) {
+				Writer writer={&log,&sync_lock,&seq,(k+j)*WRITER_STRIDE,
+					rec_num};
+				writers[j]=writer;
+				pthread_create(&thds[j],NULL,WriterThread,&writers[j]);
+			}
+			for(uint32 j=0;j<WRITER_BATCH;j++)
+				pthread_join(thds[j],NULL);
+		}
+		log.CloseForWrite();
+		if(async)
+			pthread_join(slice_writer,NULL);
+		EXPECT_EQ(OpenFdNum(),fd_num);
+		uint32 thd_num=(WRITER_THD_NUM+WRITER_BATCH-1)/WRITER_BATCH*
+			WRITER_BATCH;
+		EXPECT_EQ(ReadTrace(thd_num,rec_num,0,WRITER_STRIDE),
+			thd_num*rec_num);
+	}
+}
+
+//the records span many slices, packed or raw
+void TestRoundTrip()
+{
+	uint64 rec_num=20000;
+	for(int compress=0;compress<2;compress++) {
+		WriteTrace(compress,3,rec_num);
+		EXPECT_TRUE(StreamSize()>2*(LOG_SLICE_HEADER_SIZE+LOG_SLICE_SIZE) ||
+			compress);
+		EXPECT_EQ(ReadTrace(3,rec_num,0),3*rec_num);
+	}
+	//a thread without any entry after its last sync entry
+	WriteTrace(true,2,SYNC_PERIOD+1);
+	EXPECT_EQ(ReadTrace(2,SYNC_PERIOD+1,0),2*(SYNC_PERIOD+1));
+}
+
+//a damaged stream ends the trace at the damage
+void TestDamagedTrace()
+{
+	uint64 rec_num=100;
+	//more arguments than a record holds
+	WriteTrace(false,1,rec_num);
+	PatchStream(LOG_SLICE_HEADER_SIZE+1,0x0f,1);
+	EXPECT_EQ(ReadTrace(1,rec_num,0),0);
+	//a varint running to the end of the slice
+	WriteTrace(false,1,rec_num);
+	PatchStream(LOG_SLICE_HEADER_SIZE+2,0x80,StreamSize()-
+		LOG_SLICE_HEADER_SIZE-2);
+	EXPECT_EQ(ReadTrace(1,rec_num,0),0);
+	//a truncated stream
+	WriteTrace(true,1,rec_num);
+	EXPECT_EQ(truncate(TEST_LOG_PATH "/stream0",StreamSize()-3),0);
+	EXPECT_EQ(ReadTrace(1,rec_num,0),0);
+	//a damaged packed slice
+	WriteTrace(true,1,rec_num);
+	PatchStream(LOG_SLICE_HEADER_SIZE,0xff,8);
+	EXPECT_EQ(ReadTrace(1,rec_num,0),0);
+}
+
+//the decoders hand over the same entries in the same order as the reader
+//decoding by itself
+void TestDecoders()
+{
+	uint64 rec_num=20000;
+	for(int compress=0;compress<2;compress++) {
+		WriteTrace(compress,3,rec_num);
+		for(uint32 decoder_num=1;decoder_num<=4;decoder_num*=2)
+			EXPECT_EQ(ReadTrace(3,rec_num,decoder_num),3*rec_num);
+	}
+	WriteTrace(false,1,100);
+	PatchStream(LOG_SLICE_HEADER_SIZE+1,0x0f,1);
+	EXPECT_EQ(ReadTrace(1,100,4),0);
+	//the reader stops early, the decoders waiting for a free slice return
+	WriteTrace(false,3,rec_num);
+	TraceLog log(TEST_LOG_PATH);
+	log.EnableDecoders(4,2,new SysMutex);
+	log.OpenForRead();
+	pthread_t decoders[4];
+	for(uint32 i=0;i<4;i++)
+		pthread_create(&decoders[i],NULL,DecoderThread,&log);
+	for(int i=0;i<10 && log.HasNextEntry();i++)
+		log.NextEntry();
+	usleep(10000);
+	log.StopDecoders();
+	for(uint32 i=0;i<4;i++)
+		pthread_join(decoders[i],NULL);
+	log.CloseForRead();
+}
+
+int main(int argc,char *argv[])
+{
+	RUN_TEST(TestRoundTrip);
+	RUN_TEST(TestDamagedTrace);
+	RUN_TEST(TestDecoders);
+	RUN_TEST(TestThreadWriters);
+	return UNIT_TEST_RESULT();
+}
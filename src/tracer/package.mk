@@ -0,0 +1,80 @@
+# Rules for the tracer package
+
+protodefs += \
+	tracer/log.proto
+
+srcs += \
+	tracer/log.cc \
+	tracer/log.pb.cc \
+	tracer/codec.cc \
+	tracer/recorder.cc \
+	tracer/loader.cc \
+	tracer/loader_main.cc \
+	tracer/convert_main.cc \
+	tracer/slicer.cc \
+	tracer/slicer_main.cc \
+	tracer/profiler.cpp \
+	tracer/profiler_main.cpp
+
+pintools += \
+	tracer_profiler.so
+
+exes += \
+	tracer_loader \
+	tracer_convert \
+	tracer_slicer
+
+tracer_objs := \
+	tracer/log.o \
+	tracer/log.pb.o \
+	tracer/codec.o
+
+tracer_profiler_objs := \
+	tracer/recorder.o \
+	tracer/profiler.o \
+	tracer/profiler_main.o \
+	$(tracer_objs) \
+	$(core_objs)
+
+tracer_loader_objs := \
+	tracer/loader.o \
+	tracer/loader_main.o \
+	$(tracer_objs) \
+	$(core_offline_objs)
+
+tracer_convert_objs := \
+	tracer/convert_main.o \
+	$(tracer_objs) \
+	$(core_offline_objs)
+
+tracer_slicer_objs := \
+	tracer/slicer.o \
+	tracer/slicer_main.o \
+	$(tracer_objs) \
+	$(core_offline_objs)
+
+# the unit tests of the offline code, run by make test
+srcs += \
+	tracer/codec_test.cc \
+	tracer/log_test.cc \
+	tracer/slicer_test.cc
+
+tests += \
+	tracer_codec_test \
+	tracer_log_test \
+	tracer_slicer_test
+
+tracer_codec_test_objs := \
+	tracer/codec_test.o \
+	tracer/codec.o
+
+tracer_log_test_objs := \
+	tracer/log_test.o \
+	$(tracer_objs) \
+	$(core_offline_objs)
+
+tracer_slicer_test_objs := \
+	tracer/slicer_test.o \
+	tracer/slicer.o \
+	$(tracer_objs) \
+	$(core_offline_objs)
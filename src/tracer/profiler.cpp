@@ -1,4 +1,4 @@
-#include "tracer/profiler.h"
+#include "tracer/profiler.hpp"
 #include "core/log.h"
 
 namespace tracer
@@ -25,8 +25,19 @@ void Profiler::HandlePreSetup()
 void Profiler::HandlePostSetup()
 {
 	ExecutionControl::HandlePostSetup();
-	recorder_->Setup(CreateMutex());
-	AddAnalyzer(recorder_);
+	if(recorder_->Enabled()) {
+		recorder_->Setup(CreateMutex());
+		AddAnalyzer(recorder_);
+		if(recorder_->HasWriterThread() &&
+			!SpawnInternalThread(__TraceWriterThread,recorder_,0,NULL))
+			Abort("Can not spawn internal thread.\n");
+	}
+}
+
+void Profiler::__TraceWriterThread(VOID *v)
+{
+	((RecorderAnalyzer *)v)->WriterThread();
+	ExitThread(0);
 }
 
 bool Profiler::HandleIgnoreMemAccess(IMG img)
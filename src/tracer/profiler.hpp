@@ -19,7 +19,8 @@ public:
 private:
 	void HandlePreSetup();
 	void HandlePostSetup();
-	bool HandleIgnoreMemeAccess(IMG img);
+	bool HandleIgnoreMemAccess(IMG img);
+	static void __TraceWriterThread(VOID *v);
 
 	RecorderAnalyzer *recorder_;
 
@@ -18,10 +18,14 @@ void RecorderAnalyzer::Register()
 	knob_->RegisterStr("trace_log_path", "the trace log path", "trace-log");
 	knob_->RegisterBool("trace_mem", "whether record memory accesses", "1");
 	knob_->RegisterBool("trace_atomic", "whether record atomic instructions", "1");
+	knob_->RegisterBool("trace_call", "whether record function calls and returns", "1");
 	knob_->RegisterBool("trace_main", "whether record thread main functions", "1");
 	knob_->RegisterBool("trace_pthread", "whether record pthread functions", "1");
 	knob_->RegisterBool("trace_malloc", "whether record memory allocation function", "1");
 	knob_->RegisterBool("trace_track_clk", "whether track per thread clock", "1");
+	knob_->RegisterBool("trace_compress", "whether compress the trace slices", "1");
+	knob_->RegisterBool("trace_async_write", "whether write the trace slices in a writer thread", "1");
+	knob_->RegisterInt("trace_write_queue", "the max number of slices waiting for the writer thread", "64");
 }
 
 bool RecorderAnalyzer::Enabled() 
@@ -37,6 +41,8 @@ void RecorderAnalyzer::Setup(Mutex *lock)
 		desc_.SetHookBeforeMem();
 	if (knob_->ValueBool("trace_atomic"))
 		desc_.SetHookAtomicInst();
+	if (knob_->ValueBool("trace_call"))
+		desc_.SetHookCallReturn();
 	if (knob_->ValueBool("trace_main"))
 		desc_.SetHookMainFunc();
 	if (knob_->ValueBool("trace_pthread"))
@@ -47,7 +53,11 @@ void RecorderAnalyzer::Setup(Mutex *lock)
 		desc_.SetTrackInstCount();
 
 	// create trace log and open it
-	trace_log_ = new TraceLog(knob_->ValueStr("trace_log_path"));
+	trace_log_ = new TraceLog(knob_->ValueStr("trace_log_path"),
+		internal_lock_->Clone(),knob_->ValueBool("trace_compress"));
+	if (knob_->ValueBool("trace_async_write"))
+		trace_log_->slice_writer()->EnableThread(
+			knob_->ValueInt("trace_write_queue"));
 }
 
 } //namespace tracer
\ No newline at end of file
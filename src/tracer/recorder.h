@@ -8,6 +8,9 @@
 namespace tracer
 {
 
+//each thread records into its own stream of the trace log without a lock,
+//only the sync entries take a global timestamp. the accesses, the calls and
+//the thread mains are ordered by the next sync entry of their thread.
 class RecorderAnalyzer:public Analyzer {
 public:
 	RecorderAnalyzer();
@@ -16,24 +19,34 @@ public:
 	void Register();
 	bool Enabled();
 	void Setup(Mutex *lock);
+	bool HasWriterThread() {
+		return trace_log_->slice_writer()->ThreadEnabled();
+	}
+	//the body of the writer thread
+	void WriterThread() { trace_log_->slice_writer()->Loop(); }
 
 	void ProgramStart() {
-		trace_log_->PrepareDirForWrite();
-		LogEntry entry=trace_log_->NewEntry();
+		trace_log_->OpenForWrite();
+		LogEntry entry=trace_log_->NewSyncEntry(INVALID_THD_ID);
 		entry.set_type(LOG_ENTRY_PROGRAM_START);
 	}
 
 	void ProgramExit() {
-		LogEntry entry=trace_log_->NewEntry();
+		LogEntry entry=trace_log_->NewSyncEntry(INVALID_THD_ID);
 		entry.set_type(LOG_ENTRY_PROGRAM_EXIT);
 		trace_log_->CloseForWrite();
+		SliceWriter *writer=trace_log_->slice_writer();
+		INFO_FMT_PRINT("trace bytes: %lu, stored: %lu\n",
+			(unsigned long)writer->RawBytes(),
+			(unsigned long)writer->StoredBytes());
 	}
 
 	void ImageLoad(Image *image, address_t low_addr, address_t high_addr,
 		address_t data_start, size_t data_size, address_t bss_start,
 		size_t bss_size) {
+		//the images share the stream of no thread
 		ScopedLock lock(internal_lock_);
-		LogEntry entry=trace_log_->NewEntry();
+		LogEntry entry=trace_log_->NewSyncEntry(INVALID_THD_ID);
 		entry.set_type(LOG_ENTRY_IMAGE_LOAD);
 		entry.add_arg(image->id());
     	entry.add_arg(low_addr);
@@ -48,7 +61,7 @@ public:
 		address_t data_start, size_t data_size, address_t bss_start,
 		size_t bss_size) {
 		ScopedLock lock(internal_lock_);
-		LogEntry entry=trace_log_->NewEntry();
+		LogEntry entry=trace_log_->NewSyncEntry(INVALID_THD_ID);
 		entry.set_type(LOG_ENTRY_IMAGE_UNLOAD);
 		entry.add_arg(image->id());
     	entry.add_arg(low_addr);
@@ -60,43 +73,35 @@ public:
 	}
 
 	void ThreadStart(thread_t curr_thd_id, thread_t parent_thd_id) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_THREAD_START);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.add_arg(parent_thd_id);
 	}
 
 	void ThreadExit(thread_t curr_thd_id, timestamp_t curr_thd_clk) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_THREAD_EXIT);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
+	    // release the files and the slot of the thread
+	    trace_log_->CloseWriter(curr_thd_id);
 	}
 
 	void Main(thread_t curr_thd_id, timestamp_t curr_thd_clk) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_MAIN);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	}
 	 
 	void ThreadMain(thread_t curr_thd_id, timestamp_t curr_thd_clk) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_THREAD_MAIN);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	}
 
 	void BeforeMemRead(thread_t curr_thd_id, timestamp_t curr_thd_clk,
 		Inst *inst, address_t addr, size_t size) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_BEFORE_MEM_READ);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(addr);
@@ -105,10 +110,8 @@ public:
 
 	void AfterMemRead(thread_t curr_thd_id, timestamp_t curr_thd_clk,
 		Inst *inst, address_t addr, size_t size) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_AFTER_MEM_READ);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(addr);
@@ -117,10 +120,8 @@ public:
 
 	void BeforeMemWrite(thread_t curr_thd_id, timestamp_t curr_thd_clk,
 	  	Inst *inst, address_t addr, size_t size) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_BEFORE_MEM_WRITE);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(addr);
@@ -129,10 +130,8 @@ public:
 
 	void AfterMemWrite(thread_t curr_thd_id, timestamp_t curr_thd_clk,
 	  	Inst *inst, address_t addr, size_t size) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_AFTER_MEM_WRITE);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(addr);
@@ -141,10 +140,8 @@ public:
 
 	void BeforeAtomicInst(thread_t curr_thd_id, timestamp_t curr_thd_clk,
 		Inst *inst, std::string type, address_t addr) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_BEFORE_ATOMIC_INST);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(addr);
@@ -153,32 +150,65 @@ public:
 
 	void AfterAtomicInst(thread_t curr_thd_id, timestamp_t curr_thd_clk,
 	  	Inst *inst, std::string type, address_t addr) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_AFTER_ATOMIC_INST);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(addr);
 	    entry.add_str_arg(type);
 	}
 
+	void BeforeCall(thread_t curr_thd_id, timestamp_t curr_thd_clk,
+		Inst *inst, std::string *funcname, address_t target) {
+	    LogEntry entry = trace_log_->NewEntry(curr_thd_id);
+	    entry.set_type(LOG_ENTRY_BEFORE_CALL);
+	    entry.set_thd_clk(curr_thd_clk);
+	    entry.set_inst_id(inst->id());
+	    entry.add_arg(target);
+	    entry.add_str_arg(*funcname);
+	}
+
+	void AfterCall(thread_t curr_thd_id, timestamp_t curr_thd_clk,
+		Inst *inst, address_t target, address_t ret) {
+	    LogEntry entry = trace_log_->NewEntry(curr_thd_id);
+	    entry.set_type(LOG_ENTRY_AFTER_CALL);
+	    entry.set_thd_clk(curr_thd_clk);
+	    entry.set_inst_id(inst->id());
+	    entry.add_arg(target);
+	    entry.add_arg(ret);
+	}
+
+	void BeforeReturn(thread_t curr_thd_id, timestamp_t curr_thd_clk,
+		Inst *inst, std::string *funcname, address_t target) {
+	    LogEntry entry = trace_log_->NewEntry(curr_thd_id);
+	    entry.set_type(LOG_ENTRY_BEFORE_RETURN);
+	    entry.set_thd_clk(curr_thd_clk);
+	    entry.set_inst_id(inst->id());
+	    entry.add_arg(target);
+	    entry.add_str_arg(*funcname);
+	}
+
+	void AfterReturn(thread_t curr_thd_id, timestamp_t curr_thd_clk,
+		Inst *inst, address_t target) {
+	    LogEntry entry = trace_log_->NewEntry(curr_thd_id);
+	    entry.set_type(LOG_ENTRY_AFTER_RETURN);
+	    entry.set_thd_clk(curr_thd_clk);
+	    entry.set_inst_id(inst->id());
+	    entry.add_arg(target);
+	}
+
 	void BeforePthreadCreate(thread_t curr_thd_id, timestamp_t curr_thd_clk,
 	  	Inst *inst) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_BEFORE_PTHREAD_CREATE);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	}
 
 	void AfterPthreadCreate(thread_t curr_thd_id, timestamp_t curr_thd_clk,
 	  	Inst *inst, thread_t child_thd_id) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_AFTER_PTHREAD_CREATE);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(child_thd_id);
@@ -186,10 +216,8 @@ public:
 
 	void BeforePthreadJoin(thread_t curr_thd_id, timestamp_t curr_thd_clk,
 		Inst *inst, thread_t child_thd_id) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_BEFORE_PTHREAD_JOIN);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(child_thd_id);
@@ -197,10 +225,8 @@ public:
 
 	void AfterPthreadJoin(thread_t curr_thd_id, timestamp_t curr_thd_clk,
 	  	Inst *inst, thread_t child_thd_id) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_AFTER_PTHREAD_JOIN);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(child_thd_id);
@@ -208,10 +234,8 @@ public:
 
 	void BeforePthreadMutexTryLock(thread_t curr_thd_id,timestamp_t curr_thd_clk,
 		Inst *inst,address_t addr) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_BEFORE_PTHREAD_MUTEX_TRYLOCK);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(addr);
@@ -219,10 +243,8 @@ public:
 
 	void AfterPthreadMutexTryLock(thread_t curr_thd_id,timestamp_t curr_thd_clk,
 		Inst *inst,address_t addr, int ret_val) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_AFTER_PTHREAD_MUTEX_TRYLOCK);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(addr);
@@ -231,10 +253,8 @@ public:
 
 	void BeforePthreadMutexLock(thread_t curr_thd_id, timestamp_t curr_thd_clk,
 	  	Inst *inst, address_t addr) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_BEFORE_PTHREAD_MUTEX_LOCK);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(addr);
@@ -242,10 +262,8 @@ public:
 
 	void AfterPthreadMutexLock(thread_t curr_thd_id, timestamp_t curr_thd_clk,
 	  	Inst *inst, address_t addr) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_AFTER_PTHREAD_MUTEX_LOCK);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(addr);
@@ -253,10 +271,8 @@ public:
 
 	void BeforePthreadMutexUnlock(thread_t curr_thd_id,timestamp_t curr_thd_clk,
 	  	Inst *inst,address_t addr) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_BEFORE_PTHREAD_MUTEX_UNLOCK);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(addr);
@@ -264,10 +280,8 @@ public:
 
 	void AfterPthreadMutexUnlock(thread_t curr_thd_id,timestamp_t curr_thd_clk,
 		Inst *inst,address_t addr) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_AFTER_PTHREAD_MUTEX_UNLOCK);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(addr);
@@ -275,10 +289,8 @@ public:
 
 	void BeforePthreadRwlockTryRdlock(thread_t curr_thd_id,timestamp_t curr_thd_clk,
 		Inst *inst,address_t addr) {
-		ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_BEFORE_PTHREAD_RWLOCK_TRYRDLOCK);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(addr);
@@ -286,10 +298,8 @@ public:
 	
 	void AfterPthreadRwlockTryRdlock(thread_t curr_thd_id,timestamp_t curr_thd_clk,
 		Inst *inst,address_t addr,int ret_val) {
-		ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_AFTER_PTHREAD_RWLOCK_TRYRDLOCK);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(addr);
@@ -298,10 +308,8 @@ public:
 	
 	void BeforePthreadRwlockRdlock(thread_t curr_thd_id,timestamp_t curr_thd_clk,
 		Inst *inst,address_t addr) {
-		ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_BEFORE_PTHREAD_RWLOCK_RDLOCK);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(addr);
@@ -309,10 +317,8 @@ public:
 
 	void AfterPthreadRwlockRdlock(thread_t curr_thd_id,timestamp_t curr_thd_clk,
 		Inst *inst,address_t addr) {
-		ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_AFTER_PTHREAD_RWLOCK_RDLOCK);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(addr);
@@ -320,10 +326,8 @@ public:
 
 	void BeforePthreadRwlockTryWrlock(thread_t curr_thd_id,timestamp_t curr_thd_clk,
 		Inst *inst,address_t addr) {
-		ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_BEFORE_PTHREAD_RWLOCK_TRYWRLOCK);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(addr);
@@ -331,10 +335,8 @@ public:
 
 	void AfterPthreadRwlockTryWrlock(thread_t curr_thd_id,timestamp_t curr_thd_clk,
 		Inst *inst,address_t addr,int ret_val) {
-		ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_AFTER_PTHREAD_RWLOCK_TRYWRLOCK);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(addr);
@@ -343,10 +345,8 @@ public:
 
 	void BeforePthreadRwlockWrlock(thread_t curr_thd_id,timestamp_t curr_thd_clk,
 		Inst *inst,address_t addr) {
-		ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_BEFORE_PTHREAD_RWLOCK_WRLOCK);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(addr);
@@ -354,10 +354,8 @@ public:
 	
 	void AfterPthreadRwlockWrlock(thread_t curr_thd_id,timestamp_t curr_thd_clk,
 		Inst *inst,address_t addr) {
-		ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_AFTER_PTHREAD_RWLOCK_WRLOCK);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(addr);
@@ -365,10 +363,8 @@ public:
 
 	void BeforePthreadRwlockUnlock(thread_t curr_thd_id,timestamp_t curr_thd_clk,
 		Inst *inst,address_t addr) {
-		ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_BEFORE_PTHREAD_RWLOCK_UNLOCK);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(addr);
@@ -376,10 +372,8 @@ public:
 
 	void AfterPthreadRwlockUnlock(thread_t curr_thd_id,timestamp_t curr_thd_clk,
 		Inst *inst,address_t addr) {
-		ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_AFTER_PTHREAD_RWLOCK_UNLOCK);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(addr);
@@ -387,10 +381,8 @@ public:
 
 	void BeforePthreadCondSignal(thread_t curr_thd_id,timestamp_t curr_thd_clk,
 	  	Inst *inst,address_t addr) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_BEFORE_PTHREAD_COND_SIGNAL);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(addr);
@@ -398,10 +390,8 @@ public:
 
 	void AfterPthreadCondSignal(thread_t curr_thd_id, timestamp_t curr_thd_clk,
 	  	Inst *inst, address_t addr) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_AFTER_PTHREAD_COND_SIGNAL);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(addr);
@@ -409,10 +399,8 @@ public:
 
 	void BeforePthreadCondBroadcast(thread_t curr_thd_id,timestamp_t curr_thd_clk,
 	  	Inst *inst,address_t addr) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_BEFORE_PTHREAD_COND_BROADCAST);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(addr);
@@ -420,10 +408,8 @@ public:
 
 	void AfterPthreadCondBroadcast(thread_t curr_thd_id,timestamp_t curr_thd_clk,
 	  	Inst *inst,address_t addr) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_AFTER_PTHREAD_COND_BROADCAST);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(addr);
@@ -431,10 +417,8 @@ public:
 
 	void BeforePthreadCondWait(thread_t curr_thd_id,timestamp_t curr_thd_clk,
 	  	Inst *inst,address_t cond_addr, address_t mutex_addr) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_BEFORE_PTHREAD_COND_WAIT);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(cond_addr);
@@ -443,10 +427,8 @@ public:
 
 	void AfterPthreadCondWait(thread_t curr_thd_id, timestamp_t curr_thd_clk,
 	  	Inst *inst, address_t cond_addr,address_t mutex_addr) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_AFTER_PTHREAD_COND_WAIT);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(cond_addr);
@@ -455,10 +437,8 @@ public:
 
 	void BeforePthreadCondTimedwait(thread_t curr_thd_id,timestamp_t curr_thd_clk,
 	  	Inst *inst,address_t cond_addr, address_t mutex_addr) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_BEFORE_PTHREAD_COND_TIMEDWAIT);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(cond_addr);
@@ -467,10 +447,8 @@ public:
 
 	void AfterPthreadCondTimedwait(thread_t curr_thd_id,timestamp_t curr_thd_clk,
 	  	Inst *inst,address_t cond_addr, address_t mutex_addr) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_AFTER_PTHREAD_COND_TIMEDWAIT);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(cond_addr);
@@ -479,10 +457,8 @@ public:
 
 	void BeforePthreadBarrierInit(thread_t curr_thd_id,timestamp_t curr_thd_clk,
 	  	Inst *inst,address_t addr, unsigned int count) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_BEFORE_PTHREAD_BARRIER_INIT);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(addr);
@@ -491,10 +467,8 @@ public:
 
 	void AfterPthreadBarrierInit(thread_t curr_thd_id,timestamp_t curr_thd_clk,
 	  	Inst *inst,address_t addr, unsigned int count) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_AFTER_PTHREAD_BARRIER_INIT);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(addr);
@@ -503,10 +477,8 @@ public:
 
 	void BeforePthreadBarrierWait(thread_t curr_thd_id,timestamp_t curr_thd_clk,
 	  	Inst *inst,address_t addr) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_BEFORE_PTHREAD_BARRIER_WAIT);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(addr);
@@ -514,10 +486,8 @@ public:
 
 	void AfterPthreadBarrierWait(thread_t curr_thd_id,timestamp_t curr_thd_clk,
 	  	Inst *inst,address_t addr) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_AFTER_PTHREAD_BARRIER_WAIT);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(addr);
@@ -525,10 +495,8 @@ public:
 
   	void BeforeSemInit(thread_t curr_thd_id,timestamp_t curr_thd_clk,Inst *inst,
   		address_t addr,unsigned int value) {
-  		ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_BEFORE_SEM_INIT);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(addr);
@@ -537,10 +505,8 @@ public:
 
   	void AfterSemInit(thread_t curr_thd_id,timestamp_t curr_thd_clk,Inst *inst,
   		address_t addr,unsigned int value) {
-  		ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_AFTER_SEM_INIT);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(addr);
@@ -549,10 +515,8 @@ public:
 
    	void BeforeSemPost(thread_t curr_thd_id,timestamp_t curr_thd_clk,Inst *inst,
    		address_t addr) {
-   		ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_BEFORE_SEM_POST);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(addr);
@@ -560,10 +524,8 @@ public:
 
   	void AfterSemPost(thread_t curr_thd_id,timestamp_t curr_thd_clk,Inst *inst,
   		address_t addr) {
-  		ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_AFTER_SEM_POST);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(addr);
@@ -571,10 +533,8 @@ public:
   	
   	void BeforeSemWait(thread_t curr_thd_id,timestamp_t curr_thd_clk,Inst *inst,
   		address_t addr) {
-  		ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_BEFORE_SEM_WAIT);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(addr);
@@ -582,10 +542,8 @@ public:
 
   	void AfterSemWait(thread_t curr_thd_id,timestamp_t curr_thd_clk,Inst *inst,
   		address_t addr) {
-  		ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_AFTER_SEM_WAIT);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(addr);
@@ -593,10 +551,8 @@ public:
 
 	void BeforeMalloc(thread_t curr_thd_id, timestamp_t curr_thd_clk,Inst *inst,
 	  	size_t size) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_BEFORE_MALLOC);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(size);
@@ -604,10 +560,8 @@ public:
 
 	void AfterMalloc(thread_t curr_thd_id, timestamp_t curr_thd_clk,Inst *inst,
 	  	size_t size, address_t addr) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_AFTER_MALLOC);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(size);
@@ -616,10 +570,8 @@ public:
 
 	void BeforeCalloc(thread_t curr_thd_id, timestamp_t curr_thd_clk,Inst *inst,
 	  	size_t nmemb, size_t size) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_BEFORE_CALLOC);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(nmemb);
@@ -628,10 +580,8 @@ public:
 
 	void AfterCalloc(thread_t curr_thd_id, timestamp_t curr_thd_clk,Inst *inst,
 	  	size_t nmemb, size_t size, address_t addr) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_AFTER_CALLOC);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(nmemb);
@@ -641,10 +591,8 @@ public:
 
 	void BeforeRealloc(thread_t curr_thd_id, timestamp_t curr_thd_clk,
 		Inst *inst, address_t ori_addr, size_t size) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_BEFORE_REALLOC);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(ori_addr);
@@ -653,10 +601,8 @@ public:
 
 	void AfterRealloc(thread_t curr_thd_id, timestamp_t curr_thd_clk,
 	  	Inst *inst, address_t ori_addr, size_t size,address_t new_addr) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_AFTER_REALLOC);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(ori_addr);
@@ -666,10 +612,8 @@ public:
 
 	void BeforeFree(thread_t curr_thd_id, timestamp_t curr_thd_clk,
 	  	Inst *inst, address_t addr) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_BEFORE_FREE);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(addr);
@@ -677,10 +621,8 @@ public:
 
 	void AfterFree(thread_t curr_thd_id, timestamp_t curr_thd_clk,
 		Inst *inst, address_t addr) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_AFTER_FREE);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(addr);
@@ -688,10 +630,8 @@ public:
 
 	void BeforeValloc(thread_t curr_thd_id, timestamp_t curr_thd_clk,
 	  	Inst *inst, size_t size) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_BEFORE_VALLOC);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(size);
@@ -699,10 +639,8 @@ public:
 
 	void AfterValloc(thread_t curr_thd_id, timestamp_t curr_thd_clk,
 		Inst *inst, size_t size, address_t addr) {
-	    ScopedLock lock(internal_lock_);
-	    LogEntry entry = trace_log_->NewEntry();
+	    LogEntry entry = trace_log_->NewSyncEntry(curr_thd_id);
 	    entry.set_type(LOG_ENTRY_AFTER_VALLOC);
-	    entry.set_thd_id(curr_thd_id);
 	    entry.set_thd_clk(curr_thd_clk);
 	    entry.set_inst_id(inst->id());
 	    entry.add_arg(size);
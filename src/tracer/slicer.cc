@@ -0,0 +1,197 @@
+#include "tracer/slicer.h"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include "core/log.h"
+
+namespace tracer
+{
+
+Slicer::Slicer():trace_log_(NULL),slice_log_(NULL),mem_num_(0),
+	kept_mem_num_(0)
+{
+	//the static info is only read
+	read_only_=true;
+}
+
+Slicer::~Slicer()
+{
+	delete trace_log_;
+	delete slice_log_;
+}
+
+void Slicer::HandlePreSetup()
+{
+	OfflineTool::HandlePreSetup();
+	knob_->RegisterStr("trace_log_path","the trace log path","trace-log");
+	knob_->RegisterStr("slice_log_path","the sliced trace log path",
+		"trace-slice");
+	knob_->RegisterStr("slice_addrs","the address ranges whose accesses are"
+		" kept, start-end pairs separated by commas","0");
+	knob_->RegisterStr("slice_insts","the static instruction ids whose"
+		" accesses are kept, separated by commas","0");
+	knob_->RegisterStr("slice_lines","the source lines whose accesses are"
+		" kept, file:line pairs separated by commas","0");
+	knob_->RegisterStr("static_profile","the potential race statement pairs"
+		" whose accesses are kept","0");
+}
+
+void Slicer::HandlePostSetup()
+{
+	OfflineTool::HandlePostSetup();
+	if(knob_->ValueStr("slice_addrs").compare("0")!=0)
+		LoadAddrRanges(knob_->ValueStr("slice_addrs"));
+	if(knob_->ValueStr("slice_insts").compare("0")!=0)
+		LoadInsts(knob_->ValueStr("slice_insts"));
+	if(knob_->ValueStr("slice_lines").compare("0")!=0)
+		LoadLines(knob_->ValueStr("slice_lines"));
+	if(knob_->ValueStr("static_profile").compare("0")!=0)
+		LoadStaticProfile(knob_->ValueStr("static_profile"));
+	trace_log_=new TraceLog(knob_->ValueStr("trace_log_path"));
+	slice_log_=new TraceLog(knob_->ValueStr("slice_log_path"));
+}
+
+//the entries come in the merged order, so each one is recorded again the
+//way the recorder did: the thread local ones are ordered by the next sync
+//entry of their thread, which is also the one they precede in the merge
+void Slicer::HandleStart()
+{
+	trace_log_->OpenForRead();
+	slice_log_->OpenForWrite();
+	while(trace_log_->HasNextEntry()) {
+		LogEntry entry=trace_log_->NextEntry();
+		if(Selected(&entry))
+			Copy(&entry);
+	}
+	slice_log_->CloseForWrite();
+	trace_log_->CloseForRead();
+}
+
+void Slicer::HandleExit()
+{
+	OfflineTool::HandleExit();
+	INFO_FMT_PRINT("memory accesses: %lu, kept: %lu\n",
+		(unsigned long)mem_num_,(unsigned long)kept_mem_num_);
+}
+
+void Slicer::LoadAddrRanges(const std::string &ranges)
+{
+	std::vector<char> buffer(ranges.begin(),ranges.end());
+	buffer.push_back('\0');
+	for(char *range=strtok(&buffer[0],",");range;range=strtok(NULL,",")) {
+		char *end=NULL;
+		address_t start_addr=strtoul(range,&end,0);
+		DEBUG_ASSERT(end && *end=='-');
+		address_t end_addr=strtoul(end+1,NULL,0);
+		addr_ranges_.push_back(AddrRange(start_addr,end_addr));
+	}
+}
+
+void Slicer::LoadInsts(const std::string &insts)
+{
+	std::vector<char> buffer(insts.begin(),insts.end());
+	buffer.push_back('\0');
+	for(char *id=strtok(&buffer[0],",");id;id=strtok(NULL,","))
+		inst_table_[(inst_t)strtoul(id,NULL,0)]=true;
+}
+
+void Slicer::LoadLines(const std::string &lines)
+{
+	std::vector<char> buffer(lines.begin(),lines.end());
+	buffer.push_back('\0');
+	for(char *line=strtok(&buffer[0],",");line;line=strtok(NULL,",")) {
+		char *colon=strrchr(line,':');
+		DEBUG_ASSERT(colon);
+		*colon='\0';
+		lines_.insert(SrcLine(line,atoi(colon+1)));
+	}
+}
+
+void Slicer::LoadStaticProfile(const std::string &path)
+{
+	const char *delimit=" ",*fn=NULL,*l=NULL;
+	char buffer[200];
+	std::fstream in(path.c_str(),std::ios::in);
+	while(in.getline(buffer,200,'\n')) {
+		//both statements of a pair
+		for(fn=strtok(buffer,delimit);fn;fn=strtok(NULL,delimit)) {
+			l=strtok(NULL,delimit);
+			DEBUG_ASSERT(l);
+			lines_.insert(SrcLine(fn,atoi(l)));
+		}
+	}
+	in.close();
+}
+
+bool Slicer::Selected(LogEntry *e)
+{
+	switch(e->type()) {
+		case LOG_ENTRY_BEFORE_MEM_READ:
+		case LOG_ENTRY_AFTER_MEM_READ:
+		case LOG_ENTRY_BEFORE_MEM_WRITE:
+		case LOG_ENTRY_AFTER_MEM_WRITE:
+			break;
+		default:
+			return true;
+	}
+	mem_num_++;
+	address_t addr=e->arg(0);
+	size_t size=e->arg(1);
+	bool selected=SelectedInst(e->inst_id());
+	for(size_t i=0;!selected && i<addr_ranges_.size();i++)
+		selected=addr<addr_ranges_[i].second && addr+size>addr_ranges_[i].first;
+	if(selected)
+		kept_mem_num_++;
+	return selected;
+}
+
+bool Slicer::SelectedInst(inst_t inst_id)
+{
+	std::tr1::unordered_map<inst_t,bool>::iterator it=
+		inst_table_.find(inst_id);
+	if(it!=inst_table_.end())
+		return it->second;
+	bool selected=false;
+	if(!lines_.empty()) {
+		Inst *inst=sinfo_->FindInst(inst_id);
+		selected=inst && inst->HasDebugInfo() &&
+			lines_.find(SrcLine(inst->GetFileName(),inst->GetLine()))!=
+			lines_.end();
+	}
+	inst_table_[inst_id]=selected;
+	return selected;
+}
+
+void Slicer::Copy(LogEntry *e)
+{
+	bool local=false;
+	switch(e->type()) {
+		case LOG_ENTRY_MAIN:
+		case LOG_ENTRY_THREAD_MAIN:
+		case LOG_ENTRY_BEFORE_MEM_READ:
+		case LOG_ENTRY_AFTER_MEM_READ:
+		case LOG_ENTRY_BEFORE_MEM_WRITE:
+		case LOG_ENTRY_AFTER_MEM_WRITE:
+		case LOG_ENTRY_BEFORE_CALL:
+		case LOG_ENTRY_AFTER_CALL:
+		case LOG_ENTRY_BEFORE_RETURN:
+		case LOG_ENTRY_AFTER_RETURN:
+			local=true;
+			break;
+		default:
+			break;
+	}
+	LogEntry entry=local ? slice_log_->NewEntry(e->thd_id()) :
+		slice_log_->NewSyncEntry(e->thd_id());
+	entry.set_type(e->type());
+	entry.set_thd_clk(e->thd_clk());
+	entry.set_inst_id(e->inst_id());
+	for(uint32 i=0;i<e->arg_num();i++)
+		entry.add_arg(e->arg(i));
+	for(uint32 i=0;i<e->str_arg_num();i++) {
+		std::string str=e->str_arg(i);
+		entry.add_str_arg(str);
+	}
+}
+
+} // namespace tracer
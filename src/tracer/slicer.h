@@ -0,0 +1,63 @@
+/**
+	* @file tracer/slicer.h
+	* Define the trace slicer. Copy a trace log into a smaller one which keeps
+	* every event but the memory accesses, of which only the ones touching the
+	* given address ranges, static instructions or source lines are kept. The
+	* sliced trace replays the same synchronization, so a single race can be
+	* analyzed again on the accesses it involves.
+	*/
+
+#ifndef __TRACER_SLICER_H
+#define __TRACER_SLICER_H
+
+#include <set>
+#include <string>
+#include <vector>
+#include <utility>
+#include <tr1/unordered_map>
+#include "core/basictypes.h"
+#include "core/offline_tool.h"
+#include "tracer/log.h"
+
+namespace tracer
+{
+
+class Slicer:public OfflineTool {
+public:
+	Slicer();
+	~Slicer();
+
+protected:
+	typedef std::pair<address_t,address_t> AddrRange;
+	typedef std::pair<std::string,int> SrcLine;
+
+	void HandlePreSetup();
+	void HandlePostSetup();
+	void HandleStart();
+	void HandleExit();
+
+	void LoadAddrRanges(const std::string &ranges);
+	void LoadInsts(const std::string &insts);
+	void LoadLines(const std::string &lines);
+	//the potential race statement pairs, "file line file line" per line
+	void LoadStaticProfile(const std::string &path);
+	bool Selected(LogEntry *e);
+	bool SelectedInst(inst_t inst_id);
+	void Copy(LogEntry *e);
+
+	TraceLog *trace_log_;
+	TraceLog *slice_log_;
+	std::vector<AddrRange> addr_ranges_;
+	std::set<SrcLine> lines_;
+	//whether the accesses of an instruction are kept, looked up on its
+	//first access
+	std::tr1::unordered_map<inst_t,bool> inst_table_;
+	uint64 mem_num_;
+	uint64 kept_mem_num_;
+private:
+	DISALLOW_COPY_CONSTRUCTORS(Slicer);
+};
+
+} // namespace tracer
+
+#endif // __TRACER_SLICER_H
@@ -0,0 +1,13 @@
+#include "tracer/slicer.h"
+
+int main(int argc,char *argv[])
+{
+	tracer::Slicer *slicer=new tracer::Slicer;
+	slicer->Initialize();
+	slicer->PreSetup();
+	slicer->Parse(argc,argv);
+	slicer->PostSetup();
+	slicer->Start();
+	slicer->Exit();
+	delete slicer;
+}
@@ -0,0 +1,184 @@
+#include "tracer/slicer.h"
+#include <sstream>
+#include <vector>
+#include "core/unit_test.h"
+
+using namespace tracer;
+
+#define TEST_TRACE_PATH "/tmp/tracer_slicer_test_trace"
+#define TEST_SLICE_PATH "/tmp/tracer_slicer_test_slice"
+#define TEST_SINFO_PATH "/tmp/tracer_slicer_test.db"
+#define THREAD_NUM 3
+#define ENTRY_NUM 5000
+#define INST_NUM 7
+//one sync entry every that many entries of a thread
+#define SYNC_PERIOD 10
+
+//a decoded entry
+struct Entry {
+	LogEntryType type;
+	thread_t thd_id;
+	timestamp_t thd_clk;
+	inst_t inst_id;
+	std::vector<address_t> args;
+	std::vector<std::string> str_args;
+
+	bool operator==(const Entry &entry) const {
+		return type==entry.type && thd_id==entry.thd_id &&
+			thd_clk==entry.thd_clk && inst_id==entry.inst_id &&
+			args==entry.args && str_args==entry.str_args;
+	}
+};
+
+//the insts of one image, inst k is on line 10+k of a.c
+static std::vector<inst_t> WriteStaticInfo()
+{
+	StaticInfo sinfo(new NullMutex);
+	Image *image=sinfo.CreateImage("slicer_test");
+	std::vector<inst_t> insts;
+	for(int i=0;i<INST_NUM;i++) {
+		Inst *inst=sinfo.CreateInst(image,0x100+i*4);
+		inst->SetDebugInfo("a.c",10+i,0);
+		insts.push_back(inst->id());
+	}
+	sinfo.Save(TEST_SINFO_PATH);
+	return insts;
+}
+
+static address_t Addr(thread_t t,uint64 i)
+{
+	return ((address_t)t<<20)+0x1000+(i%16)*8;
+}
+
+//the threads write by turns. the sync entries lock one of a few mutexes,
+//some local entries are calls, the others access memory.
+static void WriteTrace(const std::vector<inst_t> &insts)
+{
+	TraceLog log(TEST_TRACE_PATH);
+	log.OpenForWrite();
+	uint64 seq=0;
+	for(uint64 i=0;i<ENTRY_NUM;i++) {
+		for(thread_t t=1;t<=THREAD_NUM;t++) {
+			if(i%SYNC_PERIOD==0) {
+				LogEntry entry=log.NewSyncEntry(t);
+				entry.set_type(LOG_ENTRY_AFTER_PTHREAD_MUTEX_LOCK);
+				entry.set_thd_clk(i+1);
+				entry.add_arg(0x100+i%3);
+				entry.add_arg(seq++);
+				std::stringstream ss;
+				ss<<"lock"<<i%3;
+				std::string name=ss.str();
+				entry.add_str_arg(name);
+				continue;
+			}
+			LogEntry entry=log.NewEntry(t);
+			entry.set_thd_clk(i+1);
+			entry.set_inst_id(insts[i%INST_NUM]);
+			if(i%SYNC_PERIOD==5) {
+				entry.set_type(LOG_ENTRY_BEFORE_CALL);
+				entry.add_arg(0x400000+i);
+				continue;
+			}
+			entry.set_type(i%2 ? LOG_ENTRY_BEFORE_MEM_READ :
+				LOG_ENTRY_BEFORE_MEM_WRITE);
+			entry.add_arg(Addr(t,i));
+			entry.add_arg(i%4==0 ? 16 : 8);
+		}
+	}
+	log.CloseForWrite();
+}
+
+static std::vector<Entry> ReadTrace(const char *path)
+{
+	std::vector<Entry> entries;
+	TraceLog log(path);
+	log.OpenForRead();
+	while(log.HasNextEntry()) {
+		LogEntry log_entry=log.NextEntry();
+		Entry entry;
+		entry.type=log_entry.type();
+		entry.thd_id=log_entry.thd_id();
+		entry.thd_clk=log_entry.thd_clk();
+		entry.inst_id=log_entry.inst_id();
+		for(uint32 i=0;i<log_entry.arg_num();i++)
+			entry.args.push_back(log_entry.arg(i));
+		for(uint32 i=0;i<log_entry.str_arg_num();i++)
+			entry.str_args.push_back(log_entry.str_arg(i));
+		entries.push_back(entry);
+	}
+	log.CloseForRead();
+	return entries;
+}
+
+static bool IsMemory(const Entry &entry)
+{
+	return entry.type==LOG_ENTRY_BEFORE_MEM_READ ||
+		entry.type==LOG_ENTRY_BEFORE_MEM_WRITE;
+}
+
+//the slice keeps the merged order of the trace, less the memory accesses
+//missing the address range, the inst and the line
+void TestSlice()
+{
+	std::vector<inst_t> insts=WriteStaticInfo();
+	WriteTrace(insts);
+	std::stringstream addrs,inst,line;
+	//the first two slots of the thread 1 stride, and the wide accesses
+	//reaching into them from below
+	addrs<<"--slice_addrs="<<Addr(1,0)<<"-"<<Addr(1,2);
+	inst<<"--slice_insts="<<insts[2];
+	line<<"--slice_lines=a.c:"<<10+4;
+	std::vector<std::string> args;
+	args.push_back("tracer_slicer");
+	args.push_back("--trace_log_path=" TEST_TRACE_PATH);
+	args.push_back("--slice_log_path=" TEST_SLICE_PATH);
+	args.push_back("--sinfo_in=" TEST_SINFO_PATH);
+	args.push_back("--debug_out=stderr");
+	args.push_back(addrs.str());
+	args.push_back(inst.str());
+	args.push_back(line.str());
+	std::vector<char *> argv;
+	for(size_t i=0;i<args.size();i++)
+		argv.push_back(&args[i][0]);
+	Slicer *slicer=new Slicer;
+	slicer->Initialize();
+	slicer->PreSetup();
+	slicer->Parse(argv.size(),&argv[0]);
+	slicer->PostSetup();
+	slicer->Start();
+	slicer->Exit();
+	delete slicer;
+
+	std::vector<Entry> trace=ReadTrace(TEST_TRACE_PATH);
+	EXPECT_EQ(trace.size(),THREAD_NUM*ENTRY_NUM);
+	std::vector<Entry> expected;
+	size_t by_addr=0,by_inst=0,by_line=0;
+	for(size_t i=0;i<trace.size();i++) {
+		const Entry &entry=trace[i];
+		if(IsMemory(entry)) {
+			address_t addr=entry.args[0];
+			bool in_range=addr<Addr(1,2) && addr+entry.args[1]>Addr(1,0);
+			bool kept=in_range || entry.inst_id==insts[2] ||
+				entry.inst_id==insts[4];
+			if(!kept)
+				continue;
+			by_addr+=in_range;
+			by_inst+=entry.inst_id==insts[2];
+			by_line+=entry.inst_id==insts[4];
+		}
+		expected.push_back(entry);
+	}
+	//each rule keeps some accesses, and some are dropped
+	EXPECT_TRUE(by_addr>0 && by_inst>0 && by_line>0);
+	EXPECT_TRUE(expected.size()<trace.size());
+	std::vector<Entry> slice=ReadTrace(TEST_SLICE_PATH);
+	EXPECT_EQ(slice.size(),expected.size());
+	for(size_t i=0;i<slice.size() && i<expected.size();i++)
+		EXPECT_TRUE(slice[i]==expected[i]);
+}
+
+int main(int argc,char *argv[])
+{
+	RUN_TEST(TestSlice);
+	return UNIT_TEST_RESULT();
+}